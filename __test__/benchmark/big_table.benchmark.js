@@ -2,6 +2,7 @@
 const { get_big_table_service } = require('./services/big_table')
 const { benchmark_args } = require('./utils')
 const { updateResult } = require('./utils/update_readme')
+const bench = require('../../build/Release/peek-orm-bench.node')
 
 const iterations = 1000
 
@@ -17,6 +18,27 @@ async function big_table_benchmark_test() {
     Time: get_big_table.toFixed(6),
   })
 
+  /** Round trip per row: network, server and decoding, not the row builder alone */
+  const fetched = await get_big_table_service()
+  const rows = fetched.length
+  if (rows > 0) {
+    results.push({
+      Method: 'Get Big Table round trip (per row)',
+      Time: (get_big_table / rows).toFixed(6),
+    })
+    results.push({
+      Method: 'Get Big Table round trip (per 1000 rows)',
+      Time: ((get_big_table / rows) * 1000).toFixed(6),
+    })
+
+    /** Row construction alone: `result_to_js` on as many synthetic rows and columns, no database involved */
+    const { toJsNsPerRow } = bench.decode({ rows, columns: Object.keys(fetched[0]).length, iterations: 100 })
+    results.push({
+      Method: 'Build rows (per 1000 rows)',
+      Time: ((toJsNsPerRow * 1000) / 1e6).toFixed(6),
+    })
+  }
+
   await updateResult(results, './results/big_table.md', 'Big Table Benchmark for 1000 rows with 1000 iterations')
 }
 
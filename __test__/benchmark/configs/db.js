@@ -1,5 +1,8 @@
 // @ts-check
-const config = require('../config.json')
+
+/** `PEEK_DRIVER=fake` runs the benchmarks against the in-process fake driver, no database needed */
+const fake = process.env.PEEK_DRIVER === 'fake'
+const config = fake ? { mysql: { host: 'fake', user: 'fake', password: '', database: 'fake' } } : require('../config.json')
 
 module.exports = {
   connectParams: {
@@ -8,5 +11,6 @@ module.exports = {
     password: config.mysql.password,
     database: config.mysql.database,
     port: config.mysql.port || 3306,
+    ...(fake && { pool: { driver: 'fake', fakeDriver: { columns: 10, rows: 1000, latencyUs: 200 } } }),
   },
 }
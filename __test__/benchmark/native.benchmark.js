@@ -0,0 +1,103 @@
+// @ts-check
+const fs = require('fs')
+const os = require('os')
+const path = require('path')
+const { execSync } = require('child_process')
+
+/**
+ * Native micro-benchmarks of the C layer, no database needed
+ * - Runs the `peek-orm-bench` addon built next to `peek-orm` by `npm run build:gyp`
+ * - Writes `results/native.json` and prints the change against the previous run
+ * @example
+ * node native.benchmark                 # full run
+ * node native.benchmark --quick         # fewer iterations
+ */
+const bench = require('../../build/Release/peek-orm-bench.node')
+
+const resultPath = path.join(__dirname, 'results', 'native.json')
+const quick = process.argv.includes('--quick')
+const scale = quick ? 0.1 : 1
+
+/** Iterations scaled down by `--quick`, at least 1 */
+function iterations(count) {
+  return Math.max(1, Math.round(count * scale))
+}
+
+/** Current commit, when run inside the repository */
+function commit() {
+  try {
+    return execSync('git rev-parse --short HEAD', { stdio: ['ignore', 'pipe', 'ignore'] })
+      .toString()
+      .trim()
+  } catch {
+    return null
+  }
+}
+
+function run() {
+  /** @type {{ name: string, params: Record<string, number>, metrics: Record<string, number> }[]} */
+  const results = []
+
+  for (const rows of [100, 10000]) {
+    for (const columns of [5, 20]) {
+      const { decodeNsPerRow, toJsNsPerRow, bytesPerRow } = bench.decode({
+        rows,
+        columns,
+        iterations: iterations(rows >= 10000 ? 50 : 2000),
+      })
+      results.push({ name: 'decode', params: { rows, columns }, metrics: { decodeNsPerRow, toJsNsPerRow, bytesPerRow } })
+    }
+  }
+
+  for (const threads of [1, 2, 4, 8, 16, 32, 64]) {
+    const { opsPerSec, nsPerOp } = bench.pool({ threads, poolSize: 10, iterations: iterations(200000) })
+    results.push({ name: 'pool', params: { threads, poolSize: 10 }, metrics: { opsPerSec, nsPerOp } })
+  }
+
+  for (const params of [4, 32]) {
+    const { nsPerStatement, bytes } = bench.sql({ params, iterations: iterations(200000) })
+    results.push({ name: 'sql', params: { params }, metrics: { nsPerStatement, bytes } })
+  }
+
+  return results
+}
+
+/** Key identifying a benchmark across runs */
+function key(result) {
+  return `${result.name} ${Object.entries(result.params)
+    .map(([name, value]) => `${name}=${value}`)
+    .join(' ')}`
+}
+
+;(function main() {
+  const previous = fs.existsSync(resultPath) ? JSON.parse(fs.readFileSync(resultPath, 'utf8')) : null
+  const previousResults = new Map((previous?.results ?? []).map((result) => [key(result), result]))
+
+  const results = run()
+
+  const table = results.map((result) => {
+    const before = previousResults.get(key(result))
+    const row = { Benchmark: key(result) }
+    for (const [metric, value] of Object.entries(result.metrics)) {
+      const old = before?.metrics?.[metric]
+      const change = old ? ` (${value >= old ? '+' : ''}${(((value - old) / old) * 100).toFixed(1)}%)` : ''
+      row[metric] = `${value.toFixed(value >= 100 ? 0 : 2)}${change}`
+    }
+    return row
+  })
+  console.table(table)
+
+  const report = {
+    date: new Date().toISOString(),
+    commit: commit(),
+    node: process.version,
+    platform: `${os.platform()} ${os.arch()}`,
+    cpu: os.cpus()[0]?.model ?? 'unknown',
+    cpus: os.cpus().length,
+    quick,
+    results,
+  }
+  fs.mkdirSync(path.dirname(resultPath), { recursive: true })
+  fs.writeFileSync(resultPath, JSON.stringify(report, null, 2) + '\n')
+  console.log(`Results written to ${path.relative(process.cwd(), resultPath)}`)
+})()
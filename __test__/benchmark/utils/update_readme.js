@@ -23,6 +23,12 @@ const prettier = require('prettier')
 async function updateResult(results = [], readmePath, topic = 'Benchmark') {
   console.table(results)
 
+  // Fake driver runs measure the ORM alone, keep them apart from the database results
+  if (process.env.PEEK_DRIVER === 'fake') {
+    readmePath = readmePath.replace(/\.md$/, '.fake.md')
+    topic = `${topic} (fake driver)`
+  }
+
   try {
     const directory = path.dirname(readmePath)
     await fs.mkdir(directory, { recursive: true }) // Create the directory if it doesn't exist
@@ -0,0 +1,19 @@
+// @ts-check
+
+/**
+ * Connection pool hand-offs, on the fake driver of the `peek-orm-bench` addon built by `npm run build:gyp`
+ */
+const bench = require('../../build/Release/peek-orm-bench.node')
+
+describe('connection pool', () => {
+  test('hands returned connections to queued waiters', () => {
+    const { failures } = bench.pool({ threads: 8, poolSize: 2, iterations: 2000, acquireTimeout: 2000 })
+    expect(failures).toBe(0)
+  })
+
+  test('hands a discarded connection slot to a queued waiter', () => {
+    // Every checkout closes its connection: the waiters are only served by the emptied slots
+    const { failures } = bench.pool({ threads: 4, poolSize: 1, iterations: 500, discard: 1, acquireTimeout: 2000 })
+    expect(failures).toBe(0)
+  })
+})
@@ -5,8 +5,30 @@
       "sources": [
         "src/orm/index.c",
         "src/orm/mysql_functions.c",
+        "src/orm/libraries/mysql_advisor.c",
+        "src/orm/libraries/mysql_arena.c",
+        "src/orm/libraries/mysql_async.c",
+        "src/orm/libraries/mysql_batch.c",
+        "src/orm/libraries/mysql_bulk.c",
+        "src/orm/libraries/mysql_driver.c",
+        "src/orm/libraries/mysql_evloop.c",
+        "src/orm/libraries/mysql_fake_driver.c",
+        "src/orm/libraries/mysql_infile.c",
         "src/orm/libraries/mysql_lib.c",
-        "src/orm/libraries/mysql_pool.c"
+        "src/orm/libraries/mysql_metrics.c",
+        "src/orm/libraries/mysql_params.c",
+        "src/orm/libraries/mysql_pool.c",
+        "src/orm/libraries/mysql_result.c",
+        "src/orm/libraries/mysql_result_cache.c",
+        "src/orm/libraries/mysql_router.c",
+        "src/orm/libraries/mysql_schema.c",
+        "src/orm/libraries/mysql_shard.c",
+        "src/orm/libraries/mysql_shared.c",
+        "src/orm/libraries/mysql_sql.c",
+        "src/orm/libraries/mysql_stmt_cache.c",
+        "src/orm/libraries/mysql_stream.c",
+        "src/orm/libraries/mysql_transaction.c",
+        "src/orm/libraries/mysql_util.c"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
@@ -20,6 +42,29 @@
       "xcode_settings": {
         "GCC_ENABLE_CPP_EXCEPTIONS": "YES"
       }
+    },
+    {
+      "target_name": "peek-orm-bench",
+      "sources": [
+        "src/orm/bench/index.c",
+        "src/orm/bench/bench_decode.c",
+        "src/orm/bench/bench_pool.c",
+        "src/orm/bench/bench_sql.c",
+        "src/orm/libraries/mysql_arena.c",
+        "src/orm/libraries/mysql_fake_driver.c",
+        "src/orm/libraries/mysql_infile.c",
+        "src/orm/libraries/mysql_metrics.c",
+        "src/orm/libraries/mysql_params.c",
+        "src/orm/libraries/mysql_pool.c",
+        "src/orm/libraries/mysql_result.c",
+        "src/orm/libraries/mysql_sql.c",
+        "src/orm/libraries/mysql_stmt_cache.c",
+        "src/orm/libraries/mysql_util.c"
+      ],
+      "include_dirs": [
+        "<!@(node -p \"require('node-addon-api').include\")",
+        "/usr/local/mysql-8.2.0-macos13-arm64/include",
+      ]
     }
   ]
 }
\ No newline at end of file
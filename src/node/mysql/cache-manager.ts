@@ -12,6 +12,7 @@ import { logger } from '../utils/logger'
 export class CacheManager {
   private readonly cacheFolderPath: string = '.peek-cache'
   private readonly schemaCacheFile: string = join(this.cacheFolderPath, 'schema-caches.json')
+  private readonly schemaHashFile: string = join(this.cacheFolderPath, 'schema-hashes.json')
 
   constructor() {
     if (!fs.existsSync(this.cacheFolderPath)) {
@@ -48,6 +49,39 @@ export class CacheManager {
     }
   }
 
+  /**
+   * Read the hashes of the tables last synced to a database
+   * @param target - Database, as `user@host:port/database`
+   * @returns {Record<string, string>} Hash by table name
+   */
+  readSchemaHashes(target: string): Record<string, string> {
+    try {
+      if (fs.existsSync(this.schemaHashFile)) {
+        return JSON.parse(fs.readFileSync(this.schemaHashFile, 'utf-8'))[target] ?? {}
+      }
+    } catch (error) {
+      logger.error('Failed to read schema hash file:', error)
+    }
+    return {}
+  }
+
+  /**
+   * Write the hashes of the tables synced to a database, keeping those of other databases
+   * @param target - Database, as `user@host:port/database`
+   * @param hashes - Hash by table name
+   */
+  writeSchemaHashes(target: string, hashes: Record<string, string>): void {
+    try {
+      const hashData = fs.existsSync(this.schemaHashFile)
+        ? JSON.parse(fs.readFileSync(this.schemaHashFile, 'utf-8'))
+        : {}
+      hashData[target] = hashes
+      fs.writeFileSync(this.schemaHashFile, JSON.stringify(hashData, null, 2))
+    } catch (error) {
+      logger.error('Failed to write schema hash file:', error)
+    }
+  }
+
   /**
    * Clear cache
    */
@@ -56,6 +90,9 @@ export class CacheManager {
       if (fs.existsSync(this.schemaCacheFile)) {
         fs.unlinkSync(this.schemaCacheFile)
       }
+      if (fs.existsSync(this.schemaHashFile)) {
+        fs.unlinkSync(this.schemaHashFile)
+      }
       if (fs.existsSync(this.cacheFolderPath) && fs.readdirSync(this.cacheFolderPath).length === 0) {
         fs.rmdirSync(this.cacheFolderPath)
       }
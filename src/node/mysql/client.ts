@@ -1,15 +1,18 @@
+import { createHash } from 'crypto'
 import fs, { readdirSync } from 'fs'
 import { join, resolve } from 'path'
 import {
   cleanup as cleanupFn,
   closeMySQL,
-  createIndex,
-  createTable,
+  declareIndexes,
+  declareShardKeys,
   initialize,
+  syncSchema,
 } from '../../build/Release/peek-orm.node'
-import { ConnectParams, CreateTableParams } from '../types/mysql-types'
+import { ConnectParams, CreateTableParams, SchemaSyncTable } from '../types/mysql-types'
 import { COLORS, logger } from '../utils/logger'
 import { CacheManager } from './cache-manager'
+import { ShardKeys } from './shard-keys'
 
 /**
  * MySQL Client
@@ -27,92 +30,146 @@ export class MySQL {
   }
 
   /**
-   * Create a table
+   * Build the schema of a table for the native schema sync
    * @param params - Create table params
-   * @returns {Promise<boolean>} True if table created successfully, false otherwise
+   * @returns {SchemaSyncTable} Column definitions, foreign keys, indexes, shard key and their hash
    */
-  private async createTable(params: CreateTableParams<Record<any, any>>): Promise<boolean> {
-    const { name, columns, indexes } = params
-    const foreignKeys: string[] = []
+  private tableSchema(params: CreateTableParams<Record<any, any>>): SchemaSyncTable {
+    const { name, columns, indexes = [], shardKey } = params
+    const constraints: string[] = []
+    const references: string[] = []
 
-    const columnDefinitions = columns
-      .map((column) => {
-        let def = `${column.name} ${column.type}`
+    const columnDefinitions = columns.map((column) => {
+      let def = `${String(column.name)} ${column.type}`
 
-        if (column.length) {
-          def += `(${column.length})`
-        }
+      if (column.length) {
+        def += `(${column.length})`
+      }
 
-        if (column.primaryKey) {
-          def += ' PRIMARY KEY'
-        }
+      if (column.primaryKey) {
+        def += ' PRIMARY KEY'
+      }
 
-        if (column.autoIncrement) {
-          def += ' AUTO_INCREMENT'
-        }
+      if (column.autoIncrement) {
+        def += ' AUTO_INCREMENT'
+      }
 
-        if (column.unique) {
-          def += ' UNIQUE'
-        }
+      if (column.unique) {
+        def += ' UNIQUE'
+      }
 
-        if (!column.nullable) {
-          def += ' NOT NULL'
-        }
+      if (!column.nullable) {
+        def += ' NOT NULL'
+      }
 
-        if (column.default !== undefined) {
-          def += ` DEFAULT ${typeof column.default === 'string' ? `'${column.default}'` : column.default}`
-        }
+      if (column.default !== undefined) {
+        def += ` DEFAULT ${typeof column.default === 'string' ? `'${column.default}'` : column.default}`
+      }
 
-        if (column.reference) {
-          const onDelete = column.onDelete || 'CASCADE'
-          const onUpdate = column.onUpdate || 'CASCADE'
-          foreignKeys.push(
-            `FOREIGN KEY (${column.name}) REFERENCES ${column.reference.table}(${column.reference.column}) ` +
-              `ON DELETE ${onDelete} ON UPDATE ${onUpdate}`,
-          )
-        }
+      if (column.reference) {
+        const onDelete = column.onDelete || 'CASCADE'
+        const onUpdate = column.onUpdate || 'CASCADE'
+        constraints.push(
+          `FOREIGN KEY (${String(column.name)}) REFERENCES ${column.reference.table}(${column.reference.column}) ` +
+            `ON DELETE ${onDelete} ON UPDATE ${onUpdate}`,
+        )
+        references.push(column.reference.table)
+      }
 
-        return def
-      })
-      .join(', ')
-
-    const tableDefinition =
-      foreignKeys.length > 0 ? `${columnDefinitions}, ${foreignKeys.join(', ')}` : columnDefinitions
-
-    const create_table_result = await createTable(name, tableDefinition)
-    if (create_table_result) {
-      if (indexes) {
-        for (const index of indexes) {
-          const formattedColumns = index.columns.join(', ')
-          try {
-            const result = await createIndex(name, index.indexName, formattedColumns)
-            if (result) {
-              console.log(
-                `${COLORS.greenBright}[INDEX] ${index.indexName} created successfully on table ${COLORS.blue}${name}${COLORS.reset}`,
-              )
-            } else {
-              console.log(
-                `${COLORS.red}[INDEX] ${index.indexName} already exists on table ${COLORS.blue}${name}${COLORS.reset}`,
-              )
-            }
-          } catch (error) {
-            logger.error(`Failed to create index ${index.indexName}:`, error)
-          }
-        }
+      return { name: String(column.name), definition: def }
+    })
+
+    const indexDefinitions = indexes.map((index) => ({
+      name: index.indexName,
+      columns: index.columns.map(String).join(', '),
+    }))
+
+    const shard = shardKey && {
+      column: String(shardKey.column),
+      strategy: shardKey.strategy ?? 'hash',
+      ranges: shardKey.ranges,
+    }
+
+    const hash = createHash('sha256')
+      .update(JSON.stringify([name, columnDefinitions, constraints, indexDefinitions, shard]))
+      .digest('hex')
+
+    return {
+      name,
+      hash,
+      columns: columnDefinitions,
+      constraints,
+      indexes: indexDefinitions,
+      references,
+      shardKey: shard,
+    }
+  }
+
+  /**
+   * Sync tables to their schemas
+   * - Tables whose hash matches the local cache of `target` are skipped without a round trip
+   * - The others go to the native schema sync in one call, which skips them again by the hashes stored in the database
+   * - With shards, tables with a shard key are synced on every shard in a second call
+   * @param tables - Table schemas
+   * @param target - Database, as `user@host:port/database`, followed by the shards
+   * @returns {Promise<Record<string, boolean>>} Object with table names as keys and sync status as values
+   */
+  private async syncTables(tables: SchemaSyncTable[], target: string): Promise<Record<string, boolean>> {
+    const results: Record<string, boolean> = {}
+    declareIndexes(
+      tables.flatMap(({ name, indexes = [] }) =>
+        indexes.map((index) => ({ table: name, name: index.name, columns: index.columns })),
+      ),
+    )
+
+    const shardKeys = tables.flatMap(({ name, shardKey }) => (shardKey ? [{ table: name, ...shardKey }] : []))
+    const sharded = declareShardKeys(shardKeys)
+    ShardKeys.declare(sharded ? shardKeys : [])
+
+    const hashes = this.cacheManager.readSchemaHashes(target)
+    const pending = tables.filter((table) => {
+      if (table.hash && hashes[table.name] === table.hash) {
+        results[table.name] = true
+        logger.success(`Table ${COLORS.blue}${table.name}${COLORS.reset} unchanged since the last sync`)
+        return false
       }
-    } else {
-      throw new Error(`Failed to create table ${name}: ${create_table_result}`)
+      return true
+    })
+
+    const onShards = pending.filter((table) => sharded && table.shardKey)
+    const onPrimary = pending.filter((table) => !onShards.includes(table))
+    const synced = [
+      ...(onPrimary.length > 0 ? await syncSchema(onPrimary) : []),
+      ...(onShards.length > 0 ? await syncSchema(onShards, { shards: true }) : []),
+    ]
+
+    for (const result of synced) {
+      const table = pending.find((table) => table.name === result.name)
+      results[result.name] = result.status !== 'failed'
+      if (result.status === 'failed') {
+        delete hashes[result.name]
+        logger.error(`Failed to sync table ${result.name}:`, result.error)
+        continue
+      }
+      if (table?.hash) {
+        hashes[result.name] = table.hash
+      }
+      const algorithm = result.algorithm ? ` (${result.algorithm})` : ''
+      logger.success(`Table ${COLORS.blue}${result.name}${COLORS.reset} ${result.status}${algorithm}`)
     }
-    return create_table_result
+
+    this.cacheManager.writeSchemaHashes(target, hashes)
+    return results
   }
 
   /**
-   * Discover and create tables from .peek.js schema files
+   * Discover and sync tables from .peek.js schema files
    * @param schemaDir - Directory containing .peek.js schema files
-   * @returns {Promise<Record<string, boolean>>} Object with table names as keys and creation status as values
+   * @param target - Database, as `user@host:port/database`, followed by the shards
+   * @returns {Promise<Record<string, boolean>>} Object with table names as keys and sync status as values
    */
-  private async createTablesFromSchemas(schemaDir: string): Promise<Record<string, boolean>> {
-    const results: Record<string, boolean> = {}
+  private async createTablesFromSchemas(schemaDir: string, target: string): Promise<Record<string, boolean>> {
+    const tables: SchemaSyncTable[] = []
     const schemaCache = this.cacheManager.readSchemaCache()
     const newSchemaCache = new Map<string, any>()
 
@@ -124,38 +181,28 @@ export class MySQL {
 
       if (schemaFiles.length === 0) {
         logger.warning(`No .peek.js or .peek.ts schema files found in ${schemaDir}`)
-        return results
+        return {}
       }
 
       for (const file of schemaFiles) {
         const filePath = join(fullPath, file)
         try {
           const stats = fs.statSync(filePath)
-          const cachedSchema = schemaCache.get(filePath)
+          let cachedSchema = schemaCache.get(filePath)
 
           if (!cachedSchema || cachedSchema.mtime !== stats.mtime.toISOString()) {
             delete require.cache[require.resolve(filePath)]
-            const schema = require(filePath)
-            newSchemaCache.set(filePath, {
+            cachedSchema = {
               mtime: stats.mtime.toISOString(),
-              schema,
-            })
-
-            for (const key in schema) {
-              const tableSchema = schema[key]
-              if (tableSchema && typeof tableSchema === 'object' && tableSchema.name && tableSchema.columns) {
-                results[tableSchema.name] = await this.createTable(tableSchema)
-                logger.success(`Table ${COLORS.blue}${tableSchema.name}${COLORS.reset} created/updated from ${file}`)
-              }
+              schema: require(filePath),
             }
-          } else {
-            newSchemaCache.set(filePath, cachedSchema)
-            for (const key in cachedSchema.schema) {
-              const tableSchema = cachedSchema.schema[key]
-              if (tableSchema && typeof tableSchema === 'object' && tableSchema.name && tableSchema.columns) {
-                results[tableSchema.name] = await this.createTable(tableSchema)
-                logger.success(`Table ${COLORS.blue}${tableSchema.name}${COLORS.reset} loaded from cache`)
-              }
+          }
+          newSchemaCache.set(filePath, cachedSchema)
+
+          for (const key in cachedSchema.schema) {
+            const tableSchema = cachedSchema.schema[key]
+            if (tableSchema && typeof tableSchema === 'object' && tableSchema.name && tableSchema.columns) {
+              tables.push(this.tableSchema(tableSchema))
             }
           }
         } catch (error) {
@@ -164,11 +211,12 @@ export class MySQL {
       }
 
       this.cacheManager.writeSchemaCache(newSchemaCache)
+      return await this.syncTables(tables, target)
     } catch (error) {
-      logger.error('Failed to read schema directory:', error)
+      logger.error('Failed to sync schemas:', error)
     }
 
-    return results
+    return {}
   }
 
   /**
@@ -186,18 +234,21 @@ export class MySQL {
   /**
    * ## Connect Method
    * - Connect to MySQL database
-   * - Create tables from .peek.js schema files
+   * - Create and alter tables from .peek.js schema files, skipping the tables unchanged since the last sync
    * @param config - Connect params
    * @param schemasDir - Directory containing .peek.js schema files
    * @returns {Promise<MySQL>} - MySQL client instance
    */
   async connect(config: ConnectParams, schemasDir: string): Promise<MySQL> {
-    const { host, user, password, database } = config
-    this.isConnected = await initialize(host, user, password, database, 3306)
+    const { host, user, password, database, port = 3306, pool = {} } = config
+    this.isConnected = await initialize(host, user, password, database, port, pool)
 
     if (this.isConnected) {
       console.log(`\n${COLORS.greenBright}🚀 Connected to MySQL database`)
-      await this.createTablesFromSchemas(schemasDir)
+      const shards = (pool.shards ?? []).map(
+        (shard) => ` ${shard.host}:${shard.port ?? port}/${shard.database ?? database}`,
+      )
+      await this.createTablesFromSchemas(schemasDir, `${user}@${host}:${port}/${database}${shards.join('')}`)
     } else {
       console.log(`\n${COLORS.red}🚨 Failed to connect to MySQL database`)
       throw new Error('🚨 Failed to connect to MySQL database')
@@ -1,2 +1,4 @@
 export * from './client'
+export * from './packed-rows'
 export * from './peek'
+export * from './transaction'
@@ -0,0 +1,172 @@
+import { PackedResult } from '../types'
+
+/** `ColumnKind` of mysql_result.h */
+const COLUMN_INT = 0
+const COLUMN_UINT = 1
+const COLUMN_DOUBLE = 2
+const COLUMN_DATETIME = 3
+const COLUMN_STRING = 4
+
+/** `PackedTag` of mysql_result.h */
+const PACKED_NULL = 1
+const PACKED_BIG = 2
+
+/** Row index of a view, a symbol so it stays out of the row's keys */
+const ROW = Symbol('row')
+
+/**
+ * ## Rows of a packed select
+ * - The whole result set is one ArrayBuffer: no JS object or string exists until a field is read
+ * - `at(index)` and iteration return row views, whose fields are getters decoding their cell on every access
+ * - View fields live on a shared prototype, so `{ ...row }` and `Object.keys(row)` see none: `row.toJSON()` and
+ *   `toArray()` give plain objects
+ * @example
+ * const rows = await peek.selectPacked<Device>('devices', (qb) => qb.select('*'))
+ * for (const row of rows) {
+ *   if (row.status === 'offline') console.log(row.name)
+ * }
+ */
+export class PackedRows<T extends Record<string, any>> implements Iterable<T> {
+  /**
+   * Column names, in select order
+   */
+  readonly columns: string[]
+  /**
+   * Number of rows
+   */
+  readonly length: number
+  private readonly kinds: number[]
+  private readonly numbers: Float64Array
+  private readonly ints: BigInt64Array
+  private readonly uints: BigUint64Array
+  private readonly spans: Uint32Array
+  private readonly tags: Uint8Array
+  private readonly data: Buffer
+  private readonly View: new (row: number) => T
+
+  constructor(packed: PackedResult) {
+    const cells = packed.rows * packed.columns.length
+    this.columns = packed.columns
+    this.kinds = packed.kinds
+    this.length = packed.rows
+    this.numbers = new Float64Array(packed.buffer, 0, cells)
+    this.ints = new BigInt64Array(packed.buffer, 0, cells)
+    this.uints = new BigUint64Array(packed.buffer, 0, cells)
+    this.spans = new Uint32Array(packed.buffer, 0, cells * 2)
+    this.tags = new Uint8Array(packed.buffer, cells * 8, cells)
+    this.data = Buffer.from(packed.buffer, cells * 9)
+    this.View = this.createView()
+  }
+
+  /**
+   * View of a row
+   * @param index - Row index, negative from the end
+   * @returns {T | undefined} Row view, undefined out of range
+   */
+  at(index: number): T | undefined {
+    const row = index < 0 ? this.length + index : index
+    return row >= 0 && row < this.length ? new this.View(row) : undefined
+  }
+
+  /**
+   * Decode one field without a view
+   * @param index - Row index
+   * @param column - Column name
+   * @returns {T[K]} Field value
+   */
+  get<K extends keyof T>(index: number, column: K): T[K] {
+    const field = this.columns.indexOf(String(column))
+    if (field < 0 || index < 0 || index >= this.length) {
+      return undefined as T[K]
+    }
+    return this.decode(index * this.columns.length + field, field) as T[K]
+  }
+
+  *[Symbol.iterator](): Iterator<T> {
+    for (let row = 0; row < this.length; row++) {
+      yield new this.View(row)
+    }
+  }
+
+  /**
+   * Decode every row into a plain object, as `peek.select` returns them
+   * @returns {T[]} Rows
+   */
+  toArray(): T[] {
+    const rows: T[] = new Array(this.length)
+    for (let row = 0; row < this.length; row++) {
+      rows[row] = this.decodeRow(row)
+    }
+    return rows
+  }
+
+  toJSON(): T[] {
+    return this.toArray()
+  }
+
+  /** Decode one cell */
+  private decode(cell: number, field: number): unknown {
+    const tag = this.tags[cell]
+    if (tag === PACKED_NULL) {
+      return null
+    }
+
+    switch (this.kinds[field]) {
+      case COLUMN_INT:
+        return tag === PACKED_BIG ? this.ints[cell] : this.numbers[cell]
+      case COLUMN_UINT:
+        return tag === PACKED_BIG ? this.uints[cell] : this.numbers[cell]
+      case COLUMN_DOUBLE:
+        return this.numbers[cell]
+      case COLUMN_DATETIME:
+        return new Date(this.numbers[cell])
+      case COLUMN_STRING: {
+        const start = this.spans[cell * 2]
+        return this.data.toString('utf8', start, start + this.spans[cell * 2 + 1])
+      }
+      default: {
+        // A copy, so the buffer outlives the rows like the buffers of `peek.select`
+        const start = this.spans[cell * 2]
+        return Buffer.from(this.data.subarray(start, start + this.spans[cell * 2 + 1]))
+      }
+    }
+  }
+
+  /** Decode a row into a plain object */
+  private decodeRow(row: number): T {
+    const width = this.columns.length
+    const obj: Record<string, unknown> = {}
+    for (let field = 0; field < width; field++) {
+      obj[this.columns[field]] = this.decode(row * width + field, field)
+    }
+    return obj as T
+  }
+
+  /** Class of the row views, one getter per column on its prototype */
+  private createView(): new (row: number) => T {
+    const rows = this
+    const width = this.columns.length
+
+    class RowView {
+      readonly [ROW]: number
+
+      constructor(row: number) {
+        this[ROW] = row
+      }
+
+      toJSON(): T {
+        return rows.decodeRow(this[ROW])
+      }
+    }
+
+    this.columns.forEach((column, field) => {
+      Object.defineProperty(RowView.prototype, column, {
+        enumerable: true,
+        get(this: RowView) {
+          return rows.decode(this[ROW] * width + field, field)
+        },
+      })
+    })
+    return RowView as unknown as new (row: number) => T
+  }
+}
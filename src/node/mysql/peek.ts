@@ -1,12 +1,46 @@
+import fs from 'fs'
 import {
-  bulkInsert as bulkInsertQuery,
+  batchQuery,
+  bulkInsertRows,
   deleteQuery,
   insert as insertQuery,
+  loadAbort,
+  loadData,
+  loadEnd,
+  loadWrite,
+  prometheusMetrics,
+  replicaStatus,
+  resultCacheClear,
+  resultCacheStats,
   select as selectQuery,
+  selectStream as selectStreamQuery,
+  slowQueryReport,
+  slowQueryReset,
+  stats,
+  streamClose,
+  streamNext,
+  transactionBegin,
   update as updateQuery,
 } from '../../build/Release/peek-orm.node'
-import { InsertedResult, QueryBuilder } from '../types'
+import {
+  BulkInsertOptions,
+  BulkInsertedResult,
+  InsertedResult,
+  LoadOptions,
+  LoadResult,
+  LoadSource,
+  PeekStats,
+  QueryBuilder,
+  ReplicaStatus,
+  ResultCacheStats,
+  SelectStreamOptions,
+  SlowQueryReport,
+} from '../types'
+import { PackedRows } from './packed-rows'
 import { createQueryBuilder } from './query-builder'
+import { BuildQueryHelper } from './query-builder/build-query-helper'
+import { ShardKeys } from './shard-keys'
+import { Transaction } from './transaction'
 
 /**
  * ## Peek ORM
@@ -28,7 +62,28 @@ export class peek {
     const queryBuilder = createQueryBuilder<T>().from(table)
     const query = callback(queryBuilder)
     const finalQuery = query.getQuery()
-    return selectQuery(finalQuery) as unknown as T[]
+    const options = { fingerprint: query.getFingerprint(), ...ShardKeys.fromQuery(table, query) }
+    return selectQuery(finalQuery, query.getParameters(), options) as unknown as T[]
+  }
+
+  /**
+   * Execute a SELECT query on a table, keeping the rows packed in one native buffer
+   * - Fields are decoded only when read, so large results that are mostly skipped cost little memory and GC time
+   * @param table - Name of the table to query
+   * @param callback - Function to build the query
+   * @returns {Promise<PackedRows<T>>} Lazy rows
+   * @example
+   * const rows = await peek.selectPacked<Device>('devices', (qb) => qb.select('*'))
+   * const online = rows.get(0, 'status')
+   */
+  static async selectPacked<T extends Record<string, any>>(
+    table: string,
+    callback: (queryBuilder: QueryBuilder<T>) => QueryBuilder<T>,
+  ): Promise<PackedRows<T>> {
+    const queryBuilder = createQueryBuilder<T>().from(table)
+    const query = callback(queryBuilder)
+    const options = { packed: true as const, fingerprint: query.getFingerprint(), ...ShardKeys.fromQuery(table, query) }
+    return new PackedRows<T>(await selectQuery(query.getQuery(), query.getParameters(), options))
   }
 
   /**
@@ -44,12 +99,110 @@ export class peek {
     const queryBuilder = createQueryBuilder<T>().from(table)
     const query = callback(queryBuilder)
     const finalQuery = query.getQuery()
-    const result = await selectQuery(finalQuery)
+    const options = { fingerprint: query.getFingerprint(), ...ShardKeys.fromQuery(table, query) }
+    const result = await selectQuery(finalQuery, query.getParameters(), options)
     return result[0] as unknown as T
   }
 
+  /**
+   * Create a query builder for a table, to be run with `peek.batch`
+   * @param table - Name of the table to query
+   * @returns {QueryBuilder<T>} Query builder
+   */
+  static query<T extends Record<string, any>>(table: string): QueryBuilder<T> {
+    return createQueryBuilder<T>().from(table)
+  }
+
+  /**
+   * Execute independent SELECT queries in one round trip
+   * - The queries are sent as one multi-statement on a single pooled connection, values are escaped client side
+   * - Fails as a whole when any query fails
+   * @param builders - Query builders, e.g. from `peek.query`
+   * @returns Array of query results per builder, in order
+   * @example
+   * const [devices, users] = await peek.batch([
+   *   peek.query<Devices>('devices').where({ device_type: 'laptop' }),
+   *   peek.query<Users>('users').select(['id', 'name']).limit(10),
+   * ])
+   */
+  static async batch<B extends QueryBuilder<any>[]>(
+    builders: [...B],
+  ): Promise<{ [K in keyof B]: B[K] extends QueryBuilder<infer R> ? R[] : never }> {
+    const queries = builders.map((builder): [string, any[]] => {
+      const query = builder.getQuery()
+      return [query, builder.getParameters()]
+    })
+    return batchQuery(queries) as Promise<any>
+  }
+
+  /**
+   * Execute a SELECT query on a table, reading the result in batches
+   * - Rows are fetched through a server side cursor, only one batch is held in memory at a time
+   * - The next batch is fetched only when the iterator is advanced
+   * - A pooled connection is pinned until the rows are exhausted, the loop exits or the iterator is collected
+   * @param table - Name of the table to query
+   * @param callback - Function to build the query
+   * @param options - Stream options
+   * @returns {AsyncIterableIterator<T[]>} Batches of query results
+   * @example
+   * for await (const rows of peek.selectStream<BigTable>('big_table', (qb) => qb.select('*'), { batchSize: 500 })) {
+   *   console.log(rows.length)
+   * }
+   */
+  static selectStream<T extends Record<string, any>>(
+    table: string,
+    callback: (queryBuilder: QueryBuilder<T>) => QueryBuilder<T>,
+    options: SelectStreamOptions = {},
+  ): AsyncIterableIterator<T[]> {
+    const queryBuilder = createQueryBuilder<T>().from(table)
+    const query = callback(queryBuilder)
+    const finalQuery = query.getQuery()
+    const parameters = query.getParameters()
+
+    let handle: unknown = null
+    let finished = false
+
+    const close = () => {
+      finished = true
+      if (handle) {
+        streamClose(handle)
+        handle = null
+      }
+    }
+
+    return {
+      [Symbol.asyncIterator]() {
+        return this
+      },
+      async next(): Promise<IteratorResult<T[]>> {
+        if (finished) {
+          return { done: true, value: undefined }
+        }
+        try {
+          if (!handle) {
+            handle = await selectStreamQuery(finalQuery, parameters, options.batchSize)
+          }
+          const rows = (await streamNext(handle)) as T[]
+          if (rows.length === 0) {
+            close()
+            return { done: true, value: undefined }
+          }
+          return { done: false, value: rows }
+        } catch (error) {
+          close()
+          throw error
+        }
+      },
+      async return(): Promise<IteratorResult<T[]>> {
+        close()
+        return { done: true, value: undefined }
+      },
+    }
+  }
+
   /**
    * Execute an INSERT query on a table
+   * - Records of a sharded table are split by shard, one INSERT per shard, `insertId` is the first shard's
    * @overload
    * @param table - Name of the table to insert into
    * @param values - Single record to insert
@@ -79,8 +232,14 @@ export class peek {
     result: InsertedResult
     values: Partial<T> | Partial<T>[]
   }> {
-    const queryBuilder = createQueryBuilder<T>().from(table).insert(table, values)
-    const result = await insertQuery(queryBuilder.getQuery())
+    const groups = ShardKeys.group(table, Array.isArray(values) ? values : [values])
+    const results = await Promise.all(
+      groups.map(({ route, records }) => {
+        const queryBuilder = createQueryBuilder<T>().from(table).insert(table, records)
+        return insertQuery(queryBuilder.getQuery(), queryBuilder.getParameters(), route)
+      }),
+    )
+    const result = results.reduce((total, next) => ({ ...total, affectedRows: total.affectedRows + next.affectedRows }))
     return { result, values }
   }
 
@@ -96,7 +255,8 @@ export class peek {
     values: Partial<T>,
   ): Promise<{ result: InsertedResult; values: Partial<T> }> {
     const queryBuilder = createQueryBuilder<T>().from(table).updateOne(table, where, values)
-    const result = await updateQuery(queryBuilder.getQuery())
+    const route = ShardKeys.fromWhere(table, where)
+    const result = await updateQuery(queryBuilder.getQuery(), queryBuilder.getParameters(), route)
     return { result, values }
   }
 
@@ -113,7 +273,8 @@ export class peek {
     values: Partial<T>[],
   ): Promise<{ result: InsertedResult; values: Partial<T>[] }> {
     const queryBuilder = createQueryBuilder<T>().from(table).updateMany(table, where, values)
-    const result = await updateQuery(queryBuilder.getQuery())
+    const route = ShardKeys.fromWhere(table, where)
+    const result = await updateQuery(queryBuilder.getQuery(), queryBuilder.getParameters(), route)
     return { result, values }
   }
 
@@ -128,22 +289,223 @@ export class peek {
     where: Partial<T>,
   ): Promise<{ result: InsertedResult }> {
     const queryBuilder = createQueryBuilder<T>().from(table).delete(table, where)
-    const result = await deleteQuery(queryBuilder.getQuery())
+    const route = ShardKeys.fromWhere(table, where)
+    const result = await deleteQuery(queryBuilder.getQuery(), queryBuilder.getParameters(), route)
     return { result }
   }
 
   /**
    * Execute a BULK INSERT query on a table
+   * - Records are serialized natively into multi-row INSERTs that each fit the server's `max_allowed_packet`
+   * - Columns are the keys of the first record, a key missing from a later record inserts NULL
+   * - Records of a sharded table are split by shard and inserted on every shard at once, `insertId` and
+   *   `lastInsertId` are then the first shard's
+   * - Only an insert on one connection of one shard is all or nothing, with `parallel` > 1 or over several shards
+   *   a failure leaves the rows of the connections that succeeded inserted, see `BulkInsertOptions`
    * @param table - Name of the table to insert into
    * @param values - Array of records to insert
+   * @param options - Bulk insert options
    * @returns Promise with insert result and input values Array
+   * @example
+   * await peek.bulkInsert<Devices>('devices', devices, { parallel: 4 })
    */
   static async bulkInsert<T extends Record<string, any>>(
     table: string,
     values: Partial<T>[],
-  ): Promise<{ result: InsertedResult; values: Partial<T>[] }> {
-    const queryBuilder = createQueryBuilder<T>().from(table).bulkInsert(table, values)
-    const result = await bulkInsertQuery(queryBuilder.getQuery())
+    options: BulkInsertOptions = {},
+  ): Promise<{ result: BulkInsertedResult; values: Partial<T>[] }> {
+    const groups = ShardKeys.group(table, values)
+    const results = await Promise.all(
+      groups.map(({ route, records }) => bulkInsertRows(table, records, { ...options, ...route })),
+    )
+    const result = results.reduce((total, next) => ({
+      ...total,
+      affectedRows: total.affectedRows + next.affectedRows,
+      statements: total.statements + next.statements,
+    }))
     return { result, values }
   }
+
+  /**
+   * Execute a LOAD DATA LOCAL INFILE into a table, fed from memory instead of a file
+   * - Requires the `localInfile` pool option
+   * - Data is streamed to the server as it is produced, writing pauses while more than a few megabytes are queued
+   * - Rows given as arrays of values are serialized as TSV, `null` becomes `NULL`
+   * @param table - Name of the table to load into
+   * @param source - File data or rows
+   * @param columns - Columns in file order, empty for all columns in table order
+   * @param options - Load options
+   * @returns {Promise<LoadResult>} Number of loaded rows, warnings and bytes sent
+   * @example
+   * await peek.load('devices', fs.createReadStream('devices.csv'), ['id', 'name'], { format: 'csv', ignoreLines: 1 })
+   * await peek.load('devices', [[1, 'device 1'], [2, null]], ['id', 'name'])
+   */
+  static async load(
+    table: string,
+    source: LoadSource,
+    columns: string[] = [],
+    options: LoadOptions = {},
+  ): Promise<LoadResult> {
+    const isRows = Array.isArray(source) && source.length > 0 && Array.isArray(source[0])
+    const format = isRows ? 'tsv' : (options.format ?? 'tsv')
+    const query = BuildQueryHelper.buildLoadDataQuery(table, columns, format, options.ignoreLines ?? 0)
+
+    let onDrain: (() => void) | null = null
+    const { handle, done } = loadData(query, (event, bytes) => {
+      if (event === 'progress') {
+        options.onProgress?.(bytes)
+      } else if (onDrain) {
+        const resolve = onDrain
+        onDrain = null
+        resolve()
+      }
+    })
+
+    // The load may fail before every chunk is written, the error is surfaced by awaiting `done`
+    done.catch(() => {})
+
+    const write = async (chunk: Buffer | string) => {
+      if (!loadWrite(handle, chunk)) {
+        await new Promise<void>((resolve) => (onDrain = resolve))
+      }
+    }
+
+    try {
+      if (isRows) {
+        const rows = source as any[][]
+        for (let i = 0; i < rows.length; i += 1000) {
+          await write(BuildQueryHelper.buildTsvRows(rows.slice(i, i + 1000)))
+        }
+      } else if (typeof source === 'string' || Buffer.isBuffer(source)) {
+        await write(source)
+      } else {
+        for await (const chunk of source as AsyncIterable<Buffer | string>) {
+          await write(chunk)
+        }
+      }
+      loadEnd(handle)
+    } catch (error) {
+      loadAbort(handle, error instanceof Error ? error.message : String(error))
+      await done.catch(() => {})
+      throw error
+    }
+
+    return done
+  }
+
+  /**
+   * Run a unit of work in a transaction
+   * - One pooled connection is pinned for the whole callback
+   * - Writes queued on `tx` are flushed together in one round trip, the last batch goes out with the COMMIT
+   * - Commits when the callback resolves, rolls back and rethrows when it throws or a statement fails
+   * @param callback - Unit of work
+   * @returns {Promise<R>} What the callback resolved with
+   * @example
+   * const order = await peek.transaction(async (tx) => {
+   *   const { insertId } = await tx.insert('orders', { customer_id: 1, total: 100 })
+   *   tx.updateOne('customers', { id: 1 }, { last_order_id: insertId })
+   *   return insertId
+   * })
+   */
+  static async transaction<R>(callback: (tx: Transaction) => Promise<R>): Promise<R> {
+    const tx = new Transaction(await transactionBegin())
+    let result: R
+    try {
+      result = await callback(tx)
+      await tx.commit()
+    } catch (error) {
+      await tx.rollback()
+      throw error
+    }
+    return result
+  }
+
+  /**
+   * Statistics of the result cache enabled by the `resultCacheSize` pool option
+   * @returns {ResultCacheStats} Hits, misses, drops and memory of the cache
+   * @example
+   * const { hits, misses } = peek.cacheStats()
+   */
+  static cacheStats(): ResultCacheStats {
+    return resultCacheStats()
+  }
+
+  /**
+   * Invalidate cached results, e.g. after another client wrote to a table
+   * @param table - Table whose results are invalidated, all results when omitted
+   * @example
+   * peek.clearCache('devices')
+   */
+  static clearCache(table?: string): void {
+    resultCacheClear(table)
+  }
+
+  /**
+   * State of the read replicas configured by the `replicas` pool option
+   * @returns {ReplicaStatus[]} Health, load and counters of every replica
+   * @example
+   * const ejected = peek.replicaStatus().filter((replica) => !replica.healthy)
+   */
+  static replicaStatus(): ReplicaStatus[] {
+    return replicaStatus()
+  }
+
+  /**
+   * Performance metrics recorded natively since the process started
+   * - Per operation: count, errors, rows and bytes decoded, latency quantiles in milliseconds
+   * - Pool: occupancy, time spent waiting for a connection, reconnects and pings
+   * @returns {PeekStats} Metrics snapshot
+   * @example
+   * const { p99 } = peek.stats().operations.select.latency
+   */
+  static stats(): PeekStats {
+    return stats()
+  }
+
+  /**
+   * The metrics of `peek.stats` in the Prometheus text exposition format, to serve from a `/metrics` endpoint
+   * @returns {string} Metrics text
+   * @example
+   * app.get('/metrics', (req, res) => res.type('text/plain').send(peek.prometheusMetrics()))
+   */
+  static prometheusMetrics(): string {
+    return prometheusMetrics()
+  }
+
+  /**
+   * Slow selects recorded with the `slowQueryThreshold` pool option, slowest total time first
+   * - Each fingerprint carries its EXPLAIN plan: full scans, filesorts and temporary tables
+   * - `coveringIndexes` are the schema `indexes` that would serve the scan or sort, `suggestedIndexes` the columns
+   *   to index when no schema declares one
+   * @returns {SlowQueryReport} Report
+   * @example
+   * const missing = peek.slowQueries().queries.filter((query) => query.suggestedIndexes.length > 0)
+   */
+  static slowQueries(): SlowQueryReport {
+    return slowQueryReport()
+  }
+
+  /**
+   * Write the slow query report to a JSON file
+   * @param path - File written
+   * @param reset - Forget the slow queries once written
+   * @returns {SlowQueryReport} Report written
+   * @example
+   * process.on('SIGUSR2', () => peek.dumpSlowQueries('slow-queries.json'))
+   */
+  static dumpSlowQueries(path: string, reset = false): SlowQueryReport {
+    const report = slowQueryReport()
+    fs.writeFileSync(path, JSON.stringify(report, null, 2))
+    if (reset) {
+      slowQueryReset()
+    }
+    return report
+  }
+
+  /**
+   * Forget the slow queries seen so far, the schema indexes are kept
+   */
+  static resetSlowQueries(): void {
+    slowQueryReset()
+  }
 }
@@ -1,5 +1,24 @@
+import { fingerprint as nativeFingerprint } from '../../../build/Release/peek-orm.node'
+import { LoadFormat } from '../../types'
 import { MySQLQueryBuilder } from './builder'
 
+/** Characters escaped in a TSV field, `\\` is LOAD DATA's default escape character */
+const TSV_ESCAPES: Record<string, string> = { '\\': '\\\\', '\t': '\\t', '\n': '\\n', '\r': '\\r', '\0': '\\0' }
+
+/** Number of query shapes whose compiled SQL is kept, the least recently used shape is dropped first */
+const COMPILED_QUERY_CACHE_SIZE = 512
+
+/**
+ * Compiled query of a query shape
+ * - `sql` is the statement with a `?` for every bound value, without the trailing `;`
+ * - `fingerprint` identifies the normalized statement, see `BuildQueryHelper.fingerprint`
+ */
+export interface CompiledQuery {
+  kind: 'SELECT' | 'INSERT' | 'UPDATE' | 'DELETE'
+  sql: string
+  fingerprint: string
+}
+
 /**
  * ## Build Query Helper
  * - This is the internal query builder class for the MySQL client
@@ -7,6 +26,41 @@ import { MySQLQueryBuilder } from './builder'
  * @author [thutasann](https://github.com/thutasann)
  */
 export class BuildQueryHelper {
+  /** Compiled queries by shape, in least recently used first order */
+  private static compiledQueries = new Map<string, CompiledQuery>()
+
+  /**
+   * Build a `column = ?` condition, pushing the value to bind
+   * @param column - Column name
+   * @param value - Value to compare with, `null` or `'NULL'` builds `IS NULL`
+   * @param values - Placeholder values to push to
+   * @returns Condition with a placeholder
+   */
+  static buildCondition(column: string, value: any, values: any[]): string {
+    if (this.isNull(value)) {
+      return `${column} IS NULL`
+    }
+    values.push(value)
+    return `${column} = ?`
+  }
+
+  private static isNull(value: any): boolean {
+    return value === null || value === undefined || value === 'NULL'
+  }
+
+  /**
+   * Build the condition template of a `where` object, `IS NULL` for null values and `= ?` otherwise
+   * @param where - Where object
+   * @returns Conditions joined with `AND`
+   */
+  private static buildWhereTemplate(where: Record<string, any>): string {
+    const conditions: string[] = []
+    for (const key in where) {
+      conditions.push(this.isNull(where[key]) ? `${key} IS NULL` : `${key} = ?`)
+    }
+    return conditions.join(' AND ')
+  }
+
   private static addJoinClauses(parts: string[], joinClauses: string[]): void {
     if (joinClauses.length > 0) {
       parts.push(joinClauses.join(' '))
@@ -33,43 +87,42 @@ export class BuildQueryHelper {
 
   private static addOrderByClause(parts: string[], orderByStatements: string[]): void {
     if (orderByStatements.length > 0) {
-      const orderByCols = orderByStatements.map((stmt) => {
-        const [col, direction] = stmt.split(' ')
-        return `${col} ${direction}`
-      })
-      parts.push(`ORDER BY ${orderByCols.join(', ')}`)
+      parts.push(`ORDER BY ${orderByStatements.join(', ')}`)
     }
   }
 
   private static addLimitClause(parts: string[], limitValue?: number): void {
     if (limitValue !== undefined) {
-      if (!Number.isInteger(limitValue) || limitValue < 0) {
-        throw new Error('LIMIT value must be a non-negative integer')
-      }
-      parts.push(`LIMIT ${limitValue}`)
+      parts.push('LIMIT ?')
     }
   }
 
   private static addOffsetClause(parts: string[], offsetValue?: number): void {
     if (offsetValue !== undefined) {
-      if (!Number.isInteger(offsetValue) || offsetValue < 0) {
-        throw new Error('OFFSET value must be a non-negative integer')
+      parts.push('OFFSET ?')
+    }
+  }
+
+  private static bindPaging(parameters: any[], clause: 'LIMIT' | 'OFFSET', value?: number): void {
+    if (value !== undefined) {
+      if (!Number.isInteger(value) || value < 0) {
+        throw new Error(`${clause} value must be a non-negative integer`)
       }
-      parts.push(`OFFSET ${offsetValue}`)
+      parameters.push(value)
     }
   }
 
   /**
    * Build an INSERT query
    * @param tableName - Name of the table to insert into
-   * @param insertedValues - Insert values
+   * @param columns - Inserted columns
+   * @param rowCount - Number of inserted rows
    * @returns INSERT query
    */
-  static buildInsertQuery(tableName: string, insertedValues: { columns: string[]; values: any[][] }): string {
-    const { columns, values } = insertedValues
-    const columnsList = columns.join(', ')
-    const valuesList = values.map((row) => `(${row.join(', ')})`).join(', ')
-    return `INSERT INTO ${tableName} (${columnsList}) VALUES ${valuesList}`
+  static buildInsertQuery(tableName: string, columns: string[], rowCount: number): string {
+    const rowPlaceholders = `(${columns.map(() => '?').join(', ')})`
+    const valuesList = new Array(rowCount).fill(rowPlaceholders).join(', ')
+    return `INSERT INTO ${tableName} (${columns.join(', ')}) VALUES ${valuesList}`
   }
 
   /**
@@ -87,45 +140,85 @@ export class BuildQueryHelper {
     return `INSERT INTO ${tableName} ${columns} VALUES ${values}`
   }
 
+  /**
+   * Build a LOAD DATA LOCAL INFILE query
+   * - The file name is a placeholder, the data comes from memory
+   * @param tableName - Name of the table to load into
+   * @param columns - Columns in file order, empty for all columns in table order
+   * @param format - Format of the data
+   * @param ignoreLines - Number of leading lines to skip
+   * @returns LOAD DATA query
+   */
+  static buildLoadDataQuery(tableName: string, columns: string[], format: LoadFormat, ignoreLines: number): string {
+    const parts = [`LOAD DATA LOCAL INFILE 'peek' INTO TABLE \`${tableName}\``]
+
+    if (format === 'csv') {
+      parts.push(`FIELDS TERMINATED BY ',' OPTIONALLY ENCLOSED BY '"' ESCAPED BY '\\\\'`)
+    } else {
+      parts.push(`FIELDS TERMINATED BY '\\t' ESCAPED BY '\\\\'`)
+    }
+    parts.push(`LINES TERMINATED BY '\\n'`)
+
+    if (ignoreLines > 0) {
+      parts.push(`IGNORE ${Math.floor(ignoreLines)} LINES`)
+    }
+    if (columns.length > 0) {
+      parts.push(`(${columns.map((column) => `\`${column}\``).join(', ')})`)
+    }
+
+    return parts.join(' ')
+  }
+
+  /**
+   * Serialize rows into TSV lines understood by LOAD DATA's default format
+   * @param rows - Rows as arrays of values
+   * @returns TSV text, one line per row
+   */
+  static buildTsvRows(rows: any[][]): string {
+    let text = ''
+    for (const row of rows) {
+      text += row.map((value) => this.toTsvField(value)).join('\t') + '\n'
+    }
+    return text
+  }
+
+  private static toTsvField(value: any): string {
+    if (value === null || value === undefined) {
+      return '\\N'
+    }
+    let text: string
+    if (value instanceof Date) {
+      text = value.toISOString().slice(0, 23).replace('T', ' ')
+    } else if (typeof value === 'boolean') {
+      text = value ? '1' : '0'
+    } else if (typeof value === 'object' && !Buffer.isBuffer(value)) {
+      text = JSON.stringify(value)
+    } else {
+      text = value.toString()
+    }
+    return text.replace(/[\\\t\n\r\0]/g, (char) => TSV_ESCAPES[char])
+  }
+
   /**
    * Build an UPDATE query
    * @param tableName - Name of the table to update
-   * @param updateValues - Update values
+   * @param columns - Updated columns
+   * @param where - Where object
    * @returns UPDATE query
    */
-  static buildUpdateQuery(tableName: string, updateValues: { columns: string[]; where: any; values: any[][] }): string {
-    const { columns, where, values } = updateValues
-    const setStatements = columns
-      .map((col, index) => {
-        const value = values[0][index]
-        return `${col} = ${typeof value === 'string' ? `'${value}'` : value === 'NULL' ? 'NULL' : value}`
-      })
-      .join(', ')
-
-    const whereConditions = Object.entries(where)
-      .map(([key, value]) => `${key} = ${value === 'NULL' ? 'NULL' : typeof value === 'string' ? `'${value}'` : value}`)
-      .join(' AND ')
-
-    return `UPDATE ${tableName} SET ${setStatements} WHERE ${whereConditions}`
+  static buildUpdateQuery(tableName: string, columns: string[], where: Record<string, any>): string {
+    const setStatements = columns.map((col) => `${col} = ?`).join(', ')
+    return `UPDATE ${tableName} SET ${setStatements} WHERE ${this.buildWhereTemplate(where)}`
   }
 
   /**
    * Build a DELETE query
    * @param tableName - Name of the table to delete from
-   * @param where - Where clause
+   * @param where - Where object
    * @returns DELETE query
    */
-  static buildDeleteQuery(tableName: string, deletedValues: { where: Record<string, any> }): string {
-    const { where } = deletedValues
-    const whereConditions = Object.entries(where)
-      .map(([key, value]) => {
-        if (value === null || value === 'NULL') {
-          return `${key} IS NULL`
-        }
-        return `${key} = ${typeof value === 'string' ? `'${value}'` : value}`
-      })
-      .join(' AND ')
-    return `DELETE FROM ${tableName} WHERE ${whereConditions}`
+  static buildDeleteQuery(tableName: string, where: Record<string, any>): string {
+    return `DELETE FROM ${tableName} WHERE ${this.buildWhereTemplate(where)}`
   }
 
   /**
@@ -154,4 +247,119 @@ export class BuildQueryHelper {
 
     return parts
   }
+
+  /**
+   * Build the shape of a query: everything its SQL depends on, without the bound values
+   * - Builders with the same shape compile to the same SQL and only differ in their parameters
+   * @param builder - Query builder, not a native or bulk insert query
+   * @returns Shape key
+   */
+  private static buildShape(builder: MySQLQueryBuilder): string {
+    const { tableName } = builder
+    if (builder.insertedValues) {
+      const { columns, values } = builder.insertedValues
+      return `INSERT\0${tableName}\0${columns.join('\x01')}\0${values.length}`
+    }
+    if (builder.updatedValues) {
+      const { columns, where } = builder.updatedValues
+      return `UPDATE\0${tableName}\0${columns.join('\x01')}\0${this.buildWhereTemplate(where)}`
+    }
+    if (builder.deletedValues) {
+      return `DELETE\0${tableName}\0${this.buildWhereTemplate(builder.deletedValues.where)}`
+    }
+    return [
+      'SELECT',
+      tableName,
+      builder.selectedColumns.join('\x01'),
+      builder.joinClauses.join('\x01'),
+      builder.whereConditions.join('\x01'),
+      builder.groupByColumns.join('\x01'),
+      builder.havingConditions.join('\x01'),
+      builder.orderByStatements.join('\x01'),
+      builder.limitValue === undefined ? '' : 'L',
+      builder.offsetValue === undefined ? '' : 'O',
+    ].join('\0')
+  }
+
+  /**
+   * ## Compile a query builder into SQL
+   * - The SQL of every query shape is built once and cached, later builders of the same shape reuse it
+   * - Bound values are not part of the shape, collect them with `bindParameters`
+   * @param builder - Query builder, not a native or bulk insert query
+   * @returns Compiled query
+   */
+  static compile(builder: MySQLQueryBuilder): CompiledQuery {
+    const shape = this.buildShape(builder)
+    const cached = this.compiledQueries.get(shape)
+    if (cached) {
+      // Move to the most recently used end
+      this.compiledQueries.delete(shape)
+      this.compiledQueries.set(shape, cached)
+      return cached
+    }
+
+    let kind: CompiledQuery['kind']
+    let sql: string
+    if (builder.insertedValues) {
+      kind = 'INSERT'
+      sql = this.buildInsertQuery(builder.tableName, builder.insertedValues.columns, builder.insertedValues.values.length)
+    } else if (builder.updatedValues) {
+      kind = 'UPDATE'
+      sql = this.buildUpdateQuery(builder.tableName, builder.updatedValues.columns, builder.updatedValues.where)
+    } else if (builder.deletedValues) {
+      kind = 'DELETE'
+      sql = this.buildDeleteQuery(builder.tableName, builder.deletedValues.where)
+    } else {
+      kind = 'SELECT'
+      sql = this.buildSelectQuery(builder).join(' ')
+    }
+
+    const compiled: CompiledQuery = { kind, sql, fingerprint: this.fingerprint(sql) }
+    if (this.compiledQueries.size >= COMPILED_QUERY_CACHE_SIZE) {
+      this.compiledQueries.delete(this.compiledQueries.keys().next().value as string)
+    }
+    this.compiledQueries.set(shape, compiled)
+    return compiled
+  }
+
+  /**
+   * Collect the values bound to the placeholders of a compiled query, in placeholder order
+   * @param builder - Query builder, not a native or bulk insert query
+   * @param parameters - Placeholder values to push to
+   */
+  static bindParameters(builder: MySQLQueryBuilder, parameters: any[]): void {
+    if (builder.insertedValues) {
+      for (const row of builder.insertedValues.values) {
+        for (const value of row) parameters.push(value === undefined ? null : value)
+      }
+      return
+    }
+
+    const where = builder.updatedValues?.where ?? builder.deletedValues?.where
+    if (where) {
+      if (builder.updatedValues) {
+        for (const value of builder.updatedValues.values[0]) parameters.push(this.isNull(value) ? null : value)
+      }
+      for (const key in where) {
+        if (!this.isNull(where[key])) parameters.push(where[key])
+      }
+      return
+    }
+
+    parameters.push(...builder.whereValues, ...builder.havingValues)
+    this.bindPaging(parameters, 'LIMIT', builder.limitValue)
+    this.bindPaging(parameters, 'OFFSET', builder.offsetValue)
+  }
+
+  /**
+   * ## Fingerprint of a SQL statement
+   * - Literals and placeholders become `?`, lists of them a single `?`, comments are dropped and whitespace is normalized
+   * - Statements that only differ in their values share a fingerprint, so it can key statistics of a query shape
+   * - Computed by the native layer, so it is the key `slowQueryReport` groups selects by
+   * @param sql - SQL statement
+   * @returns Normalized statement
+   */
+  static fingerprint(sql: string): string {
+    return nativeFingerprint(sql)
+  }
 }
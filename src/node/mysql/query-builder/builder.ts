@@ -1,6 +1,14 @@
 import { QueryBuilder } from '../../types'
 import { COLORS } from '../../utils/logger'
-import { BuildQueryHelper } from './build-query-helper'
+import { BuildQueryHelper, CompiledQuery } from './build-query-helper'
+
+/** Log color of each compiled query kind */
+const QUERY_LOG_COLORS: Record<CompiledQuery['kind'], string> = {
+  INSERT: COLORS.green,
+  UPDATE: COLORS.greenBright,
+  DELETE: COLORS.red,
+  SELECT: COLORS.blue,
+}
 
 /**
  * MySQL Query Builder Implementation
@@ -13,9 +21,13 @@ export class MySQLQueryBuilder<T = any> implements QueryBuilder<T> {
   public selectedColumns: Array<keyof T | '*'> = ['*']
   public tableName: string = ''
   public whereConditions: string[] = []
+  public whereValues: any[] = []
+  public whereEqualities = new Map<string, any>()
+  public whereHasOr: boolean = false
   public joinClauses: string[] = []
   public groupByColumns: string[] = []
   public havingConditions: string[] = []
+  public havingValues: any[] = []
   public orderByStatements: string[] = []
   public limitValue?: number
   public offsetValue?: number
@@ -24,6 +36,7 @@ export class MySQLQueryBuilder<T = any> implements QueryBuilder<T> {
   public bulkInsertValues?: { columns: string[]; values: any[][] }
   public updatedValues?: { columns: string[]; where: Partial<T>; values: any[][] }
   public deletedValues?: { where: Partial<T> }
+  public parameters: any[] = []
 
   select(columns: '*' | keyof T | Array<keyof T>): QueryBuilder<T> {
     if (columns === '*') {
@@ -49,7 +62,8 @@ export class MySQLQueryBuilder<T = any> implements QueryBuilder<T> {
       this.whereConditions.push(condition)
     } else {
       const conditions = Object.entries(condition).map(([key, value]) => {
-        return `${key} = ${typeof value === 'string' ? `'${value}'` : value}`
+        this.whereEqualities.set(key, value)
+        return BuildQueryHelper.buildCondition(key, value, this.whereValues)
       })
       this.whereConditions.push(...conditions)
     }
@@ -65,13 +79,13 @@ export class MySQLQueryBuilder<T = any> implements QueryBuilder<T> {
       return this.where(condition)
     }
 
+    // `a AND b OR c` reads as `(a AND b) OR c`, so no equality pins the result anymore
+    this.whereHasOr = true
     if (typeof condition === 'string') {
       this.whereConditions[this.whereConditions.length - 1] += ` OR ${condition}`
     } else {
       const conditions = Object.entries(condition)
-        .map(([key, value]) => {
-          return `${key} = ${typeof value === 'string' ? `'${value}'` : value}`
-        })
+        .map(([key, value]) => BuildQueryHelper.buildCondition(key, value, this.whereValues))
         .join(' OR ')
       this.whereConditions[this.whereConditions.length - 1] += ` OR ${conditions}`
     }
@@ -107,9 +121,9 @@ export class MySQLQueryBuilder<T = any> implements QueryBuilder<T> {
     if (typeof condition === 'string') {
       this.havingConditions.push(condition)
     } else {
-      const conditions = Object.entries(condition).map(([key, value]) => {
-        return `${key} = ${typeof value === 'string' ? `'${value}'` : value}`
-      })
+      const conditions = Object.entries(condition).map(([key, value]) =>
+        BuildQueryHelper.buildCondition(key, value, this.havingValues),
+      )
       this.havingConditions.push(...conditions)
     }
     return this
@@ -138,12 +152,7 @@ export class MySQLQueryBuilder<T = any> implements QueryBuilder<T> {
     const columns = Object.keys(records[0])
     if (columns.length === 0) throw new Error('Records must contain at least one column')
 
-    const rows = records.map((record) => {
-      return columns.map((col) => {
-        const value = record[col as keyof typeof record]
-        return typeof value === 'string' ? `'${value}'` : value
-      })
-    })
+    const rows = records.map((record) => columns.map((col) => record[col as keyof typeof record]))
 
     this.insertedValues = {
       columns,
@@ -205,41 +214,44 @@ export class MySQLQueryBuilder<T = any> implements QueryBuilder<T> {
     return this
   }
 
+  getParameters(): any[] {
+    return this.parameters
+  }
+
   getQuery(): string {
+    this.parameters = []
     if (this.nativeQuery) return this.nativeQuery
     if (!this.tableName) throw new Error('Table name must be specified using from() method')
 
-    // INSERT Query
-    if (this.insertedValues) {
-      const insertQuery = BuildQueryHelper.buildInsertQuery(this.tableName, this.insertedValues)
-      console.log(`${COLORS.green}[INSERT]${COLORS.reset}: ${insertQuery}`)
-      return insertQuery + ';'
-    }
-
-    // BULK INSERT Query
+    // BULK INSERT Query, values are inlined so it is built every time
     if (this.bulkInsertValues) {
       const bulkInsertQuery = BuildQueryHelper.buildBulkInsertQuery(this.tableName, this.bulkInsertValues)
       console.log(`${COLORS.greenBright}[BULK INSERT]${COLORS.reset}: ${bulkInsertQuery}`)
       return bulkInsertQuery + ';'
     }
 
-    // UPDATE Query
-    if (this.updatedValues) {
-      const updateQuery = BuildQueryHelper.buildUpdateQuery(this.tableName, this.updatedValues)
-      console.log(`${COLORS.greenBright}[UPDATE]${COLORS.reset}: ${updateQuery}`)
-      return updateQuery + ';'
-    }
+    // INSERT, UPDATE, DELETE and SELECT Queries: compiled once per shape, only the values are bound every time
+    const { kind, sql } = BuildQueryHelper.compile(this)
+    BuildQueryHelper.bindParameters(this, this.parameters)
+    console.log(`${QUERY_LOG_COLORS[kind]}[${kind}]${COLORS.reset}: ${sql}`)
+    return sql + ';'
+  }
 
-    // DELETE Query
-    if (this.deletedValues) {
-      const deleteQuery = BuildQueryHelper.buildDeleteQuery(this.tableName, this.deletedValues)
-      console.log(`${COLORS.red}[DELETE]${COLORS.reset}: ${deleteQuery}`)
-      return deleteQuery + ';'
+  getFingerprint(): string {
+    if (this.nativeQuery) return BuildQueryHelper.fingerprint(this.nativeQuery)
+    if (!this.tableName) throw new Error('Table name must be specified using from() method')
+    if (this.bulkInsertValues) {
+      return BuildQueryHelper.fingerprint(BuildQueryHelper.buildBulkInsertQuery(this.tableName, this.bulkInsertValues))
     }
+    return BuildQueryHelper.compile(this).fingerprint
+  }
 
-    const selectQuery = BuildQueryHelper.buildSelectQuery(this).join(' ')
-    console.log(`${COLORS.blue}[SELECT]${COLORS.reset}: ${selectQuery}`)
-    return selectQuery + ';'
+  getEquality(column: string): { value: any } | undefined {
+    if (this.nativeQuery || this.whereHasOr) return undefined
+    for (const key of [column, `${this.tableName}.${column}`]) {
+      if (this.whereEqualities.has(key)) return { value: this.whereEqualities.get(key) }
+    }
+    return undefined
   }
 }
 
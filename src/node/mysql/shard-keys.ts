@@ -0,0 +1,81 @@
+import { shardOf } from '../../build/Release/peek-orm.node'
+import { QueryBuilder, ShardRoute } from '../types'
+
+/**
+ * ## Shard Keys
+ * - Shard key column of every sharded table, declared by the schemas on connect
+ * - Reads the key of a statement from its records or its `where`, the native layer picks the shard
+ */
+export class ShardKeys {
+  /** Shard key column by table */
+  private static columns = new Map<string, string>()
+
+  /**
+   * Replace the shard keys, once the native layer accepted them
+   * @param keys - Table and shard key column of every sharded table
+   */
+  static declare(keys: { table: string; column: string }[]): void {
+    this.columns = new Map(keys.map(({ table, column }) => [table, column]))
+  }
+
+  /**
+   * Shard key column of a table
+   * @param table - Table name
+   * @returns Column, undefined when the table is not sharded
+   */
+  static column(table: string): string | undefined {
+    return this.columns.get(table)
+  }
+
+  /**
+   * Route of a statement whose `where` is an object, e.g. an update or a delete
+   * @param table - Table name
+   * @param where - Where object
+   * @returns {ShardRoute} The shard holding the key, every shard when `where` does not pin it
+   */
+  static fromWhere(table: string, where: Record<string, any>): ShardRoute {
+    const column = this.columns.get(table)
+    return column === undefined ? { table } : this.route(table, where[column])
+  }
+
+  /**
+   * Route of a built query
+   * @param table - Table name
+   * @param builder - Query builder
+   * @returns {ShardRoute} The shard holding the key, every shard when no equality of `where` pins it
+   */
+  static fromQuery(table: string, builder: QueryBuilder<any>): ShardRoute {
+    const column = this.columns.get(table)
+    return column === undefined ? { table } : this.route(table, builder.getEquality(column)?.value)
+  }
+
+  /**
+   * Split records by the shard holding their key, a table without a shard key keeps them together
+   * @param table - Table name
+   * @param records - Records
+   * @returns Records of every shard, each with the key of its first record, one group without records
+   */
+  static group<R extends Record<string, any>>(table: string, records: R[]): { route: ShardRoute; records: R[] }[] {
+    const column = this.columns.get(table)
+    if (column === undefined || records.length === 0) {
+      return [{ route: { table }, records }]
+    }
+
+    const groups = new Map<number, { route: ShardRoute; records: R[] }>()
+    for (const record of records) {
+      const shard = shardOf(table, record[column])
+      const group = groups.get(shard)
+      if (group) {
+        group.records.push(record)
+      } else {
+        groups.set(shard, { route: { table, shardKey: record[column] }, records: [record] })
+      }
+    }
+    return [...groups.values()]
+  }
+
+  /** `IS NULL` matches no key, so it reads every shard rather than failing */
+  private static route(table: string, key: any): ShardRoute {
+    return key === undefined || key === null || key === 'NULL' ? { table } : { table, shardKey: key }
+  }
+}
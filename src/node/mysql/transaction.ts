@@ -0,0 +1,206 @@
+import { transactionExecute, transactionSelect } from '../../build/Release/peek-orm.node'
+import { InsertedResult, QueryBuilder } from '../types'
+import { createQueryBuilder } from './query-builder'
+
+/** Write waiting to be flushed with the next batch */
+type PendingStatement = {
+  query: string
+  params: any[]
+  resolve: (result: InsertedResult) => void
+  reject: (error: unknown) => void
+}
+
+/**
+ * ## Transaction
+ * - Created by `peek.transaction`, every statement runs on the same pinned connection
+ * - Writes are queued and flushed together as one multi-statement round trip: on the next turn of the
+ *   event loop, before a select, or with the final COMMIT
+ * - Awaiting a write waits for its batch to be flushed
+ * - A failed batch fails the transaction: the earlier statements of the batch stay applied, so every later statement
+ *   and the commit reject with its error, and `peek.transaction` rolls back
+ * @example
+ * await peek.transaction(async (tx) => {
+ *   tx.insert('orders', { id: 1, total: 100 })
+ *   tx.updateOne('stock', { id: 7 }, { quantity: 9 })
+ * })
+ */
+export class Transaction {
+  private pending: PendingStatement[] = []
+  private timer: NodeJS.Immediate | null = null
+  private tail: Promise<void> = Promise.resolve()
+  private finished = false
+  private failure: { error: unknown } | null = null // First failed batch, the transaction can then only roll back
+
+  constructor(private readonly handle: unknown) {}
+
+  /**
+   * Queue an INSERT
+   * @param table - Name of the table to insert into
+   * @param values - Record or array of records to insert
+   * @returns Promise with the insert result, settled when the batch is flushed
+   */
+  insert<T extends Record<string, any>>(table: string, values: Partial<T> | Partial<T>[]): Promise<InsertedResult> {
+    return this.queue(createQueryBuilder<T>().from(table).insert(table, values))
+  }
+
+  /**
+   * Queue an UPDATE of one record
+   * @param table - Name of the table to update
+   * @param where - Where clause
+   * @param values - Values to set
+   * @returns Promise with the update result, settled when the batch is flushed
+   */
+  updateOne<T extends Record<string, any>>(table: string, where: Partial<T>, values: Partial<T>): Promise<InsertedResult> {
+    return this.queue(createQueryBuilder<T>().from(table).updateOne(table, where, values))
+  }
+
+  /**
+   * Queue an UPDATE of many records
+   * @param table - Name of the table to update
+   * @param where - Where clause
+   * @param values - Values to set
+   * @returns Promise with the update result, settled when the batch is flushed
+   */
+  updateMany<T extends Record<string, any>>(table: string, where: Partial<T>, values: Partial<T>[]): Promise<InsertedResult> {
+    return this.queue(createQueryBuilder<T>().from(table).updateMany(table, where, values))
+  }
+
+  /**
+   * Queue a DELETE
+   * @param table - Name of the table to delete from
+   * @param where - Where clause
+   * @returns Promise with the delete result, settled when the batch is flushed
+   */
+  delete<T extends Record<string, any>>(table: string, where: Partial<T>): Promise<InsertedResult> {
+    return this.queue(createQueryBuilder<T>().from(table).delete(table, where))
+  }
+
+  /**
+   * Execute a SELECT inside the transaction, after flushing the queued writes so it sees them
+   * @param table - Name of the table to query
+   * @param callback - Function to build the query
+   * @returns {Promise<T[]>} Array of query results
+   */
+  async select<T extends Record<string, any>>(
+    table: string,
+    callback: (queryBuilder: QueryBuilder<T>) => QueryBuilder<T>,
+  ): Promise<T[]> {
+    const query = callback(createQueryBuilder<T>().from(table))
+    const finalQuery = query.getQuery()
+    const parameters = query.getParameters()
+    await this.flush()
+    return this.run(() => transactionSelect(this.handle, finalQuery, parameters)) as Promise<T[]>
+  }
+
+  /**
+   * Execute a SELECT inside the transaction, returning the first row
+   * @param table - Name of the table to query
+   * @param callback - Function to build the query
+   * @returns {Promise<T>} Query result
+   */
+  async selectOne<T extends Record<string, any>>(
+    table: string,
+    callback: (queryBuilder: QueryBuilder<T>) => QueryBuilder<T>,
+  ): Promise<T> {
+    const rows = await this.select<T>(table, callback)
+    return rows[0]
+  }
+
+  /**
+   * Send the queued writes now
+   * @returns Promise settled once the batch ran, rejected with the error of the first failing statement
+   */
+  flush(): Promise<void> {
+    return this.send()
+  }
+
+  /** @internal Flush the queued writes together with COMMIT, rejected without committing once a batch failed */
+  commit(): Promise<void> {
+    return this.send('commit')
+  }
+
+  /** @internal Drop the queued writes and roll back */
+  rollback(): Promise<void> {
+    this.cancelFlush()
+    const dropped = this.pending
+    this.pending = []
+    const error = new Error('Transaction rolled back')
+    dropped.forEach((statement) => statement.reject(error))
+
+    this.finished = true
+    return this.run(() => transactionExecute(this.handle, [], 'rollback')).then(() => undefined)
+  }
+
+  private queue(builder: QueryBuilder<any>): Promise<InsertedResult> {
+    if (this.finished) {
+      return Promise.reject(new Error('Transaction is already finished'))
+    }
+
+    const promise = new Promise<InsertedResult>((resolve, reject) => {
+      this.pending.push({ query: builder.getQuery(), params: builder.getParameters(), resolve, reject })
+    })
+    // Writes are often not awaited one by one, their failure surfaces through the transaction itself
+    promise.catch(() => {})
+
+    if (!this.timer) {
+      this.timer = setImmediate(() => {
+        this.timer = null
+        this.send().catch(() => {})
+      })
+    }
+    return promise
+  }
+
+  private cancelFlush(): void {
+    if (this.timer) {
+      clearImmediate(this.timer)
+      this.timer = null
+    }
+  }
+
+  private send(end?: 'commit'): Promise<void> {
+    this.cancelFlush()
+    const batch = this.pending
+    this.pending = []
+
+    if (end) {
+      this.finished = true
+    }
+
+    return this.run(async () => {
+      // A batch flushed in the background may have failed after this one was queued
+      if (this.failure) {
+        batch.forEach((statement) => statement.reject(this.failure!.error))
+        throw this.failure.error
+      }
+      if (batch.length === 0 && !end) {
+        return
+      }
+
+      try {
+        const results = await transactionExecute(
+          this.handle,
+          batch.map((statement) => [statement.query, statement.params]),
+          end,
+        )
+        batch.forEach((statement, i) => statement.resolve(results[i]))
+      } catch (error) {
+        if (!this.failure) {
+          this.failure = { error }
+        }
+        batch.forEach((statement) => statement.reject(error))
+        throw error
+      }
+    })
+  }
+
+  /** Run native calls one after another, the pinned connection serves one statement at a time */
+  private run<T>(operation: () => Promise<T>): Promise<T> {
+    const result = this.tail.then(operation)
+    this.tail = result.then(
+      () => undefined,
+      () => undefined,
+    )
+    return result
+  }
+}
@@ -0,0 +1,37 @@
+/**
+ * Result cache statistics, see `peek.cacheStats`
+ */
+export type ResultCacheStats = {
+  /**
+   * Whether `resultCacheSize` enabled the cache
+   */
+  enabled: boolean
+  /**
+   * Selects served from the cache
+   */
+  hits: number
+  /**
+   * Cacheable selects sent to the server
+   */
+  misses: number
+  /**
+   * Results dropped to stay under `resultCacheSize`
+   */
+  evictions: number
+  /**
+   * Results dropped because a table they read was written
+   */
+  invalidations: number
+  /**
+   * Results dropped after `resultCacheTtl`
+   */
+  expirations: number
+  /**
+   * Cached results
+   */
+  entries: number
+  /**
+   * Memory held by the cached results
+   */
+  bytes: number
+}
@@ -1,3 +1,9 @@
 export * from './condition.type'
 export * from './insert.type'
 export * from './select.type'
+export * from './load.type'
+export * from './cache.type'
+export * from './stats.type'
+export * from './slow-query.type'
+export * from './packed.type'
+export * from './shard.type'
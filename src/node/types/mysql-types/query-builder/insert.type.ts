@@ -11,3 +11,31 @@ export type InsertedResult = {
    */
   insertId: number
 }
+
+/**
+ * Results of a bulk insert coming from C function
+ */
+export type BulkInsertedResult = InsertedResult & {
+  /**
+   * Last generated AUTO_INCREMENT ID, `insertId` to `lastInsertId` spans the IDs of the inserted rows
+   */
+  lastInsertId: number
+  /**
+   * Number of INSERT statements the rows were split into to fit `max_allowed_packet`
+   */
+  statements: number
+}
+
+/**
+ * Options of a bulk insert
+ */
+export type BulkInsertOptions = {
+  /**
+   * Number of pooled connections the rows are spread over, capped by the pool size
+   * - With `1` the insert is all or nothing
+   * - Above `1` it is not atomic: each connection commits its share of the rows on its own, so a failure leaves the
+   *   shares that succeeded inserted. The rejected error's `result` counts them
+   * @default 1
+   */
+  parallel?: number
+}
@@ -0,0 +1,57 @@
+/**
+ * Format of the data fed to `peek.load`
+ * - `csv`: fields separated by `,`, optionally enclosed by `"`, escaped by `\`
+ * - `tsv`: MySQL's default format, fields separated by tabs, `\N` for NULL
+ */
+export type LoadFormat = 'csv' | 'tsv'
+
+/**
+ * Data fed to `peek.load`
+ * - Raw file data as a Buffer, a string, or an array or (async) iterable of chunks, e.g. a `fs.ReadStream`
+ * - Rows as arrays of values, serialized as TSV
+ */
+export type LoadSource =
+  | Buffer
+  | string
+  | (Buffer | string)[]
+  | any[][]
+  | Iterable<Buffer | string>
+  | AsyncIterable<Buffer | string>
+
+/**
+ * Options of a LOAD DATA LOCAL INFILE
+ */
+export type LoadOptions = {
+  /**
+   * Format of raw file data, rows given as arrays are always sent as TSV
+   * @default 'tsv'
+   */
+  format?: LoadFormat
+  /**
+   * Number of leading lines to skip, e.g. `1` for a CSV header
+   * @default 0
+   */
+  ignoreLines?: number
+  /**
+   * Called with the number of bytes sent to the server, about every megabyte
+   */
+  onProgress?: (bytes: number) => void
+}
+
+/**
+ * Results of a LOAD DATA LOCAL INFILE coming from C function
+ */
+export type LoadResult = {
+  /**
+   * Number of loaded rows
+   */
+  affectedRows: number
+  /**
+   * Number of warnings, e.g. truncated values or rows with missing fields
+   */
+  warnings: number
+  /**
+   * Number of bytes sent to the server
+   */
+  bytes: number
+}
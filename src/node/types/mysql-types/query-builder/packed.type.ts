@@ -0,0 +1,15 @@
+/**
+ * Result set copied into one ArrayBuffer by `select(query, params, { packed: true })`
+ * - For `n = rows * columns.length` cells in row-major order, `buffer` holds `n` slots of 8 bytes, `n` tag bytes,
+ *   then the bytes of every string and buffer
+ * - Read through `PackedRows`, which decodes a field only when it is accessed
+ */
+export type PackedResult = {
+  columns: string[]
+  /**
+   * How each column decodes: 0 int, 1 unsigned int, 2 double, 3 date, 4 string, 5 buffer
+   */
+  kinds: number[]
+  rows: number
+  buffer: ArrayBuffer
+}
@@ -166,6 +166,39 @@ export interface QueryBuilder<T = any> {
    */
   getQuery(): string
 
+  /**
+   * Returns the values bound to the `?` placeholders of the last `getQuery()` call, in placeholder order
+   * @returns Placeholder values
+   * @example
+   * const query = queryBuilder.from('users').where({ status: 'active' }).getQuery()
+   * // SELECT * FROM users WHERE status = ?;
+   * const values = queryBuilder.getParameters()
+   * // ['active']
+   */
+  getParameters(): any[]
+
+  /**
+   * Returns the fingerprint of the query shape: the statement with every value and literal replaced by `?`
+   * - Queries that only differ in their values share a fingerprint, so it can key caches and statistics
+   * - `peek` selects pass it to the native layer, it is the `fingerprint` of their `peek.slowQueries()` entry
+   * @returns Normalized statement
+   * @example
+   * queryBuilder.from('users').where({ id: 1 }).getFingerprint() // 'SELECT * FROM users WHERE id = ?'
+   * queryBuilder.from('users').where({ id: 1 }).getFingerprint() ===
+   *   createQueryBuilder().from('users').where({ id: 2 }).getFingerprint() // true
+   */
+  getFingerprint(): string
+
+  /**
+   * Returns the value an object `where` pins a column to, e.g. to route the query to the shard holding it
+   * - Only equalities every row of the result satisfies count: none once `orWhere` was used
+   * @param column - Column name, also matched as `table.column`
+   * @returns The value, undefined when the column is not pinned
+   * @example
+   * queryBuilder.from('orders').where({ customer_id: 7 }).getEquality('customer_id') // { value: 7 }
+   */
+  getEquality(column: string): { value: any } | undefined
+
   /**
    * Adds an INSERT INTO clause to the query
    * @param options - Insert options
@@ -203,3 +236,14 @@ export interface QueryBuilder<T = any> {
    */
   bulkInsert(tableName: string, values: any[]): QueryBuilder<T>
 }
+
+/**
+ * Options of a streaming SELECT
+ */
+export type SelectStreamOptions = {
+  /**
+   * Number of rows fetched from the server per batch
+   * @default 1000
+   */
+  batchSize?: number
+}
@@ -0,0 +1,9 @@
+/**
+ * Where a statement on a table runs, see the `shards` pool option
+ * - A table without a declared shard key runs on the primary
+ * - A sharded table runs on the shard holding `shardKey`, or on every shard when it is left out
+ */
+export type ShardRoute = {
+  table: string
+  shardKey?: any
+}
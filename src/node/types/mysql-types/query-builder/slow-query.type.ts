@@ -0,0 +1,106 @@
+/**
+ * Table access of an EXPLAIN
+ */
+export type SlowQueryTable = {
+  /**
+   * Table, resolved from its alias when the statement aliases it
+   */
+  table: string
+  /**
+   * Join type: `ALL` is a full table scan, `index` a full index scan
+   */
+  access: string
+  /**
+   * Index used, absent without one
+   */
+  key?: string
+  /**
+   * Rows examined per scan, as estimated by the optimizer
+   */
+  rows: number
+  /**
+   * Columns of the table the attached condition filters on
+   */
+  filterColumns: string[]
+}
+
+/**
+ * Plan of a slow query, read from `EXPLAIN FORMAT=JSON`
+ */
+export type SlowQueryPlan = {
+  fullScan: boolean
+  filesort: boolean
+  temporaryTable: boolean
+  /**
+   * Columns of the outermost ORDER BY
+   */
+  orderColumns: string[]
+  tables: SlowQueryTable[]
+}
+
+/**
+ * Index advised for a slow query
+ */
+export type SlowQueryIndex = {
+  table: string
+  /**
+   * Name of the index in the schema, absent for a suggested index no schema declares
+   */
+  name?: string
+  columns: string[]
+}
+
+/**
+ * Slow queries sharing a fingerprint
+ */
+export type SlowQuery = {
+  /**
+   * Statement with its literals and placeholders replaced by `?`
+   */
+  fingerprint: string
+  count: number
+  /**
+   * Milliseconds, from the call to the decoded rows
+   */
+  totalTime: number
+  meanTime: number
+  maxTime: number
+  /**
+   * Absent until the EXPLAIN ran
+   */
+  plan?: SlowQueryPlan
+  /**
+   * Why the last EXPLAIN failed
+   */
+  explainError?: string
+  /**
+   * Indexes of the schemas whose first column a full scan or filesort filters or sorts on
+   */
+  coveringIndexes: SlowQueryIndex[]
+  /**
+   * Columns to index for the full scans and filesorts no schema index covers
+   */
+  suggestedIndexes: SlowQueryIndex[]
+}
+
+/**
+ * Slow queries since `initialize` or the last reset, see `peek.slowQueries`
+ */
+export type SlowQueryReport = {
+  /**
+   * Whether the `slowQueryThreshold` pool option is set
+   */
+  enabled: boolean
+  /**
+   * Milliseconds from which a select is slow
+   */
+  threshold: number
+  /**
+   * Slow queries not tracked, past 256 fingerprints
+   */
+  dropped: number
+  /**
+   * Slowest total time first
+   */
+  queries: SlowQuery[]
+}
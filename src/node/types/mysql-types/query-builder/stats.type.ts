@@ -0,0 +1,85 @@
+/**
+ * Latency summary of a histogram, in milliseconds
+ * - Quantiles are read from log-linear buckets, within 1/16 of the exact value
+ */
+export type LatencyStats = {
+  /**
+   * Recorded values
+   */
+  count: number
+  mean: number
+  p50: number
+  p90: number
+  p99: number
+  p999: number
+  max: number
+}
+
+/**
+ * Metrics of one kind of operation
+ */
+export type OperationStats = {
+  /**
+   * Settled operations
+   */
+  count: number
+  /**
+   * Rejected operations
+   */
+  errors: number
+  /**
+   * Rows decoded from the server
+   */
+  rows: number
+  /**
+   * Bytes of the decoded values: string and binary lengths, 8 per other value
+   */
+  bytes: number
+  /**
+   * Time from the call to the settled promise
+   */
+  latency: LatencyStats
+}
+
+/**
+ * Performance metrics since the process started, see `peek.stats`
+ */
+export type PeekStats = {
+  operations: {
+    select: OperationStats
+    insert: OperationStats
+    update: OperationStats
+    delete: OperationStats
+    bulk_insert: OperationStats
+    load: OperationStats
+    stream: OperationStats
+    transaction: OperationStats
+    batch: OperationStats
+  }
+  pool: {
+    /**
+     * Open connections
+     */
+    open: number
+    idle: number
+    inUse: number
+    /**
+     * Queries waiting for a free connection
+     */
+    waiting: number
+    maxSize: number
+    /**
+     * Time spent getting a connection from the pool
+     */
+    acquireWait: LatencyStats
+    /**
+     * Checkouts that timed out or could not connect
+     */
+    acquireFailures: number
+    /**
+     * Connections reopened after a failed ping
+     */
+    reconnects: number
+    pings: number
+  }
+}
@@ -91,4 +91,82 @@ export type CreateTableParams<T extends Record<string, unknown>> = {
    * Indexes
    */
   indexes?: CreateIndexParams<T>[]
+  /**
+   * Column spreading the rows over the `shards` of the pool options, ignored without shards
+   */
+  shardKey?: ShardKeyParams<T>
+}
+
+/**
+ * Shard key of a table
+ * - `hash`: a consistent hash of the key, for an even spread
+ * - `range`: `ranges` are the lowest numeric key of every shard but the first, ascending, one less than the shards
+ */
+export type ShardKeyParams<T> = {
+  /**
+   * Shard key column, every row needs a value
+   */
+  column: keyof T
+  /**
+   * How a key picks its shard
+   * @default 'hash'
+   */
+  strategy?: 'hash' | 'range'
+  /**
+   * Lowest key of shards 1 to n - 1, for `range`
+   */
+  ranges?: number[]
+}
+
+/**
+ * Table schema handed to the native schema sync, built from `CreateTableParams`
+ */
+export type SchemaSyncTable = {
+  /**
+   * Table name
+   */
+  name: string
+  /**
+   * Hash of everything below, the table is skipped while it matches the hash of its last sync
+   */
+  hash?: string
+  /**
+   * Columns, `definition` as in CREATE TABLE
+   */
+  columns: { name: string; definition: string }[]
+  /**
+   * Foreign keys, only applied when the table is created
+   */
+  constraints?: string[]
+  /**
+   * Indexes, `columns` comma separated
+   */
+  indexes?: { name: string; columns: string }[]
+  /**
+   * Tables synced before this one
+   */
+  references?: string[]
+  /**
+   * Shard key, the table is synced on every shard instead of the primary
+   */
+  shardKey?: { column: string; strategy: 'hash' | 'range'; ranges?: number[] }
+}
+
+/**
+ * Outcome of syncing one table
+ * - `skipped`: hash matched the last sync, not introspected
+ * - `unchanged`: introspected, already matches its schema
+ * - `created`: one CREATE TABLE with its indexes ran
+ * - `altered`: one ALTER TABLE ran, with the cheapest `algorithm` the server accepted
+ * - `failed`: the statement failed, see `error`
+ */
+export type SchemaSyncResult = {
+  name: string
+  status: 'skipped' | 'unchanged' | 'created' | 'altered' | 'failed'
+  /**
+   * Columns, constraints and indexes created, added, dropped or modified
+   */
+  changes: number
+  algorithm?: 'instant' | 'inplace' | 'copy'
+  error?: string
 }
@@ -1,3 +1,208 @@
+/**
+ * Connection pool options
+ */
+export type PoolOptions = {
+  /**
+   * Connections opened at startup and kept open while idle
+   * @default 2
+   */
+  minPoolSize?: number
+  /**
+   * Maximum number of open connections
+   * @default 10
+   */
+  maxPoolSize?: number
+  /**
+   * Milliseconds a query waits for a free connection before failing, `-1` waits forever
+   * @default 10000
+   */
+  acquireTimeout?: number
+  /**
+   * Milliseconds an idle connection above `minPoolSize` is kept open, `0` never closes it
+   * @default 60000
+   */
+  idleTimeout?: number
+  /**
+   * Milliseconds a connection may sit idle before a checkout pings it first, `-1` never pings
+   * @default 5000
+   */
+  validateAfter?: number
+  /**
+   * Milliseconds between background health checks of idle connections, `0` disables them
+   * @default 30000
+   */
+  healthCheckInterval?: number
+  /**
+   * Prepared statements kept per connection, least recently used ones are closed first
+   * @default 64
+   */
+  statementCacheSize?: number
+  /**
+   * Allow `LOAD DATA LOCAL INFILE`, served only from memory by `peek.load`, never from the local file system
+   * @default false
+   */
+  localInfile?: boolean
+  /**
+   * How `select`, `insert`, `update` and `delete` run
+   * - `thread`: each query blocks a libuv worker thread while it waits for the server
+   * - `eventloop`: queries run on the main thread with the nonblocking MySQL client API, sockets are polled by the
+   *   event loop, so hundreds of queries can be in flight without a thread each. Statements above 128KB, streams,
+   *   bulk inserts, loads and transactions still use worker threads
+   * @default 'thread'
+   */
+  executionMode?: 'thread' | 'eventloop'
+  /**
+   * Bytes of memory for cached `select` results, `0` disables the cache
+   * - Plain SELECTs without volatile functions such as `NOW()` are cached by SQL and values
+   * - Inserts, updates, deletes, bulk inserts and loads invalidate the results of the tables they write,
+   *   a committed transaction invalidates every result
+   * - Writes from other clients are not seen, they only expire with `resultCacheTtl`
+   * @default 0
+   */
+  resultCacheSize?: number
+  /**
+   * Milliseconds a cached result stays valid, `0` until invalidated or evicted
+   * @default 60000
+   */
+  resultCacheTtl?: number
+  /**
+   * Read replicas, each with its own pool sized like the primary's
+   * - `select` goes to the healthy replica with the fewest queries in flight, or to the primary when none is healthy
+   *   or the replica has no connection to spare within `acquireTimeout`
+   * - Writes, DDL, streams, batches, loads and transactions always use the primary
+   * - With replicas, selects run on worker threads even with `executionMode: 'eventloop'`
+   */
+  replicas?: ReplicaParams[]
+  /**
+   * Milliseconds selects stay on the primary after a write, so they see it despite replication lag, `0` never pins
+   * @default 0
+   */
+  readYourWrites?: number
+  /**
+   * Milliseconds between pings of every replica, an unreachable replica is ejected until it answers again
+   * - Must be above `0` with replicas, the ping is what re-adds an ejected replica
+   * @default 5000
+   */
+  replicaCheckInterval?: number
+  /**
+   * Shards, each with its own pool sized like the primary's
+   * - Tables whose schema declares a `shardKey` are created on every shard, each shard holding the rows its keys
+   *   route to. The other tables stay on the primary
+   * - Queries that pin the shard key with an equality of `where` run on one shard, the others on every shard, merged
+   *   by their ORDER BY, LIMIT and OFFSET
+   * - Streams, batches, loads and transactions always use the primary
+   * @see README, Sharding
+   */
+  shards?: ShardParams[]
+  /**
+   * Milliseconds from which a select is slow, `0` disables slow query tracking
+   * - Slow selects are grouped by fingerprint, and one per fingerprint and minute is re-run in the background as
+   *   `EXPLAIN FORMAT=JSON` on a primary connection
+   * - Full scans, filesorts and temporary tables are matched against the `indexes` of the synced schemas, see
+   *   `peek.slowQueries`
+   * @default 0
+   */
+  slowQueryThreshold?: number
+  /**
+   * Backend the native layer talks to
+   * - `mysql`: libmysqlclient
+   * - `fake`: a deterministic in-process server with synthetic tables, see `fakeDriver`. Measures the ORM without
+   *   server time, nothing is stored. Not available with `executionMode: 'eventloop'`
+   * @default 'mysql'
+   */
+  driver?: 'mysql' | 'fake'
+  /**
+   * Synthetic data served by `driver: 'fake'`
+   */
+  fakeDriver?: FakeDriverParams
+}
+
+/**
+ * Synthetic data of the fake driver
+ * - Every SELECT returns the same table, capped by its LIMIT: `id`, then columns cycling through BIGINT, VARCHAR,
+ *   DOUBLE, DATETIME and BLOB
+ * - SHOW and DESCRIBE return no rows, INSERT affects one row per VALUES tuple, UPDATE and DELETE one row
+ */
+export type FakeDriverParams = {
+  /**
+   * Columns of the synthetic table, 1 to 4096
+   * @default 10
+   */
+  columns?: number
+  /**
+   * Rows of the synthetic table
+   * @default 100
+   */
+  rows?: number
+  /**
+   * Microseconds slept per round trip, to stand in for the network and the server
+   * @default 0
+   */
+  latencyUs?: number
+}
+
+/**
+ * Read replica, credentials left out are the primary's
+ */
+export type ReplicaParams = {
+  /**
+   * Replica host
+   */
+  host: string
+  /**
+   * Replica port
+   * @default the primary's port
+   */
+  port?: number
+  /**
+   * Replica user
+   */
+  user?: string
+  /**
+   * Replica password
+   */
+  password?: string
+  /**
+   * Replica database
+   */
+  database?: string
+}
+
+/**
+ * Shard, credentials left out are the primary's
+ */
+export type ShardParams = ReplicaParams
+
+/**
+ * State of a read replica, see `peek.replicaStatus`
+ */
+export type ReplicaStatus = {
+  /**
+   * Replica host
+   */
+  host: string
+  /**
+   * Replica port
+   */
+  port: number
+  /**
+   * False while the replica is ejected
+   */
+  healthy: boolean
+  /**
+   * Selects running on the replica
+   */
+  outstanding: number
+  /**
+   * Selects routed to the replica since `initialize`
+   */
+  reads: number
+  /**
+   * Times the replica was ejected
+   */
+  ejections: number
+}
+
 /**
  * MySQL connection parameters
  */
@@ -22,4 +227,8 @@ export type ConnectParams = {
    * MySQL port
    */
   port: number
+  /**
+   * Connection pool options
+   */
+  pool?: PoolOptions
 }
@@ -7,6 +7,8 @@ declare module '*.node' {
    * @param password - MySQL password
    * @param database - MySQL database
    * @param port - MySQL port
+   * @param options - Connection pool options, `executionMode` aside they must match the ones of any other `worker_threads`
+   * environment already initialized with the same server and credentials
    * @returns {Promise<boolean>} - True if initialization successful, false otherwise
    */
   export async function initialize(
@@ -15,10 +17,11 @@ declare module '*.node' {
     password: string,
     database: string,
     port: number,
+    options?: import('./mysql-types').PoolOptions,
   ): Promise<boolean>
 
   /**
-   * Cleanup MySQL connection
+   * Cleanup MySQL connection, the shared pool closes once every environment using it cleaned up or exited
    * @returns {Promise<boolean>} - True if cleanup successful, false otherwise
    */
   export async function cleanup(): Promise<boolean>
@@ -73,31 +76,56 @@ declare module '*.node' {
 
   /**
    * Select query
-   * @param query - SQL query
+   * @param query - SQL query with `?` placeholders
+   * @param params - Values bound to the placeholders
+   * @param options - Shard the select runs on, and the query builder's fingerprint slow selects are reported under
    * @returns {Promise<any>} - Query result
    */
-  export function select(query: string): Promise<any>
+  export function select(
+    query: string,
+    params?: any[],
+    options?: import('./mysql-types').ShardRoute & { fingerprint?: string },
+  ): Promise<any>
+
+  /**
+   * Select query, resolving with the rows copied into one ArrayBuffer
+   * @param query - SQL query with `?` placeholders
+   * @param params - Values bound to the placeholders
+   * @param options - `packed: true`, the shard the select runs on and the query builder's fingerprint
+   * @returns {Promise<import('./mysql-types').PackedResult>} - Packed rows, read with `PackedRows`
+   */
+  export function select(
+    query: string,
+    params: any[] | undefined,
+    options: { packed: true; fingerprint?: string } & Partial<import('./mysql-types').ShardRoute>,
+  ): Promise<import('./mysql-types').PackedResult>
 
   /**
    * Insert query
-   * @param query - SQL query
+   * @param query - SQL query with `?` placeholders
+   * @param params - Values bound to the placeholders
+   * @param options - Shard the insert runs on, an insert into a sharded table needs `shardKey`
    * @returns {Promise<any>} - Query result
    */
-  export function insert(query: string): Promise<any>
+  export function insert(query: string, params?: any[], options?: import('./mysql-types').ShardRoute): Promise<any>
 
   /**
    * Update query
-   * @param query - SQL query
+   * @param query - SQL query with `?` placeholders
+   * @param params - Values bound to the placeholders
+   * @param options - Shard the update runs on
    * @returns {Promise<any>} - Query result
    */
-  export function update(query: string): Promise<any>
+  export function update(query: string, params?: any[], options?: import('./mysql-types').ShardRoute): Promise<any>
 
   /**
    * Delete query
-   * @param query - SQL query
+   * @param query - SQL query with `?` placeholders
+   * @param params - Values bound to the placeholders
+   * @param options - Shard the delete runs on
    * @returns {Promise<any>} - Query result
    */
-  export function deleteQuery(query: string): Promise<any>
+  export function deleteQuery(query: string, params?: any[], options?: import('./mysql-types').ShardRoute): Promise<any>
 
   /**
    * Bulk insert query
@@ -105,4 +133,197 @@ declare module '*.node' {
    * @returns {Promise<any>} - Query result
    */
   export function bulkInsert(query: string): Promise<any>
+
+  /**
+   * Open a streaming select over a server side cursor
+   * @param query - SQL query with `?` placeholders
+   * @param params - Values bound to the placeholders
+   * @param batchSize - Rows fetched per batch
+   * @returns {Promise<unknown>} - Stream handle, pins a pooled connection until exhausted or closed
+   */
+  export function selectStream(query: string, params?: any[], batchSize?: number): Promise<unknown>
+
+  /**
+   * Fetch the next batch of a stream
+   * @param handle - Stream handle
+   * @returns {Promise<any[]>} - Next rows, empty once the stream is exhausted
+   */
+  export function streamNext(handle: unknown): Promise<any[]>
+
+  /**
+   * Close a stream and return its connection to the pool
+   * @param handle - Stream handle
+   * @returns {boolean} - True once closed
+   */
+  export function streamClose(handle: unknown): boolean
+
+  /**
+   * Bulk insert an array of records, serialized natively into INSERTs that fit `max_allowed_packet`
+   * @param table - Table name
+   * @param records - Records, columns are the keys of the first record
+   * @param options - Bulk insert options, and the shard of the records for a sharded table
+   * @returns {Promise<import('./mysql-types').BulkInsertedResult>} - Aggregate result, on failure the rejected error's
+   * `result` counts the rows kept by the connections that succeeded with `parallel` > 1
+   */
+  export function bulkInsertRows(
+    table: string,
+    records: Record<string, any>[],
+    options?: import('./mysql-types').BulkInsertOptions & Partial<import('./mysql-types').ShardRoute>,
+  ): Promise<import('./mysql-types').BulkInsertedResult>
+
+  /**
+   * Start a LOAD DATA LOCAL INFILE whose file data is written from memory
+   * @param query - LOAD DATA LOCAL INFILE query, the file name is ignored
+   * @param onEvent - Called with `drain` once queued data fell below the high water mark, and with `progress`
+   * @returns Load handle and the promise of the load result
+   */
+  export function loadData(
+    query: string,
+    onEvent: (event: 'drain' | 'progress', bytes: number) => void,
+  ): { handle: unknown; done: Promise<import('./mysql-types').LoadResult> }
+
+  /**
+   * Queue a chunk of file data
+   * @param handle - Load handle
+   * @param chunk - File data
+   * @returns {boolean} - False when the caller should wait for a `drain` event before writing more
+   */
+  export function loadWrite(handle: unknown, chunk: Buffer | string): boolean
+
+  /**
+   * Mark the end of the file data
+   * @param handle - Load handle
+   */
+  export function loadEnd(handle: unknown): void
+
+  /**
+   * Abort a load, the statement fails with the given message
+   * @param handle - Load handle
+   * @param message - Error message
+   */
+  export function loadAbort(handle: unknown, message?: string): void
+
+  /**
+   * Begin a transaction
+   * @returns {Promise<unknown>} - Transaction handle, pins a pooled connection until committed or rolled back
+   */
+  export function transactionBegin(): Promise<unknown>
+
+  /**
+   * Run writes of a transaction as one multi-statement round trip
+   * @param handle - Transaction handle
+   * @param statements - `[query, params]` pairs
+   * @param end - Append COMMIT or ROLLBACK and release the connection
+   * @returns {Promise<import('./mysql-types').InsertedResult[]>} - Result of every statement
+   */
+  export function transactionExecute(
+    handle: unknown,
+    statements: [string, any[]][],
+    end?: 'commit' | 'rollback',
+  ): Promise<import('./mysql-types').InsertedResult[]>
+
+  /**
+   * Run a select inside a transaction
+   * @param handle - Transaction handle
+   * @param query - SQL query with `?` placeholders
+   * @param params - Values bound to the placeholders
+   * @returns {Promise<any[]>} - Query result
+   */
+  export function transactionSelect(handle: unknown, query: string, params?: any[]): Promise<any[]>
+
+  /**
+   * Run independent queries as one multi-statement round trip
+   * @param queries - `[query, params]` pairs
+   * @returns {Promise<any[][]>} - Rows of every query, in order
+   */
+  export function batchQuery(queries: [string, any[]][]): Promise<any[][]>
+
+  /**
+   * Create and alter tables to match their schemas
+   * - Tables whose hash matches their last sync are skipped, the others are introspected in one round trip
+   * - Each table gets one CREATE TABLE or one ALTER TABLE, tried with `ALGORITHM=INSTANT`, then `INPLACE, LOCK=NONE`
+   * - Statements run on up to `parallel` pooled connections, a table after the tables it references
+   * @param tables - Table schemas
+   * @param options - `parallel`, default 4, capped by `maxPoolSize`. `shards` syncs the tables on every shard, one
+   *   shard after the other, instead of the primary
+   * @returns {Promise<import('./mysql-types').SchemaSyncResult[]>} - One result per table, in order
+   */
+  export function syncSchema(
+    tables: import('./mysql-types').SchemaSyncTable[],
+    options?: { parallel?: number; shards?: boolean },
+  ): Promise<import('./mysql-types').SchemaSyncResult[]>
+
+  /**
+   * Read the result cache statistics
+   * @returns {import('./mysql-types').ResultCacheStats} - Counters since `initialize`
+   */
+  export function resultCacheStats(): import('./mysql-types').ResultCacheStats
+
+  /**
+   * Invalidate cached results
+   * @param table - Table whose results are invalidated, all results when omitted
+   * @returns {boolean} - True
+   */
+  export function resultCacheClear(table?: string): boolean
+
+  /**
+   * Read the state of the read replicas
+   * @returns {import('./mysql-types').ReplicaStatus[]} - One status per replica, empty without replicas
+   */
+  export function replicaStatus(): import('./mysql-types').ReplicaStatus[]
+
+  /**
+   * Read the performance metrics
+   * @returns {import('./mysql-types').PeekStats} - Latency histograms, rows decoded and pool counters
+   */
+  export function stats(): import('./mysql-types').PeekStats
+
+  /**
+   * Render the performance metrics in the Prometheus text exposition format
+   * @returns {string} - Metrics text
+   */
+  export function prometheusMetrics(): string
+
+  /**
+   * Read the slow queries and the indexes advised for them
+   * @returns {import('./mysql-types').SlowQueryReport} - Slow queries since `initialize` or the last reset
+   */
+  export function slowQueryReport(): import('./mysql-types').SlowQueryReport
+
+  /**
+   * Forget the slow queries seen so far, the schema indexes are kept
+   * @returns {boolean} - True
+   */
+  export function slowQueryReset(): boolean
+
+  /**
+   * Declare the indexes of the schemas, which slow queries are matched against
+   * @param indexes - Indexes, `columns` as written in the schema
+   * @returns {boolean} - True
+   */
+  export function declareIndexes(indexes: { table: string; name: string; columns: string }[]): boolean
+
+  /**
+   * Fingerprint a statement, the key `slowQueryReport` groups selects by
+   * @param query - SQL statement
+   * @returns {string} - Statement with every literal and placeholder replaced by `?`
+   */
+  export function fingerprint(query: string): string
+
+  /**
+   * Declare the shard keys of the schemas, replacing the previous key of a table
+   * @param keys - Shard keys, `ranges` for `strategy: 'range'`
+   * @returns {boolean} - False without the `shards` option, the keys are then ignored
+   */
+  export function declareShardKeys(
+    keys: { table: string; column: string; strategy: 'hash' | 'range'; ranges?: number[] }[],
+  ): boolean
+
+  /**
+   * Find the shard holding a key of a table
+   * @param table - Table name
+   * @param key - Shard key value
+   * @returns {number} - Shard index, -1 when the table is not sharded
+   */
+  export function shardOf(table: string, key: any): number
 }
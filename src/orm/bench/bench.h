@@ -0,0 +1,58 @@
+#ifndef PEEK_BENCH_H
+#define PEEK_BENCH_H
+
+#include <mysql.h>
+#include <node_api.h>
+#include <stdint.h>
+
+/**
+ * # Native micro-benchmarks
+ * - Built as the separate `peek-orm-bench` addon, on the fake driver (see `mysql_driver.h`) instead of libmysqlclient
+ * - The fake driver serves synthetic rows and never touches the network, so only the C layer is measured
+ * - Run with `npm run benchmark:native`
+ */
+
+/**
+ * Monotonic clock in nanoseconds
+ * @return uint64_t - Nanoseconds
+ */
+uint64_t bench_now_ns(void);
+
+/**
+ * Read an optional integer property of an options object
+ * @param env - N-API environment
+ * @param options - Options object, may be undefined
+ * @param key - Property name
+ * @param fallback - Value when the property is missing or not a number
+ * @return int - Value
+ */
+int bench_get_int(napi_env env, napi_value options, const char *key, int fallback);
+
+/**
+ * Set a named number property
+ */
+void bench_set_number(napi_env env, napi_value obj, const char *key, double number);
+
+/**
+ * Decode synthetic rows and build their JS objects
+ * @example
+ * decode({ rows: 1000, columns: 10, iterations: 200 });
+ */
+napi_value BenchDecode(napi_env env, napi_callback_info info);
+
+/**
+ * Check connections out of the pool and back from contending threads
+ * @example
+ * pool({ threads: 8, poolSize: 4, iterations: 100000 });
+ * pool({ threads: 4, poolSize: 1, iterations: 1000, discard: 1, acquireTimeout: 2000 });
+ */
+napi_value BenchPool(napi_env env, napi_callback_info info);
+
+/**
+ * Interpolate placeholder values into SQL text, as batches do
+ * @example
+ * sql({ params: 8, iterations: 100000 });
+ */
+napi_value BenchSql(napi_env env, napi_callback_info info);
+
+#endif
@@ -0,0 +1,100 @@
+#include "../include/mysql_arena.h"
+#include "../include/mysql_driver.h"
+#include "../include/mysql_result.h"
+#include "bench.h"
+#include <node_api.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * ## Row decode benchmark
+ * - `decode`: `result_from_stmt` copying the bound buffers of every row into a `PeekResult`
+ * - `toJs`: `result_to_js` building the array of row objects
+ * @return { rows, columns, iterations, bytesPerRow, decodeNsPerRow, toJsNsPerRow }
+ */
+napi_value BenchDecode(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    napi_value options = args[0];
+    if (argc < 1) {
+        napi_get_undefined(env, &options);
+    }
+    int rows = bench_get_int(env, options, "rows", 1000);
+    int columns = bench_get_int(env, options, "columns", 10);
+    int iterations = bench_get_int(env, options, "iterations", 100);
+
+    if (rows < 1 || columns < 1 || columns > FAKE_COLUMNS_LIMIT || iterations < 1) {
+        napi_throw_range_error(env, NULL, "Expected rows and iterations >= 1, 1 <= columns <= 4096");
+        return NULL;
+    }
+
+    //? Step 1: A statement of the fake driver serving the synthetic table, executed once and decoded again and again
+    FakeDriverOptions fake_options = {.columns = columns, .rows = rows, .latency_us = 0};
+    fake_driver_configure(&fake_options);
+
+    const char *query = "SELECT * FROM synthetic";
+    MYSQL *conn = peek_driver->init(NULL);
+    MYSQL_STMT *stmt = NULL;
+    if (!conn || !peek_driver->real_connect(conn, NULL, NULL, NULL, NULL, 0, NULL, 0) ||
+        !(stmt = peek_driver->stmt_init(conn)) || peek_driver->stmt_prepare(stmt, query, (unsigned long)strlen(query)) ||
+        peek_driver->stmt_execute(stmt)) {
+        if (stmt) {
+            peek_driver->stmt_close(stmt);
+        }
+        peek_driver->close(conn);
+        napi_throw_error(env, NULL, "Failed to prepare the synthetic statement");
+        return NULL;
+    }
+
+    Arena scratch;
+    arena_init(&scratch, 0);
+
+    char error[256];
+    uint64_t decode_ns = 0, to_js_ns = 0;
+    size_t bytes = 0;
+
+    // One extra untimed round warms the arena and the allocator
+    for (int i = 0; i <= iterations; i++) {
+        uint64_t started = bench_now_ns();
+        PeekResult *result = result_from_stmt(stmt, &scratch, error, sizeof(error));
+        uint64_t decoded = bench_now_ns();
+        if (!result) {
+            arena_destroy(&scratch);
+            peek_driver->stmt_close(stmt);
+            peek_driver->close(conn);
+            napi_throw_error(env, NULL, error);
+            return NULL;
+        }
+
+        napi_handle_scope scope;
+        napi_open_handle_scope(env, &scope);
+        uint64_t converting = bench_now_ns();
+        result_to_js(env, result);
+        uint64_t converted = bench_now_ns();
+        napi_close_handle_scope(env, scope);
+
+        if (i > 0) {
+            decode_ns += decoded - started;
+            to_js_ns += converted - converting;
+        }
+        bytes = result->bytes;
+        result_free(result);
+    }
+
+    arena_destroy(&scratch);
+    peek_driver->stmt_close(stmt);
+    peek_driver->close(conn);
+
+    double total_rows = (double)rows * iterations;
+    napi_value obj;
+    napi_create_object(env, &obj);
+    bench_set_number(env, obj, "rows", rows);
+    bench_set_number(env, obj, "columns", columns);
+    bench_set_number(env, obj, "iterations", iterations);
+    bench_set_number(env, obj, "bytesPerRow", (double)bytes / rows);
+    bench_set_number(env, obj, "decodeNsPerRow", (double)decode_ns / total_rows);
+    bench_set_number(env, obj, "toJsNsPerRow", (double)to_js_ns / total_rows);
+    return obj;
+}
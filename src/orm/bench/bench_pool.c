@@ -0,0 +1,143 @@
+#include "../include/mysql_pool.h"
+#include "bench.h"
+#include <node_api.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** Start gate, opened once every thread is created */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool open;
+} StartGate;
+
+/** Benchmark thread */
+typedef struct {
+    ConnectionPool *pool;
+    StartGate *gate;
+    int iterations;
+    bool discard; // Close every connection instead of returning it
+    int failures;
+} PoolWorker;
+
+static void *pool_worker(void *arg) {
+    PoolWorker *worker = (PoolWorker *)arg;
+
+    pthread_mutex_lock(&worker->gate->lock);
+    while (!worker->gate->open) {
+        pthread_cond_wait(&worker->gate->cond, &worker->gate->lock);
+    }
+    pthread_mutex_unlock(&worker->gate->lock);
+
+    for (int i = 0; i < worker->iterations; i++) {
+        PoolConnection *conn = pool_get_connection(worker->pool);
+        if (!conn) {
+            worker->failures++;
+            continue;
+        }
+        if (worker->discard) {
+            pool_discard_connection(worker->pool, conn);
+        } else {
+            pool_return_connection(worker->pool, conn);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * ## Pool contention benchmark
+ * - `threads` threads check a connection out and back `iterations` times each, on a pool of `poolSize` connections
+ * - Fake connections never reach the network, so this measures the pool lock, the idle stack and the waiter queue
+ * - With `discard: 1` every checkout closes its connection, so waiters are served by reconnected slots
+ * - `acquireTimeout` bounds each wait, -1 (the default) waits forever
+ * @return { threads, poolSize, iterations, failures, opsPerSec, nsPerOp }
+ */
+napi_value BenchPool(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    napi_value options = args[0];
+    if (argc < 1) {
+        napi_get_undefined(env, &options);
+    }
+    int threads = bench_get_int(env, options, "threads", 4);
+    int pool_size = bench_get_int(env, options, "poolSize", 10);
+    int iterations = bench_get_int(env, options, "iterations", 100000);
+    bool discard = bench_get_int(env, options, "discard", 0) != 0;
+    int acquire_timeout_ms = bench_get_int(env, options, "acquireTimeout", -1);
+
+    if (threads < 1 || threads > 1024 || pool_size < 1 || pool_size > POOL_SIZE_LIMIT || iterations < 1) {
+        napi_throw_range_error(env, NULL, "Expected 1 <= threads <= 1024, 1 <= poolSize <= 1024 and iterations >= 1");
+        return NULL;
+    }
+
+    PoolOptions pool_options;
+    pool_options_default(&pool_options);
+    pool_options.min_size = pool_size;
+    pool_options.max_size = pool_size;
+    pool_options.acquire_timeout_ms = acquire_timeout_ms;
+    pool_options.validate_after_ms = -1;
+    pool_options.health_check_interval_ms = 0;
+
+    ConnectionPool *pool = pool_create("bench", "bench", "bench", "bench", 3306, &pool_options);
+    PoolWorker *workers = (PoolWorker *)calloc((size_t)threads, sizeof(PoolWorker));
+    pthread_t *ids = (pthread_t *)calloc((size_t)threads, sizeof(pthread_t));
+    if (!pool || !workers || !ids) {
+        pool_destroy(pool);
+        free(workers);
+        free(ids);
+        napi_throw_error(env, NULL, "Failed to create the benchmark pool");
+        return NULL;
+    }
+
+    //? Step 1: Start every thread, they wait at the gate
+    StartGate gate = {.open = false};
+    pthread_mutex_init(&gate.lock, NULL);
+    pthread_cond_init(&gate.cond, NULL);
+
+    int started = 0;
+    for (; started < threads; started++) {
+        workers[started] = (PoolWorker){.pool = pool, .gate = &gate, .iterations = iterations, .discard = discard};
+        if (pthread_create(&ids[started], NULL, pool_worker, &workers[started]) != 0) {
+            break;
+        }
+    }
+
+    //? Step 2: Release them together and time until the last one is done
+    uint64_t begin = bench_now_ns();
+    pthread_mutex_lock(&gate.lock);
+    gate.open = true;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.lock);
+
+    int failures = 0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+        failures += workers[i].failures;
+    }
+    uint64_t elapsed = bench_now_ns() - begin;
+
+    pthread_cond_destroy(&gate.cond);
+    pthread_mutex_destroy(&gate.lock);
+    pool_destroy(pool);
+    free(workers);
+    free(ids);
+
+    if (started < threads) {
+        napi_throw_error(env, NULL, "Failed to start the benchmark threads");
+        return NULL;
+    }
+
+    double ops = (double)threads * iterations;
+    napi_value obj;
+    napi_create_object(env, &obj);
+    bench_set_number(env, obj, "threads", threads);
+    bench_set_number(env, obj, "poolSize", pool_size);
+    bench_set_number(env, obj, "iterations", iterations);
+    bench_set_number(env, obj, "failures", failures);
+    bench_set_number(env, obj, "opsPerSec", ops / ((double)elapsed / 1e9));
+    bench_set_number(env, obj, "nsPerOp", (double)elapsed / ops);
+    return obj;
+}
@@ -0,0 +1,115 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_sql.h"
+#include "bench.h"
+#include <node_api.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Fill one placeholder value, cycling through INT, DOUBLE, quoted STRING, DATETIME and NULL */
+static void bench_param(PeekParam *param, int index, char *text) {
+    switch (index % 5) {
+    case 0:
+        param->type = PARAM_INT;
+        param->int_value = 1000000 + index;
+        break;
+    case 1:
+        param->type = PARAM_DOUBLE;
+        param->double_value = index * 3.5;
+        break;
+    case 2:
+        param->type = PARAM_STRING;
+        param->data = text;
+        param->length = (unsigned long)strlen(text);
+        break;
+    case 3:
+        param->type = PARAM_DATETIME;
+        param->time_value = (MYSQL_TIME){.year = 2024, .month = 6, .day = 15, .hour = 12, .minute = 30};
+        break;
+    case 4:
+        param->type = PARAM_NULL;
+        param->is_null = true;
+        break;
+    }
+}
+
+/**
+ * ## SQL build benchmark
+ * - `sql_append_statement` replacing `params` placeholders by escaped literals, as `peek.batch` does for every query
+ * @return { params, iterations, bytes, nsPerStatement }
+ */
+napi_value BenchSql(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    napi_value options = args[0];
+    if (argc < 1) {
+        napi_get_undefined(env, &options);
+    }
+    int count = bench_get_int(env, options, "params", 8);
+    int iterations = bench_get_int(env, options, "iterations", 100000);
+
+    if (count < 1 || count > 4096 || iterations < 1) {
+        napi_throw_range_error(env, NULL, "Expected 1 <= params <= 4096 and iterations >= 1");
+        return NULL;
+    }
+
+    //? Step 1: SELECT * FROM `devices` WHERE `column_0` = ? AND `column_1` = ? ...
+    SqlBuffer query = {0};
+    PeekParams params = {.items = (PeekParam *)calloc((size_t)count, sizeof(PeekParam)), .count = (size_t)count};
+    char text[] = "O'Reilly said \"hi\"\\n and left";
+    const char *select = "SELECT * FROM `devices` WHERE ";
+    bool ok = params.items && sql_append(&query, select, strlen(select));
+    for (int i = 0; ok && i < count; i++) {
+        char condition[48];
+        int length = snprintf(condition, sizeof(condition), "%s`column_%d` = ?", i ? " AND " : "", i);
+        ok = sql_append(&query, condition, (size_t)length);
+        bench_param(&params.items[i], i, text);
+    }
+
+    MYSQL *conn = peek_driver->init(NULL);
+    if (!ok || !conn) {
+        sql_free(&query);
+        free(params.items);
+        peek_driver->close(conn);
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    //? Step 2: Build it again and again into a buffer reused like the batch buffer
+    char error[256];
+    SqlBuffer sql = {0};
+    uint64_t elapsed = 0;
+    for (int i = 0; i <= iterations; i++) {
+        sql.length = 0;
+        uint64_t started = bench_now_ns();
+        ok = sql_append_statement(&sql, conn, query.data, &params, error, sizeof(error));
+        if (i > 0) {
+            elapsed += bench_now_ns() - started;
+        }
+        if (!ok) {
+            break;
+        }
+    }
+
+    size_t bytes = sql.length;
+    sql_free(&sql);
+    sql_free(&query);
+    free(params.items);
+    peek_driver->close(conn);
+
+    if (!ok) {
+        napi_throw_error(env, NULL, error);
+        return NULL;
+    }
+
+    napi_value obj;
+    napi_create_object(env, &obj);
+    bench_set_number(env, obj, "params", count);
+    bench_set_number(env, obj, "iterations", iterations);
+    bench_set_number(env, obj, "bytes", (double)bytes);
+    bench_set_number(env, obj, "nsPerStatement", (double)elapsed / iterations);
+    return obj;
+}
@@ -0,0 +1,60 @@
+#include "../include/mysql_driver.h"
+#include "bench.h"
+#include <node_api.h>
+#include <time.h>
+
+// The benchmarks never link libmysqlclient: every library call goes to the fake driver
+const PeekDriver *peek_driver = &fake_driver;
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int bench_get_int(napi_env env, napi_value options, const char *key, int fallback) {
+    napi_valuetype type;
+    napi_typeof(env, options, &type);
+    if (type != napi_object) {
+        return fallback;
+    }
+
+    bool has_property = false;
+    if (napi_has_named_property(env, options, key, &has_property) != napi_ok || !has_property) {
+        return fallback;
+    }
+
+    napi_value value;
+    napi_get_named_property(env, options, key, &value);
+    napi_typeof(env, value, &type);
+
+    int result = fallback;
+    if (type == napi_number) {
+        napi_get_value_int32(env, value, &result);
+    }
+    return result;
+}
+
+void bench_set_number(napi_env env, napi_value obj, const char *key, double number) {
+    napi_value value;
+    napi_create_double(env, number, &value);
+    napi_set_named_property(env, obj, key, value);
+}
+
+/** Benchmark Module Initialization */
+napi_value Init(napi_env env, napi_value exports) {
+    napi_value decodeFn, poolFn, sqlFn;
+
+    napi_create_function(env, NULL, 0, BenchDecode, NULL, &decodeFn);
+    napi_set_named_property(env, exports, "decode", decodeFn);
+
+    napi_create_function(env, NULL, 0, BenchPool, NULL, &poolFn);
+    napi_set_named_property(env, exports, "pool", poolFn);
+
+    napi_create_function(env, NULL, 0, BenchSql, NULL, &sqlFn);
+    napi_set_named_property(env, exports, "sql", sqlFn);
+
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,221 @@
+#ifndef MYSQL_ADVISOR_H
+#define MYSQL_ADVISOR_H
+
+#include "mysql_params.h"
+#include "mysql_pool.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ## Distinct slow statements tracked, slower statements past it are only counted in `dropped`
+ */
+#define SLOW_QUERY_FINGERPRINT_LIMIT 256
+
+/**
+ * ## Slow statements waiting for their EXPLAIN, more are not explained
+ */
+#define SLOW_QUERY_QUEUE_SIZE 64
+
+/**
+ * ## Minimum time between two EXPLAINs of the same fingerprint
+ */
+#define SLOW_QUERY_EXPLAIN_INTERVAL_MS 60000
+
+/**
+ * ## Tables kept per plan, and bytes of the names and column lists kept
+ */
+#define SLOW_QUERY_TABLE_LIMIT 8
+#define SLOW_QUERY_NAME_SIZE 65
+#define SLOW_QUERY_COLUMNS_SIZE 256
+#define SLOW_QUERY_FINGERPRINT_SIZE 1024
+
+/**
+ * Table access of an EXPLAIN
+ * - `columns` are the columns of the table its attached condition filters on, comma separated
+ */
+typedef struct {
+    char table[SLOW_QUERY_NAME_SIZE];
+    char access_type[16]; // ALL is a full table scan, index a full index scan
+    char key[SLOW_QUERY_NAME_SIZE];
+    uint64_t rows;
+    char columns[SLOW_QUERY_COLUMNS_SIZE];
+} SlowQueryTable;
+
+/**
+ * Plan of a statement, read from `EXPLAIN FORMAT=JSON`
+ * - `order_columns` come from the statement's ORDER BY, the plan does not name them
+ */
+typedef struct {
+    bool full_scan;
+    bool filesort;
+    bool temporary_table;
+    SlowQueryTable tables[SLOW_QUERY_TABLE_LIMIT];
+    int table_count;
+    char order_columns[SLOW_QUERY_COLUMNS_SIZE];
+} SlowQueryPlan;
+
+/**
+ * Slow statements sharing a fingerprint: their text with literals replaced by `?`
+ */
+typedef struct {
+    char *fingerprint;
+    uint64_t hash;
+    uint64_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+    uint64_t explained_ms; // Last EXPLAIN, 0 for never
+    bool explaining;       // An EXPLAIN is queued or running
+    bool explained;
+    char error[256]; // Error of the last EXPLAIN, empty when it succeeded
+    SlowQueryPlan plan;
+} SlowQueryEntry;
+
+/**
+ * Index declared by a schema, see `advisor_register_index`
+ */
+typedef struct {
+    char *table;
+    char *name;
+    char *columns; // Comma separated
+} AdvisorIndex;
+
+/**
+ * Slow statement waiting for its EXPLAIN
+ */
+typedef struct {
+    SlowQueryEntry *entry;
+    char *query;
+    PeekParams params;
+} SlowQuerySample;
+
+/**
+ * ## Slow query advisor
+ * - Selects slower than `threshold_us` are counted per fingerprint
+ * - The first one of a fingerprint, then at most one per `SLOW_QUERY_EXPLAIN_INTERVAL_MS`, is re-run by a background
+ *   thread as `EXPLAIN FORMAT=JSON` on a connection of the primary pool
+ * - The plan is matched against the indexes the schemas declared, see `advisor_report`
+ * @note Replica reads are explained on the primary, which has the same indexes
+ */
+typedef struct {
+    ConnectionPool *pool;
+    uint64_t threshold_us;
+    SlowQueryEntry *entries[SLOW_QUERY_FINGERPRINT_LIMIT];
+    int entry_count;
+    uint64_t dropped; // Slow statements past `SLOW_QUERY_FINGERPRINT_LIMIT` fingerprints
+    SlowQuerySample queue[SLOW_QUERY_QUEUE_SIZE];
+    int queue_head;
+    int queue_count;
+    uint64_t generation; // Bumped by `advisor_reset`, an EXPLAIN finishing past it is dropped
+    AdvisorIndex *indexes;
+    size_t index_count;
+    pthread_mutex_t lock;
+    pthread_cond_t queue_cond;
+    pthread_t thread;
+    bool thread_running;
+    bool stopping;
+} SlowQueryAdvisor;
+
+/**
+ * Index of a schema that covers a slow statement, or one it lacks
+ * - `name` is empty for a suggested index no schema declares
+ */
+typedef struct {
+    char table[SLOW_QUERY_NAME_SIZE];
+    char name[SLOW_QUERY_NAME_SIZE];
+    char columns[SLOW_QUERY_COLUMNS_SIZE];
+} AdvisorAdvice;
+
+/**
+ * Report of one fingerprint, see `advisor_report`
+ */
+typedef struct {
+    SlowQueryEntry entry; // `fingerprint` is owned by the report
+    AdvisorAdvice covering[SLOW_QUERY_TABLE_LIMIT];
+    int covering_count;
+    AdvisorAdvice suggested[SLOW_QUERY_TABLE_LIMIT];
+    int suggested_count;
+} SlowQueryReport;
+
+/**
+ * ## Create a slow query advisor and start its EXPLAIN thread
+ * @param pool - Primary pool, EXPLAINs borrow its connections
+ * @param threshold_ms - Latency from which a select is slow, > 0
+ * @return SlowQueryAdvisor* - Advisor, NULL when out of memory
+ */
+SlowQueryAdvisor *advisor_create(ConnectionPool *pool, int threshold_ms);
+
+/**
+ * Stop the EXPLAIN thread and destroy an advisor, before the pool it borrows from
+ * @param advisor - Advisor, may be NULL
+ */
+void advisor_destroy(SlowQueryAdvisor *advisor);
+
+/**
+ * ## Fingerprint of a statement
+ * - Literals and placeholders become `?`, and lists of them, as in `IN (?, ?, ?)`, a single `?`
+ * - Comments and a trailing `;` are dropped and whitespace is normalized
+ * @param query - Statement
+ * @return char* - Fingerprint, NULL when out of memory
+ * @note The one definition of a fingerprint: the query builder's `getFingerprint()` calls it through the addon
+ */
+char *advisor_fingerprint(const char *query);
+
+/**
+ * ## Record a finished select
+ * - Returns right away below the threshold, otherwise copies what the EXPLAIN needs
+ * - Safe to call from any thread
+ * @param advisor - Advisor
+ * @param query - Statement with `?` placeholders
+ * @param fingerprint - Fingerprint the caller already has, see `advisor_fingerprint`, NULL to compute it
+ * @param params - Placeholder values
+ * @param elapsed_us - Latency of the select
+ */
+void advisor_observe(SlowQueryAdvisor *advisor, const char *query, const char *fingerprint, const PeekParams *params,
+                     uint64_t elapsed_us);
+
+/**
+ * Declare an index of a schema, replacing one of the same table and name
+ * @param advisor - Advisor
+ * @param table - Table name
+ * @param name - Index name
+ * @param columns - Comma separated columns
+ */
+void advisor_register_index(SlowQueryAdvisor *advisor, const char *table, const char *name, const char *columns);
+
+/**
+ * ## Snapshot every fingerprint, slowest total first
+ * - `covering` are the declared indexes whose first column a full scan or filesort filters or sorts on
+ * - `suggested` are the columns to index for the full scans and filesorts no declared index covers
+ * @param advisor - Advisor
+ * @param reports - Receives the reports, free them with `advisor_reports_free`
+ * @param count - Receives the number of reports
+ * @param dropped - Receives the slow statements past the fingerprint limit
+ * @return bool - False when out of memory
+ */
+bool advisor_report(SlowQueryAdvisor *advisor, SlowQueryReport **reports, int *count, uint64_t *dropped);
+
+/**
+ * Free reports of `advisor_report`
+ * @param reports - Reports
+ * @param count - Number of reports
+ */
+void advisor_reports_free(SlowQueryReport *reports, int count);
+
+/**
+ * Forget every fingerprint, declared indexes are kept
+ * @param advisor - Advisor
+ */
+void advisor_reset(SlowQueryAdvisor *advisor);
+
+/**
+ * ## Read the plan of an `EXPLAIN FORMAT=JSON`, as printed by MySQL or MariaDB
+ * @param json - EXPLAIN output
+ * @param query - Statement explained, read for its ORDER BY columns
+ * @param plan - Receives the plan
+ * @return bool - False when the JSON is malformed
+ */
+bool advisor_parse_plan(const char *json, const char *query, SlowQueryPlan *plan);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef MYSQL_ARENA_H
+#define MYSQL_ARENA_H
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * ## Default size of an arena block
+ */
+#define ARENA_BLOCK_SIZE 16384
+
+/**
+ * ## Largest block an arena keeps across resets
+ * @note A reset after a bigger query shrinks the arena back to this size
+ */
+#define ARENA_RETAIN_LIMIT (1024 * 1024)
+
+/**
+ * Arena block
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    alignas(max_align_t) char data[];
+} ArenaBlock;
+
+/**
+ * Bump allocator
+ * - Allocations are freed all at once by `arena_reset` or `arena_destroy`
+ * - A reset keeps one block sized to the previous usage, so a reused arena settles on a single allocation
+ * @note Not thread safe
+ */
+typedef struct {
+    ArenaBlock *head; // Current block, older blocks follow
+    size_t block_size;
+} Arena;
+
+/**
+ * Initialize an empty arena
+ * @param arena - Arena
+ * @param block_size - Minimum block size, 0 for `ARENA_BLOCK_SIZE`
+ */
+void arena_init(Arena *arena, size_t block_size);
+
+/**
+ * ## Allocate from an arena
+ * @param arena - Arena
+ * @param size - Number of bytes
+ * @return void* - Memory aligned for any type, NULL when out of memory
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * Allocate zeroed memory from an arena
+ * @param arena - Arena
+ * @param count - Number of elements
+ * @param size - Size of an element
+ * @return void* - Zeroed memory, NULL when out of memory
+ */
+void *arena_calloc(Arena *arena, size_t count, size_t size);
+
+/**
+ * Copy a string into an arena
+ * @param arena - Arena
+ * @param str - String
+ * @return char* - Copy, NULL when out of memory
+ */
+char *arena_strdup(Arena *arena, const char *str);
+
+/**
+ * Move every block of another arena into this one, so its allocations live as long as this arena
+ * @param arena - Arena
+ * @param other - Arena emptied, it stays usable
+ */
+void arena_adopt(Arena *arena, Arena *other);
+
+/**
+ * Release every allocation while keeping memory for the next use
+ * @param arena - Arena
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * Free every block of an arena
+ * @param arena - Arena
+ */
+void arena_destroy(Arena *arena);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef MYSQL_ASYNC_H
+#define MYSQL_ASYNC_H
+
+#include "mysql_metrics.h"
+#include <node_api.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * ## Maximum length of a task error message
+ */
+#define TASK_ERROR_SIZE 512
+
+typedef struct PeekTask PeekTask;
+
+/**
+ * Runs on a libuv worker thread
+ * @note Must not call any N-API function
+ */
+typedef void (*TaskExecute)(PeekTask *task);
+
+/**
+ * Runs on the main thread once `execute` finished
+ * @return napi_value - Value the promise resolves with
+ */
+typedef napi_value (*TaskComplete)(napi_env env, PeekTask *task);
+
+/**
+ * Releases everything the task owns, including the task itself
+ */
+typedef void (*TaskDestroy)(PeekTask *task);
+
+/**
+ * Async task
+ * - Base of every native operation that runs off the JS main thread
+ * - Embed it as the first member of an operation specific struct
+ * @note The promise is rejected with `error` when `failed` is set
+ * @note Its latency is recorded under `op` when the promise settles, `METRIC_OP_NONE` records nothing
+ */
+struct PeekTask {
+    napi_async_work work;
+    napi_deferred deferred;
+    TaskExecute execute;
+    TaskComplete complete;
+    TaskDestroy destroy;
+    bool failed;
+    char error[TASK_ERROR_SIZE];
+    napi_env env;                // Set by `task_start` only
+    napi_async_context context;  // Set by `task_start` only
+    MetricOp op;
+    uint64_t started_us;         // Set by `task_queue` and `task_start`
+};
+
+/**
+ * ## Queue a task on the libuv thread pool
+ * @param env - N-API environment
+ * @param name - Async resource name
+ * @param task - Task to run, ownership moves to the queue
+ * @return napi_value - Promise settled when the task completes
+ */
+napi_value task_queue(napi_env env, const char *name, PeekTask *task);
+
+/**
+ * ## Start a task driven on the main thread instead of the thread pool
+ * - Only creates the promise, the caller runs the work, e.g. from libuv callbacks, then calls `task_finish`
+ * - `execute` is not used
+ * @param env - N-API environment
+ * @param name - Async resource name
+ * @param task - Task, released by `task_finish`
+ * @return napi_value - Promise settled by `task_finish`
+ */
+napi_value task_start(napi_env env, const char *name, PeekTask *task);
+
+/**
+ * Settle the promise of a task started with `task_start` and release the task
+ * @param task - Task
+ * @note Main thread only, safe to call from a bare libuv callback
+ */
+void task_finish(PeekTask *task);
+
+/**
+ * Mark a task as failed
+ * @param task - Task
+ * @param message - Error message the promise is rejected with
+ */
+void task_fail(PeekTask *task, const char *message);
+
+/**
+ * Initialize the MySQL client library for the calling worker thread
+ * @note Cheap after the first call on a given thread
+ */
+void task_thread_init(void);
+
+#endif
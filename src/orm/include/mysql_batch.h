@@ -0,0 +1,26 @@
+#ifndef MYSQL_BATCH_H
+#define MYSQL_BATCH_H
+
+#include "mysql_pool.h"
+#include "mysql_result.h"
+#include "mysql_sql.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * ## Run independent queries as one multi-statement on a single connection
+ * - Statements are interpolated on the connection, joined with `;` and sent in one round trip
+ * - Every result set is read with `mysql_next_result`, a statement without one yields an empty result
+ * - Multi statements are only on while the batch holds the connection, see `pool_enable_multi_statements`
+ * @param pool - Connection pool
+ * @param statements - Queries
+ * @param count - Number of queries
+ * @param results - Receives `count` result sets, owned by the caller
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False on failure, results read before the failing query are still set
+ */
+bool batch_query(ConnectionPool *pool, const SqlStatement *statements, size_t count, PeekResult **results, char *error,
+                 size_t error_size);
+
+#endif
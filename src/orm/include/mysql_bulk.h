@@ -0,0 +1,78 @@
+#ifndef MYSQL_BULK_H
+#define MYSQL_BULK_H
+
+#include "mysql_params.h"
+#include "mysql_pool.h"
+#include <mysql.h>
+#include <node_api.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * ## Upper bound of one generated INSERT statement
+ * @note Statements are also kept below the server's `max_allowed_packet`
+ */
+#define BULK_MAX_STATEMENT_SIZE (16 * 1024 * 1024)
+
+/**
+ * ## Maximum number of connections a single bulk insert spreads its rows over
+ */
+#define BULK_MAX_PARALLEL 16
+
+/**
+ * Rows of a bulk insert
+ * - Copied out of JS on the main thread, `values` is row-major: `row_count * column_count` values
+ */
+typedef struct {
+    char *table;
+    char **columns;
+    size_t column_count;
+    size_t row_count;
+    PeekParams values;
+} BulkRows;
+
+/**
+ * Outcome of a bulk insert
+ * - `first_insert_id` / `last_insert_id` bound the AUTO_INCREMENT ids generated, 0 when none were
+ */
+typedef struct {
+    my_ulonglong affected_rows;
+    my_ulonglong first_insert_id;
+    my_ulonglong last_insert_id;
+    size_t statements;
+} BulkResult;
+
+/**
+ * ## Copy a JS array of records into bulk rows
+ * - Columns are the keys of the first record, a key missing from a later record inserts NULL
+ * @param env - N-API environment
+ * @param table - JS string, table name
+ * @param records - JS array of objects
+ * @param rows - Receives the rows
+ * @return bool - False with a pending JS exception on invalid input
+ */
+bool bulk_rows_from_js(napi_env env, napi_value table, napi_value records, BulkRows *rows);
+
+/**
+ * ## Insert rows as multi-row INSERT statements
+ * - Rows are escaped on the connection and packed into statements that fit `max_allowed_packet`
+ * - With `parallel` > 1 the rows are split into contiguous ranges, each inserted on its own pooled connection
+ * - Each range is all or nothing: one that takes several statements runs them in a transaction
+ * @param pool - Connection pool
+ * @param rows - Rows to insert
+ * @param parallel - Number of connections to use, clamped to the pool size
+ * @param result - Receives the aggregate outcome, on failure that of the ranges that were committed
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False on failure
+ * @note Parallel mode is not atomic: the ranges commit on their own, a failed one leaves the others inserted
+ */
+bool bulk_insert(ConnectionPool *pool, const BulkRows *rows, int parallel, BulkResult *result, char *error, size_t error_size);
+
+/**
+ * Free bulk rows
+ * @param rows - Rows
+ */
+void bulk_rows_free(BulkRows *rows);
+
+#endif
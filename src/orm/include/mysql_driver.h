@@ -0,0 +1,149 @@
+#ifndef MYSQL_DRIVER_H
+#define MYSQL_DRIVER_H
+
+#include <errmsg.h>
+#include <mysql.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * ## Default shape of the synthetic table served by the fake driver
+ * @note Used when `fakeDriver` leaves them out
+ */
+#define DEFAULT_FAKE_COLUMNS 10
+#define DEFAULT_FAKE_ROWS 100
+
+/**
+ * ## Widest synthetic table of the fake driver
+ */
+#define FAKE_COLUMNS_LIMIT 4096
+
+/**
+ * ## Backend driver
+ * - Every call the libraries make into the client library goes through `peek_driver`, named like the libmysqlclient
+ *   function without its `mysql_` prefix
+ * - `mysql_driver` is libmysqlclient itself, `fake_driver` an in-process server (see `fake_driver_configure`)
+ * - Handles are opaque: a handle must only be passed back to the driver that returned it
+ * @note `errno` is a macro, the error numbers are `error_code` and `stmt_error_code`
+ * @note A driver without nonblocking calls leaves them NULL, and cannot serve `executionMode: 'eventloop'`
+ */
+typedef struct {
+    const char *name;
+
+    // Library
+    int (*library_init)(int argc, char **argv, char **groups);
+    bool (*thread_init)(void);
+    void (*thread_end)(void);
+
+    // Connections
+    MYSQL *(*init)(MYSQL *mysql);
+    int (*options)(MYSQL *mysql, enum mysql_option option, const void *arg);
+    MYSQL *(*real_connect)(MYSQL *mysql, const char *host, const char *user, const char *passwd, const char *db,
+                           unsigned int port, const char *unix_socket, unsigned long client_flag);
+    void (*close)(MYSQL *mysql);
+    int (*ping)(MYSQL *mysql);
+    int (*set_server_option)(MYSQL *mysql, enum enum_mysql_set_option option);
+    const char *(*error)(MYSQL *mysql);
+    unsigned int (*error_code)(MYSQL *mysql);
+    unsigned long (*real_escape_string_quote)(MYSQL *mysql, char *to, const char *from, unsigned long length, char quote);
+    void (*set_local_infile_handler)(MYSQL *mysql, int (*local_infile_init)(void **, const char *, void *),
+                                     int (*local_infile_read)(void *, char *, unsigned int),
+                                     void (*local_infile_end)(void *),
+                                     int (*local_infile_error)(void *, char *, unsigned int), void *userdata);
+
+    // Text protocol
+    int (*query)(MYSQL *mysql, const char *query);
+    int (*real_query)(MYSQL *mysql, const char *query, unsigned long length);
+    MYSQL_RES *(*store_result)(MYSQL *mysql);
+    int (*next_result)(MYSQL *mysql);
+    bool (*more_results)(MYSQL *mysql);
+    unsigned int (*field_count)(MYSQL *mysql);
+    my_ulonglong (*affected_rows)(MYSQL *mysql);
+    my_ulonglong (*insert_id)(MYSQL *mysql);
+    unsigned int (*warning_count)(MYSQL *mysql);
+
+    // Result sets
+    void (*free_result)(MYSQL_RES *result);
+    my_ulonglong (*num_rows)(MYSQL_RES *result);
+    unsigned int (*num_fields)(MYSQL_RES *result);
+    MYSQL_FIELD *(*fetch_fields)(MYSQL_RES *result);
+    MYSQL_ROW (*fetch_row)(MYSQL_RES *result);
+    unsigned long *(*fetch_lengths)(MYSQL_RES *result);
+    void (*data_seek)(MYSQL_RES *result, my_ulonglong offset);
+
+    // Prepared statements
+    MYSQL_STMT *(*stmt_init)(MYSQL *mysql);
+    int (*stmt_prepare)(MYSQL_STMT *stmt, const char *query, unsigned long length);
+    unsigned long (*stmt_param_count)(MYSQL_STMT *stmt);
+    bool (*stmt_bind_param)(MYSQL_STMT *stmt, MYSQL_BIND *bind);
+    bool (*stmt_attr_set)(MYSQL_STMT *stmt, enum enum_stmt_attr_type attr_type, const void *attr);
+    int (*stmt_execute)(MYSQL_STMT *stmt);
+    MYSQL_RES *(*stmt_result_metadata)(MYSQL_STMT *stmt);
+    int (*stmt_store_result)(MYSQL_STMT *stmt);
+    my_ulonglong (*stmt_num_rows)(MYSQL_STMT *stmt);
+    bool (*stmt_bind_result)(MYSQL_STMT *stmt, MYSQL_BIND *bind);
+    int (*stmt_fetch)(MYSQL_STMT *stmt);
+    int (*stmt_fetch_column)(MYSQL_STMT *stmt, MYSQL_BIND *bind, unsigned int column, unsigned long offset);
+    my_ulonglong (*stmt_affected_rows)(MYSQL_STMT *stmt);
+    my_ulonglong (*stmt_insert_id)(MYSQL_STMT *stmt);
+    bool (*stmt_free_result)(MYSQL_STMT *stmt);
+    bool (*stmt_close)(MYSQL_STMT *stmt);
+    const char *(*stmt_error)(MYSQL_STMT *stmt);
+    unsigned int (*stmt_error_code)(MYSQL_STMT *stmt);
+
+    // Nonblocking API, only used by the event loop pool
+    my_socket (*get_socket)(const MYSQL *mysql);
+    enum net_async_status (*real_connect_nonblocking)(MYSQL *mysql, const char *host, const char *user,
+                                                      const char *passwd, const char *db, unsigned int port,
+                                                      const char *unix_socket, unsigned long client_flag);
+    enum net_async_status (*real_query_nonblocking)(MYSQL *mysql, const char *query, unsigned long length);
+    enum net_async_status (*store_result_nonblocking)(MYSQL *mysql, MYSQL_RES **result);
+} PeekDriver;
+
+/**
+ * Shape and timing of the fake driver's synthetic data
+ * - `columns` cycle through BIGINT, VARCHAR, DOUBLE, DATETIME and BLOB, every 10th VARCHAR is NULL
+ * - `rows` is the row count of every SELECT, capped by its LIMIT
+ * - `latency_us` is slept once per round trip: query, statement execute, ping
+ */
+typedef struct {
+    int columns;
+    int rows;
+    int latency_us;
+} FakeDriverOptions;
+
+/**
+ * ## Driver the libraries call
+ * @note Only changed by `initialize` while no connection is open
+ */
+extern const PeekDriver *peek_driver;
+
+/** libmysqlclient */
+extern const PeekDriver mysql_driver;
+
+/**
+ * ## Deterministic in-process server, no network and no database
+ * - SELECT returns the synthetic table, the same values for the same row number on every run
+ * - SHOW, DESCRIBE, EXPLAIN and SELECTs from information_schema return empty result sets, so schema sync creates
+ *   every table
+ * - INSERT affects one row per VALUES tuple and hands out increasing insert ids per connection,
+ *   UPDATE and DELETE affect one row, LOAD DATA LOCAL reads the whole source and affects one row per line
+ * - Anything else succeeds without a result set
+ * - Several statements in one query fail with a syntax error, as on the server, unless multi statements are on
+ */
+extern const PeekDriver fake_driver;
+
+/**
+ * Fill fake driver options with the defaults
+ * @param options - Options
+ */
+void fake_driver_options_default(FakeDriverOptions *options);
+
+/**
+ * ## Set the synthetic data served by connections opened from now on
+ * @param options - Options, copied
+ * @note Open connections keep the options they were opened with
+ */
+void fake_driver_configure(const FakeDriverOptions *options);
+
+#endif
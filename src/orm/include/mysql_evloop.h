@@ -0,0 +1,95 @@
+#ifndef MYSQL_EVLOOP_H
+#define MYSQL_EVLOOP_H
+
+#include "mysql_async.h"
+#include "mysql_params.h"
+#include "mysql_pool.h"
+#include "mysql_result.h"
+#include <mysql.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <uv.h>
+
+/**
+ * ## Largest statement run on the event loop
+ * @note Longer statements, typically big multi-row writes, run on the worker threads instead
+ */
+#define EV_MAX_QUERY_SIZE (128 * 1024)
+
+/**
+ * ## Socket send buffer of an event loop connection
+ * @note Larger than `EV_MAX_QUERY_SIZE`, so sending a statement never waits for the socket to drain
+ */
+#define EV_SEND_BUFFER_SIZE (256 * 1024)
+
+typedef struct EvQuery EvQuery;
+
+/**
+ * Called once on the main thread when a query finished or failed
+ */
+typedef void (*EvQueryDone)(EvQuery *query);
+
+/**
+ * Statement run on the event loop
+ * - Filled by the caller, who keeps it alive until `done` is called
+ */
+struct EvQuery {
+    const char *sql;   // SQL text with `?` placeholders
+    PeekParams *params; // Placeholder values, NULL for none
+    EvQueryDone done;
+    void *context;
+    PeekResult *result; // Rows of a statement that returns a result set, owned by the caller
+    my_ulonglong affected_rows;
+    my_ulonglong insert_id;
+    bool failed;
+    char error[TASK_ERROR_SIZE];
+    EvQuery *next;      // Wait queue
+};
+
+/**
+ * Event loop connection pool
+ * - Drives every connection from the JS main thread with the nonblocking client API,
+ *   each socket registered as a `uv_poll_t` handle, so in-flight queries cost no thread
+ * - Values are interpolated client side, there is no nonblocking prepared statement API
+ * @note Main thread only
+ */
+typedef struct EvPool EvPool;
+
+/**
+ * ## Create an event loop pool
+ * - Connections are opened on demand up to `options->max_size`
+ * @param loop - Event loop of the JS main thread
+ * @param host - Host name
+ * @param user - User name
+ * @param password - Password
+ * @param database - Database name
+ * @param port - Port number
+ * @param options - Pool options
+ * @return EvPool* - Pool, NULL when out of memory
+ */
+EvPool *ev_pool_create(uv_loop_t *loop, const char *host, const char *user, const char *password, const char *database,
+                       int port, const PoolOptions *options);
+
+/**
+ * Whether a statement is small enough for the event loop
+ * @param sql - SQL text with `?` placeholders
+ * @param params - Placeholder values, NULL for none
+ * @return bool - False when the interpolated statement may exceed `EV_MAX_QUERY_SIZE`
+ */
+bool ev_query_fits(const char *sql, const PeekParams *params);
+
+/**
+ * ## Run a statement on an idle connection, or queue it until one is free
+ * @param pool - Event loop pool
+ * @param query - Statement, `done` is called exactly once, possibly before this returns
+ */
+void ev_pool_submit(EvPool *pool, EvQuery *query);
+
+/**
+ * Destroy an event loop pool
+ * - Fails queued and in-flight queries, the pool is freed once every socket handle is closed
+ * @param pool - Event loop pool
+ */
+void ev_pool_destroy(EvPool *pool);
+
+#endif
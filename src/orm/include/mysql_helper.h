@@ -3,6 +3,9 @@
 
 #include <node_api.h>
 
+/** Set the instance data of an environment, once per environment that loads the addon */
+void InitMySQLInstance(napi_env env);
+
 napi_value ConnectMySQL(napi_env env, napi_callback_info info);
 napi_value CloseMySQL(napi_env env, napi_callback_info info);
 napi_value CreateTable(napi_env env, napi_callback_info info);
@@ -15,7 +18,53 @@ napi_value Update(napi_env env, napi_callback_info info);
 napi_value Delete(napi_env env, napi_callback_info info);
 napi_value BulkInsert(napi_env env, napi_callback_info info);
 
+// =========================== BULK INSERT ===========================
+napi_value BulkInsertRows(napi_env env, napi_callback_info info);
+
+// =========================== LOAD DATA ===========================
+napi_value LoadData(napi_env env, napi_callback_info info);
+napi_value LoadWrite(napi_env env, napi_callback_info info);
+napi_value LoadEnd(napi_env env, napi_callback_info info);
+napi_value LoadAbort(napi_env env, napi_callback_info info);
+
+// =========================== TRANSACTIONS ===========================
+napi_value TransactionBegin(napi_env env, napi_callback_info info);
+napi_value TransactionExecute(napi_env env, napi_callback_info info);
+napi_value TransactionSelect(napi_env env, napi_callback_info info);
+
+// =========================== BATCH ===========================
+napi_value BatchQuery(napi_env env, napi_callback_info info);
+
+// =========================== SCHEMA SYNC ===========================
+napi_value SyncSchema(napi_env env, napi_callback_info info);
+
+// =========================== RESULT CACHE ===========================
+napi_value GetResultCacheStats(napi_env env, napi_callback_info info);
+napi_value ClearResultCache(napi_env env, napi_callback_info info);
+
+// =========================== REPLICAS ===========================
+napi_value GetReplicaStatus(napi_env env, napi_callback_info info);
+
+// =========================== METRICS ===========================
+napi_value GetStats(napi_env env, napi_callback_info info);
+napi_value GetPrometheusMetrics(napi_env env, napi_callback_info info);
+
+// =========================== SLOW QUERIES ===========================
+napi_value GetSlowQueryReport(napi_env env, napi_callback_info info);
+napi_value ResetSlowQueries(napi_env env, napi_callback_info info);
+napi_value DeclareIndexes(napi_env env, napi_callback_info info);
+napi_value Fingerprint(napi_env env, napi_callback_info info);
+
+// =========================== SHARDS ===========================
+napi_value DeclareShardKeys(napi_env env, napi_callback_info info);
+napi_value ShardOf(napi_env env, napi_callback_info info);
+
 // =========================== TRIGGERS ===========================
 napi_value CreateTrigger(napi_env env, napi_callback_info info);
 
+// =========================== STREAMS ===========================
+napi_value SelectStream(napi_env env, napi_callback_info info);
+napi_value StreamNext(napi_env env, napi_callback_info info);
+napi_value StreamClose(napi_env env, napi_callback_info info);
+
 #endif
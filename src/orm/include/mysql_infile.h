@@ -0,0 +1,141 @@
+#ifndef MYSQL_INFILE_H
+#define MYSQL_INFILE_H
+
+#include "mysql_pool.h"
+#include <mysql.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ## Queued bytes above which writers are asked to wait for a drain
+ */
+#define INFILE_HIGH_WATER_MARK (4 * 1024 * 1024)
+
+/**
+ * ## Bytes sent between two progress events
+ */
+#define INFILE_PROGRESS_INTERVAL (1024 * 1024)
+
+/**
+ * Event of an in-memory infile source
+ * - `INFILE_EVENT_DRAIN`: the queue fell below the high water mark, or the load finished
+ * - `INFILE_EVENT_PROGRESS`: more bytes were sent to the server
+ */
+typedef enum {
+    INFILE_EVENT_DRAIN,
+    INFILE_EVENT_PROGRESS,
+} InfileEvent;
+
+/**
+ * Called from the loading thread when an event occurs
+ * @note Must be safe to call from any thread
+ */
+typedef void (*InfileNotify)(void *context, InfileEvent event, uint64_t bytes);
+
+/**
+ * Queued chunk of file data
+ */
+typedef struct InfileChunk {
+    struct InfileChunk *next;
+    size_t length;
+    size_t offset;
+    char data[];
+} InfileChunk;
+
+/**
+ * In-memory source of a `LOAD DATA LOCAL INFILE`
+ * - JS writes chunks on the main thread, the local infile handler reads them on the loading thread
+ * - Shared by both sides and freed when the last one releases it
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    InfileChunk *head;
+    InfileChunk *tail;
+    size_t queued_bytes;
+    uint64_t bytes_sent;
+    uint64_t bytes_reported;
+    bool ended;
+    bool aborted;
+    bool finished;
+    bool need_drain;
+    char error[256];
+    InfileNotify notify;
+    void *notify_context;
+    int refs;
+} InfileSource;
+
+/**
+ * Create a source, referenced once by the caller
+ * @param notify - Event callback, NULL for none
+ * @param notify_context - Passed to `notify`
+ * @return InfileSource* - Source, NULL when out of memory
+ */
+InfileSource *infile_source_create(InfileNotify notify, void *notify_context);
+
+/**
+ * Reference a source once more
+ * @param source - Source
+ */
+void infile_source_retain(InfileSource *source);
+
+/**
+ * Drop a reference, freeing the source with the last one
+ * @param source - Source
+ */
+void infile_source_release(InfileSource *source);
+
+/**
+ * ## Queue a chunk of file data
+ * @param source - Source
+ * @param data - Bytes, copied
+ * @param length - Number of bytes
+ * @return bool - False when the writer should wait for a drain event before writing more
+ */
+bool infile_source_write(InfileSource *source, const char *data, size_t length);
+
+/**
+ * Mark the end of the file data
+ * @param source - Source
+ */
+void infile_source_end(InfileSource *source);
+
+/**
+ * Abort the load, the server rejects the statement with `message`
+ * @param source - Source
+ * @param message - Error message
+ */
+void infile_source_abort(InfileSource *source, const char *message);
+
+/**
+ * Mark a source finished and wake writers waiting for a drain
+ * @param source - Source
+ * @return uint64_t - Number of bytes sent to the server
+ */
+uint64_t infile_source_finish(InfileSource *source);
+
+/**
+ * ## Run a `LOAD DATA LOCAL INFILE` statement fed from a source
+ * @param pooled - Connection opened with `MYSQL_OPT_LOCAL_INFILE`
+ * @param sql - LOAD DATA LOCAL INFILE statement
+ * @param source - Source
+ * @param affected_rows - Receives the number of loaded rows
+ * @param warnings - Receives the number of warnings
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False on failure
+ * @note Finishes the source, so writers are never left waiting
+ */
+bool infile_load(PoolConnection *pooled, const char *sql, InfileSource *source, my_ulonglong *affected_rows,
+                 unsigned int *warnings, char *error, size_t error_size);
+
+/**
+ * Install a handler refusing every LOCAL INFILE request outside of `infile_load`
+ * - Keeps a server from reading arbitrary client files on a connection that allows LOCAL INFILE
+ * @param conn - Connection
+ */
+void infile_install_guard(MYSQL *conn);
+
+#endif
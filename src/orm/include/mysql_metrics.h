@@ -0,0 +1,158 @@
+#ifndef MYSQL_METRICS_H
+#define MYSQL_METRICS_H
+
+#include "mysql_pool.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ## Linear sub-buckets per power of two of a latency histogram
+ * @note 16 sub-buckets bound the error of a recorded value to 1/16
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * ## Largest power of two a histogram tells apart, values above land in the last bucket
+ * @note 2^40 microseconds is about 12 days
+ */
+#define HISTOGRAM_MAX_MAGNITUDE 40
+
+/**
+ * Number of buckets of a latency histogram
+ */
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_MAGNITUDE - HISTOGRAM_SUB_BUCKET_BITS + 2) * HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * Operation whose latency is recorded
+ * @note `METRIC_OP_NONE` is not recorded
+ */
+typedef enum {
+    METRIC_OP_NONE,
+    METRIC_OP_SELECT,
+    METRIC_OP_INSERT,
+    METRIC_OP_UPDATE,
+    METRIC_OP_DELETE,
+    METRIC_OP_BULK_INSERT,
+    METRIC_OP_LOAD,
+    METRIC_OP_STREAM,
+    METRIC_OP_TRANSACTION,
+    METRIC_OP_BATCH,
+    METRIC_OP_COUNT,
+} MetricOp;
+
+/**
+ * Log-linear histogram of microsecond values, in the style of HdrHistogram
+ * - Values below `HISTOGRAM_SUB_BUCKETS` get a bucket each, every power of two above is split in
+ *   `HISTOGRAM_SUB_BUCKETS` linear buckets
+ */
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+} Histogram;
+
+/**
+ * Counters of one thread, or their sum in a snapshot
+ */
+typedef struct {
+    Histogram latency[METRIC_OP_COUNT]; // Call to settled promise
+    uint64_t errors[METRIC_OP_COUNT];
+    uint64_t rows[METRIC_OP_COUNT];  // Rows decoded from the server
+    uint64_t bytes[METRIC_OP_COUNT]; // Bytes of the decoded values
+    Histogram acquire_wait;          // Time spent in `pool_get_connection`
+    uint64_t acquire_failures;       // Checkouts that timed out or could not connect
+    uint64_t reconnects;             // Connections reopened after a failed ping
+    uint64_t pings;
+} MetricsCounters;
+
+/**
+ * ## Per-thread metrics shard
+ * - Only its thread writes it, with relaxed atomic stores, so recording takes no lock and shares no cache line
+ * - Snapshots sum every shard with relaxed atomic loads
+ * - The shard of a thread that exits goes to the next thread that records, its counts carry on in the sums
+ * @note Shards live as long as the process, so there are as many as threads ever recorded at once: the libuv workers
+ * and the short-lived threads of parallel bulk inserts, shard fan-outs and schema syncs
+ */
+typedef struct MetricsShard {
+    MetricsCounters counters;
+    struct MetricsShard *next;      // Every shard
+    struct MetricsShard *next_free; // Shards of exited threads
+} MetricsShard;
+
+/**
+ * Monotonic clock in microseconds
+ * @return uint64_t - Microseconds
+ */
+uint64_t metrics_now_us(void);
+
+/**
+ * Record a finished operation
+ * @param op - Operation
+ * @param elapsed_us - Latency
+ * @param failed - Whether it failed
+ */
+void metrics_record_op(MetricOp op, uint64_t elapsed_us, bool failed);
+
+/**
+ * Record rows decoded by an operation
+ * @param op - Operation
+ * @param rows - Rows
+ * @param bytes - Bytes of the decoded values
+ */
+void metrics_record_rows(MetricOp op, uint64_t rows, uint64_t bytes);
+
+/**
+ * Record a pool checkout
+ * @param elapsed_us - Time spent waiting for the connection
+ * @param acquired - False when the checkout timed out or could not connect
+ */
+void metrics_record_acquire(uint64_t elapsed_us, bool acquired);
+
+/** Record a connection reopened after a failed ping */
+void metrics_record_reconnect(void);
+
+/** Record a connection ping */
+void metrics_record_ping(void);
+
+/**
+ * ## Sum the shards of every thread
+ * @param snapshot - Receives the sums
+ * @note Shards keep being written while they are read, counters are each consistent but not with each other
+ */
+void metrics_snapshot(MetricsCounters *snapshot);
+
+/**
+ * Value below which a fraction of the recorded values fall
+ * @param histogram - Histogram
+ * @param quantile - Fraction, 0 to 1
+ * @return uint64_t - Upper bound of the bucket holding the quantile, 0 when empty
+ */
+uint64_t histogram_quantile(const Histogram *histogram, double quantile);
+
+/**
+ * Number of recorded values at most `value`, rounded to bucket bounds
+ * @param histogram - Histogram
+ * @param value - Value
+ * @return uint64_t - Count
+ */
+uint64_t histogram_count_below(const Histogram *histogram, uint64_t value);
+
+/**
+ * ## Render metrics in the Prometheus text exposition format
+ * @param snapshot - Counters from `metrics_snapshot`
+ * @param gauges - Gauges of the connection pool
+ * @return char* - Text to free, NULL when out of memory
+ */
+char *metrics_prometheus(const MetricsCounters *snapshot, const PoolGauges *gauges);
+
+/**
+ * Name of an operation, as used in JS and Prometheus labels
+ * @param op - Operation
+ * @return const char* - Name
+ */
+const char *metrics_op_name(MetricOp op);
+
+#endif
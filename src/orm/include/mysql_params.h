@@ -0,0 +1,95 @@
+#ifndef MYSQL_PARAMS_H
+#define MYSQL_PARAMS_H
+
+#include <mysql.h>
+#include <node_api.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Parameter type
+ */
+typedef enum {
+    PARAM_NULL,
+    PARAM_INT,
+    PARAM_DOUBLE,
+    PARAM_STRING,
+    PARAM_BLOB,
+    PARAM_DATETIME,
+} ParamType;
+
+/**
+ * Single `?` placeholder value
+ * - Copied out of JS on the main thread so it can be bound on a worker thread
+ */
+typedef struct {
+    ParamType type;
+    bool is_null;
+    unsigned long length;
+    union {
+        long long int_value;
+        double double_value;
+        char *data;
+        MYSQL_TIME time_value;
+    };
+} PeekParam;
+
+/**
+ * Placeholder values of one statement, in placeholder order
+ */
+typedef struct {
+    PeekParam *items;
+    size_t count;
+} PeekParams;
+
+/**
+ * ## Read a JS string of any length
+ * @param env - N-API environment
+ * @param value - JS string
+ * @param length - Receives the length in bytes, may be NULL
+ * @return char* - NUL terminated copy owned by the caller, NULL if `value` is not a string
+ */
+char *params_get_string(napi_env env, napi_value value, size_t *length);
+
+/**
+ * Copy one JS value into a placeholder value
+ * @param env - N-API environment
+ * @param value - JS value
+ * @param param - Receives the value, zeroed by the caller
+ * @return bool - False with a pending JS exception when the value cannot be bound
+ */
+bool params_value_from_js(napi_env env, napi_value value, PeekParam *param);
+
+/**
+ * ## Copy a JS array of values into placeholder values
+ * - `null`/`undefined` bind as NULL, booleans as 0/1, integers and BigInt as BIGINT,
+ *   other numbers as DOUBLE, strings as VARCHAR, Buffers as BLOB and Dates as UTC DATETIME
+ * @param env - N-API environment
+ * @param array - JS array, `undefined` for no values
+ * @param params - Receives the values
+ * @return bool - False with a pending JS exception when a value cannot be bound
+ */
+bool params_from_js(napi_env env, napi_value array, PeekParams *params);
+
+/**
+ * ## Point a MYSQL_BIND array at the placeholder values
+ * @param params - Placeholder values
+ * @param bind - Array of `params->count` binds, zeroed by the caller
+ */
+void params_bind(PeekParams *params, MYSQL_BIND *bind);
+
+/**
+ * Deep copy placeholder values, so they outlive the task they came from
+ * @param source - Placeholder values
+ * @param copy - Receives the copy, free it with `params_free`
+ * @return bool - False when out of memory
+ */
+bool params_copy(const PeekParams *source, PeekParams *copy);
+
+/**
+ * Free placeholder values
+ * @param params - Placeholder values
+ */
+void params_free(PeekParams *params);
+
+#endif
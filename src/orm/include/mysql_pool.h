@@ -1,41 +1,137 @@
 #ifndef MYSQL_POOL_H
 #define MYSQL_POOL_H
 
+#include "mysql_arena.h"
+#include "mysql_stmt_cache.h"
 #include <mysql.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
- * ## Define the maximum number of connections in the pool
- * @note This is the maximum number of connections that can be created in the pool
+ * ## Default maximum number of connections in the pool
+ * @note Used when `maxPoolSize` is not passed to `initialize`
  */
-#define MAX_POOL_SIZE 10
+#define DEFAULT_MAX_POOL_SIZE 10
 
 /**
- * ## Define the minimum number of connections in the pool
- * @note This is the minimum number of connections that will be created in the pool
+ * ## Default minimum number of connections in the pool
+ * @note Used when `minPoolSize` is not passed to `initialize`
  */
-#define MIN_POOL_SIZE 2
+#define DEFAULT_MIN_POOL_SIZE 2
+
+/**
+ * ## Default time a caller waits for a free connection
+ * @note Used when `acquireTimeout` is not passed to `initialize`
+ */
+#define DEFAULT_ACQUIRE_TIMEOUT_MS 10000
+
+/**
+ * ## Default time an idle connection above the minimum is kept open
+ * @note Used when `idleTimeout` is not passed to `initialize`
+ */
+#define DEFAULT_IDLE_TIMEOUT_MS 60000
+
+/**
+ * ## Default idle time after which a checkout pings the connection first
+ * @note Used when `validateAfter` is not passed to `initialize`
+ */
+#define DEFAULT_VALIDATE_AFTER_MS 5000
+
+/**
+ * ## Default interval of the background health check
+ * @note Used when `healthCheckInterval` is not passed to `initialize`
+ */
+#define DEFAULT_HEALTH_CHECK_INTERVAL_MS 30000
+
+/**
+ * ## Hard upper bound of the pool size
+ */
+#define POOL_SIZE_LIMIT 1024
+
+/**
+ * Pool options
+ * - `acquire_timeout_ms` < 0 waits forever, 0 fails immediately when the pool is exhausted
+ * - `idle_timeout_ms` <= 0 never evicts idle connections
+ * - `validate_after_ms` < 0 never pings on checkout
+ * - `health_check_interval_ms` <= 0 disables the background health check
+ * - `stmt_cache_size` is the number of prepared statements kept per connection
+ * - `local_infile` opens connections with `MYSQL_OPT_LOCAL_INFILE`, LOCAL INFILE requests are then only served by `peek.load`
+ * - `event_loop` also opens an event loop pool (see `mysql_evloop.h`) that runs single statements on the main thread
+ */
+typedef struct {
+    int min_size;
+    int max_size;
+    int acquire_timeout_ms;
+    int idle_timeout_ms;
+    int validate_after_ms;
+    int health_check_interval_ms;
+    int stmt_cache_size;
+    bool local_infile;
+    bool event_loop;
+} PoolOptions;
+
+/**
+ * Pool connection state
+ */
+typedef enum {
+    SLOT_EMPTY,      // No connection, on the empty stack
+    SLOT_IDLE,       // Connected, on the idle stack
+    SLOT_IN_USE,     // Checked out by a caller
+    SLOT_CONNECTING, // Being connected outside the lock
+    SLOT_CHECKING,   // Being validated by the health check
+} SlotState;
 
 /**
  * Pool connection
+ * - `scratch` holds per-query working memory such as bind buffers, reused by every query on the connection
+ * - `max_packet` caches the server's `max_allowed_packet`, 0 until first needed
+ * - `multi_statements` is only on while a batch or a transaction holds the connection, see `pool_enable_multi_statements`
+ * @note Slots never move, so a `PoolConnection *` stays valid for the lifetime of the pool
  */
 typedef struct {
     MYSQL *connection;
-    bool in_use;
+    SlotState state;
+    uint64_t last_used_ms;    // Last returned by a caller, idle eviction counts from it
+    uint64_t last_checked_ms; // Last known alive: returned or pinged by the health check
+    StmtCache stmt_cache;
+    Arena scratch;
+    unsigned long max_packet;
+    bool multi_statements;
 } PoolConnection;
 
+/**
+ * Caller blocked in `pool_get_connection`
+ * - Waiters are served in FIFO order, a returned connection is handed directly to the oldest one
+ */
+typedef struct PoolWaiter {
+    pthread_cond_t cond;
+    PoolConnection *connection;
+    struct PoolWaiter *next;
+} PoolWaiter;
+
 /**
  * Connection pool Manager
  * - It manages the connection pool
  * - It provides a direct connection to the database
  * - It provides a connection from the pool
- * @note This is the manager of the connection pool
+ * @note Idle and empty slots are kept on stacks, so checkout and return are O(1)
  */
 typedef struct {
-    PoolConnection connections[MAX_POOL_SIZE];
-    int current_size;
+    PoolConnection *connections;
+    PoolConnection **idle;  // Stack of idle slots, most recently used on top
+    int idle_count;
+    PoolConnection **empty; // Stack of unconnected slots
+    int empty_count;
+    int current_size;       // Slots holding or opening a connection
+    PoolOptions options;
+    PoolWaiter *wait_head;
+    PoolWaiter *wait_tail;
     pthread_mutex_t lock;
+    pthread_cond_t health_cond;
+    pthread_t health_thread;
+    bool health_running;
+    bool stopping;
     char *host;
     char *user;
     char *password;
@@ -43,6 +139,23 @@ typedef struct {
     int port;
 } ConnectionPool;
 
+/**
+ * Pool occupancy at one point in time
+ */
+typedef struct {
+    int open;    // Slots holding or opening a connection
+    int idle;
+    int in_use;
+    int waiting; // Callers queued in `pool_get_connection`
+    int max_size;
+} PoolGauges;
+
+/**
+ * Fill pool options with their defaults
+ * @param options - Pool options
+ */
+void pool_options_default(PoolOptions *options);
+
 /**
  * ## Create a connection pool
  * @param host - Host name
@@ -50,9 +163,10 @@ typedef struct {
  * @param password - Password
  * @param database - Database name
  * @param port - Port number
+ * @param options - Pool options, NULL for defaults
  * @return ConnectionPool* - Connection pool
  */
-ConnectionPool *pool_create(const char *host, const char *user, const char *password, const char *database, int port);
+ConnectionPool *pool_create(const char *host, const char *user, const char *password, const char *database, int port, const PoolOptions *options);
 
 /**
  * Destroy a connection pool
@@ -62,17 +176,51 @@ void pool_destroy(ConnectionPool *pool);
 
 /**
  * Get a connection from the pool
+ * - Pops the most recently used idle connection in O(1)
+ * - Pings first only when the connection sat idle longer than `validate_after_ms`, outside the lock
+ * - Waits in a FIFO queue up to `acquire_timeout_ms` when every connection is in use
  * @param pool - Connection pool
- * @return MYSQL* - Connection
+ * @return PoolConnection* - Connection, NULL on timeout or connection failure
  */
-MYSQL *pool_get_connection(ConnectionPool *pool);
+PoolConnection *pool_get_connection(ConnectionPool *pool);
 
 /**
- * Return a connection to the pool
+ * Return a connection to the pool in O(1)
  * @param pool - Connection pool
  * @param conn - Connection
  */
-void pool_return_connection(ConnectionPool *pool, MYSQL *conn);
+void pool_return_connection(ConnectionPool *pool, PoolConnection *conn);
+
+/**
+ * ## Allow several statements per query on a checked out connection
+ * - Connections are opened without multi statements, so a query built from user input can never stack statements.
+ *   Batches and transactions, which join their own statements, turn them on for as long as they hold the connection
+ * - `pool_return_connection` drains what is left of the results and turns them off again
+ * @param conn - Connection, checked out
+ * @return bool - False when the server refused, the connection error says why
+ */
+bool pool_enable_multi_statements(PoolConnection *conn);
+
+/**
+ * Consume the result sets left on a connection by a multi-statement, so it can serve the next query
+ * @param conn - Connection
+ */
+void pool_drain_results(MYSQL *conn);
+
+/**
+ * Close a connection left in an unknown state instead of returning it
+ * - The slot becomes free, the next checkout opens a new connection in its place
+ * @param pool - Connection pool
+ * @param conn - Connection
+ */
+void pool_discard_connection(ConnectionPool *pool, PoolConnection *conn);
+
+/**
+ * Read the occupancy of a pool
+ * @param pool - Connection pool, NULL reads all zeros
+ * @param gauges - Receives the occupancy
+ */
+void pool_gauges(ConnectionPool *pool, PoolGauges *gauges);
 
 /**
  * Validate a connection
@@ -81,4 +229,4 @@ void pool_return_connection(ConnectionPool *pool, MYSQL *conn);
  */
 bool pool_validate_connection(MYSQL *conn);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,245 @@
+#ifndef MYSQL_RESULT_H
+#define MYSQL_RESULT_H
+
+#include "mysql_arena.h"
+#include <mysql.h>
+#include <node_api.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ## Bind buffer size of a column whose longest value is not known up front
+ * @note Only cursors fetch this way, buffered results size every buffer from the column's longest value
+ */
+#define RESULT_COLUMN_BUFFER_SIZE 4096
+
+/**
+ * ## Largest bind buffer of a column
+ * @note Longer values are fetched separately with `mysql_stmt_fetch_column`, never truncated
+ */
+#define RESULT_COLUMN_BUFFER_LIMIT 65536
+
+/**
+ * How a column is bound and which JS type it becomes
+ * - `COLUMN_INT` / `COLUMN_UINT`: TINYINT..BIGINT and YEAR, a number or a BigInt beyond 2^53
+ * - `COLUMN_DOUBLE`: FLOAT and DOUBLE, a number
+ * - `COLUMN_DATETIME`: DATE, DATETIME and TIMESTAMP read as UTC, a Date
+ * - `COLUMN_BINARY`: BLOB, BINARY, VARBINARY and BIT, a Buffer
+ * - `COLUMN_STRING`: everything else (VARCHAR, TEXT, DECIMAL, JSON, TIME, ENUM, SET), a string
+ */
+typedef enum {
+    COLUMN_INT,
+    COLUMN_UINT,
+    COLUMN_DOUBLE,
+    COLUMN_DATETIME,
+    COLUMN_STRING,
+    COLUMN_BINARY,
+} ColumnKind;
+
+/**
+ * Single value of a result set
+ * - `double_value` holds milliseconds since the epoch for `COLUMN_DATETIME`
+ * - `data` / `length` hold the bytes of `COLUMN_STRING` and `COLUMN_BINARY`
+ */
+typedef struct {
+    bool is_null;
+    unsigned long length;
+    union {
+        long long int_value;
+        unsigned long long uint_value;
+        double double_value;
+        char *data;
+    };
+} PeekCell;
+
+/**
+ * Result set
+ * - Rows fetched on a worker thread, kept in C memory until they are turned into JS values
+ * - Field names and cell bytes live in `arena`, so a result is freed in a few calls however many cells it has
+ * @note `cells` is row-major: `num_rows * num_fields` cells
+ */
+typedef struct {
+    Arena arena;
+    unsigned int num_fields;
+    char **field_names;
+    ColumnKind *kinds;
+    PeekCell *cells;
+    size_t num_rows;
+    size_t capacity;
+    size_t bytes; // Decoded value bytes: string and binary lengths, 8 per other value
+} PeekResult;
+
+/**
+ * Pick how a column is bound from its metadata
+ * @param field - Column metadata
+ * @return ColumnKind - Column kind
+ */
+ColumnKind result_column_kind(const MYSQL_FIELD *field);
+
+/**
+ * Incremental reader of an executed statement
+ * - Binds the result columns once, then fetches rows in batches of any size
+ */
+typedef struct ResultReader ResultReader;
+
+/**
+ * Bind the result columns of an executed statement
+ * - `buffered` transfers the whole result first, so every bind buffer is sized from the column's longest value
+ * - Otherwise rows stay on the server (cursors) and buffers start at `RESULT_COLUMN_BUFFER_SIZE`
+ * @param stmt - Executed statement
+ * @param scratch - Arena of the statement's connection, reset here and holding the bind buffers
+ * @param buffered - Whether to store the result on the client first
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return ResultReader* - Reader, NULL on failure
+ * @note The reader lives in `scratch`: it is invalid once `scratch` is reset by the next query on the connection
+ */
+ResultReader *result_reader_create(MYSQL_STMT *stmt, Arena *scratch, bool buffered, char *error, size_t error_size);
+
+/**
+ * ## Fetch the next rows of a reader
+ * @param reader - Reader
+ * @param max_rows - Maximum number of rows, 0 for all remaining rows
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return PeekResult* - Result set, empty once the statement is exhausted, NULL on failure
+ */
+PeekResult *result_reader_fetch(ResultReader *reader, size_t max_rows, char *error, size_t error_size);
+
+/**
+ * Whether every row of the statement has been fetched
+ * @param reader - Reader
+ * @return bool - True once `mysql_stmt_fetch` reported no more data
+ */
+bool result_reader_done(const ResultReader *reader);
+
+/**
+ * Release the metadata of a reader
+ * @param reader - Reader
+ * @note The statement and the scratch memory are left untouched
+ */
+void result_reader_free(ResultReader *reader);
+
+/**
+ * ## Fetch all rows of an executed statement
+ * @param stmt - Executed statement
+ * @param scratch - Arena of the statement's connection
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return PeekResult* - Result set, NULL on failure
+ */
+PeekResult *result_from_stmt(MYSQL_STMT *stmt, Arena *scratch, char *error, size_t error_size);
+
+/**
+ * ## Read a text protocol result, such as one result set of a multi-statement
+ * - Values are decoded into the same column kinds as prepared statement results
+ * @param res - Stored result, NULL for a statement without a result set
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return PeekResult* - Result set, empty without columns when `res` is NULL, NULL on failure
+ */
+PeekResult *result_from_text(MYSQL_RES *res, char *error, size_t error_size);
+
+/**
+ * ## Convert a result set into an array of row objects
+ * @param env - N-API environment
+ * @param result - Result set
+ * @return napi_value - JS array
+ */
+napi_value result_to_js(napi_env env, const PeekResult *result);
+
+/**
+ * Size of a result set once serialized by `result_serialize`
+ * @param result - Result set
+ * @return size_t - Size in bytes
+ */
+size_t result_serialized_size(const PeekResult *result);
+
+/**
+ * ## Serialize a result set into one contiguous buffer
+ * - Column names and kinds, then every cell: a null flag followed by 8 bytes for numbers and dates or a length and
+ *   the bytes for strings and buffers
+ * @param result - Result set
+ * @param out - Buffer of `result_serialized_size(result)` bytes
+ */
+void result_serialize(const PeekResult *result, uint8_t *out);
+
+/**
+ * ## Convert a serialized result set into an array of row objects
+ * - Produces the same values as `result_to_js` on the original result set
+ * @param env - N-API environment
+ * @param data - Buffer filled by `result_serialize`
+ * @return napi_value - JS array
+ */
+napi_value result_serialized_to_js(napi_env env, const uint8_t *data);
+
+/**
+ * ## Tag of a cell of a packed result set
+ * - `PACKED_BIG`: an integer beyond 2^53, its slot holds an int64 (`COLUMN_INT`) or a uint64 (`COLUMN_UINT`)
+ */
+typedef enum {
+    PACKED_VALUE,
+    PACKED_NULL,
+    PACKED_BIG,
+} PackedTag;
+
+/**
+ * ## Copy a result set into one ArrayBuffer, decoded lazily by JS row views
+ * - For `n = rows * columns` cells in row-major order, the buffer holds:
+ *   - `n` slots of 8 bytes: a double for numbers, safe integers and dates (ms since the epoch), the integer of a
+ *     `PACKED_BIG` cell, or a uint32 offset and a uint32 length into the data area for strings and buffers
+ *   - `n` tag bytes, see `PackedTag`
+ *   - The data area: the bytes of every string and buffer
+ * - Returns `{ columns, kinds, rows, buffer }`, `kinds` holding the `ColumnKind` of every column
+ * @param env - N-API environment
+ * @param result - Result set
+ * @return napi_value - Packed result, NULL with a pending exception on failure
+ * @note Slots are in the byte order of the host, which JS typed arrays share
+ */
+napi_value result_to_packed(napi_env env, const PeekResult *result);
+
+/**
+ * Copy a serialized result set into one ArrayBuffer, see `result_to_packed`
+ * @param env - N-API environment
+ * @param data - Buffer filled by `result_serialize`
+ * @return napi_value - Packed result, NULL with a pending exception on failure
+ */
+napi_value result_serialized_to_packed(napi_env env, const uint8_t *data);
+
+/**
+ * Column a merge orders rows by, see `result_merge`
+ */
+typedef struct {
+    unsigned int column;
+    bool descending;
+} ResultSortKey;
+
+/**
+ * ## Merge result sets of the same columns, such as the parts of a select fanned out to shards
+ * - Without keys the rows are concatenated in part order
+ * - With keys every part must already be sorted by them, as the server sorts an ORDER BY: the sorted parts are merged,
+ *   rows with equal keys keep their part order
+ * - NULL sorts first when ascending, strings compare bytewise with ASCII letters folded, buffers bytewise
+ * - The first `offset` merged rows are dropped and at most `limit` rows are kept
+ * @param parts - Result sets, all consumed: the merged rows are returned in `parts[0]`, the others are freed
+ * @param count - Number of parts, >= 1
+ * @param keys - Columns to order by, NULL for none
+ * @param key_count - Number of keys
+ * @param offset - Rows dropped
+ * @param limit - Rows kept at most, `SIZE_MAX` for all
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return PeekResult* - Merged result set, NULL on failure, when the parts do not have the same columns
+ * @note Cell bytes are not copied, the arenas of the parts move into the merged result
+ */
+PeekResult *result_merge(PeekResult **parts, size_t count, const ResultSortKey *keys, size_t key_count, size_t offset,
+                         size_t limit, char *error, size_t error_size);
+
+/**
+ * Free a result set
+ * @param result - Result set
+ */
+void result_free(PeekResult *result);
+
+#endif
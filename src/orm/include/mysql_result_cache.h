@@ -0,0 +1,198 @@
+#ifndef MYSQL_RESULT_CACHE_H
+#define MYSQL_RESULT_CACHE_H
+
+#include "mysql_params.h"
+#include "mysql_result.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ## Default time a cached result stays valid
+ * @note Used when `resultCacheTtl` is not passed to `initialize`
+ */
+#define DEFAULT_RESULT_CACHE_TTL_MS 60000
+
+/**
+ * ## Most tables a cached statement may read
+ * @note Statements reading more tables are not cached, writes touching more invalidate the whole cache
+ */
+#define RESULT_CACHE_MAX_TABLES 16
+
+/**
+ * Number of buckets of the table generation map
+ */
+#define RESULT_CACHE_TABLE_BUCKETS 64
+
+/**
+ * Write generation of a table
+ * - Bumped by every write to the table, tables are never removed
+ */
+typedef struct ResultCacheTable {
+    char *name;
+    uint64_t generation;
+    struct ResultCacheTable *next;
+} ResultCacheTable;
+
+/**
+ * Table read by a cached statement, with its generation when the statement started
+ */
+typedef struct {
+    ResultCacheTable *table;
+    uint64_t generation;
+} ResultCacheDependency;
+
+/**
+ * Serialized result set shared by the cache and the hits reading it
+ * - `data` holds `result_serialize` output and is never modified, so hits read it without the lock
+ */
+typedef struct {
+    int refs;
+    size_t size;
+    uint8_t data[];
+} CachedResult;
+
+/**
+ * Cached result of one statement and its placeholder values
+ */
+typedef struct ResultCacheEntry {
+    char *key;
+    size_t key_length;
+    uint64_t hash;
+    CachedResult *result;
+    ResultCacheDependency tables[RESULT_CACHE_MAX_TABLES];
+    int table_count;
+    uint64_t epoch;      // Cache epoch when the statement started
+    uint64_t expires_ms; // 0 never expires
+    size_t bytes;
+    struct ResultCacheEntry *prev;   // LRU list, towards most recently used
+    struct ResultCacheEntry *next;   // LRU list, towards least recently used
+    struct ResultCacheEntry *bucket; // Hash chain
+} ResultCacheEntry;
+
+/**
+ * Missed lookup, filled by `result_cache_lookup` and handed to `result_cache_store` once the statement ran
+ * - Holds the generations read before the statement ran, so a write racing with it makes the stored result stale
+ * @note `key` is NULL when the statement cannot be cached
+ */
+typedef struct {
+    char *key;
+    size_t key_length;
+    uint64_t hash;
+    ResultCacheDependency tables[RESULT_CACHE_MAX_TABLES];
+    int table_count;
+    uint64_t epoch;
+} ResultCacheTicket;
+
+/**
+ * Result cache statistics
+ */
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;     // Dropped to stay under the memory bound
+    uint64_t invalidations; // Dropped because a table they read was written
+    uint64_t expirations;   // Dropped after their TTL
+    size_t entries;
+    size_t bytes;
+} ResultCacheStats;
+
+/**
+ * ## Read-through result cache
+ * - LRU of serialized result sets keyed by normalized SQL plus placeholder values, bounded in bytes
+ * - Every write bumps the generation of the tables it touches, entries that read an older generation are stale and
+ *   dropped when a lookup or the LRU reaches them
+ * - Only plain deterministic SELECTs of at most `RESULT_CACHE_MAX_TABLES` tables are cached
+ * @note Thread safe, lookups run on the main thread while workers store results and invalidate tables
+ */
+typedef struct {
+    ResultCacheEntry **buckets;
+    size_t bucket_count;
+    ResultCacheEntry *head; // Most recently used
+    ResultCacheEntry *tail; // Least recently used
+    ResultCacheTable *tables[RESULT_CACHE_TABLE_BUCKETS];
+    uint64_t epoch; // Bumped by writes whose tables are unknown, invalidates every entry
+    size_t max_bytes;
+    int ttl_ms;
+    ResultCacheStats stats;
+    pthread_mutex_t lock;
+} ResultCache;
+
+/**
+ * ## Create a result cache
+ * @param max_bytes - Memory bound of the cached entries
+ * @param ttl_ms - Time an entry stays valid, <= 0 until invalidated or evicted
+ * @return ResultCache* - Cache, NULL when out of memory
+ */
+ResultCache *result_cache_create(size_t max_bytes, int ttl_ms);
+
+/**
+ * Destroy a result cache
+ * @param cache - Cache, may be NULL
+ * @note Every result returned by `result_cache_lookup` must be released first
+ */
+void result_cache_destroy(ResultCache *cache);
+
+/**
+ * ## Look up the result of a SELECT
+ * @param cache - Cache
+ * @param sql - SQL statement
+ * @param params - Placeholder values, may be NULL
+ * @param ticket - Receives what `result_cache_store` needs on a miss, zeroed by the caller
+ * @return CachedResult* - Result to pass to `result_serialized_to_js` then `result_cache_release`, NULL on a miss
+ */
+CachedResult *result_cache_lookup(ResultCache *cache, const char *sql, const PeekParams *params, ResultCacheTicket *ticket);
+
+/**
+ * ## Store the result of a missed lookup
+ * - Skipped when a table it read was written since the lookup, or when it alone exceeds the memory bound
+ * @param cache - Cache
+ * @param ticket - Ticket of the missed lookup, left for `result_cache_ticket_free`
+ * @param result - Result set of the statement
+ */
+void result_cache_store(ResultCache *cache, ResultCacheTicket *ticket, const PeekResult *result);
+
+/**
+ * Release a result returned by `result_cache_lookup`
+ * @param cache - Cache
+ * @param result - Result
+ */
+void result_cache_release(ResultCache *cache, CachedResult *result);
+
+/**
+ * Free a ticket
+ * @param ticket - Ticket
+ */
+void result_cache_ticket_free(ResultCacheTicket *ticket);
+
+/**
+ * ## Invalidate the tables written by a statement
+ * - Tables are read from INSERT/REPLACE INTO, UPDATE, DELETE FROM, JOIN, LOAD DATA INTO TABLE and DDL
+ * - Invalidates the whole cache when the statement names no table it understands
+ * @param cache - Cache
+ * @param sql - SQL statement
+ */
+void result_cache_invalidate(ResultCache *cache, const char *sql);
+
+/**
+ * Invalidate one table
+ * @param cache - Cache
+ * @param table - Table name, optionally qualified by its database, NULL to invalidate the whole cache
+ */
+void result_cache_invalidate_table(ResultCache *cache, const char *table);
+
+/**
+ * Drop every entry
+ * @param cache - Cache
+ */
+void result_cache_clear(ResultCache *cache);
+
+/**
+ * Read the statistics of a cache
+ * @param cache - Cache
+ * @param stats - Receives the statistics
+ */
+void result_cache_stats(ResultCache *cache, ResultCacheStats *stats);
+
+#endif
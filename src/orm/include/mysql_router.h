@@ -0,0 +1,126 @@
+#ifndef MYSQL_ROUTER_H
+#define MYSQL_ROUTER_H
+
+#include "mysql_pool.h"
+#include <mysql.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * ## Default interval of the replica health check
+ * @note Used when `replicaCheckInterval` is not passed to `initialize`
+ */
+#define DEFAULT_REPLICA_CHECK_INTERVAL_MS 5000
+
+/**
+ * ## Connect timeout of a replica health check, in seconds
+ */
+#define REPLICA_PROBE_TIMEOUT_S 2
+
+/**
+ * Replica server, anything left NULL is taken from the primary
+ */
+typedef struct {
+    const char *host;
+    const char *user;
+    const char *password;
+    const char *database;
+    int port;
+} ReplicaConfig;
+
+/**
+ * Read replica
+ * - `probe` is a connection of its own, only used by the health check thread
+ */
+typedef struct {
+    ConnectionPool *pool;
+    MYSQL *probe;
+    int outstanding; // Reads running on the replica
+    bool healthy;    // False while ejected
+    uint64_t reads;
+    uint64_t ejections;
+} ReplicaNode;
+
+/**
+ * Snapshot of a replica, see `router_status`
+ */
+typedef struct {
+    const char *host;
+    int port;
+    bool healthy;
+    int outstanding;
+    uint64_t reads;
+    uint64_t ejections;
+} ReplicaStatus;
+
+/**
+ * ## Read router
+ * - Sends each read to the healthy replica with the fewest outstanding reads, ties go round robin
+ * - Reads within `read_your_writes_ms` of the last write go to the primary, so they see it
+ * - A replica whose connection fails `pool_validate_connection` is ejected, the health check re-adds it once it
+ *   answers again. A replica that is only saturated stays in, the read goes to the primary
+ * @note Writes, DDL, streams and transactions never go through the router, they always use the primary pool
+ */
+typedef struct {
+    ReplicaNode *replicas;
+    int replica_count;
+    int next; // Round robin start of the next pick
+    int read_your_writes_ms;
+    uint64_t last_write_ms;
+    int check_interval_ms;
+    pthread_mutex_t lock;
+    pthread_cond_t check_cond;
+    pthread_t check_thread;
+    bool check_running;
+    bool stopping;
+} ReplicaRouter;
+
+/**
+ * ## Create a read router with one connection pool per replica
+ * - Every replica is probed once before returning, an unreachable one starts ejected
+ * @param replicas - Replica servers
+ * @param count - Number of replicas
+ * @param primary - Pool of the primary, the source of missing credentials
+ * @param read_your_writes_ms - Time reads stay on the primary after a write, 0 never pins
+ * @param check_interval_ms - Interval of the replica health check, <= 0 disables it
+ * @return ReplicaRouter* - Router, NULL when out of memory
+ */
+ReplicaRouter *router_create(const ReplicaConfig *replicas, int count, const ConnectionPool *primary, int read_your_writes_ms,
+                             int check_interval_ms);
+
+/**
+ * Destroy a read router and the pools of its replicas
+ * @param router - Router, may be NULL
+ */
+void router_destroy(ReplicaRouter *router);
+
+/**
+ * ## Pick the replica of the next read
+ * @param router - Router
+ * @return ReplicaNode* - Replica to read from, hand it back with `router_release`, NULL to read from the primary
+ */
+ReplicaNode *router_acquire(ReplicaRouter *router);
+
+/**
+ * Hand back a replica picked by `router_acquire`
+ * @param router - Router
+ * @param node - Replica
+ * @param lost - Whether the replica stopped answering, it is then ejected until the health check re-adds it
+ */
+void router_release(ReplicaRouter *router, ReplicaNode *node, bool lost);
+
+/**
+ * Record a write to the primary, starting the read-your-writes window
+ * @param router - Router
+ */
+void router_note_write(ReplicaRouter *router);
+
+/**
+ * Read the state of every replica
+ * @param router - Router
+ * @param statuses - Receives `replica_count` statuses
+ */
+void router_status(ReplicaRouter *router, ReplicaStatus *statuses);
+
+#endif
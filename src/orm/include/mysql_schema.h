@@ -0,0 +1,197 @@
+#ifndef MYSQL_SCHEMA_H
+#define MYSQL_SCHEMA_H
+
+#include "mysql_async.h"
+#include "mysql_pool.h"
+#include <mysql.h>
+#include <node_api.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * ## Table holding the schema hash each table was last synced from
+ * @note Created on the first sync
+ */
+#define SCHEMA_META_TABLE "_peek_schema"
+
+/**
+ * ## Longest schema hash kept, longer ones never match
+ */
+#define SCHEMA_HASH_SIZE 128
+
+/**
+ * ## Maximum number of connections a schema sync spreads its DDL over
+ */
+#define SCHEMA_MAX_PARALLEL 16
+
+/**
+ * ## Bytes of a column type and default kept for the diff
+ * @note Longer ones are compared on their first bytes only
+ */
+#define SCHEMA_TYPE_SIZE 512
+#define SCHEMA_DEFAULT_SIZE 256
+
+/**
+ * Outcome of syncing one table
+ */
+typedef enum {
+    SCHEMA_PENDING,   // Not looked at yet
+    SCHEMA_SKIPPED,   // Hash matches the metadata table, not introspected
+    SCHEMA_UNCHANGED, // Introspected, already matches the schema
+    SCHEMA_CREATED,   // Created with its indexes
+    SCHEMA_ALTERED,   // Columns added, dropped or modified, or indexes created
+    SCHEMA_FAILED,    // A DDL statement failed, see `error`
+} SchemaStatus;
+
+/**
+ * ## Column attributes compared by the diff
+ * - Parsed from a column definition, or read from `information_schema.COLUMNS`
+ * - `type` is lowercased outside quotes with synonyms and integer display widths folded, so `INT(11)`, `int` and
+ *   `INTEGER` compare equal
+ * - `default_value` is unquoted, `CURRENT_TIMESTAMP` and `NOW()` fold to `current_timestamp`
+ */
+typedef struct {
+    char type[SCHEMA_TYPE_SIZE];
+    bool nullable;
+    bool has_default;
+    char default_value[SCHEMA_DEFAULT_SIZE];
+    bool primary_key;
+    bool unique;
+    bool auto_increment;
+} SchemaColumnInfo;
+
+/**
+ * Column of a table schema
+ */
+typedef struct {
+    char *name;
+    char *definition; // As in CREATE TABLE, name included
+    SchemaColumnInfo info;
+} SchemaColumn;
+
+/**
+ * Column found by the introspection
+ */
+typedef struct {
+    char *name;
+    SchemaColumnInfo info;
+} SchemaExistingColumn;
+
+/**
+ * Index of a table schema
+ */
+typedef struct {
+    char *name;
+    char *columns; // Comma separated
+    bool exists;   // Found by the introspection
+} SchemaIndex;
+
+/**
+ * ## Table schema to sync
+ * - Copied out of JS on the main thread, synced on worker threads
+ * - `constraints` (foreign keys) only apply when the table is created
+ * - `references` are tables that must be created first
+ */
+typedef struct {
+    char *name;
+    char *hash;
+    SchemaColumn *columns;
+    size_t column_count;
+    char **constraints;
+    size_t constraint_count;
+    SchemaIndex *indexes;
+    size_t index_count;
+    char **references;
+    size_t reference_count;
+
+    // Filled by `schema_sync`
+    SchemaStatus status;
+    bool exists;
+    SchemaExistingColumn *existing;
+    size_t existing_count;
+    size_t existing_capacity;
+    int level;             // DDL runs level by level, a table after the tables it references
+    char *ddl;             // CREATE TABLE or one coalesced ALTER TABLE, NULL when the table is in line
+    size_t changes;        // Columns, constraints and indexes `ddl` creates, adds, drops or modifies
+    const char *algorithm; // ALTER algorithm the server accepted: "instant", "inplace" or "copy"
+    char error[TASK_ERROR_SIZE];
+} SchemaTable;
+
+/**
+ * Table schemas of one sync
+ */
+typedef struct {
+    SchemaTable *items;
+    size_t count;
+} SchemaTables;
+
+/**
+ * ## Copy a JS array of table schemas
+ * - `{ name, hash, columns: [{ name, definition }], constraints?, indexes?: [{ name, columns }], references? }`
+ * @param env - N-API environment
+ * @param array - JS array
+ * @param tables - Receives the schemas
+ * @return bool - False with a pending JS exception on invalid input
+ */
+bool schema_tables_from_js(napi_env env, napi_value array, SchemaTables *tables);
+
+/**
+ * ## Bring tables in line with their schemas
+ * - One read of the metadata table skips every table whose hash did not change
+ * - One round trip to `information_schema` reads the columns and indexes of all the other tables
+ * - Each table gets at most one statement: a CREATE TABLE with its indexes, or one ALTER TABLE with every column added,
+ *   dropped or modified and every index added, tried with `ALGORITHM=INSTANT`, then `ALGORITHM=INPLACE, LOCK=NONE`,
+ *   then the server's default
+ * - The statements run on up to `parallel` pooled connections at once, a table after the tables it references
+ * - Hashes of the tables now in line are written back in one statement
+ * @param pool - Connection pool
+ * @param tables - Schemas, receive their status
+ * @param parallel - Connections to spread the DDL over
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False when the introspection failed, a failed table only sets its own status
+ */
+bool schema_sync(ConnectionPool *pool, SchemaTables *tables, int parallel, char *error, size_t error_size);
+
+/**
+ * ## Bring one table in line with its schema, on one connection
+ * - Same diff and ALTER as `schema_sync`, without the hash metadata table
+ * @param conn - MySQL connection
+ * @param table - Schema, receives its status
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False when the introspection or the statement failed
+ */
+bool schema_sync_table(MYSQL *conn, SchemaTable *table, char *error, size_t error_size);
+
+/**
+ * ## Build a table schema from a comma separated definition list, as in CREATE TABLE
+ * - Commas inside parentheses and quotes do not split, so `DECIMAL(10,2)` and `ENUM('a','b')` stay whole
+ * - Entries starting with CONSTRAINT, FOREIGN, PRIMARY, UNIQUE, KEY, INDEX, CHECK, FULLTEXT or SPATIAL are constraints
+ * @param name - Table name, copied
+ * @param definitions - Definition list
+ * @param table - Receives the schema, free it with `schema_table_free`
+ * @return bool - False when out of memory or a column definition cannot be parsed
+ */
+bool schema_table_from_definitions(const char *name, const char *definitions, SchemaTable *table);
+
+/**
+ * Name of a sync outcome, as used in JS
+ * @param status - Outcome
+ * @return const char* - Name
+ */
+const char *schema_status_name(SchemaStatus status);
+
+/**
+ * Free one table schema
+ * @param table - Schema
+ */
+void schema_table_free(SchemaTable *table);
+
+/**
+ * Free table schemas
+ * @param tables - Schemas
+ */
+void schema_tables_free(SchemaTables *tables);
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef MYSQL_SHARD_H
+#define MYSQL_SHARD_H
+
+#include "mysql_params.h"
+#include "mysql_pool.h"
+#include "mysql_result.h"
+#include "mysql_router.h"
+#include <mysql.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * ## Maximum number of shards of a shard map
+ */
+#define SHARD_LIMIT 64
+
+/**
+ * ## ORDER BY columns a fanned out select is merged on
+ */
+#define SHARD_ORDER_LIMIT 16
+
+/**
+ * ## `shard_map_route` results that are not a shard
+ */
+#define SHARD_UNSHARDED -1
+#define SHARD_INVALID -2
+
+/**
+ * How the shard key of a table picks its shard
+ * - `SHARD_HASH`: a jump consistent hash of the key's text, so `42` and `'42'` land on the same shard
+ * - `SHARD_RANGE`: the last shard whose lower bound is <= the numeric key
+ */
+typedef enum {
+    SHARD_HASH,
+    SHARD_RANGE,
+} ShardStrategy;
+
+/**
+ * Table spread over the shards, declared by its schema
+ */
+typedef struct {
+    char *table;
+    char *column;
+    ShardStrategy strategy;
+    double *bounds; // `SHARD_RANGE`: lower bound of shards 1 to count - 1, ascending, shard 0 takes everything below
+} ShardTable;
+
+/**
+ * ## Shard map
+ * - One connection pool per shard, sharded tables live on every shard with a share of the rows each
+ * - Tables no schema declared a shard key for stay on the primary pool
+ * @note Every Node environment sharing the map declares and looks up tables, `lock` guards them
+ */
+typedef struct {
+    ConnectionPool **pools;
+    int shard_count;
+    ShardTable *tables;
+    size_t table_count;
+    pthread_mutex_t lock;
+} ShardMap;
+
+/**
+ * ## Create a shard map with one connection pool per shard
+ * - An unreachable shard gets a pool that opens connections on demand, its queries fail until it answers
+ * @param servers - Shard servers, anything left NULL is taken from the primary, as for replicas
+ * @param count - Number of shards, 1 to `SHARD_LIMIT`
+ * @param primary - Pool of the primary, the source of missing credentials and of the pool options
+ * @return ShardMap* - Shard map, NULL when out of memory
+ */
+ShardMap *shard_map_create(const ReplicaConfig *servers, int count, const ConnectionPool *primary);
+
+/**
+ * Destroy a shard map and the pools of its shards
+ * @param map - Shard map, may be NULL
+ */
+void shard_map_destroy(ShardMap *map);
+
+/**
+ * ## Declare the shard key of a table, replacing its previous one
+ * @param map - Shard map
+ * @param table - Table name
+ * @param column - Shard key column
+ * @param strategy - How the key picks its shard
+ * @param bounds - `SHARD_RANGE`: `shard_count - 1` ascending lower bounds, NULL for `SHARD_HASH`
+ * @param bound_count - Number of bounds
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False when the bounds do not fit the shards, or out of memory
+ */
+bool shard_map_declare(ShardMap *map, const char *table, const char *column, ShardStrategy strategy, const double *bounds,
+                       int bound_count, char *error, size_t error_size);
+
+/**
+ * Whether a table has a shard key
+ * @param map - Shard map, may be NULL
+ * @param table - Table name
+ * @return bool - False when the table stays on the primary
+ */
+bool shard_map_contains(ShardMap *map, const char *table);
+
+/**
+ * ## Shard holding a key of a table
+ * @param map - Shard map
+ * @param table - Table name
+ * @param key - Shard key value
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return int - Shard index, `SHARD_UNSHARDED` when the table has no shard key, `SHARD_INVALID` for a NULL key or a
+ * non numeric key of a range
+ */
+int shard_map_route(ShardMap *map, const char *table, const PeekParam *key, char *error, size_t error_size);
+
+/**
+ * ## Run a select on every shard in parallel and merge the results
+ * - The outermost ORDER BY must name selected columns or positions: each shard sorts its rows, which are then merged
+ * - `LIMIT n OFFSET m` runs as `LIMIT n + m` on every shard, the offset and limit apply to the merged rows
+ * - DISTINCT, GROUP BY, HAVING and aggregates are refused outside subqueries: their per shard rows cannot be merged
+ * @param map - Shard map
+ * @param query - Statement with `?` placeholders
+ * @param params - Placeholder values
+ * @param result - Receives the merged result set
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False when a shard failed or the select cannot be merged
+ */
+bool shard_select(ShardMap *map, const char *query, const PeekParams *params, PeekResult **result, char *error,
+                  size_t error_size);
+
+/**
+ * ## Run a write on every shard in parallel
+ * @param map - Shard map
+ * @param query - Statement with `?` placeholders
+ * @param params - Placeholder values
+ * @param affected_rows - Receives the rows affected on all shards
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False when a shard failed, the other shards may have applied the write
+ */
+bool shard_write(ShardMap *map, const char *query, const PeekParams *params, my_ulonglong *affected_rows, char *error,
+                 size_t error_size);
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef MYSQL_SHARED_H
+#define MYSQL_SHARED_H
+
+#include "mysql_advisor.h"
+#include "mysql_driver.h"
+#include "mysql_pool.h"
+#include "mysql_result_cache.h"
+#include "mysql_router.h"
+#include "mysql_shard.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * What `initialize` asks for, see `shared_pool_acquire`
+ */
+typedef struct {
+    const char *host;
+    const char *user;
+    const char *password;
+    const char *database;
+    int port;
+    PoolOptions pool_options;
+    int cache_size; // Bytes of the result cache, 0 without one
+    int cache_ttl_ms;
+    const ReplicaConfig *replicas;
+    int replica_count;
+    int read_your_writes_ms;
+    int replica_check_ms;
+    const ReplicaConfig *shards;
+    int shard_count;
+    int slow_query_ms; // 0 without a slow query advisor
+} SharedPoolConfig;
+
+/**
+ * ## Shared pool
+ * - The connection pool of a server, with the replica router, shard map, slow query advisor and result cache built on
+ *   it, shared by every Node environment of the process that initialized with the same server and credentials, so
+ *   `worker_threads` query over the connections of the main thread
+ * - Reference counted: every environment holds one reference, every task running on it another, so it outlives the
+ *   environments that leave while their queries still run
+ * @note Everything in it is safe to use from any thread, the environment's own state is its direct connection and
+ * its event loop pool
+ */
+typedef struct SharedPool {
+    char *host;
+    char *user;
+    char *password;
+    char *database;
+    int port;
+    SharedPoolConfig config; // Options it was created with, an environment asking for others cannot join it
+    ConnectionPool *pool;
+    ResultCache *result_cache; // Only with resultCacheSize > 0
+    ReplicaRouter *router;     // Only with replicas
+    SlowQueryAdvisor *advisor; // Only with slowQueryThreshold > 0
+    ShardMap *shards;          // Only with shards
+    int environments;          // Environments holding it, only these let another environment join it
+    int refs;                  // Environments and running tasks holding it, both guarded by the registry lock
+    struct SharedPool *next;
+} SharedPool;
+
+/**
+ * ## Select the driver of the process and initialize its client library
+ * - The driver can only change while no shared pool is left, the fake driver's options likewise
+ * @param driver - Driver
+ * @param fake_options - Synthetic data, for the fake driver
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False when another driver or other fake driver options are in use, or the library fails to
+ * initialize
+ */
+bool shared_pool_use_driver(const PeekDriver *driver, const FakeDriverOptions *fake_options, char *error, size_t error_size);
+
+/**
+ * ## Join the shared pool of a server as an environment, creating it on first use
+ * - The options must be the ones the pool was created with, `event_loop` aside as each environment has its own
+ *   event loop pool
+ * @param config - Server, credentials and options
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return SharedPool* - Shared pool, NULL when it could not be created or was created with other options
+ */
+SharedPool *shared_pool_acquire(const SharedPoolConfig *config, char *error, size_t error_size);
+
+/**
+ * Leave a shared pool joined with `shared_pool_acquire`, its running tasks keep it alive until they complete
+ * @param shared - Shared pool, may be NULL
+ */
+void shared_pool_detach(SharedPool *shared);
+
+/**
+ * Take a reference to a shared pool for a task, before it is queued
+ * @param shared - Shared pool
+ * @return SharedPool* - The same shared pool
+ */
+SharedPool *shared_pool_retain(SharedPool *shared);
+
+/**
+ * Drop a reference taken with `shared_pool_retain`, the last reference destroys the pool
+ * @param shared - Shared pool, may be NULL
+ */
+void shared_pool_release(SharedPool *shared);
+
+#endif
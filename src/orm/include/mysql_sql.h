@@ -0,0 +1,151 @@
+#ifndef MYSQL_SQL_H
+#define MYSQL_SQL_H
+
+#include "mysql_params.h"
+#include <mysql.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Growable SQL text
+ * - Always NUL terminated once something was appended, zero initialize before first use
+ */
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} SqlBuffer;
+
+/**
+ * Make room for `extra` more bytes plus a NUL
+ * @param sql - SQL text
+ * @param extra - Number of bytes about to be appended
+ * @return bool - False when out of memory
+ */
+bool sql_reserve(SqlBuffer *sql, size_t extra);
+
+/**
+ * Statement with its placeholder values
+ * - Copied out of JS on the main thread, interpolated on a worker thread once a connection is known
+ */
+typedef struct {
+    char *query;
+    PeekParams params;
+} SqlStatement;
+
+/**
+ * Append raw SQL text
+ * @param sql - SQL text
+ * @param text - Bytes to append
+ * @param length - Number of bytes
+ * @return bool - False when out of memory
+ */
+bool sql_append(SqlBuffer *sql, const char *text, size_t length);
+
+/**
+ * Append a backtick quoted identifier
+ * @param sql - SQL text
+ * @param name - Identifier, backticks are doubled
+ * @return bool - False when out of memory
+ */
+bool sql_append_identifier(SqlBuffer *sql, const char *name);
+
+/**
+ * ## Append one value as an SQL literal
+ * - Strings are escaped for the connection's character set, binary data is written as a hex literal
+ * @param sql - SQL text
+ * @param conn - Connection the text will be sent on
+ * @param value - Value
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False on failure
+ */
+bool sql_append_value(SqlBuffer *sql, MYSQL *conn, const PeekParam *value, char *error, size_t error_size);
+
+/**
+ * ## Append a statement with its `?` placeholders replaced by escaped literals
+ * - Placeholders inside quoted strings, quoted identifiers and comments are left alone
+ * - Trailing whitespace and semicolons are dropped, so statements can be joined with `;`
+ * @param sql - SQL text
+ * @param conn - Connection the text will be sent on
+ * @param query - Statement with `?` placeholders
+ * @param params - Placeholder values, NULL for none
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False on failure, including a placeholder count mismatch
+ */
+bool sql_append_statement(SqlBuffer *sql, MYSQL *conn, const char *query, const PeekParams *params, char *error,
+                          size_t error_size);
+
+/**
+ * Kind of an SQL token
+ */
+typedef enum {
+    SQL_TOKEN_END,
+    SQL_TOKEN_IDENTIFIER, // Bare word, keywords included, or backquoted name
+    SQL_TOKEN_LITERAL,    // Quoted string or number
+    SQL_TOKEN_SYMBOL,     // Any other single character, `?` included
+} SqlTokenKind;
+
+/**
+ * SQL token, pointing into the statement it was read from
+ */
+typedef struct {
+    SqlTokenKind kind;
+    const char *start;
+    size_t length;
+} SqlToken;
+
+/**
+ * ## Read the token at `p`, skipping whitespace and comments first
+ * @param p - Position in a NUL terminated statement
+ * @param token - Receives the token, `SQL_TOKEN_END` at the end of the statement
+ * @return const char* - Position following the token
+ */
+const char *sql_next_token(const char *p, SqlToken *token);
+
+/**
+ * Whether a token is the given symbol
+ * @param token - Token
+ * @param symbol - Symbol
+ * @return bool - True when it is
+ */
+bool sql_is_symbol(const SqlToken *token, char symbol);
+
+/**
+ * Whether a token is the given keyword, case insensitively
+ * @param token - Token
+ * @param keyword - Keyword, upper case
+ * @return bool - True when it is, a backquoted name never is
+ */
+bool sql_is_keyword(const SqlToken *token, const char *keyword);
+
+/**
+ * Whether a query holds one statement at most, an optional trailing `;` aside
+ * @param query - Query
+ * @return bool - False when a `;` outside strings and comments is followed by more SQL
+ */
+bool sql_single_statement(const char *query);
+
+/**
+ * Copy the name of an identifier, without its backquotes
+ * @param token - Identifier token
+ * @param name - Receives the name, truncated to fit
+ * @param size - Size of `name`
+ */
+void sql_token_name(const SqlToken *token, char *name, size_t size);
+
+/**
+ * Free statements and the array holding them
+ * @param statements - Statements
+ * @param count - Number of statements
+ */
+void sql_statements_free(SqlStatement *statements, size_t count);
+
+/**
+ * Free SQL text
+ * @param sql - SQL text
+ */
+void sql_free(SqlBuffer *sql);
+
+#endif
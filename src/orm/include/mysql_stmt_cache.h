@@ -0,0 +1,87 @@
+#ifndef MYSQL_STMT_CACHE_H
+#define MYSQL_STMT_CACHE_H
+
+#include "mysql_params.h"
+#include <mysql.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ## Default number of prepared statements kept per connection
+ * @note Used when `statementCacheSize` is not passed to `initialize`
+ */
+#define DEFAULT_STMT_CACHE_SIZE 64
+
+/**
+ * Cached prepared statement
+ */
+typedef struct StmtCacheEntry {
+    char *sql;
+    size_t sql_length;
+    uint64_t hash;
+    MYSQL_STMT *stmt;
+    struct StmtCacheEntry *prev;   // LRU list, towards most recently used
+    struct StmtCacheEntry *next;   // LRU list, towards least recently used
+    struct StmtCacheEntry *bucket; // Hash chain
+} StmtCacheEntry;
+
+/**
+ * Prepared statement cache
+ * - LRU of prepared statements keyed by SQL text, one per pooled connection
+ * - Hash lookup plus a doubly linked list, so lookup, promotion and eviction are O(1)
+ * @note Not thread safe, a connection is only used by one thread at a time
+ */
+typedef struct {
+    StmtCacheEntry **buckets;
+    size_t bucket_count;
+    StmtCacheEntry *head; // Most recently used
+    StmtCacheEntry *tail; // Least recently used
+    int size;
+    int capacity;
+} StmtCache;
+
+/**
+ * Initialize an empty cache
+ * @param cache - Statement cache
+ * @param capacity - Maximum number of statements, at least 1
+ * @return bool - False when out of memory
+ */
+bool stmt_cache_init(StmtCache *cache, int capacity);
+
+/**
+ * ## Prepare, bind and execute a statement, reusing a cached prepared statement when possible
+ * - Re-prepares once when the server reports the statement must be re-prepared (e.g. after DDL)
+ * - A statement is only dropped from the cache when it cannot run again: it must be re-prepared or its connection
+ *   is gone. Errors of the values, such as a duplicate key, keep it cached
+ * @param cache - Statement cache of `conn`
+ * @param conn - Connection
+ * @param sql - SQL text with `?` placeholders
+ * @param params - Placeholder values, NULL for none
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return MYSQL_STMT* - Executed statement owned by the cache, NULL on failure
+ * @note Call `stmt_cache_done` once the result has been consumed
+ */
+MYSQL_STMT *stmt_cache_execute(StmtCache *cache, MYSQL *conn, const char *sql, PeekParams *params, char *error, size_t error_size);
+
+/**
+ * Release the result of a statement returned by `stmt_cache_execute`
+ * @param stmt - Statement
+ */
+void stmt_cache_done(MYSQL_STMT *stmt);
+
+/**
+ * Close every cached statement
+ * @param cache - Statement cache
+ * @note Call after the connection was closed to only free memory, before to also free server resources
+ */
+void stmt_cache_clear(StmtCache *cache);
+
+/**
+ * Clear the cache and free its buckets
+ * @param cache - Statement cache
+ */
+void stmt_cache_destroy(StmtCache *cache);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef MYSQL_STREAM_H
+#define MYSQL_STREAM_H
+
+#include "mysql_params.h"
+#include "mysql_pool.h"
+#include "mysql_result.h"
+#include <mysql.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * ## Default number of rows fetched per batch of a stream
+ * @note Used when `batchSize` is not passed to `selectStream`
+ */
+#define DEFAULT_STREAM_BATCH_SIZE 1000
+
+/**
+ * Streaming select
+ * - A read-only server side cursor on a dedicated prepared statement, rows are fetched `batch_size` at a time
+ * - The pooled connection stays pinned until the stream is exhausted, fails or is released
+ * @note Not thread safe, only one batch may be fetched at a time
+ */
+typedef struct {
+    ConnectionPool *pool;
+    PoolConnection *pooled;
+    MYSQL_STMT *stmt;
+    ResultReader *reader;
+    size_t batch_size;
+} PeekStream;
+
+/**
+ * ## Check out a connection and open a cursor over a query
+ * @param pool - Connection pool
+ * @param sql - SQL text with `?` placeholders
+ * @param params - Placeholder values, NULL for none
+ * @param batch_size - Rows per batch, 0 for the default
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return PeekStream* - Stream, NULL on failure
+ */
+PeekStream *stream_open(ConnectionPool *pool, const char *sql, PeekParams *params, size_t batch_size, char *error, size_t error_size);
+
+/**
+ * ## Fetch the next batch of a stream
+ * - Releases the connection as soon as the cursor is exhausted or fails
+ * @param stream - Stream
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return PeekResult* - Next rows, empty once the stream is exhausted, NULL on failure
+ */
+PeekResult *stream_fetch(PeekStream *stream, char *error, size_t error_size);
+
+/**
+ * Close the cursor and return the connection to the pool
+ * @param stream - Stream
+ * @note Safe to call more than once
+ */
+void stream_release(PeekStream *stream);
+
+/**
+ * Release and free a stream
+ * @param stream - Stream
+ */
+void stream_free(PeekStream *stream);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef MYSQL_TRANSACTION_H
+#define MYSQL_TRANSACTION_H
+
+#include "mysql_params.h"
+#include "mysql_pool.h"
+#include "mysql_result.h"
+#include "mysql_sql.h"
+#include <mysql.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * How a batch of transaction statements ends
+ */
+typedef enum {
+    TX_END_NONE,     // Keep the transaction open
+    TX_END_COMMIT,   // Append COMMIT and release the connection
+    TX_END_ROLLBACK, // Append ROLLBACK and release the connection
+} TxEnd;
+
+/**
+ * Outcome of one queued write
+ */
+typedef struct {
+    my_ulonglong affected_rows;
+    my_ulonglong insert_id;
+} TxStatementResult;
+
+/**
+ * Transaction
+ * - Pins one pooled connection from `transaction_begin` until it commits, rolls back or is released
+ * - START TRANSACTION is deferred and sent together with the first batch, so it costs no round trip of its own
+ * @note Not thread safe, only one batch or select may run at a time
+ */
+typedef struct {
+    ConnectionPool *pool;
+    PoolConnection *pooled;
+    bool begun;    // START TRANSACTION was executed
+    bool finished; // Committed, rolled back or lost, the connection is no longer pinned
+} PeekTransaction;
+
+/**
+ * ## Check out a connection for a transaction
+ * @param pool - Connection pool
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return PeekTransaction* - Transaction, NULL on failure
+ */
+PeekTransaction *transaction_begin(ConnectionPool *pool, char *error, size_t error_size);
+
+/**
+ * ## Run queued writes in one round trip
+ * - Statements are interpolated on the connection and sent as a single multi-statement,
+ *   preceded by START TRANSACTION on the first batch and followed by COMMIT or ROLLBACK when `end` says so
+ * - Execution stops at the first failing statement, the transaction stays open so the caller can roll back
+ * - A COMMIT or ROLLBACK that succeeded, or a lost connection, releases the connection
+ * @param tx - Transaction
+ * @param statements - Queued writes
+ * @param count - Number of queued writes
+ * @param end - How the batch ends
+ * @param results - Receives `count` outcomes
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return bool - False on failure
+ */
+bool transaction_execute(PeekTransaction *tx, const SqlStatement *statements, size_t count, TxEnd end,
+                         TxStatementResult *results, char *error, size_t error_size);
+
+/**
+ * ## Run a select inside the transaction
+ * - Uses the cached prepared statements of the pinned connection, so it sees the transaction's own writes
+ * @param tx - Transaction
+ * @param query - SQL text with `?` placeholders
+ * @param params - Placeholder values, NULL for none
+ * @param error - Buffer receiving the error message on failure
+ * @param error_size - Size of the error buffer
+ * @return PeekResult* - Result set, NULL on failure
+ */
+PeekResult *transaction_select(PeekTransaction *tx, const char *query, PeekParams *params, char *error, size_t error_size);
+
+/**
+ * Roll back a transaction that is still open and return its connection
+ * @param tx - Transaction
+ * @note Safe to call more than once, blocks for the ROLLBACK round trip
+ */
+void transaction_release(PeekTransaction *tx);
+
+/**
+ * Release and free a transaction
+ * @param tx - Transaction
+ */
+void transaction_free(PeekTransaction *tx);
+
+#endif
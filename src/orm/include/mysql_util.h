@@ -0,0 +1,29 @@
+#ifndef MYSQL_UTIL_H
+#define MYSQL_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ## Monotonic clock in milliseconds
+ * @return uint64_t - Milliseconds since an arbitrary point, never going back
+ */
+uint64_t util_now_ms(void);
+
+/**
+ * ## FNV-1a hash
+ * @param data - Bytes
+ * @param length - Number of bytes
+ * @return uint64_t - Hash
+ */
+uint64_t util_hash(const char *data, size_t length);
+
+/**
+ * FNV-1a hash of ASCII lowercased bytes, for names MySQL compares case insensitively
+ * @param data - Bytes
+ * @param length - Number of bytes
+ * @return uint64_t - Hash, the same for `Users` and `users`
+ */
+uint64_t util_hash_folded(const char *data, size_t length);
+
+#endif
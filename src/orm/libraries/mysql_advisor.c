@@ -0,0 +1,949 @@
+#include "../include/mysql_advisor.h"
+#include "../include/mysql_driver.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_sql.h"
+#include "../include/mysql_util.h"
+#include <ctype.h>
+#include <mysql.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/** Nesting an EXPLAIN may have, deeper output is refused rather than risking the stack */
+#define JSON_DEPTH_LIMIT 32
+
+/** Bytes of a JSON string kept, attached conditions past it lose their last columns */
+#define JSON_TEXT_SIZE 2048
+
+/** Tables of a FROM clause matched to their aliases */
+#define ALIAS_LIMIT 16
+
+/** Dotted name, `a`, `a.b` or `a.b.c`, keeping its last three parts */
+typedef struct {
+    char parts[3][SLOW_QUERY_NAME_SIZE];
+    int count;
+} NameChain;
+
+/** Read the dotted name starting at the identifier at `p` and return what follows it */
+static const char *read_chain(const char *p, NameChain *chain) {
+    SqlToken token;
+    chain->count = 0;
+    for (;;) {
+        const char *next = sql_next_token(p, &token);
+        if (chain->count == 3) {
+            memmove(chain->parts[0], chain->parts[1], 2 * sizeof(chain->parts[0]));
+            chain->count = 2;
+        }
+        sql_token_name(&token, chain->parts[chain->count++], SLOW_QUERY_NAME_SIZE);
+        p = next;
+
+        const char *dot = sql_next_token(p, &token);
+        SqlToken after;
+        if (!sql_is_symbol(&token, '.') || (sql_next_token(dot, &after), after.kind != SQL_TOKEN_IDENTIFIER)) {
+            return p;
+        }
+        p = dot;
+    }
+}
+
+char *advisor_fingerprint(const char *query) {
+    char *fingerprint = (char *)malloc(SLOW_QUERY_FINGERPRINT_SIZE);
+    if (!fingerprint) {
+        return NULL;
+    }
+
+    size_t length = 0;
+    SqlToken token, previous = {SQL_TOKEN_END, NULL, 0};
+    const char *p = query;
+    while (length < SLOW_QUERY_FINGERPRINT_SIZE - 1 && (p = sql_next_token(p, &token), token.kind != SQL_TOKEN_END)) {
+        bool value = token.kind == SQL_TOKEN_LITERAL || sql_is_symbol(&token, '?');
+        if (value && length >= 2 && memcmp(fingerprint + length - 2, "?,", 2) == 0) {
+            length--;
+            continue;
+        }
+
+        bool space = length > 0 && !sql_is_symbol(&token, ',') && !sql_is_symbol(&token, ')') && !sql_is_symbol(&token, '.') &&
+                     !sql_is_symbol(&token, ';') &&
+                     !sql_is_symbol(&previous, '(') && !sql_is_symbol(&previous, '.') &&
+                     !(previous.kind == SQL_TOKEN_SYMBOL && token.kind == SQL_TOKEN_SYMBOL && strchr("<>=!", *token.start));
+        if (space) {
+            fingerprint[length++] = ' ';
+        }
+
+        const char *text = value ? "?" : token.start;
+        size_t text_length = value ? 1 : token.length;
+        if (text_length > SLOW_QUERY_FINGERPRINT_SIZE - 1 - length) {
+            text_length = SLOW_QUERY_FINGERPRINT_SIZE - 1 - length;
+        }
+        memcpy(fingerprint + length, text, text_length);
+        length += text_length;
+        previous = token;
+    }
+    // `SELECT 1;` and `SELECT 1` are the same statement
+    while (length > 0 && fingerprint[length - 1] == ';') {
+        length--;
+    }
+    fingerprint[length] = '\0';
+    return fingerprint;
+}
+
+// =========================== COLUMN LISTS ===========================
+
+/** Whether a comma separated list holds a name, compared like MySQL column names */
+static bool list_contains(const char *list, const char *name) {
+    size_t length = strlen(name);
+    while (*list) {
+        const char *end = strchr(list, ',');
+        size_t item = end ? (size_t)(end - list) : strlen(list);
+        if (item == length && strncasecmp(list, name, length) == 0) {
+            return true;
+        }
+        list += item + (end ? 1 : 0);
+    }
+    return false;
+}
+
+/** Append a name to a comma separated list, unless it is already there or the list is full */
+static void list_add(char *list, size_t size, const char *name) {
+    size_t used = strlen(list);
+    size_t length = strlen(name);
+    if (length == 0 || list_contains(list, name) || used + length + 2 > size) {
+        return;
+    }
+    if (used > 0) {
+        list[used++] = ',';
+    }
+    memcpy(list + used, name, length + 1);
+}
+
+/** Copy the first name of a comma separated list */
+static void list_first(const char *list, char *name, size_t size) {
+    size_t length = strcspn(list, ",");
+    if (length >= size) {
+        length = size - 1;
+    }
+    memcpy(name, list, length);
+    name[length] = '\0';
+}
+
+/**
+ * Columns of an index definition, as written in a schema: `` `a`, b(10) DESC ``
+ * - Expressions, as in `((lower(a)))`, are left out
+ */
+static void index_columns(const char *definition, char *columns, size_t size) {
+    SqlToken token;
+    const char *p = definition;
+    int depth = 0;
+    bool expect_name = true;
+    columns[0] = '\0';
+    while ((p = sql_next_token(p, &token), token.kind != SQL_TOKEN_END)) {
+        if (sql_is_symbol(&token, '(')) {
+            depth++;
+        } else if (sql_is_symbol(&token, ')')) {
+            depth--;
+        } else if (depth == 0 && sql_is_symbol(&token, ',')) {
+            expect_name = true;
+            continue;
+        } else if (depth == 0 && expect_name && token.kind == SQL_TOKEN_IDENTIFIER) {
+            char name[SLOW_QUERY_NAME_SIZE];
+            sql_token_name(&token, name, sizeof(name));
+            list_add(columns, size, name);
+        }
+        expect_name = false;
+    }
+}
+
+/** Columns of `table` a condition names, as `` `db`.`table`.`column` `` or `table.column` */
+static void condition_columns(const char *condition, SlowQueryTable *table) {
+    SqlToken token;
+    const char *p = condition;
+    for (;;) {
+        const char *next = sql_next_token(p, &token);
+        if (token.kind == SQL_TOKEN_END) {
+            return;
+        }
+        if (token.kind != SQL_TOKEN_IDENTIFIER) {
+            p = next;
+            continue;
+        }
+
+        NameChain chain;
+        p = read_chain(p, &chain);
+        if (chain.count >= 2 && strcasecmp(chain.parts[chain.count - 2], table->table) == 0) {
+            list_add(table->columns, sizeof(table->columns), chain.parts[chain.count - 1]);
+        }
+    }
+}
+
+/**
+ * Columns of the outermost ORDER BY of a statement
+ * - Only plain columns are kept, expressions and positions are skipped
+ */
+static void order_columns(const char *query, char *columns, size_t size) {
+    SqlToken token;
+    const char *p = query;
+    const char *order = NULL;
+    int depth = 0;
+    columns[0] = '\0';
+
+    //? Step 1: Find the last ORDER BY outside parentheses
+    while ((p = sql_next_token(p, &token), token.kind != SQL_TOKEN_END)) {
+        if (sql_is_symbol(&token, '(')) {
+            depth++;
+        } else if (sql_is_symbol(&token, ')')) {
+            depth--;
+        } else if (depth == 0 && sql_is_keyword(&token, "ORDER")) {
+            SqlToken by;
+            const char *next = sql_next_token(p, &by);
+            if (sql_is_keyword(&by, "BY")) {
+                order = p = next;
+            }
+        }
+    }
+    if (!order) {
+        return;
+    }
+
+    //? Step 2: Read its items until the clause ends
+    p = order;
+    for (;;) {
+        const char *next = sql_next_token(p, &token);
+        char name[SLOW_QUERY_NAME_SIZE] = "";
+        if (token.kind == SQL_TOKEN_IDENTIFIER) {
+            NameChain chain;
+            next = read_chain(p, &chain);
+            memcpy(name, chain.parts[chain.count - 1], sizeof(name));
+            next = sql_next_token(next, &token);
+            if (sql_is_keyword(&token, "ASC") || sql_is_keyword(&token, "DESC")) {
+                next = sql_next_token(next, &token);
+            }
+        }
+
+        // Anything but `,` or the end of the clause makes the item an expression
+        depth = 0;
+        while (token.kind != SQL_TOKEN_END && !(depth == 0 && (sql_is_symbol(&token, ',') || sql_is_symbol(&token, ')') ||
+                                                           sql_is_symbol(&token, ';') || sql_is_keyword(&token, "LIMIT") ||
+                                                           sql_is_keyword(&token, "FOR") || sql_is_keyword(&token, "LOCK")))) {
+            depth += sql_is_symbol(&token, '(') ? 1 : sql_is_symbol(&token, ')') ? -1 : 0;
+            name[0] = '\0';
+            next = sql_next_token(next, &token);
+        }
+        list_add(columns, size, name);
+        if (!sql_is_symbol(&token, ',')) {
+            return;
+        }
+        p = next;
+    }
+}
+
+/** Keywords that end a table reference, where an alias would otherwise be */
+static bool ends_table_reference(const SqlToken *token) {
+    static const char *const KEYWORDS[] = {"WHERE",  "JOIN",   "INNER", "LEFT",  "RIGHT",     "CROSS", "NATURAL",
+                                           "OUTER",  "ON",     "USING", "GROUP", "ORDER",     "LIMIT", "HAVING",
+                                           "WINDOW", "FOR",    "UNION", "LOCK",  "FORCE",     "USE",   "IGNORE",
+                                           "INTO",   "SET",    "VALUES", "PARTITION", "STRAIGHT_JOIN"};
+    for (size_t i = 0; i < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); i++) {
+        if (sql_is_keyword(token, KEYWORDS[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Keywords of a join, which keep a FROM list going */
+static bool is_join(const SqlToken *token) {
+    return sql_is_keyword(token, "JOIN") || sql_is_keyword(token, "STRAIGHT_JOIN") || sql_is_keyword(token, "INNER") ||
+           sql_is_keyword(token, "LEFT") || sql_is_keyword(token, "RIGHT") || sql_is_keyword(token, "CROSS") ||
+           sql_is_keyword(token, "NATURAL") || sql_is_keyword(token, "OUTER");
+}
+
+/** Replace the aliases EXPLAIN names tables by with the tables of the FROM and JOIN clauses */
+static void resolve_aliases(const char *query, SlowQueryPlan *plan) {
+    char tables[ALIAS_LIMIT][SLOW_QUERY_NAME_SIZE];
+    char aliases[ALIAS_LIMIT][SLOW_QUERY_NAME_SIZE];
+    int count = 0;
+
+    SqlToken token;
+    const char *p = query;
+    bool listing = false; // Inside a FROM list, where `,` starts another table
+    while (count < ALIAS_LIMIT && (p = sql_next_token(p, &token), token.kind != SQL_TOKEN_END)) {
+        bool reference = sql_is_keyword(&token, "FROM") || sql_is_keyword(&token, "JOIN") ||
+                         sql_is_keyword(&token, "STRAIGHT_JOIN") || (listing && sql_is_symbol(&token, ','));
+        if (sql_is_keyword(&token, "FROM")) {
+            listing = true;
+        } else if (ends_table_reference(&token) && !is_join(&token)) {
+            listing = false;
+        }
+        if (!reference) {
+            continue;
+        }
+
+        // A table reference follows: name, then an optional alias
+        SqlToken name;
+        sql_next_token(p, &name);
+        if (name.kind != SQL_TOKEN_IDENTIFIER) {
+            continue;
+        }
+        NameChain chain;
+        p = read_chain(p, &chain);
+        memcpy(tables[count], chain.parts[chain.count - 1], SLOW_QUERY_NAME_SIZE);
+        memcpy(aliases[count], tables[count], SLOW_QUERY_NAME_SIZE);
+
+        SqlToken alias;
+        const char *next = sql_next_token(p, &alias);
+        if (sql_is_keyword(&alias, "AS")) {
+            p = next;
+            next = sql_next_token(p, &alias);
+        }
+        if (alias.kind == SQL_TOKEN_IDENTIFIER && !ends_table_reference(&alias)) {
+            sql_token_name(&alias, aliases[count], SLOW_QUERY_NAME_SIZE);
+            p = next;
+        }
+        count++;
+    }
+
+    for (int i = 0; i < plan->table_count; i++) {
+        for (int j = 0; j < count; j++) {
+            if (strcasecmp(plan->tables[i].table, aliases[j]) == 0) {
+                memcpy(plan->tables[i].table, tables[j], SLOW_QUERY_NAME_SIZE);
+                break;
+            }
+        }
+    }
+}
+
+// =========================== EXPLAIN PLANS ===========================
+
+typedef struct {
+    const char *p;
+    SlowQueryPlan *plan;
+    int depth;
+    char text[JSON_TEXT_SIZE]; // Last string or scalar read
+} JsonReader;
+
+static void json_space(JsonReader *reader) {
+    while (isspace((unsigned char)*reader->p)) {
+        reader->p++;
+    }
+}
+
+/** Read a string into `text`, truncated to its size but consumed whole */
+static bool json_string(JsonReader *reader, char *text, size_t size) {
+    if (*reader->p != '"') {
+        return false;
+    }
+    reader->p++;
+
+    size_t length = 0;
+    while (*reader->p != '"') {
+        char c = *reader->p++;
+        if (c == '\0') {
+            return false;
+        }
+        if (c == '\\') {
+            c = *reader->p++;
+            switch (c) {
+            case '\0':
+                return false;
+            case 'n':
+            case 'r':
+            case 't':
+            case 'b':
+            case 'f':
+                c = ' ';
+                break;
+            case 'u':
+                for (int i = 0; i < 4; i++, reader->p++) {
+                    if (!isxdigit((unsigned char)*reader->p)) {
+                        return false;
+                    }
+                }
+                c = '?';
+                break;
+            default:
+                break; // `"`, `\` and `/` stand for themselves
+            }
+        }
+        if (length + 1 < size) {
+            text[length++] = c;
+        }
+    }
+    reader->p++;
+    text[length] = '\0';
+    return true;
+}
+
+/** Read a number, `true`, `false` or `null` into `text` */
+static bool json_scalar(JsonReader *reader, char *text, size_t size) {
+    const char *start = reader->p;
+    while (isalnum((unsigned char)*reader->p) || *reader->p == '-' || *reader->p == '+' || *reader->p == '.') {
+        reader->p++;
+    }
+    size_t length = (size_t)(reader->p - start);
+    if (length == 0 || length >= size) {
+        return false;
+    }
+    memcpy(text, start, length);
+    text[length] = '\0';
+    return true;
+}
+
+static bool json_value(JsonReader *reader, const char *key, SlowQueryTable *table, char *condition);
+
+/**
+ * Read an object
+ * @param table - Table the object describes, NULL for any other object
+ * @param condition - Receives the attached condition of `table`
+ */
+static bool json_object(JsonReader *reader, SlowQueryTable *table, char *condition) {
+    if (++reader->depth > JSON_DEPTH_LIMIT) {
+        return false;
+    }
+    reader->p++;
+    json_space(reader);
+    if (*reader->p == '}') {
+        reader->p++;
+        reader->depth--;
+        return true;
+    }
+
+    for (;;) {
+        char key[64];
+        json_space(reader);
+        if (!json_string(reader, key, sizeof(key))) {
+            return false;
+        }
+        json_space(reader);
+        if (*reader->p != ':') {
+            return false;
+        }
+        reader->p++;
+        if (!json_value(reader, key, table, condition)) {
+            return false;
+        }
+
+        json_space(reader);
+        if (*reader->p == '}') {
+            reader->p++;
+            reader->depth--;
+            return true;
+        }
+        if (*reader->p != ',') {
+            return false;
+        }
+        reader->p++;
+    }
+}
+
+static bool json_array(JsonReader *reader) {
+    if (++reader->depth > JSON_DEPTH_LIMIT) {
+        return false;
+    }
+    reader->p++;
+    json_space(reader);
+    if (*reader->p == ']') {
+        reader->p++;
+        reader->depth--;
+        return true;
+    }
+
+    for (;;) {
+        if (!json_value(reader, NULL, NULL, NULL)) {
+            return false;
+        }
+        json_space(reader);
+        if (*reader->p == ']') {
+            reader->p++;
+            reader->depth--;
+            return true;
+        }
+        if (*reader->p != ',') {
+            return false;
+        }
+        reader->p++;
+    }
+}
+
+/** Read a `table` object, tables past `SLOW_QUERY_TABLE_LIMIT` are read and dropped */
+static bool json_table(JsonReader *reader) {
+    SlowQueryPlan *plan = reader->plan;
+    SlowQueryTable dropped;
+    SlowQueryTable *table = plan->table_count < SLOW_QUERY_TABLE_LIMIT ? &plan->tables[plan->table_count++] : &dropped;
+    memset(table, 0, sizeof(SlowQueryTable));
+
+    char condition[JSON_TEXT_SIZE] = "";
+    if (!json_object(reader, table, condition)) {
+        return false;
+    }
+    if (strcmp(table->access_type, "ALL") == 0) {
+        plan->full_scan = true;
+    }
+    condition_columns(condition, table);
+    return true;
+}
+
+/**
+ * ## Read a value of an EXPLAIN
+ * - MySQL flags sorts and temporary tables with `using_filesort` and `using_temporary_table`, MariaDB with `filesort`
+ *   and `temporary_table` objects
+ * @param key - Member name of the value, NULL in an array
+ * @param table - Table whose member the value is, NULL for any other value
+ * @param condition - Receives the attached condition of `table`
+ */
+static bool json_value(JsonReader *reader, const char *key, SlowQueryTable *table, char *condition) {
+    SlowQueryPlan *plan = reader->plan;
+    json_space(reader);
+
+    if (*reader->p == '{') {
+        if (key && strcmp(key, "table") == 0) {
+            return json_table(reader);
+        }
+        if (key && strcmp(key, "filesort") == 0) {
+            plan->filesort = true;
+        } else if (key && strcmp(key, "temporary_table") == 0) {
+            plan->temporary_table = true;
+        }
+        return json_object(reader, NULL, NULL);
+    }
+    if (*reader->p == '[') {
+        return json_array(reader);
+    }
+
+    char *text = reader->text;
+    if (!(*reader->p == '"' ? json_string(reader, text, sizeof(reader->text))
+                            : json_scalar(reader, text, sizeof(reader->text)))) {
+        return false;
+    }
+    if (!key) {
+        return true;
+    }
+
+    if (strcmp(key, "using_filesort") == 0 && strcmp(text, "true") == 0) {
+        plan->filesort = true;
+    } else if (strcmp(key, "using_temporary_table") == 0 && strcmp(text, "true") == 0) {
+        plan->temporary_table = true;
+    } else if (!table) {
+        return true;
+    } else if (strcmp(key, "table_name") == 0) {
+        snprintf(table->table, sizeof(table->table), "%s", text);
+    } else if (strcmp(key, "access_type") == 0) {
+        snprintf(table->access_type, sizeof(table->access_type), "%s", text);
+    } else if (strcmp(key, "key") == 0) {
+        snprintf(table->key, sizeof(table->key), "%s", text);
+    } else if (strcmp(key, "rows_examined_per_scan") == 0 || strcmp(key, "rows") == 0) {
+        table->rows = strtoull(text, NULL, 10);
+    } else if (strcmp(key, "attached_condition") == 0) {
+        snprintf(condition, JSON_TEXT_SIZE, "%s", text);
+    }
+    return true;
+}
+
+bool advisor_parse_plan(const char *json, const char *query, SlowQueryPlan *plan) {
+    memset(plan, 0, sizeof(SlowQueryPlan));
+
+    JsonReader *reader = (JsonReader *)calloc(1, sizeof(JsonReader));
+    if (!reader) {
+        return false;
+    }
+    reader->p = json;
+    reader->plan = plan;
+    bool ok = json_value(reader, NULL, NULL, NULL);
+    if (ok) {
+        json_space(reader);
+        ok = *reader->p == '\0';
+    }
+    free(reader);
+    if (!ok) {
+        return false;
+    }
+
+    resolve_aliases(query, plan);
+    order_columns(query, plan->order_columns, sizeof(plan->order_columns));
+    return true;
+}
+
+// =========================== EXPLAIN THREAD ===========================
+
+static void sample_free(SlowQuerySample *sample) {
+    free(sample->query);
+    params_free(&sample->params);
+    memset(sample, 0, sizeof(SlowQuerySample));
+}
+
+/** Run the EXPLAIN of a sample on a connection of the pool */
+static bool explain_sample(ConnectionPool *pool, const SlowQuerySample *sample, SlowQueryPlan *plan, char *error,
+                           size_t error_size) {
+    PoolConnection *pooled = pool_get_connection(pool);
+    if (!pooled) {
+        snprintf(error, error_size, "Failed to get database connection");
+        return false;
+    }
+    MYSQL *conn = pooled->connection;
+
+    SqlBuffer sql = {0};
+    bool ok = sql_append(&sql, "EXPLAIN FORMAT=JSON ", 20) &&
+              sql_append_statement(&sql, conn, sample->query, &sample->params, error, error_size);
+    if (!ok && !error[0]) {
+        snprintf(error, error_size, "Out of memory");
+    }
+
+    if (ok && peek_driver->real_query(conn, sql.data, (unsigned long)sql.length) != 0) {
+        snprintf(error, error_size, "%s", peek_driver->error(conn));
+        ok = false;
+    }
+    sql_free(&sql);
+
+    MYSQL_RES *result = ok ? peek_driver->store_result(conn) : NULL;
+    if (result) {
+        MYSQL_ROW row = peek_driver->num_fields(result) > 0 ? peek_driver->fetch_row(result) : NULL;
+        if (!row || !row[0]) {
+            snprintf(error, error_size, "EXPLAIN returned no plan");
+            ok = false;
+        } else if (!advisor_parse_plan(row[0], sample->query, plan)) {
+            snprintf(error, error_size, "Unreadable EXPLAIN output");
+            ok = false;
+        }
+        peek_driver->free_result(result);
+    } else if (ok) {
+        snprintf(error, error_size, "EXPLAIN returned no plan");
+        ok = false;
+    }
+
+    if (!ok && !pool_validate_connection(conn)) {
+        pool_discard_connection(pool, pooled);
+    } else {
+        pool_return_connection(pool, pooled);
+    }
+    return ok;
+}
+
+/**
+ * ## EXPLAIN loop
+ * - Waits for samples and explains them one at a time, outside the lock
+ * - A sample finished after `advisor_reset` belongs to a freed entry and is dropped
+ */
+static void *explain_loop(void *arg) {
+    SlowQueryAdvisor *advisor = (SlowQueryAdvisor *)arg;
+    peek_driver->thread_init();
+
+    pthread_mutex_lock(&advisor->lock);
+    while (!advisor->stopping) {
+        if (advisor->queue_count == 0) {
+            pthread_cond_wait(&advisor->queue_cond, &advisor->lock);
+            continue;
+        }
+
+        SlowQuerySample sample = advisor->queue[advisor->queue_head];
+        advisor->queue_head = (advisor->queue_head + 1) % SLOW_QUERY_QUEUE_SIZE;
+        advisor->queue_count--;
+        uint64_t generation = advisor->generation;
+        pthread_mutex_unlock(&advisor->lock);
+
+        SlowQueryPlan plan;
+        char error[sizeof(sample.entry->error)] = "";
+        bool ok = explain_sample(advisor->pool, &sample, &plan, error, sizeof(error));
+
+        pthread_mutex_lock(&advisor->lock);
+        if (generation == advisor->generation) {
+            SlowQueryEntry *entry = sample.entry;
+            entry->explaining = false;
+            entry->explained_ms = util_now_ms();
+            memcpy(entry->error, error, sizeof(error));
+            if (ok) {
+                entry->plan = plan;
+                entry->explained = true;
+            }
+        }
+        sample_free(&sample);
+    }
+    pthread_mutex_unlock(&advisor->lock);
+
+    peek_driver->thread_end();
+    return NULL;
+}
+
+// =========================== ADVISOR ===========================
+
+SlowQueryAdvisor *advisor_create(ConnectionPool *pool, int threshold_ms) {
+    SlowQueryAdvisor *advisor = (SlowQueryAdvisor *)calloc(1, sizeof(SlowQueryAdvisor));
+    if (!advisor) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&advisor->lock, NULL);
+    pthread_cond_init(&advisor->queue_cond, NULL);
+    advisor->pool = pool;
+    advisor->threshold_us = (uint64_t)threshold_ms * 1000;
+
+    if (!(advisor->thread_running = pthread_create(&advisor->thread, NULL, explain_loop, advisor) == 0)) {
+        advisor_destroy(advisor);
+        return NULL;
+    }
+    return advisor;
+}
+
+/** Forget every fingerprint and queued sample. Caller holds the lock */
+static void clear_entries(SlowQueryAdvisor *advisor) {
+    while (advisor->queue_count > 0) {
+        sample_free(&advisor->queue[advisor->queue_head]);
+        advisor->queue_head = (advisor->queue_head + 1) % SLOW_QUERY_QUEUE_SIZE;
+        advisor->queue_count--;
+    }
+    for (int i = 0; i < advisor->entry_count; i++) {
+        free(advisor->entries[i]->fingerprint);
+        free(advisor->entries[i]);
+    }
+    advisor->entry_count = 0;
+    advisor->dropped = 0;
+    advisor->generation++;
+}
+
+void advisor_destroy(SlowQueryAdvisor *advisor) {
+    if (!advisor) {
+        return;
+    }
+
+    pthread_mutex_lock(&advisor->lock);
+    advisor->stopping = true;
+    pthread_cond_signal(&advisor->queue_cond);
+    pthread_mutex_unlock(&advisor->lock);
+
+    if (advisor->thread_running) {
+        pthread_join(advisor->thread, NULL);
+    }
+
+    clear_entries(advisor);
+    for (size_t i = 0; i < advisor->index_count; i++) {
+        free(advisor->indexes[i].table);
+        free(advisor->indexes[i].name);
+        free(advisor->indexes[i].columns);
+    }
+    free(advisor->indexes);
+
+    pthread_cond_destroy(&advisor->queue_cond);
+    pthread_mutex_destroy(&advisor->lock);
+    free(advisor);
+}
+
+/** Find or add the entry of a fingerprint, taking ownership of it. Caller holds the lock */
+static SlowQueryEntry *find_entry(SlowQueryAdvisor *advisor, char *fingerprint) {
+    uint64_t hash = util_hash(fingerprint, strlen(fingerprint));
+    for (int i = 0; i < advisor->entry_count; i++) {
+        SlowQueryEntry *entry = advisor->entries[i];
+        if (entry->hash == hash && strcmp(entry->fingerprint, fingerprint) == 0) {
+            free(fingerprint);
+            return entry;
+        }
+    }
+
+    SlowQueryEntry *entry = NULL;
+    if (advisor->entry_count == SLOW_QUERY_FINGERPRINT_LIMIT ||
+        !(entry = (SlowQueryEntry *)calloc(1, sizeof(SlowQueryEntry)))) {
+        free(fingerprint);
+        return NULL;
+    }
+    entry->fingerprint = fingerprint;
+    entry->hash = hash;
+    advisor->entries[advisor->entry_count++] = entry;
+    return entry;
+}
+
+void advisor_observe(SlowQueryAdvisor *advisor, const char *query, const char *fingerprint, const PeekParams *params,
+                     uint64_t elapsed_us) {
+    if (!advisor || !query || elapsed_us < advisor->threshold_us) {
+        return;
+    }
+
+    char *key = fingerprint ? strdup(fingerprint) : advisor_fingerprint(query);
+    if (!key) {
+        return;
+    }
+
+    pthread_mutex_lock(&advisor->lock);
+    SlowQueryEntry *entry = find_entry(advisor, key);
+    if (!entry) {
+        advisor->dropped++;
+        pthread_mutex_unlock(&advisor->lock);
+        return;
+    }
+    entry->count++;
+    entry->total_us += elapsed_us;
+    if (elapsed_us > entry->max_us) {
+        entry->max_us = elapsed_us;
+    }
+
+    //? Queue an EXPLAIN when the plan is unknown or stale, and the statement cannot smuggle a second one in
+    uint64_t now = util_now_ms();
+    bool due = !entry->explaining && (entry->explained_ms == 0 || now - entry->explained_ms >= SLOW_QUERY_EXPLAIN_INTERVAL_MS);
+    if (due && advisor->queue_count < SLOW_QUERY_QUEUE_SIZE && sql_single_statement(query)) {
+        SlowQuerySample *sample =
+            &advisor->queue[(advisor->queue_head + advisor->queue_count) % SLOW_QUERY_QUEUE_SIZE];
+        sample->entry = entry;
+        sample->query = strdup(query);
+        if (sample->query && params_copy(params, &sample->params)) {
+            advisor->queue_count++;
+            entry->explaining = true;
+            pthread_cond_signal(&advisor->queue_cond);
+        } else {
+            free(sample->query);
+            memset(sample, 0, sizeof(SlowQuerySample));
+        }
+    }
+    pthread_mutex_unlock(&advisor->lock);
+}
+
+void advisor_register_index(SlowQueryAdvisor *advisor, const char *table, const char *name, const char *columns) {
+    if (!advisor) {
+        return;
+    }
+
+    char normalized[SLOW_QUERY_COLUMNS_SIZE];
+    index_columns(columns, normalized, sizeof(normalized));
+
+    pthread_mutex_lock(&advisor->lock);
+    for (size_t i = 0; i < advisor->index_count; i++) {
+        AdvisorIndex *index = &advisor->indexes[i];
+        if (strcasecmp(index->table, table) == 0 && strcasecmp(index->name, name) == 0) {
+            char *copy = strdup(normalized);
+            if (copy) {
+                free(index->columns);
+                index->columns = copy;
+            }
+            pthread_mutex_unlock(&advisor->lock);
+            return;
+        }
+    }
+
+    AdvisorIndex *indexes = (AdvisorIndex *)realloc(advisor->indexes, (advisor->index_count + 1) * sizeof(AdvisorIndex));
+    if (indexes) {
+        advisor->indexes = indexes;
+        AdvisorIndex *index = &indexes[advisor->index_count];
+        index->table = strdup(table);
+        index->name = strdup(name);
+        index->columns = strdup(normalized);
+        if (index->table && index->name && index->columns) {
+            advisor->index_count++;
+        } else {
+            free(index->table);
+            free(index->name);
+            free(index->columns);
+        }
+    }
+    pthread_mutex_unlock(&advisor->lock);
+}
+
+/**
+ * Match the full scans and filesorts of a plan against the declared indexes. Caller holds the lock
+ * - MySQL sorts on the first table of the join, so only its indexes can spare a filesort
+ */
+static void advise(const SlowQueryAdvisor *advisor, SlowQueryReport *report) {
+    const SlowQueryPlan *plan = &report->entry.plan;
+    char first_order[SLOW_QUERY_NAME_SIZE];
+    list_first(plan->order_columns, first_order, sizeof(first_order));
+
+    for (int i = 0; report->entry.explained && i < plan->table_count; i++) {
+        const SlowQueryTable *table = &plan->tables[i];
+        bool scan = strcmp(table->access_type, "ALL") == 0;
+        bool sort = plan->filesort && i == 0;
+        if (!scan && !sort) {
+            continue;
+        }
+
+        bool covered = false;
+        for (size_t j = 0; j < advisor->index_count; j++) {
+            const AdvisorIndex *index = &advisor->indexes[j];
+            char first[SLOW_QUERY_NAME_SIZE];
+            list_first(index->columns, first, sizeof(first));
+            if (strcasecmp(index->table, table->table) != 0 || !first[0] ||
+                !(list_contains(table->columns, first) || (sort && strcasecmp(first, first_order) == 0))) {
+                continue;
+            }
+
+            covered = true;
+            if (report->covering_count < SLOW_QUERY_TABLE_LIMIT) {
+                AdvisorAdvice *advice = &report->covering[report->covering_count++];
+                snprintf(advice->table, sizeof(advice->table), "%s", index->table);
+                snprintf(advice->name, sizeof(advice->name), "%s", index->name);
+                snprintf(advice->columns, sizeof(advice->columns), "%s", index->columns);
+            }
+        }
+        if (covered || report->suggested_count == SLOW_QUERY_TABLE_LIMIT) {
+            continue;
+        }
+
+        // Filtered columns first, so the index narrows the rows before it orders them
+        AdvisorAdvice *advice = &report->suggested[report->suggested_count];
+        memset(advice, 0, sizeof(AdvisorAdvice));
+        snprintf(advice->table, sizeof(advice->table), "%s", table->table);
+        snprintf(advice->columns, sizeof(advice->columns), "%s", table->columns);
+        if (sort) {
+            const char *p = plan->order_columns;
+            while (*p) {
+                char name[SLOW_QUERY_NAME_SIZE];
+                list_first(p, name, sizeof(name));
+                list_add(advice->columns, sizeof(advice->columns), name);
+                p += strcspn(p, ",");
+                p += *p == ',' ? 1 : 0;
+            }
+        }
+        if (advice->columns[0]) {
+            report->suggested_count++;
+        }
+    }
+}
+
+static int compare_reports(const void *a, const void *b) {
+    uint64_t left = ((const SlowQueryReport *)a)->entry.total_us;
+    uint64_t right = ((const SlowQueryReport *)b)->entry.total_us;
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+bool advisor_report(SlowQueryAdvisor *advisor, SlowQueryReport **reports, int *count, uint64_t *dropped) {
+    *reports = NULL;
+    *count = 0;
+    *dropped = 0;
+
+    pthread_mutex_lock(&advisor->lock);
+    SlowQueryReport *list = (SlowQueryReport *)calloc(advisor->entry_count > 0 ? advisor->entry_count : 1, sizeof(SlowQueryReport));
+    if (!list) {
+        pthread_mutex_unlock(&advisor->lock);
+        return false;
+    }
+    for (int i = 0; i < advisor->entry_count; i++) {
+        list[i].entry = *advisor->entries[i];
+        if (!(list[i].entry.fingerprint = strdup(advisor->entries[i]->fingerprint))) {
+            pthread_mutex_unlock(&advisor->lock);
+            advisor_reports_free(list, i);
+            return false;
+        }
+        advise(advisor, &list[i]);
+    }
+    *count = advisor->entry_count;
+    *dropped = advisor->dropped;
+    pthread_mutex_unlock(&advisor->lock);
+
+    qsort(list, (size_t)*count, sizeof(SlowQueryReport), compare_reports);
+    *reports = list;
+    return true;
+}
+
+void advisor_reports_free(SlowQueryReport *reports, int count) {
+    if (!reports) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        free(reports[i].entry.fingerprint);
+    }
+    free(reports);
+}
+
+void advisor_reset(SlowQueryAdvisor *advisor) {
+    pthread_mutex_lock(&advisor->lock);
+    clear_entries(advisor);
+    pthread_mutex_unlock(&advisor->lock);
+}
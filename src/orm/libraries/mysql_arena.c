@@ -0,0 +1,129 @@
+#include "../include/mysql_arena.h"
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+/** Round up to the arena alignment */
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+/** Allocate a block of at least `size` usable bytes */
+static ArenaBlock *block_create(size_t size) {
+    ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+    if (block) {
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+    }
+    return block;
+}
+
+void arena_init(Arena *arena, size_t block_size) {
+    arena->head = NULL;
+    arena->block_size = block_size > 0 ? block_size : ARENA_BLOCK_SIZE;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = align_up(size > 0 ? size : 1);
+
+    ArenaBlock *block = arena->head;
+    if (!block || block->size - block->used < size) {
+        // Grow geometrically so a large result needs few blocks
+        size_t block_size = block ? block->size * 2 : arena->block_size;
+        if (block_size < size) {
+            block_size = size;
+        }
+
+        ArenaBlock *next = block_create(block_size);
+        if (!next) {
+            return NULL;
+        }
+        next->next = block;
+        arena->head = block = next;
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void *arena_calloc(Arena *arena, size_t count, size_t size) {
+    if (size > 0 && count > (size_t)-1 / size) {
+        return NULL;
+    }
+
+    void *ptr = arena_alloc(arena, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+char *arena_strdup(Arena *arena, const char *str) {
+    size_t length = strlen(str);
+    char *copy = (char *)arena_alloc(arena, length + 1);
+    if (copy) {
+        memcpy(copy, str, length + 1);
+    }
+    return copy;
+}
+
+void arena_adopt(Arena *arena, Arena *other) {
+    ArenaBlock *blocks = other->head;
+    if (!blocks) {
+        return;
+    }
+    other->head = NULL;
+
+    // Behind the current block, which keeps serving new allocations
+    if (!arena->head) {
+        arena->head = blocks;
+        return;
+    }
+    ArenaBlock *last = blocks;
+    while (last->next) {
+        last = last->next;
+    }
+    last->next = arena->head->next;
+    arena->head->next = blocks;
+}
+
+void arena_reset(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    if (!block) {
+        return;
+    }
+
+    if (!block->next && block->size <= ARENA_RETAIN_LIMIT) {
+        block->used = 0;
+        return;
+    }
+
+    // Several blocks were needed: replace them with one block sized to the total, up to the retain limit
+    size_t total = 0;
+    while (block) {
+        ArenaBlock *next = block->next;
+        total += block->size;
+        free(block);
+        block = next;
+    }
+
+    if (total > ARENA_RETAIN_LIMIT) {
+        total = ARENA_RETAIN_LIMIT;
+    }
+    arena->head = block_create(total);
+}
+
+void arena_destroy(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+}
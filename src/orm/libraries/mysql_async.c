@@ -0,0 +1,150 @@
+#include "../include/mysql_async.h"
+#include "../include/mysql_driver.h"
+#include <mysql.h>
+#include <node_api.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static _Thread_local bool thread_initialized = false;
+
+void task_thread_init(void) {
+    if (!thread_initialized) {
+        peek_driver->thread_init();
+        thread_initialized = true;
+    }
+}
+
+void task_fail(PeekTask *task, const char *message) {
+    task->failed = true;
+    snprintf(task->error, sizeof(task->error), "%s", message ? message : "Unknown error");
+}
+
+/** Worker thread entry */
+static void task_execute(napi_env env, void *data) {
+    PeekTask *task = (PeekTask *)data;
+    task_thread_init();
+    task->execute(task);
+}
+
+/** Resolve or reject the promise of a task */
+static void task_settle(napi_env env, PeekTask *task) {
+    napi_value value = NULL;
+
+    if (!task->failed && task->complete) {
+        value = task->complete(env, task);
+    }
+
+    bool exception_pending = false;
+    napi_is_exception_pending(env, &exception_pending);
+
+    // Decoding into JS values is part of the latency
+    metrics_record_op(task->op, metrics_now_us() - task->started_us, task->failed || exception_pending);
+
+    if (exception_pending) {
+        napi_value exception;
+        napi_get_and_clear_last_exception(env, &exception);
+        napi_reject_deferred(env, task->deferred, exception);
+    } else if (task->failed) {
+        napi_value message, error;
+        napi_create_string_utf8(env, task->error, NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, NULL, message, &error);
+        napi_reject_deferred(env, task->deferred, error);
+    } else {
+        if (value == NULL) {
+            napi_get_undefined(env, &value);
+        }
+        napi_resolve_deferred(env, task->deferred, value);
+    }
+}
+
+/** Main thread entry: settle the promise and release the task */
+static void task_complete(napi_env env, napi_status status, void *data) {
+    PeekTask *task = (PeekTask *)data;
+
+    if (status == napi_cancelled) {
+        task_fail(task, "Operation was cancelled");
+    }
+
+    task_settle(env, task);
+    napi_delete_async_work(env, task->work);
+    task->destroy(task);
+}
+
+napi_value task_queue(napi_env env, const char *name, PeekTask *task) {
+    napi_value promise, resource_name;
+
+    task->started_us = metrics_now_us();
+    task->failed = false;
+    task->error[0] = '\0';
+
+    if (napi_create_promise(env, &task->deferred, &promise) != napi_ok) {
+        task->destroy(task);
+        napi_throw_error(env, NULL, "Failed to create promise");
+        return NULL;
+    }
+
+    napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resource_name);
+
+    task->work = NULL;
+    if (napi_create_async_work(env, NULL, resource_name, task_execute, task_complete, task, &task->work) != napi_ok ||
+        napi_queue_async_work(env, task->work) != napi_ok) {
+        napi_value message, error;
+        if (task->work) {
+            napi_delete_async_work(env, task->work);
+        }
+        napi_create_string_utf8(env, "Failed to queue async work", NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, NULL, message, &error);
+        napi_reject_deferred(env, task->deferred, error);
+        task->destroy(task);
+    }
+
+    return promise;
+}
+
+napi_value task_start(napi_env env, const char *name, PeekTask *task) {
+    napi_value promise, resource, resource_name;
+
+    task->started_us = metrics_now_us();
+    task->failed = false;
+    task->error[0] = '\0';
+    task->work = NULL;
+    task->env = env;
+    task->context = NULL;
+
+    if (napi_create_promise(env, &task->deferred, &promise) != napi_ok) {
+        task->destroy(task);
+        napi_throw_error(env, NULL, "Failed to create promise");
+        return NULL;
+    }
+
+    napi_create_object(env, &resource);
+    napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resource_name);
+    napi_async_init(env, resource, resource_name, &task->context);
+
+    return promise;
+}
+
+void task_finish(PeekTask *task) {
+    napi_env env = task->env;
+    napi_handle_scope handle_scope;
+    napi_callback_scope callback_scope;
+    napi_value resource;
+
+    // Settled from a bare libuv callback: the callback scope runs async hooks and drains microtasks on close
+    napi_open_handle_scope(env, &handle_scope);
+    napi_create_object(env, &resource);
+    bool scoped = task->context && napi_open_callback_scope(env, resource, task->context, &callback_scope) == napi_ok;
+
+    task_settle(env, task);
+
+    if (scoped) {
+        napi_close_callback_scope(env, callback_scope);
+    }
+    if (task->context) {
+        napi_async_destroy(env, task->context);
+    }
+    napi_close_handle_scope(env, handle_scope);
+
+    task->destroy(task);
+}
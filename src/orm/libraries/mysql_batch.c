@@ -0,0 +1,104 @@
+#include "../include/mysql_batch.h"
+#include "../include/mysql_driver.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_result.h"
+#include "../include/mysql_sql.h"
+#include <errmsg.h>
+#include <mysql.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+bool batch_query(ConnectionPool *pool, const SqlStatement *statements, size_t count, PeekResult **results, char *error,
+                 size_t error_size) {
+    if (count == 0) {
+        return true;
+    }
+
+    // Joined with the others, a query holding several statements would shift every result after it
+    for (size_t i = 0; i < count; i++) {
+        if (!sql_single_statement(statements[i].query)) {
+            snprintf(error, error_size, "Expected one statement per query, query %zu of %zu holds several", i + 1,
+                     count);
+            return false;
+        }
+    }
+
+    PoolConnection *pooled = pool_get_connection(pool);
+    if (!pooled) {
+        snprintf(error, error_size, "Failed to get database connection");
+        return false;
+    }
+    MYSQL *conn = pooled->connection;
+    if (!pool_enable_multi_statements(pooled)) {
+        snprintf(error, error_size, "Failed to enable multi statements: %s", peek_driver->error(conn));
+        pool_discard_connection(pool, pooled);
+        return false;
+    }
+
+    //? Step 1: Join the queries into one multi-statement
+    SqlBuffer sql = {0};
+    bool ok = true;
+    for (size_t i = 0; ok && i < count; i++) {
+        if (i > 0 && !sql_append(&sql, ";", 1)) {
+            snprintf(error, error_size, "Out of memory");
+            ok = false;
+        } else {
+            ok = sql_append_statement(&sql, conn, statements[i].query, &statements[i].params, error, error_size);
+        }
+    }
+
+    if (!ok) {
+        sql_free(&sql);
+        pool_return_connection(pool, pooled);
+        return false;
+    }
+
+    //? Step 2: One round trip, then one result set per query
+    int status = peek_driver->real_query(conn, sql.data, (unsigned long)sql.length);
+    sql_free(&sql);
+
+    size_t index = 0;
+    while (status == 0 && index < count) {
+        MYSQL_RES *res = peek_driver->store_result(conn);
+        if (!res && peek_driver->field_count(conn) > 0) {
+            break; // Reading the result set failed
+        }
+
+        results[index] = result_from_text(res, error, error_size);
+        if (res) {
+            peek_driver->free_result(res);
+        }
+        if (!results[index]) {
+            pool_drain_results(conn);
+            pool_return_connection(pool, pooled);
+            return false;
+        }
+
+        index++;
+        status = peek_driver->next_result(conn);
+    }
+
+    //? Step 3: -1 means every query ran, anything else is the error of query `index`
+    if (status == -1 && index == count) {
+        pool_return_connection(pool, pooled);
+        return true;
+    }
+
+    if (status == 0 && index == count) {
+        // Every query produced its result set yet more followed: one of them held several statements
+        snprintf(error, error_size, "Expected one statement per query, got more than %zu", count);
+        pool_drain_results(conn);
+        pool_return_connection(pool, pooled);
+        return false;
+    }
+
+    snprintf(error, error_size, "Query %zu of %zu failed: %s", index + 1, count, peek_driver->error(conn));
+    if (peek_driver->error_code(conn) == CR_SERVER_GONE_ERROR || peek_driver->error_code(conn) == CR_SERVER_LOST) {
+        pool_discard_connection(pool, pooled);
+    } else {
+        pool_drain_results(conn);
+        pool_return_connection(pool, pooled);
+    }
+    return false;
+}
@@ -0,0 +1,380 @@
+#include "../include/mysql_bulk.h"
+#include "../include/mysql_async.h"
+#include "../include/mysql_driver.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_sql.h"
+#include <mysql.h>
+#include <node_api.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Room left in a packet for the command byte and protocol framing */
+#define PACKET_OVERHEAD 1024
+
+/** Read `max_allowed_packet` once per connection */
+static unsigned long connection_max_packet(PoolConnection *pooled) {
+    if (pooled->max_packet > 0) {
+        return pooled->max_packet;
+    }
+
+    unsigned long max_packet = 4 * 1024 * 1024; // Server default before 8.0
+    if (peek_driver->query(pooled->connection, "SELECT @@max_allowed_packet") == 0) {
+        MYSQL_RES *res = peek_driver->store_result(pooled->connection);
+        MYSQL_ROW row = res ? peek_driver->fetch_row(res) : NULL;
+        if (row && row[0]) {
+            max_packet = strtoul(row[0], NULL, 10);
+        }
+        if (res) {
+            peek_driver->free_result(res);
+        }
+    }
+
+    pooled->max_packet = max_packet;
+    return max_packet;
+}
+
+/** Run one generated INSERT and fold its outcome into `result` */
+static bool flush_statement(MYSQL *conn, SqlBuffer *sql, BulkResult *result, char *error, size_t error_size) {
+    if (peek_driver->real_query(conn, sql->data, (unsigned long)sql->length)) {
+        snprintf(error, error_size, "%s", peek_driver->error(conn));
+        return false;
+    }
+
+    my_ulonglong affected = peek_driver->affected_rows(conn);
+    my_ulonglong first_id = peek_driver->insert_id(conn);
+    result->affected_rows += affected;
+    result->statements++;
+
+    // Ids of one multi-row INSERT are consecutive, starting at the id of its first row
+    if (first_id > 0 && affected > 0) {
+        my_ulonglong last_id = first_id + affected - 1;
+        if (result->first_insert_id == 0 || first_id < result->first_insert_id) {
+            result->first_insert_id = first_id;
+        }
+        if (last_id > result->last_insert_id) {
+            result->last_insert_id = last_id;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Insert rows [first, last) on one pooled connection, all or nothing
+ * - A range that takes more than one statement runs in a transaction, opened before its first statement is sent
+ * @param result - Receives the outcome of the range, left zeroed when it failed as nothing of it was kept
+ */
+static bool insert_range(ConnectionPool *pool, const BulkRows *rows, size_t first, size_t last, BulkResult *result,
+                         char *error, size_t error_size) {
+    PoolConnection *pooled = pool_get_connection(pool);
+    if (!pooled) {
+        snprintf(error, error_size, "Could not get database connection from pool");
+        return false;
+    }
+
+    MYSQL *conn = pooled->connection;
+    SqlBuffer sql = {0}, row = {0};
+    bool ok = false, in_transaction = false, broken = false;
+
+    size_t limit = connection_max_packet(pooled);
+    limit = limit > PACKET_OVERHEAD ? limit - PACKET_OVERHEAD : limit;
+    if (limit > BULK_MAX_STATEMENT_SIZE) {
+        limit = BULK_MAX_STATEMENT_SIZE;
+    }
+
+    //? Step 1: INSERT INTO `table` (`a`, `b`) VALUES
+    if (!sql_append(&sql, "INSERT INTO ", 12) || !sql_append_identifier(&sql, rows->table) || !sql_append(&sql, " (", 2)) {
+        snprintf(error, error_size, "Out of memory");
+        goto done;
+    }
+    for (size_t c = 0; c < rows->column_count; c++) {
+        if ((c > 0 && !sql_append(&sql, ", ", 2)) || !sql_append_identifier(&sql, rows->columns[c])) {
+            snprintf(error, error_size, "Out of memory");
+            goto done;
+        }
+    }
+    if (!sql_append(&sql, ") VALUES ", 9)) {
+        snprintf(error, error_size, "Out of memory");
+        goto done;
+    }
+
+    size_t prefix_length = sql.length;
+    size_t pending = 0;
+
+    //? Step 2: Serialize rows, flushing whenever the next row would not fit in the packet
+    for (size_t r = first; r < last; r++) {
+        row.length = 0;
+        if (!sql_append(&row, "(", 1)) {
+            snprintf(error, error_size, "Out of memory");
+            goto done;
+        }
+        for (size_t c = 0; c < rows->column_count; c++) {
+            if ((c > 0 && !sql_append(&row, ", ", 2)) ||
+                !sql_append_value(&row, conn, &rows->values.items[r * rows->column_count + c], error, error_size)) {
+                if (error[0] == '\0') {
+                    snprintf(error, error_size, "Out of memory");
+                }
+                goto done;
+            }
+        }
+        if (!sql_append(&row, ")", 1)) {
+            snprintf(error, error_size, "Out of memory");
+            goto done;
+        }
+
+        if (prefix_length + row.length > limit) {
+            snprintf(error, error_size, "Row %zu does not fit in max_allowed_packet (%zu bytes)", r, limit);
+            goto done;
+        }
+
+        if (pending > 0 && sql.length + 2 + row.length > limit) {
+            if (!in_transaction && peek_driver->query(conn, "START TRANSACTION")) {
+                snprintf(error, error_size, "%s", peek_driver->error(conn));
+                goto done;
+            }
+            in_transaction = true;
+            if (!flush_statement(conn, &sql, result, error, error_size)) {
+                goto done;
+            }
+            sql.length = prefix_length;
+            pending = 0;
+        }
+
+        if ((pending > 0 && !sql_append(&sql, ", ", 2)) || !sql_append(&sql, row.data, row.length)) {
+            snprintf(error, error_size, "Out of memory");
+            goto done;
+        }
+        pending++;
+    }
+
+    ok = pending == 0 || flush_statement(conn, &sql, result, error, error_size);
+    if (ok && in_transaction && peek_driver->query(conn, "COMMIT")) {
+        snprintf(error, error_size, "%s", peek_driver->error(conn));
+        ok = false;
+        in_transaction = false; // A failed COMMIT already ended the transaction, or lost the connection
+        broken = true;
+    }
+
+done:
+    //? Step 3: Undo the statements that went through, a connection that cannot roll back is not reused
+    if (!ok && in_transaction && peek_driver->query(conn, "ROLLBACK")) {
+        broken = true;
+    }
+    if (!ok) {
+        memset(result, 0, sizeof(BulkResult));
+    }
+    sql_free(&sql);
+    sql_free(&row);
+    if (broken) {
+        pool_discard_connection(pool, pooled);
+    } else {
+        pool_return_connection(pool, pooled);
+    }
+    return ok;
+}
+
+/**
+ * One range of a parallel bulk insert
+ */
+typedef struct {
+    ConnectionPool *pool;
+    const BulkRows *rows;
+    size_t first;
+    size_t last;
+    BulkResult result;
+    bool ok;
+    char error[TASK_ERROR_SIZE];
+} BulkRange;
+
+static void *insert_range_thread(void *data) {
+    BulkRange *range = (BulkRange *)data;
+    peek_driver->thread_init();
+    range->ok = insert_range(range->pool, range->rows, range->first, range->last, &range->result, range->error,
+                             sizeof(range->error));
+    peek_driver->thread_end();
+    return NULL;
+}
+
+bool bulk_insert(ConnectionPool *pool, const BulkRows *rows, int parallel, BulkResult *result, char *error, size_t error_size) {
+    memset(result, 0, sizeof(BulkResult));
+    error[0] = '\0';
+
+    if (rows->row_count == 0) {
+        return true;
+    }
+
+    if (parallel > pool->options.max_size) {
+        parallel = pool->options.max_size;
+    }
+    if (parallel > BULK_MAX_PARALLEL) {
+        parallel = BULK_MAX_PARALLEL;
+    }
+    if ((size_t)parallel > rows->row_count) {
+        parallel = (int)rows->row_count;
+    }
+
+    if (parallel <= 1) {
+        return insert_range(pool, rows, 0, rows->row_count, result, error, error_size);
+    }
+
+    //? Step 1: Split into contiguous ranges, the calling thread takes the first one
+    BulkRange ranges[BULK_MAX_PARALLEL];
+    pthread_t threads[BULK_MAX_PARALLEL];
+    bool started[BULK_MAX_PARALLEL] = {false};
+    size_t per_range = (rows->row_count + (size_t)parallel - 1) / (size_t)parallel;
+
+    for (int i = 0; i < parallel; i++) {
+        BulkRange *range = &ranges[i];
+        memset(range, 0, sizeof(BulkRange));
+        range->pool = pool;
+        range->rows = rows;
+        range->first = (size_t)i * per_range;
+        range->last = range->first + per_range < rows->row_count ? range->first + per_range : rows->row_count;
+    }
+
+    for (int i = 1; i < parallel; i++) {
+        started[i] = pthread_create(&threads[i], NULL, insert_range_thread, &ranges[i]) == 0;
+    }
+
+    // Ranges whose thread could not start run here after the first one
+    for (int i = 0; i < parallel; i++) {
+        if (i == 0 || !started[i]) {
+            ranges[i].ok = insert_range(pool, rows, ranges[i].first, ranges[i].last, &ranges[i].result, ranges[i].error,
+                                        sizeof(ranges[i].error));
+        }
+    }
+
+    //? Step 2: Join and aggregate what the ranges that succeeded inserted, reporting the first failure
+    bool ok = true;
+    for (int i = 0; i < parallel; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+
+        BulkRange *range = &ranges[i];
+        result->affected_rows += range->result.affected_rows;
+        result->statements += range->result.statements;
+        if (range->result.first_insert_id > 0 &&
+            (result->first_insert_id == 0 || range->result.first_insert_id < result->first_insert_id)) {
+            result->first_insert_id = range->result.first_insert_id;
+        }
+        if (range->result.last_insert_id > result->last_insert_id) {
+            result->last_insert_id = range->result.last_insert_id;
+        }
+        if (!range->ok && ok) {
+            snprintf(error, error_size, "%s", range->error);
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+bool bulk_rows_from_js(napi_env env, napi_value table, napi_value records, BulkRows *rows) {
+    memset(rows, 0, sizeof(BulkRows));
+
+    bool is_array = false;
+    napi_is_array(env, records, &is_array);
+    if (!is_array) {
+        napi_throw_type_error(env, NULL, "Expected records to be an array");
+        return false;
+    }
+
+    uint32_t row_count;
+    napi_get_array_length(env, records, &row_count);
+    if (row_count == 0) {
+        napi_throw_error(env, NULL, "At least one record must be provided for bulk insert");
+        return false;
+    }
+
+    if (!(rows->table = params_get_string(env, table, NULL))) {
+        napi_throw_type_error(env, NULL, "Expected table to be a string");
+        return false;
+    }
+
+    //? Step 1: Columns are the keys of the first record
+    napi_value first, keys;
+    napi_valuetype type;
+    napi_get_element(env, records, 0, &first);
+    napi_typeof(env, first, &type);
+    if (type != napi_object || napi_get_property_names(env, first, &keys) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected records to be objects");
+        goto fail;
+    }
+
+    uint32_t column_count;
+    napi_get_array_length(env, keys, &column_count);
+    if (column_count == 0) {
+        napi_throw_error(env, NULL, "Records must contain at least one column");
+        goto fail;
+    }
+
+    napi_value *column_keys = (napi_value *)malloc(column_count * sizeof(napi_value));
+    rows->columns = (char **)calloc(column_count, sizeof(char *));
+    rows->values.items = (PeekParam *)calloc((size_t)row_count * column_count, sizeof(PeekParam));
+    if (!column_keys || !rows->columns || !rows->values.items) {
+        free(column_keys);
+        napi_throw_error(env, NULL, "Out of memory");
+        goto fail;
+    }
+
+    rows->column_count = column_count;
+    for (uint32_t c = 0; c < column_count; c++) {
+        napi_get_element(env, keys, c, &column_keys[c]);
+        if (!(rows->columns[c] = params_get_string(env, column_keys[c], NULL))) {
+            free(column_keys);
+            napi_throw_error(env, NULL, "Out of memory");
+            goto fail;
+        }
+    }
+
+    //? Step 2: Copy every value by column key, reusing the key strings for the lookups
+    for (uint32_t r = 0; r < row_count; r++) {
+        napi_value record;
+        napi_get_element(env, records, r, &record);
+        napi_typeof(env, record, &type);
+        if (type != napi_object) {
+            free(column_keys);
+            napi_throw_type_error(env, NULL, "Expected records to be objects");
+            goto fail;
+        }
+
+        napi_handle_scope scope;
+        napi_open_handle_scope(env, &scope);
+        for (uint32_t c = 0; c < column_count; c++) {
+            napi_value value;
+            napi_get_property(env, record, column_keys[c], &value);
+            rows->values.count = (size_t)r * column_count + c + 1;
+            if (!params_value_from_js(env, value, &rows->values.items[rows->values.count - 1])) {
+                napi_close_handle_scope(env, scope);
+                free(column_keys);
+                goto fail;
+            }
+        }
+        napi_close_handle_scope(env, scope);
+        rows->row_count = r + 1;
+    }
+
+    free(column_keys);
+    return true;
+
+fail:
+    bulk_rows_free(rows);
+    return false;
+}
+
+void bulk_rows_free(BulkRows *rows) {
+    if (rows->columns) {
+        for (size_t c = 0; c < rows->column_count; c++) {
+            free(rows->columns[c]);
+        }
+    }
+    free(rows->columns);
+    free(rows->table);
+    params_free(&rows->values);
+    memset(rows, 0, sizeof(BulkRows));
+}
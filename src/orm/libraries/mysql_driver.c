@@ -0,0 +1,65 @@
+#include "../include/mysql_driver.h"
+#include <mysql.h>
+
+const PeekDriver mysql_driver = {
+    .name = "mysql",
+
+    .library_init = mysql_library_init,
+    .thread_init = mysql_thread_init,
+    .thread_end = mysql_thread_end,
+
+    .init = mysql_init,
+    .options = mysql_options,
+    .real_connect = mysql_real_connect,
+    .close = mysql_close,
+    .ping = mysql_ping,
+    .set_server_option = mysql_set_server_option,
+    .error = mysql_error,
+    .error_code = mysql_errno,
+    .real_escape_string_quote = mysql_real_escape_string_quote,
+    .set_local_infile_handler = mysql_set_local_infile_handler,
+
+    .query = mysql_query,
+    .real_query = mysql_real_query,
+    .store_result = mysql_store_result,
+    .next_result = mysql_next_result,
+    .more_results = mysql_more_results,
+    .field_count = mysql_field_count,
+    .affected_rows = mysql_affected_rows,
+    .insert_id = mysql_insert_id,
+    .warning_count = mysql_warning_count,
+
+    .free_result = mysql_free_result,
+    .num_rows = mysql_num_rows,
+    .num_fields = mysql_num_fields,
+    .fetch_fields = mysql_fetch_fields,
+    .fetch_row = mysql_fetch_row,
+    .fetch_lengths = mysql_fetch_lengths,
+    .data_seek = mysql_data_seek,
+
+    .stmt_init = mysql_stmt_init,
+    .stmt_prepare = mysql_stmt_prepare,
+    .stmt_param_count = mysql_stmt_param_count,
+    .stmt_bind_param = mysql_stmt_bind_param,
+    .stmt_attr_set = mysql_stmt_attr_set,
+    .stmt_execute = mysql_stmt_execute,
+    .stmt_result_metadata = mysql_stmt_result_metadata,
+    .stmt_store_result = mysql_stmt_store_result,
+    .stmt_num_rows = mysql_stmt_num_rows,
+    .stmt_bind_result = mysql_stmt_bind_result,
+    .stmt_fetch = mysql_stmt_fetch,
+    .stmt_fetch_column = mysql_stmt_fetch_column,
+    .stmt_affected_rows = mysql_stmt_affected_rows,
+    .stmt_insert_id = mysql_stmt_insert_id,
+    .stmt_free_result = mysql_stmt_free_result,
+    .stmt_close = mysql_stmt_close,
+    .stmt_error = mysql_stmt_error,
+    .stmt_error_code = mysql_stmt_errno,
+
+    .get_socket = mysql_get_socket,
+    .real_connect_nonblocking = mysql_real_connect_nonblocking,
+    .real_query_nonblocking = mysql_real_query_nonblocking,
+    .store_result_nonblocking = mysql_store_result_nonblocking,
+};
+
+const PeekDriver *peek_driver = &mysql_driver;
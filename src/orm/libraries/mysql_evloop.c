@@ -0,0 +1,489 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_evloop.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_result.h"
+#include "../include/mysql_sql.h"
+#include <errmsg.h>
+#include <mysql.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <uv.h>
+
+/**
+ * Event loop connection state
+ */
+typedef enum {
+    EV_CONNECTING, // mysql_real_connect_nonblocking in progress
+    EV_IDLE,       // Connected, on the idle stack
+    EV_QUERY,      // mysql_real_query_nonblocking in progress
+    EV_STORE,      // mysql_store_result_nonblocking in progress
+} EvState;
+
+/**
+ * Event loop connection
+ * - `poll` is initialized once the socket exists and closed asynchronously, so the struct is freed in its close callback
+ */
+typedef struct {
+    EvPool *pool;
+    MYSQL *mysql;
+    uv_poll_t poll;
+    bool polling;     // `poll` initialized
+    int slot;         // Index in `pool->slots`
+    EvState state;
+    EvQuery *query;   // Running query
+    SqlBuffer sql;    // Interpolated text of the running query
+} EvConnection;
+
+struct EvPool {
+    uv_loop_t *loop;
+    PoolOptions options;
+    char *host;
+    char *user;
+    char *password;
+    char *database;
+    int port;
+    EvConnection **slots; // Open or opening connections, NULL for a free slot
+    EvConnection **idle;  // Stack of idle connections, most recently used on top
+    int idle_count;
+    int open_count;       // Non NULL slots
+    EvQuery *wait_head;
+    EvQuery *wait_tail;
+    int handles;          // Poll handles not closed yet
+    bool growing;         // `ev_grow` running, guards against recursion on synchronous connect failures
+    bool destroyed;
+};
+
+static void ev_step(EvConnection *conn);
+static void ev_release(EvConnection *conn);
+
+/** Free the pool once it was destroyed and its last handle closed */
+static void ev_pool_maybe_free(EvPool *pool) {
+    if (!pool->destroyed || pool->handles > 0) {
+        return;
+    }
+    free(pool->slots);
+    free(pool->idle);
+    free(pool->host);
+    free(pool->user);
+    free(pool->password);
+    free(pool->database);
+    free(pool);
+}
+
+static void ev_query_fail(EvQuery *query, const char *message) {
+    query->failed = true;
+    snprintf(query->error, sizeof(query->error), "%s", message);
+    query->done(query);
+}
+
+static void ev_free_connection(EvConnection *conn) {
+    peek_driver->close(conn->mysql);
+    sql_free(&conn->sql);
+    free(conn);
+}
+
+static void ev_on_close(uv_handle_t *handle) {
+    EvConnection *conn = (EvConnection *)handle->data;
+    EvPool *pool = conn->pool;
+    ev_free_connection(conn);
+    pool->handles--;
+    ev_pool_maybe_free(pool);
+}
+
+/** Drop a connection from the pool and close it */
+static void ev_close(EvConnection *conn) {
+    EvPool *pool = conn->pool;
+
+    if (conn->state == EV_IDLE) {
+        for (int i = 0; i < pool->idle_count; i++) {
+            if (pool->idle[i] == conn) {
+                pool->idle[i] = pool->idle[--pool->idle_count];
+                break;
+            }
+        }
+    }
+    pool->slots[conn->slot] = NULL;
+    pool->open_count--;
+
+    if (conn->polling) {
+        uv_poll_stop(&conn->poll);
+        uv_close((uv_handle_t *)&conn->poll, ev_on_close);
+    } else {
+        ev_free_connection(conn);
+    }
+}
+
+static void ev_on_poll(uv_poll_t *handle, int status, int events);
+
+/** Wait for the socket, `events` being UV_READABLE and/or UV_WRITABLE */
+static bool ev_wait(EvConnection *conn, int events) {
+    if (!conn->polling) {
+        if (uv_poll_init(conn->pool->loop, &conn->poll, peek_driver->get_socket(conn->mysql)) != 0) {
+            return false;
+        }
+        conn->poll.data = conn;
+        conn->polling = true;
+        conn->pool->handles++;
+    }
+
+    // Only sockets with a query in flight keep the process alive
+    if (conn->state == EV_IDLE) {
+        uv_unref((uv_handle_t *)&conn->poll);
+    } else {
+        uv_ref((uv_handle_t *)&conn->poll);
+    }
+    return uv_poll_start(&conn->poll, events, ev_on_poll) == 0;
+}
+
+/** Remove and return the oldest waiting query */
+static EvQuery *ev_pop_waiter(EvPool *pool) {
+    EvQuery *query = pool->wait_head;
+    if (query) {
+        pool->wait_head = query->next;
+        if (!pool->wait_head) {
+            pool->wait_tail = NULL;
+        }
+        query->next = NULL;
+    }
+    return query;
+}
+
+/** Start a query on a connection */
+static void ev_dispatch(EvConnection *conn, EvQuery *query) {
+    conn->query = query;
+    conn->state = EV_QUERY;
+    conn->sql.length = 0;
+
+    if (!sql_append_statement(&conn->sql, conn->mysql, query->sql, query->params, query->error, sizeof(query->error))) {
+        conn->query = NULL;
+        ev_release(conn);
+        query->failed = true;
+        query->done(query);
+        return;
+    }
+
+    ev_step(conn);
+}
+
+/**
+ * Hand a free connection to the oldest waiter, or park it on the idle stack
+ * - Idle sockets stay polled for readability: data on an idle connection means the server closed it
+ */
+static void ev_release(EvConnection *conn) {
+    EvPool *pool = conn->pool;
+    conn->state = EV_IDLE;
+
+    EvQuery *query = ev_pop_waiter(pool);
+    if (query) {
+        ev_dispatch(conn, query);
+        return;
+    }
+
+    pool->idle[pool->idle_count++] = conn;
+    if (!ev_wait(conn, UV_READABLE)) {
+        ev_close(conn);
+    }
+}
+
+/** Open a new connection in a free slot */
+static bool ev_connect(EvPool *pool) {
+    int slot = 0;
+    while (slot < pool->options.max_size && pool->slots[slot]) {
+        slot++;
+    }
+    if (slot == pool->options.max_size) {
+        return false;
+    }
+
+    EvConnection *conn = (EvConnection *)calloc(1, sizeof(EvConnection));
+    if (!conn || !(conn->mysql = peek_driver->init(NULL))) {
+        free(conn);
+        return false;
+    }
+
+    conn->pool = pool;
+    conn->slot = slot;
+    conn->state = EV_CONNECTING;
+    pool->slots[slot] = conn;
+    pool->open_count++;
+
+    ev_step(conn);
+    return true;
+}
+
+/** Fail every waiting query */
+static void ev_fail_waiters(EvPool *pool, const char *message) {
+    EvQuery *query;
+    while ((query = ev_pop_waiter(pool))) {
+        ev_query_fail(query, message);
+    }
+}
+
+/**
+ * Open connections while more queries wait than connections are coming up
+ * - Each waiter beyond the connecting ones gets its own connect, which serves the oldest waiter
+ * @note Only fails the queue when no connection can even be started and none is open to serve it
+ */
+static void ev_grow(EvPool *pool) {
+    if (pool->growing || pool->destroyed) {
+        return;
+    }
+    pool->growing = true;
+
+    for (;;) {
+        int connecting = 0;
+        for (int i = 0; i < pool->options.max_size; i++) {
+            connecting += pool->slots[i] && pool->slots[i]->state == EV_CONNECTING;
+        }
+        int waiting = 0;
+        for (EvQuery *waiter = pool->wait_head; waiter && waiting <= connecting; waiter = waiter->next) {
+            waiting++;
+        }
+        // A connect failing synchronously fails one waiter, so the loop ends
+        if (waiting <= connecting || !ev_connect(pool)) {
+            break;
+        }
+    }
+
+    pool->growing = false;
+    if (pool->open_count == 0) {
+        ev_fail_waiters(pool, "Failed to open database connection");
+    }
+}
+
+/**
+ * Drop a connection that failed to connect
+ * - Only the oldest waiter, the one the connect was serving, fails; the others stay queued behind the open
+ *   connections and get connects of their own
+ */
+static void ev_connect_failed(EvConnection *conn, const char *message) {
+    EvPool *pool = conn->pool;
+    ev_close(conn);
+
+    EvQuery *query = ev_pop_waiter(pool);
+    if (query) {
+        ev_query_fail(query, message);
+    }
+    ev_grow(pool);
+}
+
+/** Finish the running query of a connection */
+static void ev_finish(EvConnection *conn, bool failed) {
+    EvQuery *query = conn->query;
+    conn->query = NULL;
+    query->failed = failed;
+
+    if (failed) {
+        snprintf(query->error, sizeof(query->error), "%s", peek_driver->error(conn->mysql));
+    }
+
+    // A connection in an unknown state is never reused
+    unsigned int code = failed ? peek_driver->error_code(conn->mysql) : 0;
+    if (code >= CR_MIN_ERROR && code <= CR_MAX_ERROR) {
+        ev_close(conn);
+    } else {
+        ev_release(conn);
+    }
+
+    query->done(query);
+}
+
+/** Advance the nonblocking call of a connection until it has to wait for the socket */
+static void ev_step(EvConnection *conn) {
+    EvPool *pool = conn->pool;
+    enum net_async_status status;
+
+    switch (conn->state) {
+    case EV_CONNECTING:
+        status = peek_driver->real_connect_nonblocking(conn->mysql, pool->host, pool->user, pool->password,
+                                                       pool->database, (unsigned int)pool->port, NULL, 0);
+        if (status == NET_ASYNC_NOT_READY) {
+            // The first wait covers the TCP connect, the handshake then only waits for the server
+            if (!ev_wait(conn, conn->polling ? UV_READABLE : UV_WRITABLE)) {
+                ev_connect_failed(conn, "Failed to poll database connection");
+            }
+            return;
+        }
+        if (status == NET_ASYNC_ERROR) {
+            char message[TASK_ERROR_SIZE];
+            snprintf(message, sizeof(message), "%s", peek_driver->error(conn->mysql));
+            ev_connect_failed(conn, message);
+            return;
+        }
+        {
+            int size = EV_SEND_BUFFER_SIZE;
+            setsockopt(peek_driver->get_socket(conn->mysql), SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        }
+        ev_release(conn);
+        return;
+
+    case EV_QUERY:
+        status = peek_driver->real_query_nonblocking(conn->mysql, conn->sql.data, (unsigned long)conn->sql.length);
+        if (status == NET_ASYNC_NOT_READY) {
+            break;
+        }
+        if (status == NET_ASYNC_ERROR) {
+            ev_finish(conn, true);
+            return;
+        }
+        if (peek_driver->field_count(conn->mysql) == 0) {
+            conn->query->affected_rows = peek_driver->affected_rows(conn->mysql);
+            conn->query->insert_id = peek_driver->insert_id(conn->mysql);
+            ev_finish(conn, false);
+            return;
+        }
+        conn->state = EV_STORE;
+        // fall through
+
+    case EV_STORE: {
+        MYSQL_RES *res = NULL;
+        status = peek_driver->store_result_nonblocking(conn->mysql, &res);
+        if (status == NET_ASYNC_NOT_READY) {
+            break;
+        }
+        if (status == NET_ASYNC_ERROR || !res) {
+            ev_finish(conn, true);
+            return;
+        }
+
+        EvQuery *query = conn->query;
+        query->result = result_from_text(res, query->error, sizeof(query->error));
+        query->affected_rows = peek_driver->affected_rows(conn->mysql);
+        peek_driver->free_result(res);
+
+        if (!query->result) {
+            // Not a connection error: keep the message of the failed conversion
+            conn->query = NULL;
+            ev_release(conn);
+            query->failed = true;
+            query->done(query);
+            return;
+        }
+        ev_finish(conn, false);
+        return;
+    }
+
+    case EV_IDLE:
+        // Readable while idle: the server closed the connection, e.g. after wait_timeout
+        ev_close(conn);
+        return;
+    }
+
+    if (!ev_wait(conn, UV_READABLE)) {
+        snprintf(conn->query->error, sizeof(conn->query->error), "Failed to poll database connection");
+        EvQuery *query = conn->query;
+        conn->query = NULL;
+        ev_close(conn);
+        query->failed = true;
+        query->done(query);
+    }
+}
+
+static void ev_on_poll(uv_poll_t *handle, int status, int events) {
+    EvConnection *conn = (EvConnection *)handle->data;
+
+    if (status < 0) {
+        if (conn->state == EV_CONNECTING) {
+            ev_connect_failed(conn, uv_strerror(status));
+            return;
+        }
+        EvQuery *query = conn->query;
+        conn->query = NULL;
+        ev_close(conn);
+        if (query) {
+            ev_query_fail(query, uv_strerror(status));
+        }
+        return;
+    }
+
+    ev_step(conn);
+}
+
+EvPool *ev_pool_create(uv_loop_t *loop, const char *host, const char *user, const char *password, const char *database,
+                       int port, const PoolOptions *options) {
+    EvPool *pool = (EvPool *)calloc(1, sizeof(EvPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->loop = loop;
+    pool->options = *options;
+    pool->port = port;
+    pool->slots = (EvConnection **)calloc((size_t)options->max_size, sizeof(EvConnection *));
+    pool->idle = (EvConnection **)calloc((size_t)options->max_size, sizeof(EvConnection *));
+    pool->host = strdup(host);
+    pool->user = strdup(user);
+    pool->password = strdup(password);
+    pool->database = strdup(database);
+
+    if (!pool->slots || !pool->idle || !pool->host || !pool->user || !pool->password || !pool->database) {
+        pool->destroyed = true;
+        ev_pool_maybe_free(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < options->min_size; i++) {
+        ev_connect(pool);
+    }
+
+    return pool;
+}
+
+bool ev_query_fits(const char *sql, const PeekParams *params) {
+    size_t size = strlen(sql);
+    for (size_t i = 0; params && i < params->count; i++) {
+        // Escaping at most doubles a string, hex doubles a blob, other literals stay short
+        size += params->items[i].type == PARAM_STRING || params->items[i].type == PARAM_BLOB
+                    ? (size_t)params->items[i].length * 2 + 3
+                    : 32;
+    }
+    return size <= EV_MAX_QUERY_SIZE;
+}
+
+void ev_pool_submit(EvPool *pool, EvQuery *query) {
+    query->next = NULL;
+    query->failed = false;
+    query->error[0] = '\0';
+
+    if (pool->idle_count > 0) {
+        ev_dispatch(pool->idle[--pool->idle_count], query);
+        return;
+    }
+
+    if (pool->wait_tail) {
+        pool->wait_tail->next = query;
+    } else {
+        pool->wait_head = query;
+    }
+    pool->wait_tail = query;
+
+    // Grow while queries wait, a connection that comes up serves the oldest one
+    ev_grow(pool);
+}
+
+void ev_pool_destroy(EvPool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    ev_fail_waiters(pool, "Database closed");
+
+    for (int i = 0; i < pool->options.max_size; i++) {
+        EvConnection *conn = pool->slots[i];
+        if (!conn) {
+            continue;
+        }
+        EvQuery *query = conn->query;
+        conn->query = NULL;
+        ev_close(conn);
+        if (query) {
+            ev_query_fail(query, "Database closed");
+        }
+    }
+
+    pool->destroyed = true;
+    ev_pool_maybe_free(pool);
+}
@@ -0,0 +1,1090 @@
+#include "../include/mysql_driver.h"
+#include <ctype.h>
+#include <mysql.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+/** Length of the synthetic VARCHAR values, cycling from 8 to 8 + FAKE_STRING_SPREAD - 1 bytes */
+#define FAKE_STRING_SPREAD 32
+
+/** Length of the synthetic BLOB values */
+#define FAKE_BLOB_LENGTH 16
+
+/** Longest text rendering of a synthetic value, NUL included */
+#define FAKE_CELL_TEXT_SIZE 64
+
+/** Bytes read from a LOAD DATA source at a time */
+#define FAKE_INFILE_CHUNK 16384
+
+static const char FAKE_TEXT[] = "The quick brown fox jumps over the lazy dog, again and again";
+
+static FakeDriverOptions configured = {DEFAULT_FAKE_COLUMNS, DEFAULT_FAKE_ROWS, 0};
+static pthread_mutex_t configured_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Kind of a statement, from its first keyword */
+typedef enum {
+    FAKE_OTHER,  // Succeeds without a result set
+    FAKE_SELECT, // Synthetic table
+    FAKE_SHOW,   // Empty result set, also for SELECTs from information_schema
+    FAKE_INSERT, // One affected row per VALUES tuple
+    FAKE_WRITE,  // UPDATE, DELETE: one affected row
+    FAKE_LOAD,   // LOAD DATA LOCAL INFILE
+} FakeKind;
+
+/** What the fake server needs to know of a statement */
+typedef struct {
+    FakeKind kind;
+    bool empty;
+    unsigned long params; // Placeholders
+    int64_t limit;        // Row count of a top-level LIMIT, -1 without one
+    int limit_param;      // Placeholder holding the LIMIT row count, -1 when it is a literal
+    uint64_t tuples;      // VALUES tuples of an INSERT
+    char file[256];       // LOAD DATA source name
+} FakeQuery;
+
+typedef struct {
+    FakeDriverOptions options;
+    MYSQL_FIELD *fields; // Synthetic table
+    char (*names)[16];
+    MYSQL_FIELD show_field; // Single column of SHOW results
+    bool local_infile;
+    bool multi_statements; // Several statements per query, from CLIENT_MULTI_STATEMENTS or `set_server_option`
+
+    // Text protocol state
+    char *sql;              // Multi-statement being served
+    size_t sql_length;
+    size_t next_statement;  // Offset of the statement `next_result` runs
+    FakeKind result_kind;   // Result set waiting for `store_result`, FAKE_OTHER when none
+    uint64_t result_rows;
+    unsigned int field_count;
+    my_ulonglong affected_rows;
+    my_ulonglong insert_id;
+    my_ulonglong next_insert_id;
+
+    unsigned int error_code;
+    char error[256];
+
+    int (*infile_init)(void **, const char *, void *);
+    int (*infile_read)(void *, char *, unsigned int);
+    void (*infile_end)(void *);
+    int (*infile_error)(void *, char *, unsigned int);
+    void *infile_userdata;
+} FakeConnection;
+
+typedef struct {
+    const MYSQL_FIELD *fields;
+    unsigned int num_fields;
+    uint64_t num_rows;
+    uint64_t cursor;
+    char **row;
+    unsigned long *lengths;
+    char *text; // FAKE_CELL_TEXT_SIZE bytes per column
+} FakeResult;
+
+typedef struct {
+    FakeConnection *conn;
+    FakeQuery query;
+    int64_t bound_limit; // Value bound to a `LIMIT ?`, the binds themselves belong to the caller
+    MYSQL_BIND *bind;
+    bool prepared;
+    FakeKind result_kind;
+    uint64_t num_rows;
+    uint64_t fetched;
+    my_ulonglong affected_rows;
+    my_ulonglong insert_id;
+    unsigned int error_code;
+    char error[256];
+} FakeStmt;
+
+/** One synthetic value */
+typedef struct {
+    bool is_null;
+    bool is_bytes;
+    long long int_value;
+    double double_value;
+    MYSQL_TIME time;
+    const char *bytes;
+    unsigned long length;
+} FakeCell;
+
+// =========================== SYNTHETIC TABLE ===========================
+
+void fake_driver_options_default(FakeDriverOptions *options) {
+    options->columns = DEFAULT_FAKE_COLUMNS;
+    options->rows = DEFAULT_FAKE_ROWS;
+    options->latency_us = 0;
+}
+
+void fake_driver_configure(const FakeDriverOptions *options) {
+    pthread_mutex_lock(&configured_lock);
+    configured = *options;
+    pthread_mutex_unlock(&configured_lock);
+}
+
+/** Build the fields of the synthetic table of a connection */
+static bool fake_table_create(FakeConnection *conn) {
+    unsigned int columns = (unsigned int)conn->options.columns;
+    if (!(conn->fields = (MYSQL_FIELD *)calloc(columns, sizeof(MYSQL_FIELD))) ||
+        !(conn->names = (char(*)[16])calloc(columns, sizeof(*conn->names)))) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < columns; i++) {
+        MYSQL_FIELD *field = &conn->fields[i];
+        snprintf(conn->names[i], sizeof(conn->names[i]), i == 0 ? "id" : "column_%u", i);
+        field->name = field->org_name = conn->names[i];
+        field->name_length = field->org_name_length = (unsigned int)strlen(conn->names[i]);
+        field->table = field->org_table = "synthetic";
+        field->table_length = field->org_table_length = 9;
+        field->charsetnr = 255; // utf8mb4
+
+        switch (i % 5) {
+        case 0:
+            field->type = MYSQL_TYPE_LONGLONG;
+            field->flags = NOT_NULL_FLAG | (i == 0 ? PRI_KEY_FLAG : 0);
+            field->charsetnr = 63;
+            field->length = field->max_length = 20;
+            break;
+        case 1:
+            field->type = MYSQL_TYPE_VAR_STRING;
+            field->length = 255;
+            field->max_length = 8 + FAKE_STRING_SPREAD - 1;
+            break;
+        case 2:
+            field->type = MYSQL_TYPE_DOUBLE;
+            field->flags = NOT_NULL_FLAG;
+            field->charsetnr = 63;
+            field->length = field->max_length = 22;
+            break;
+        case 3:
+            field->type = MYSQL_TYPE_DATETIME;
+            field->flags = NOT_NULL_FLAG | BINARY_FLAG;
+            field->charsetnr = 63;
+            field->length = field->max_length = 19;
+            break;
+        case 4:
+            field->type = MYSQL_TYPE_BLOB;
+            field->flags = NOT_NULL_FLAG | BINARY_FLAG | BLOB_FLAG;
+            field->charsetnr = 63; // binary
+            field->length = 65535;
+            field->max_length = FAKE_BLOB_LENGTH;
+            break;
+        }
+    }
+
+    conn->show_field.name = conn->show_field.org_name = "Field";
+    conn->show_field.name_length = conn->show_field.org_name_length = 5;
+    conn->show_field.type = MYSQL_TYPE_VAR_STRING;
+    conn->show_field.charsetnr = 255;
+    conn->show_field.length = 256;
+    return true;
+}
+
+/** Value of a cell: the same for the same row and column on every run */
+static void fake_cell(uint64_t row, unsigned int column, unsigned int num_fields, FakeCell *cell) {
+    memset(cell, 0, sizeof(FakeCell));
+
+    switch (column % 5) {
+    case 0:
+        cell->int_value = column == 0 ? (long long)row + 1 : (long long)(row * num_fields + column);
+        break;
+    case 1:
+        cell->is_null = row % 10 == 9;
+        cell->is_bytes = true;
+        cell->bytes = FAKE_TEXT;
+        cell->length = 8 + (unsigned long)(row % FAKE_STRING_SPREAD);
+        break;
+    case 2:
+        cell->double_value = (double)row * 1.25 + column;
+        break;
+    case 3:
+        cell->time.year = 2024;
+        cell->time.month = 1 + (unsigned int)(row % 12);
+        cell->time.day = 1 + (unsigned int)(row % 28);
+        cell->time.hour = (unsigned int)(row % 24);
+        cell->time.minute = (unsigned int)(row % 60);
+        cell->time.second = column % 60;
+        cell->time.time_type = MYSQL_TIMESTAMP_DATETIME;
+        break;
+    case 4:
+        cell->is_bytes = true;
+        cell->bytes = FAKE_TEXT + column % 8;
+        cell->length = FAKE_BLOB_LENGTH;
+        break;
+    }
+}
+
+/** Text protocol form of a cell, returns its length */
+static unsigned long fake_cell_text(unsigned int column, const FakeCell *cell, char *text) {
+    int length = 0;
+    switch (column % 5) {
+    case 0:
+        length = snprintf(text, FAKE_CELL_TEXT_SIZE, "%lld", cell->int_value);
+        break;
+    case 2:
+        length = snprintf(text, FAKE_CELL_TEXT_SIZE, "%.17g", cell->double_value);
+        break;
+    case 3:
+        length = snprintf(text, FAKE_CELL_TEXT_SIZE, "%04u-%02u-%02u %02u:%02u:%02u", cell->time.year, cell->time.month,
+                          cell->time.day, cell->time.hour, cell->time.minute, cell->time.second);
+        break;
+    default:
+        memcpy(text, cell->bytes, cell->length);
+        text[cell->length] = '\0';
+        return cell->length;
+    }
+    return (unsigned long)length;
+}
+
+/** Write a cell into a result bind, converted to the bind's buffer type. Returns true when truncated */
+static bool fake_fill_bind(uint64_t row, unsigned int column, unsigned int num_fields, MYSQL_BIND *bind) {
+    FakeCell cell;
+    fake_cell(row, column, num_fields, &cell);
+
+    bool is_null = cell.is_null;
+    if (bind->is_null) {
+        *bind->is_null = is_null;
+    }
+    if (bind->error) {
+        *bind->error = false;
+    }
+    if (is_null) {
+        return false;
+    }
+
+    switch (bind->buffer_type) {
+    case MYSQL_TYPE_LONGLONG:
+        *(long long *)bind->buffer = cell.is_bytes ? strtoll(cell.bytes, NULL, 10) : cell.int_value;
+        return false;
+    case MYSQL_TYPE_DOUBLE:
+        *(double *)bind->buffer = column % 5 == 2 ? cell.double_value : (double)cell.int_value;
+        return false;
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+    case MYSQL_TYPE_DATE:
+        *(MYSQL_TIME *)bind->buffer = cell.time;
+        return false;
+    default: {
+        // Byte buffers get as much as fits, the full length tells the caller to fetch the rest
+        char text[FAKE_CELL_TEXT_SIZE];
+        unsigned long length = fake_cell_text(column, &cell, text);
+        unsigned long copied = length < bind->buffer_length ? length : bind->buffer_length;
+        memcpy(bind->buffer, text, copied);
+        if (copied < bind->buffer_length) {
+            ((char *)bind->buffer)[copied] = '\0';
+        }
+        if (bind->length) {
+            *bind->length = length;
+        }
+        if (length > bind->buffer_length && bind->error) {
+            *bind->error = true;
+        }
+        return length > bind->buffer_length;
+    }
+    }
+}
+
+// =========================== STATEMENTS ===========================
+
+static bool is_word_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+/** Skip whitespace and comments */
+static const char *skip_space(const char *p, const char *end) {
+    for (;;) {
+        while (p < end && isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (end - p >= 2 && p[0] == '/' && p[1] == '*') {
+            const char *close = p + 2;
+            while (end - close >= 2 && !(close[0] == '*' && close[1] == '/')) {
+                close++;
+            }
+            p = end - close >= 2 ? close + 2 : end;
+        } else if ((end - p >= 2 && p[0] == '-' && p[1] == '-') || (p < end && *p == '#')) {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+        } else {
+            return p;
+        }
+    }
+}
+
+/** Whether the word at `p` is `keyword`, case-insensitively */
+static bool is_keyword(const char *p, const char *end, const char *keyword) {
+    size_t length = strlen(keyword);
+    return (size_t)(end - p) >= length && strncasecmp(p, keyword, length) == 0 &&
+           (p + length == end || !is_word_char(p[length]));
+}
+
+/** Read the LIMIT row count at `p`: a number, a placeholder, or `offset, count` */
+static void parse_limit(const char *p, const char *end, unsigned long params, FakeQuery *query) {
+    for (int part = 0; part < 2; part++) {
+        p = skip_space(p, end);
+        if (p < end && *p == '?') {
+            query->limit = -1;
+            query->limit_param = (int)params++;
+            p++;
+        } else if (p < end && isdigit((unsigned char)*p)) {
+            query->limit = strtoll(p, (char **)&p, 10);
+            query->limit_param = -1;
+        } else {
+            return;
+        }
+        p = skip_space(p, end);
+        if (p >= end || *p != ',') {
+            return;
+        }
+        p++;
+    }
+}
+
+/**
+ * Scan one statement: its kind from the first keyword, placeholders, top-level LIMIT and VALUES tuples
+ * @return const char* - End of the statement: its `;` or `end`
+ */
+static const char *parse_statement(const char *sql, const char *end, FakeQuery *query) {
+    memset(query, 0, sizeof(FakeQuery));
+    query->limit = -1;
+    query->limit_param = -1;
+
+    const char *p = skip_space(sql, end);
+    while (p < end && *p == '(') {
+        p = skip_space(p + 1, end);
+    }
+    query->empty = p >= end || *p == ';';
+
+    if (is_keyword(p, end, "SELECT") || is_keyword(p, end, "WITH")) {
+        query->kind = FAKE_SELECT;
+    } else if (is_keyword(p, end, "SHOW") || is_keyword(p, end, "DESCRIBE") || is_keyword(p, end, "DESC") ||
+               is_keyword(p, end, "EXPLAIN")) {
+        query->kind = FAKE_SHOW;
+    } else if (is_keyword(p, end, "INSERT") || is_keyword(p, end, "REPLACE")) {
+        query->kind = FAKE_INSERT;
+    } else if (is_keyword(p, end, "UPDATE") || is_keyword(p, end, "DELETE")) {
+        query->kind = FAKE_WRITE;
+    } else if (is_keyword(p, end, "LOAD")) {
+        query->kind = FAKE_LOAD;
+    }
+
+    int depth = 0;
+    bool in_values = false, in_infile = false;
+    while (p < end) {
+        char c = *p;
+        if (c == '\'' || c == '"' || c == '`') {
+            const char *start = ++p;
+            while (p < end && *p != c) {
+                p += *p == '\\' && c != '`' && p + 1 < end ? 2 : 1;
+            }
+            if (in_infile) {
+                size_t length = (size_t)(p - start) < sizeof(query->file) ? (size_t)(p - start) : sizeof(query->file) - 1;
+                memcpy(query->file, start, length);
+                query->file[length] = '\0';
+                in_infile = false;
+            }
+            p++;
+        } else if (c == ';' && depth == 0) {
+            return p;
+        } else if (c == '?') {
+            query->params++;
+            p++;
+        } else if (c == '(') {
+            if (depth == 0 && in_values) {
+                query->tuples++;
+            }
+            depth++;
+            p++;
+        } else if (c == ')') {
+            depth--;
+            p++;
+        } else if (is_word_char(c)) {
+            const char *word = p;
+            while (p < end && is_word_char(*p)) {
+                p++;
+            }
+            if (depth == 0 && is_keyword(word, end, "LIMIT")) {
+                parse_limit(p, end, query->params, query);
+            } else if (depth == 0 && (is_keyword(word, end, "VALUES") || is_keyword(word, end, "VALUE"))) {
+                in_values = true;
+            } else if (depth == 0 && (is_keyword(word, end, "ON") || is_keyword(word, end, "AS"))) {
+                in_values = false; // ON DUPLICATE KEY UPDATE, row alias
+            } else if (is_keyword(word, end, "INFILE")) {
+                in_infile = true;
+            } else if (query->kind == FAKE_SELECT && is_keyword(word, end, "information_schema")) {
+                query->kind = FAKE_SHOW; // Catalog reads see no tables
+            }
+        } else if ((c == '-' && p + 1 < end && p[1] == '-') || c == '#' || (c == '/' && p + 1 < end && p[1] == '*')) {
+            p = skip_space(p, end);
+        } else {
+            p++;
+        }
+    }
+    return p;
+}
+
+/** Row count of a SELECT, capped by its LIMIT */
+static uint64_t select_rows(const FakeConnection *conn, int64_t limit) {
+    uint64_t rows = (uint64_t)conn->options.rows;
+    return limit >= 0 && (uint64_t)limit < rows ? (uint64_t)limit : rows;
+}
+
+/** Sleep the injected latency of one round trip */
+static void round_trip(const FakeConnection *conn) {
+    int latency_us = conn->options.latency_us;
+    if (latency_us > 0) {
+        struct timespec ts = {latency_us / 1000000, (long)(latency_us % 1000000) * 1000};
+        while (nanosleep(&ts, &ts) != 0) {
+        }
+    }
+}
+
+static void set_error(FakeConnection *conn, unsigned int code, const char *message) {
+    conn->error_code = code;
+    snprintf(conn->error, sizeof(conn->error), "%s", message);
+}
+
+/** Serve LOAD DATA LOCAL INFILE from the connection's infile handler, one affected row per line */
+static bool run_load(FakeConnection *conn, const FakeQuery *query) {
+    if (!conn->local_infile) {
+        set_error(conn, 3948, "Loading local data is disabled; this must be enabled on both the client and server sides");
+        return false;
+    }
+    if (!conn->infile_init) {
+        set_error(conn, 2068, "LOAD DATA LOCAL INFILE file request rejected due to restrictions on access.");
+        return false;
+    }
+
+    void *ptr = NULL;
+    char *buffer = (char *)malloc(FAKE_INFILE_CHUNK);
+    bool ok = buffer && conn->infile_init(&ptr, query->file, conn->infile_userdata) == 0;
+
+    uint64_t lines = 0;
+    bool pending = false; // Bytes after the last newline
+    while (ok) {
+        int read = conn->infile_read(ptr, buffer, FAKE_INFILE_CHUNK);
+        if (read < 0) {
+            ok = false;
+        } else if (read == 0) {
+            break;
+        }
+        for (int i = 0; ok && i < read; i++) {
+            if (buffer[i] == '\n') {
+                lines++;
+                pending = false;
+            } else {
+                pending = true;
+            }
+        }
+    }
+
+    if (!ok) {
+        char message[256] = "Out of memory";
+        int code = buffer ? conn->infile_error(ptr, message, sizeof(message)) : CR_UNKNOWN_ERROR;
+        set_error(conn, code > 0 ? (unsigned int)code : CR_UNKNOWN_ERROR, message);
+    }
+    if (buffer) {
+        conn->infile_end(ptr);
+    }
+    free(buffer);
+
+    conn->affected_rows = lines + (pending ? 1 : 0);
+    return ok;
+}
+
+/** Run one statement of the text protocol */
+static bool run_statement(FakeConnection *conn, const FakeQuery *query) {
+    conn->result_kind = FAKE_OTHER;
+    conn->field_count = 0;
+    conn->affected_rows = 0;
+    conn->insert_id = 0;
+
+    switch (query->kind) {
+    case FAKE_SELECT:
+        conn->result_kind = FAKE_SELECT;
+        conn->result_rows = select_rows(conn, query->limit);
+        conn->field_count = (unsigned int)conn->options.columns;
+        break;
+    case FAKE_SHOW:
+        conn->result_kind = FAKE_SHOW;
+        conn->result_rows = 0;
+        conn->field_count = 1;
+        break;
+    case FAKE_INSERT:
+        conn->affected_rows = query->tuples > 0 ? query->tuples : 1;
+        conn->insert_id = conn->next_insert_id;
+        conn->next_insert_id += conn->affected_rows;
+        break;
+    case FAKE_WRITE:
+        conn->affected_rows = 1;
+        break;
+    case FAKE_LOAD:
+        return run_load(conn, query);
+    case FAKE_OTHER:
+        break;
+    }
+    return true;
+}
+
+/** Run the statement at `next_statement` and move past it. Returns 0, or 1 on error */
+static int run_next(FakeConnection *conn) {
+    const char *start = conn->sql + conn->next_statement;
+    const char *end = conn->sql + conn->sql_length;
+
+    FakeQuery query;
+    const char *stop = parse_statement(start, end, &query);
+    conn->next_statement = (size_t)(stop - conn->sql) + (stop < end ? 1 : 0);
+
+    if (query.empty) {
+        set_error(conn, 1065, "Query was empty");
+        return 1;
+    }
+    return run_statement(conn, &query) ? 0 : 1;
+}
+
+/** Whether only whitespace and empty statements follow `next_statement` */
+static bool statements_left(const FakeConnection *conn) {
+    const char *p = conn->sql ? conn->sql + conn->next_statement : NULL;
+    const char *end = conn->sql ? conn->sql + conn->sql_length : NULL;
+    while (p && p < end) {
+        p = skip_space(p, end);
+        if (p < end && *p != ';') {
+            return true;
+        }
+        p += p < end ? 1 : 0;
+    }
+    return false;
+}
+
+// =========================== CONNECTIONS ===========================
+
+static int fake_library_init(int argc, char **argv, char **groups) {
+    return 0;
+}
+
+static bool fake_thread_init(void) {
+    return false;
+}
+
+static void fake_thread_end(void) {
+}
+
+// Handles are always allocated by the driver, a caller-owned MYSQL cannot hold a fake connection
+static MYSQL *fake_init(MYSQL *mysql) {
+    if (mysql) {
+        return NULL;
+    }
+    FakeConnection *conn = (FakeConnection *)calloc(1, sizeof(FakeConnection));
+    if (conn) {
+        conn->next_insert_id = 1;
+    }
+    return (MYSQL *)conn;
+}
+
+static int fake_options(MYSQL *mysql, enum mysql_option option, const void *arg) {
+    if (option == MYSQL_OPT_LOCAL_INFILE) {
+        ((FakeConnection *)mysql)->local_infile = arg && *(const unsigned int *)arg != 0;
+    }
+    return 0;
+}
+
+static MYSQL *fake_real_connect(MYSQL *mysql, const char *host, const char *user, const char *passwd, const char *db,
+                                unsigned int port, const char *unix_socket, unsigned long client_flag) {
+    FakeConnection *conn = (FakeConnection *)mysql;
+
+    pthread_mutex_lock(&configured_lock);
+    conn->options = configured;
+    pthread_mutex_unlock(&configured_lock);
+
+    free(conn->fields);
+    free(conn->names);
+    conn->fields = NULL;
+    conn->names = NULL;
+    if (!fake_table_create(conn)) {
+        set_error(conn, CR_UNKNOWN_ERROR, "Out of memory");
+        return NULL;
+    }
+
+    conn->multi_statements = (client_flag & CLIENT_MULTI_STATEMENTS) != 0;
+    round_trip(conn);
+    return mysql;
+}
+
+static void fake_close(MYSQL *mysql) {
+    FakeConnection *conn = (FakeConnection *)mysql;
+    if (!conn) {
+        return;
+    }
+    free(conn->fields);
+    free(conn->names);
+    free(conn->sql);
+    free(conn);
+}
+
+static int fake_ping(MYSQL *mysql) {
+    round_trip((FakeConnection *)mysql);
+    return 0;
+}
+
+static int fake_set_server_option(MYSQL *mysql, enum enum_mysql_set_option option) {
+    FakeConnection *conn = (FakeConnection *)mysql;
+    conn->multi_statements = option == MYSQL_OPTION_MULTI_STATEMENTS_ON;
+    round_trip(conn);
+    return 0;
+}
+
+static const char *fake_error(MYSQL *mysql) {
+    return ((FakeConnection *)mysql)->error;
+}
+
+static unsigned int fake_error_code(MYSQL *mysql) {
+    return ((FakeConnection *)mysql)->error_code;
+}
+
+static unsigned long fake_real_escape_string_quote(MYSQL *mysql, char *to, const char *from, unsigned long length,
+                                                   char quote) {
+    char *out = to;
+    for (unsigned long i = 0; i < length; i++) {
+        char c = from[i];
+        switch (c) {
+        case '\0':
+            *out++ = '\\';
+            *out++ = '0';
+            break;
+        case '\n':
+            *out++ = '\\';
+            *out++ = 'n';
+            break;
+        case '\r':
+            *out++ = '\\';
+            *out++ = 'r';
+            break;
+        case '\032':
+            *out++ = '\\';
+            *out++ = 'Z';
+            break;
+        case '\\':
+        case '\'':
+        case '"':
+            *out++ = '\\';
+            *out++ = c;
+            break;
+        default:
+            *out++ = c;
+        }
+    }
+    *out = '\0';
+    return (unsigned long)(out - to);
+}
+
+static void fake_set_local_infile_handler(MYSQL *mysql, int (*local_infile_init)(void **, const char *, void *),
+                                          int (*local_infile_read)(void *, char *, unsigned int),
+                                          void (*local_infile_end)(void *),
+                                          int (*local_infile_error)(void *, char *, unsigned int), void *userdata) {
+    FakeConnection *conn = (FakeConnection *)mysql;
+    conn->infile_init = local_infile_init;
+    conn->infile_read = local_infile_read;
+    conn->infile_end = local_infile_end;
+    conn->infile_error = local_infile_error;
+    conn->infile_userdata = userdata;
+}
+
+// =========================== TEXT PROTOCOL ===========================
+
+static int fake_real_query(MYSQL *mysql, const char *query, unsigned long length) {
+    FakeConnection *conn = (FakeConnection *)mysql;
+    conn->error_code = 0;
+    conn->error[0] = '\0';
+    conn->result_kind = FAKE_OTHER;
+
+    //? Step 1: Keep the statements, `next_result` runs the ones after the first
+    char *sql = (char *)malloc(length + 1);
+    if (!sql) {
+        set_error(conn, CR_UNKNOWN_ERROR, "Out of memory");
+        return 1;
+    }
+    memcpy(sql, query, length);
+    sql[length] = '\0';
+    free(conn->sql);
+    conn->sql = sql;
+    conn->sql_length = length;
+    conn->next_statement = 0;
+
+    //? Step 2: One round trip, then the first statement
+    round_trip(conn);
+
+    // Without multi statements the server reads the whole text as one statement, and fails at the `;`
+    if (!conn->multi_statements) {
+        FakeQuery first;
+        const char *stop = parse_statement(sql, sql + length, &first);
+        conn->next_statement = (size_t)(stop - sql) + (stop < sql + length ? 1 : 0);
+        bool stacked = statements_left(conn);
+        conn->next_statement = 0;
+        if (stacked) {
+            conn->next_statement = length;
+            set_error(conn, 1064, "You have an error in your SQL syntax near ';'");
+            return 1;
+        }
+    }
+    return run_next(conn);
+}
+
+static int fake_query(MYSQL *mysql, const char *query) {
+    return fake_real_query(mysql, query, (unsigned long)strlen(query));
+}
+
+static FakeResult *result_create(const MYSQL_FIELD *fields, unsigned int num_fields, uint64_t num_rows, bool with_rows) {
+    FakeResult *result = (FakeResult *)calloc(1, sizeof(FakeResult));
+    if (!result) {
+        return NULL;
+    }
+    result->fields = fields;
+    result->num_fields = num_fields;
+    result->num_rows = num_rows;
+
+    if (with_rows && (!(result->row = (char **)calloc(num_fields, sizeof(char *))) ||
+                      !(result->lengths = (unsigned long *)calloc(num_fields, sizeof(unsigned long))) ||
+                      !(result->text = (char *)malloc((size_t)num_fields * FAKE_CELL_TEXT_SIZE)))) {
+        free(result->row);
+        free(result->lengths);
+        free(result);
+        return NULL;
+    }
+    return result;
+}
+
+static MYSQL_RES *fake_store_result(MYSQL *mysql) {
+    FakeConnection *conn = (FakeConnection *)mysql;
+    FakeKind kind = conn->result_kind;
+    conn->result_kind = FAKE_OTHER;
+
+    if (kind == FAKE_SELECT) {
+        conn->affected_rows = conn->result_rows;
+        return (MYSQL_RES *)result_create(conn->fields, conn->field_count, conn->result_rows, true);
+    }
+    if (kind == FAKE_SHOW) {
+        return (MYSQL_RES *)result_create(&conn->show_field, 1, 0, true);
+    }
+    return NULL;
+}
+
+static int fake_next_result(MYSQL *mysql) {
+    FakeConnection *conn = (FakeConnection *)mysql;
+    conn->result_kind = FAKE_OTHER;
+    if (!statements_left(conn)) {
+        return -1;
+    }
+    return run_next(conn) == 0 ? 0 : 1;
+}
+
+static bool fake_more_results(MYSQL *mysql) {
+    return statements_left((FakeConnection *)mysql);
+}
+
+static unsigned int fake_field_count(MYSQL *mysql) {
+    return ((FakeConnection *)mysql)->field_count;
+}
+
+static my_ulonglong fake_affected_rows(MYSQL *mysql) {
+    return ((FakeConnection *)mysql)->affected_rows;
+}
+
+static my_ulonglong fake_insert_id(MYSQL *mysql) {
+    return ((FakeConnection *)mysql)->insert_id;
+}
+
+static unsigned int fake_warning_count(MYSQL *mysql) {
+    return 0;
+}
+
+// =========================== RESULT SETS ===========================
+
+static void fake_free_result(MYSQL_RES *res) {
+    FakeResult *result = (FakeResult *)res;
+    if (!result) {
+        return;
+    }
+    free(result->row);
+    free(result->lengths);
+    free(result->text);
+    free(result);
+}
+
+static my_ulonglong fake_num_rows(MYSQL_RES *res) {
+    return ((FakeResult *)res)->num_rows;
+}
+
+static unsigned int fake_num_fields(MYSQL_RES *res) {
+    return ((FakeResult *)res)->num_fields;
+}
+
+static MYSQL_FIELD *fake_fetch_fields(MYSQL_RES *res) {
+    return (MYSQL_FIELD *)((FakeResult *)res)->fields;
+}
+
+static MYSQL_ROW fake_fetch_row(MYSQL_RES *res) {
+    FakeResult *result = (FakeResult *)res;
+    if (!result->row || result->cursor >= result->num_rows) {
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < result->num_fields; i++) {
+        FakeCell cell;
+        fake_cell(result->cursor, i, result->num_fields, &cell);
+        char *text = result->text + (size_t)i * FAKE_CELL_TEXT_SIZE;
+        result->lengths[i] = cell.is_null ? 0 : fake_cell_text(i, &cell, text);
+        result->row[i] = cell.is_null ? NULL : text;
+    }
+    result->cursor++;
+    return result->row;
+}
+
+static unsigned long *fake_fetch_lengths(MYSQL_RES *res) {
+    return ((FakeResult *)res)->lengths;
+}
+
+static void fake_data_seek(MYSQL_RES *res, my_ulonglong offset) {
+    ((FakeResult *)res)->cursor = offset;
+}
+
+// =========================== PREPARED STATEMENTS ===========================
+
+static void set_stmt_error(FakeStmt *stmt, unsigned int code, const char *message) {
+    stmt->error_code = code;
+    snprintf(stmt->error, sizeof(stmt->error), "%s", message);
+}
+
+static MYSQL_STMT *fake_stmt_init(MYSQL *mysql) {
+    FakeStmt *stmt = (FakeStmt *)calloc(1, sizeof(FakeStmt));
+    if (stmt) {
+        stmt->conn = (FakeConnection *)mysql;
+    }
+    return (MYSQL_STMT *)stmt;
+}
+
+static int fake_stmt_prepare(MYSQL_STMT *mysql_stmt, const char *query, unsigned long length) {
+    FakeStmt *stmt = (FakeStmt *)mysql_stmt;
+    stmt->error_code = 0;
+    stmt->error[0] = '\0';
+    stmt->prepared = false;
+
+    round_trip(stmt->conn);
+
+    const char *end = query + length;
+    const char *stop = parse_statement(query, end, &stmt->query);
+    if (stmt->query.empty) {
+        set_stmt_error(stmt, 1065, "Query was empty");
+        return 1;
+    }
+    if (stop < end && skip_space(stop + 1, end) < end) {
+        set_stmt_error(stmt, 1064, "You have an error in your SQL syntax: one statement per prepared statement");
+        return 1;
+    }
+    if (stmt->query.kind == FAKE_LOAD) {
+        set_stmt_error(stmt, 1295, "This command is not supported in the prepared statement protocol yet");
+        return 1;
+    }
+
+    stmt->prepared = true;
+    return 0;
+}
+
+static unsigned long fake_stmt_param_count(MYSQL_STMT *stmt) {
+    return ((FakeStmt *)stmt)->query.params;
+}
+
+/** Row count of a `LIMIT ?` from its bound value, -1 when it is not an integer */
+static int64_t bound_limit(const MYSQL_BIND *bind) {
+    if (!bind->buffer || (bind->is_null && *bind->is_null)) {
+        return -1;
+    }
+    switch (bind->buffer_type) {
+    case MYSQL_TYPE_LONGLONG:
+        return *(const long long *)bind->buffer;
+    case MYSQL_TYPE_LONG:
+        return *(const int *)bind->buffer;
+    default:
+        return -1;
+    }
+}
+
+static bool fake_stmt_bind_param(MYSQL_STMT *mysql_stmt, MYSQL_BIND *bind) {
+    FakeStmt *stmt = (FakeStmt *)mysql_stmt;
+    stmt->bound_limit = stmt->query.limit_param >= 0 ? bound_limit(&bind[stmt->query.limit_param]) : -1;
+    return false;
+}
+
+static bool fake_stmt_attr_set(MYSQL_STMT *stmt, enum enum_stmt_attr_type attr_type, const void *attr) {
+    return false;
+}
+
+static int fake_stmt_execute(MYSQL_STMT *mysql_stmt) {
+    FakeStmt *stmt = (FakeStmt *)mysql_stmt;
+    FakeConnection *conn = stmt->conn;
+    if (!stmt->prepared) {
+        set_stmt_error(stmt, CR_UNKNOWN_ERROR, "Statement not prepared");
+        return 1;
+    }
+
+    round_trip(conn);
+
+    int64_t limit = stmt->query.limit_param >= 0 ? stmt->bound_limit : stmt->query.limit;
+    if (!run_statement(conn, &stmt->query)) {
+        set_stmt_error(stmt, conn->error_code, conn->error);
+        return 1;
+    }
+
+    stmt->result_kind = conn->result_kind;
+    stmt->num_rows = stmt->result_kind == FAKE_SELECT ? select_rows(conn, limit) : 0;
+    stmt->fetched = 0;
+    stmt->affected_rows = stmt->result_kind == FAKE_OTHER ? conn->affected_rows : stmt->num_rows;
+    stmt->insert_id = conn->insert_id;
+    conn->result_kind = FAKE_OTHER;
+    return 0;
+}
+
+static MYSQL_RES *fake_stmt_result_metadata(MYSQL_STMT *mysql_stmt) {
+    FakeStmt *stmt = (FakeStmt *)mysql_stmt;
+    if (stmt->query.kind == FAKE_SELECT) {
+        return (MYSQL_RES *)result_create(stmt->conn->fields, (unsigned int)stmt->conn->options.columns, 0, false);
+    }
+    if (stmt->query.kind == FAKE_SHOW) {
+        return (MYSQL_RES *)result_create(&stmt->conn->show_field, 1, 0, false);
+    }
+    return NULL;
+}
+
+static int fake_stmt_store_result(MYSQL_STMT *stmt) {
+    ((FakeStmt *)stmt)->fetched = 0;
+    return 0;
+}
+
+static my_ulonglong fake_stmt_num_rows(MYSQL_STMT *stmt) {
+    return ((FakeStmt *)stmt)->num_rows;
+}
+
+static bool fake_stmt_bind_result(MYSQL_STMT *stmt, MYSQL_BIND *bind) {
+    ((FakeStmt *)stmt)->bind = bind;
+    return false;
+}
+
+static int fake_stmt_fetch(MYSQL_STMT *mysql_stmt) {
+    FakeStmt *stmt = (FakeStmt *)mysql_stmt;
+    if (stmt->fetched >= stmt->num_rows) {
+        return MYSQL_NO_DATA;
+    }
+
+    unsigned int num_fields = (unsigned int)stmt->conn->options.columns;
+    bool truncated = false;
+    for (unsigned int i = 0; i < num_fields; i++) {
+        truncated |= fake_fill_bind(stmt->fetched, i, num_fields, &stmt->bind[i]);
+    }
+    stmt->fetched++;
+    return truncated ? MYSQL_DATA_TRUNCATED : 0;
+}
+
+static int fake_stmt_fetch_column(MYSQL_STMT *mysql_stmt, MYSQL_BIND *bind, unsigned int column, unsigned long offset) {
+    FakeStmt *stmt = (FakeStmt *)mysql_stmt;
+    if (stmt->fetched == 0 || column >= (unsigned int)stmt->conn->options.columns) {
+        set_stmt_error(stmt, 2051, "Attempt to read column without prior row fetch");
+        return 1;
+    }
+    fake_fill_bind(stmt->fetched - 1, column, (unsigned int)stmt->conn->options.columns, bind);
+    return 0;
+}
+
+static my_ulonglong fake_stmt_affected_rows(MYSQL_STMT *stmt) {
+    return ((FakeStmt *)stmt)->affected_rows;
+}
+
+static my_ulonglong fake_stmt_insert_id(MYSQL_STMT *stmt) {
+    return ((FakeStmt *)stmt)->insert_id;
+}
+
+static bool fake_stmt_free_result(MYSQL_STMT *mysql_stmt) {
+    FakeStmt *stmt = (FakeStmt *)mysql_stmt;
+    stmt->fetched = stmt->num_rows;
+    return false;
+}
+
+static bool fake_stmt_close(MYSQL_STMT *stmt) {
+    free(stmt);
+    return false;
+}
+
+static const char *fake_stmt_error(MYSQL_STMT *stmt) {
+    return ((FakeStmt *)stmt)->error;
+}
+
+static unsigned int fake_stmt_error_code(MYSQL_STMT *stmt) {
+    return ((FakeStmt *)stmt)->error_code;
+}
+
+const PeekDriver fake_driver = {
+    .name = "fake",
+
+    .library_init = fake_library_init,
+    .thread_init = fake_thread_init,
+    .thread_end = fake_thread_end,
+
+    .init = fake_init,
+    .options = fake_options,
+    .real_connect = fake_real_connect,
+    .close = fake_close,
+    .ping = fake_ping,
+    .set_server_option = fake_set_server_option,
+    .error = fake_error,
+    .error_code = fake_error_code,
+    .real_escape_string_quote = fake_real_escape_string_quote,
+    .set_local_infile_handler = fake_set_local_infile_handler,
+
+    .query = fake_query,
+    .real_query = fake_real_query,
+    .store_result = fake_store_result,
+    .next_result = fake_next_result,
+    .more_results = fake_more_results,
+    .field_count = fake_field_count,
+    .affected_rows = fake_affected_rows,
+    .insert_id = fake_insert_id,
+    .warning_count = fake_warning_count,
+
+    .free_result = fake_free_result,
+    .num_rows = fake_num_rows,
+    .num_fields = fake_num_fields,
+    .fetch_fields = fake_fetch_fields,
+    .fetch_row = fake_fetch_row,
+    .fetch_lengths = fake_fetch_lengths,
+    .data_seek = fake_data_seek,
+
+    .stmt_init = fake_stmt_init,
+    .stmt_prepare = fake_stmt_prepare,
+    .stmt_param_count = fake_stmt_param_count,
+    .stmt_bind_param = fake_stmt_bind_param,
+    .stmt_attr_set = fake_stmt_attr_set,
+    .stmt_execute = fake_stmt_execute,
+    .stmt_result_metadata = fake_stmt_result_metadata,
+    .stmt_store_result = fake_stmt_store_result,
+    .stmt_num_rows = fake_stmt_num_rows,
+    .stmt_bind_result = fake_stmt_bind_result,
+    .stmt_fetch = fake_stmt_fetch,
+    .stmt_fetch_column = fake_stmt_fetch_column,
+    .stmt_affected_rows = fake_stmt_affected_rows,
+    .stmt_insert_id = fake_stmt_insert_id,
+    .stmt_free_result = fake_stmt_free_result,
+    .stmt_close = fake_stmt_close,
+    .stmt_error = fake_stmt_error,
+    .stmt_error_code = fake_stmt_error_code,
+
+    // No socket to poll: the event loop pool needs the mysql driver
+    .get_socket = NULL,
+    .real_connect_nonblocking = NULL,
+    .real_query_nonblocking = NULL,
+    .store_result_nonblocking = NULL,
+};
@@ -0,0 +1,244 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_infile.h"
+#include "../include/mysql_pool.h"
+#include <mysql.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Client error code reported for a refused or aborted LOCAL INFILE */
+#define INFILE_ERROR_CODE 2000
+
+InfileSource *infile_source_create(InfileNotify notify, void *notify_context) {
+    InfileSource *source = (InfileSource *)calloc(1, sizeof(InfileSource));
+    if (!source) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&source->lock, NULL);
+    pthread_cond_init(&source->cond, NULL);
+    source->notify = notify;
+    source->notify_context = notify_context;
+    source->refs = 1;
+    return source;
+}
+
+void infile_source_retain(InfileSource *source) {
+    pthread_mutex_lock(&source->lock);
+    source->refs++;
+    pthread_mutex_unlock(&source->lock);
+}
+
+void infile_source_release(InfileSource *source) {
+    pthread_mutex_lock(&source->lock);
+    bool last = --source->refs == 0;
+    pthread_mutex_unlock(&source->lock);
+
+    if (!last) {
+        return;
+    }
+
+    InfileChunk *chunk = source->head;
+    while (chunk) {
+        InfileChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    pthread_cond_destroy(&source->cond);
+    pthread_mutex_destroy(&source->lock);
+    free(source);
+}
+
+bool infile_source_write(InfileSource *source, const char *data, size_t length) {
+    pthread_mutex_lock(&source->lock);
+
+    // Nobody reads anymore: drop the data, writers learn the outcome from the load itself
+    if (source->finished || source->aborted || source->ended || length == 0) {
+        pthread_mutex_unlock(&source->lock);
+        return true;
+    }
+    pthread_mutex_unlock(&source->lock);
+
+    InfileChunk *chunk = (InfileChunk *)malloc(sizeof(InfileChunk) + length);
+    if (!chunk) {
+        infile_source_abort(source, "Out of memory");
+        return true;
+    }
+    chunk->next = NULL;
+    chunk->length = length;
+    chunk->offset = 0;
+    memcpy(chunk->data, data, length);
+
+    pthread_mutex_lock(&source->lock);
+    if (source->tail) {
+        source->tail->next = chunk;
+    } else {
+        source->head = chunk;
+    }
+    source->tail = chunk;
+    source->queued_bytes += length;
+
+    bool below = source->queued_bytes < INFILE_HIGH_WATER_MARK;
+    if (!below) {
+        source->need_drain = true;
+    }
+    pthread_cond_signal(&source->cond);
+    pthread_mutex_unlock(&source->lock);
+    return below;
+}
+
+void infile_source_end(InfileSource *source) {
+    pthread_mutex_lock(&source->lock);
+    source->ended = true;
+    pthread_cond_signal(&source->cond);
+    pthread_mutex_unlock(&source->lock);
+}
+
+void infile_source_abort(InfileSource *source, const char *message) {
+    pthread_mutex_lock(&source->lock);
+    if (!source->aborted) {
+        source->aborted = true;
+        snprintf(source->error, sizeof(source->error), "%s", message ? message : "Load aborted");
+    }
+    pthread_cond_signal(&source->cond);
+    pthread_mutex_unlock(&source->lock);
+}
+
+uint64_t infile_source_finish(InfileSource *source) {
+    pthread_mutex_lock(&source->lock);
+    source->finished = true;
+    uint64_t bytes_sent = source->bytes_sent;
+    pthread_mutex_unlock(&source->lock);
+
+    // Release writers still waiting for a drain
+    if (source->notify) {
+        source->notify(source->notify_context, INFILE_EVENT_PROGRESS, bytes_sent);
+        source->notify(source->notify_context, INFILE_EVENT_DRAIN, bytes_sent);
+    }
+
+    return bytes_sent;
+}
+
+// =========================== LOCAL INFILE HANDLER ===========================
+
+static int infile_init(void **ptr, const char *filename, void *userdata) {
+    *ptr = userdata;
+    return 0;
+}
+
+/** Copy the next queued bytes into the client's packet buffer, blocking until data arrives */
+static int infile_read(void *ptr, char *buf, unsigned int buf_len) {
+    InfileSource *source = (InfileSource *)ptr;
+    bool drain = false, progress = false;
+    uint64_t bytes_sent = 0;
+    int copied = 0;
+
+    pthread_mutex_lock(&source->lock);
+    while (!source->head && !source->ended && !source->aborted) {
+        pthread_cond_wait(&source->cond, &source->lock);
+    }
+
+    if (source->aborted) {
+        pthread_mutex_unlock(&source->lock);
+        return -1;
+    }
+
+    //? Step 1: Fill the buffer from as many queued chunks as fit
+    while (source->head && (unsigned int)copied < buf_len) {
+        InfileChunk *chunk = source->head;
+        size_t length = chunk->length - chunk->offset;
+        if (length > buf_len - (unsigned int)copied) {
+            length = buf_len - (unsigned int)copied;
+        }
+
+        memcpy(buf + copied, chunk->data + chunk->offset, length);
+        chunk->offset += length;
+        copied += (int)length;
+        source->queued_bytes -= length;
+
+        if (chunk->offset == chunk->length) {
+            source->head = chunk->next;
+            if (!source->head) {
+                source->tail = NULL;
+            }
+            free(chunk);
+        }
+    }
+
+    //? Step 2: Tell writers to resume and report progress, outside the lock
+    source->bytes_sent += (uint64_t)copied;
+    bytes_sent = source->bytes_sent;
+    if (source->need_drain && source->queued_bytes < INFILE_HIGH_WATER_MARK / 2) {
+        source->need_drain = false;
+        drain = true;
+    }
+    if (source->bytes_sent - source->bytes_reported >= INFILE_PROGRESS_INTERVAL) {
+        source->bytes_reported = source->bytes_sent;
+        progress = true;
+    }
+    pthread_mutex_unlock(&source->lock);
+
+    if (source->notify) {
+        if (drain) {
+            source->notify(source->notify_context, INFILE_EVENT_DRAIN, bytes_sent);
+        }
+        if (progress) {
+            source->notify(source->notify_context, INFILE_EVENT_PROGRESS, bytes_sent);
+        }
+    }
+
+    // 0 tells the client library the file ended
+    return copied;
+}
+
+static void infile_end(void *ptr) {
+}
+
+static int infile_error(void *ptr, char *error_msg, unsigned int error_msg_len) {
+    InfileSource *source = (InfileSource *)ptr;
+    pthread_mutex_lock(&source->lock);
+    snprintf(error_msg, error_msg_len, "%s", source->error[0] ? source->error : "Load aborted");
+    pthread_mutex_unlock(&source->lock);
+    return INFILE_ERROR_CODE;
+}
+
+static int guard_init(void **ptr, const char *filename, void *userdata) {
+    *ptr = NULL;
+    return 1;
+}
+
+static int guard_read(void *ptr, char *buf, unsigned int buf_len) {
+    return -1;
+}
+
+static void guard_end(void *ptr) {
+}
+
+static int guard_error(void *ptr, char *error_msg, unsigned int error_msg_len) {
+    snprintf(error_msg, error_msg_len, "LOCAL INFILE is only accepted during peek.load");
+    return INFILE_ERROR_CODE;
+}
+
+void infile_install_guard(MYSQL *conn) {
+    peek_driver->set_local_infile_handler(conn, guard_init, guard_read, guard_end, guard_error, NULL);
+}
+
+bool infile_load(PoolConnection *pooled, const char *sql, InfileSource *source, my_ulonglong *affected_rows,
+                 unsigned int *warnings, char *error, size_t error_size) {
+    MYSQL *conn = pooled->connection;
+
+    peek_driver->set_local_infile_handler(conn, infile_init, infile_read, infile_end, infile_error, source);
+    bool ok = peek_driver->query(conn, sql) == 0;
+    if (ok) {
+        *affected_rows = peek_driver->affected_rows(conn);
+        *warnings = peek_driver->warning_count(conn);
+    } else {
+        snprintf(error, error_size, "%s", peek_driver->error(conn));
+    }
+    infile_install_guard(conn);
+
+    infile_source_finish(source);
+    return ok;
+}
@@ -1,20 +1,323 @@
+#include "../include/mysql_advisor.h"
+#include "../include/mysql_async.h"
+#include "../include/mysql_batch.h"
+#include "../include/mysql_bulk.h"
+#include "../include/mysql_driver.h"
+#include "../include/mysql_evloop.h"
 #include "../include/mysql_helper.h"
+#include "../include/mysql_infile.h"
+#include "../include/mysql_metrics.h"
+#include "../include/mysql_params.h"
 #include "../include/mysql_pool.h"
+#include "../include/mysql_result.h"
+#include "../include/mysql_result_cache.h"
+#include "../include/mysql_router.h"
+#include "../include/mysql_schema.h"
+#include "../include/mysql_shard.h"
+#include "../include/mysql_shared.h"
+#include "../include/mysql_stmt_cache.h"
+#include "../include/mysql_stream.h"
+#include "../include/mysql_transaction.h"
 #include <ctype.h>
 #include <mysql.h>
 #include <node_api.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static ConnectionPool *pool = NULL; // Pool Manager
-static MYSQL *conn = NULL;          // Direct Connection
+/**
+ * ## Instance
+ * - State of one Node environment, the main thread or a `worker_threads` worker, kept as its instance data
+ * - The pool is shared with every environment that initialized with the same server, see `shared_pool_acquire`
+ */
+typedef struct {
+    SharedPool *shared; // Shared pool, NULL until `initialize`
+    MYSQL *conn;        // Direct Connection
+    EvPool *ev_pool;    // Event loop pool, only with executionMode 'eventloop', bound to this environment's loop
+} PeekInstance;
+
+/**
+ * Read an optional integer property of an options object
+ * @note Leaves `out` untouched when the property is missing or not a number
+ */
+static void get_int_option(napi_env env, napi_value options, const char *key, int *out) {
+    bool has_property = false;
+    if (napi_has_named_property(env, options, key, &has_property) != napi_ok || !has_property) {
+        return;
+    }
+
+    napi_value value;
+    napi_valuetype type;
+    napi_get_named_property(env, options, key, &value);
+    napi_typeof(env, value, &type);
+    if (type == napi_number) {
+        napi_get_value_int32(env, value, out);
+    }
+}
+
+/**
+ * Read an optional boolean property of an options object
+ * @note Leaves `out` untouched when the property is missing or not a boolean
+ */
+static void get_bool_option(napi_env env, napi_value options, const char *key, bool *out) {
+    bool has_property = false;
+    if (napi_has_named_property(env, options, key, &has_property) != napi_ok || !has_property) {
+        return;
+    }
+
+    napi_value value;
+    napi_valuetype type;
+    napi_get_named_property(env, options, key, &value);
+    napi_typeof(env, value, &type);
+    if (type == napi_boolean) {
+        napi_get_value_bool(env, value, out);
+    }
+}
+
+/** Read pool options from the optional `options` argument of `initialize` */
+static bool get_pool_options(napi_env env, napi_value options, PoolOptions *pool_options) {
+    pool_options_default(pool_options);
+
+    napi_valuetype type;
+    napi_typeof(env, options, &type);
+    if (type != napi_object) {
+        return true;
+    }
+
+    get_int_option(env, options, "minPoolSize", &pool_options->min_size);
+    get_int_option(env, options, "maxPoolSize", &pool_options->max_size);
+    get_int_option(env, options, "acquireTimeout", &pool_options->acquire_timeout_ms);
+    get_int_option(env, options, "idleTimeout", &pool_options->idle_timeout_ms);
+    get_int_option(env, options, "validateAfter", &pool_options->validate_after_ms);
+    get_int_option(env, options, "healthCheckInterval", &pool_options->health_check_interval_ms);
+    get_int_option(env, options, "statementCacheSize", &pool_options->stmt_cache_size);
+    get_bool_option(env, options, "localInfile", &pool_options->local_infile);
+
+    bool has_mode = false;
+    napi_has_named_property(env, options, "executionMode", &has_mode);
+    if (has_mode) {
+        napi_value value;
+        napi_get_named_property(env, options, "executionMode", &value);
+        char *mode = params_get_string(env, value, NULL);
+        bool valid = mode && (strcmp(mode, "thread") == 0 || strcmp(mode, "eventloop") == 0);
+        pool_options->event_loop = valid && strcmp(mode, "eventloop") == 0;
+        free(mode);
+        if (!valid) {
+            napi_throw_range_error(env, NULL, "Invalid executionMode: expected 'thread' or 'eventloop'");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Read an optional string property of an options object
+ * @return char* - Heap copy, NULL when the property is missing or not a string
+ */
+static char *get_string_option(napi_env env, napi_value options, const char *key) {
+    bool has_property = false;
+    if (napi_has_named_property(env, options, key, &has_property) != napi_ok || !has_property) {
+        return NULL;
+    }
+
+    napi_value value;
+    napi_valuetype type;
+    napi_get_named_property(env, options, key, &value);
+    napi_typeof(env, value, &type);
+    return type == napi_string ? params_get_string(env, value, NULL) : NULL;
+}
+
+/** Free server configs read by `get_server_configs` */
+static void server_configs_free(ReplicaConfig *configs, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        free((char *)configs[i].host);
+        free((char *)configs[i].user);
+        free((char *)configs[i].password);
+        free((char *)configs[i].database);
+    }
+    free(configs);
+}
+
+/**
+ * Read an optional array of servers of the `initialize` options, `replicas` or `shards`
+ * @param key - Name of the array
+ * @param configs - Receives the servers, NULL when there are none
+ * @return bool - False with a pending exception when the array is invalid
+ */
+static bool get_server_configs(napi_env env, napi_value options, const char *key, ReplicaConfig **configs, uint32_t *count) {
+    *configs = NULL;
+    *count = 0;
+
+    bool has_servers = false;
+    napi_valuetype type;
+    napi_typeof(env, options, &type);
+    if (type != napi_object || napi_has_named_property(env, options, key, &has_servers) != napi_ok || !has_servers) {
+        return true;
+    }
+
+    char message[128];
+    napi_value array;
+    bool is_array = false;
+    napi_get_named_property(env, options, key, &array);
+    napi_is_array(env, array, &is_array);
+    if (!is_array) {
+        snprintf(message, sizeof(message), "Expected %s to be an array", key);
+        napi_throw_type_error(env, NULL, message);
+        return false;
+    }
+
+    uint32_t length = 0;
+    napi_get_array_length(env, array, &length);
+    if (length == 0) {
+        return true;
+    }
+
+    ReplicaConfig *servers = (ReplicaConfig *)calloc(length, sizeof(ReplicaConfig));
+    if (!servers) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value server;
+        napi_get_element(env, array, i, &server);
+        napi_typeof(env, server, &type);
+
+        if (type != napi_object || !(servers[i].host = get_string_option(env, server, "host"))) {
+            server_configs_free(servers, length);
+            snprintf(message, sizeof(message), "Expected every entry of %s to be an object with a host", key);
+            napi_throw_type_error(env, NULL, message);
+            return false;
+        }
+        servers[i].user = get_string_option(env, server, "user");
+        servers[i].password = get_string_option(env, server, "password");
+        servers[i].database = get_string_option(env, server, "database");
+        get_int_option(env, server, "port", &servers[i].port);
+    }
+
+    *configs = servers;
+    *count = length;
+    return true;
+}
+
+/**
+ * Read the optional `driver` and `fakeDriver` of the `initialize` options
+ * @param driver - Receives the driver, libmysqlclient by default
+ * @param fake_options - Receives the synthetic data of the fake driver
+ * @return bool - False with a pending exception when they are invalid
+ */
+static bool get_driver(napi_env env, napi_value options, const PeekDriver **driver, FakeDriverOptions *fake_options) {
+    *driver = &mysql_driver;
+    fake_driver_options_default(fake_options);
+
+    napi_valuetype type;
+    napi_typeof(env, options, &type);
+    if (type != napi_object) {
+        return true;
+    }
+
+    char *name = get_string_option(env, options, "driver");
+    bool known = !name || strcmp(name, "mysql") == 0 || strcmp(name, "fake") == 0;
+    if (name && strcmp(name, "fake") == 0) {
+        *driver = &fake_driver;
+    }
+    free(name);
+    if (!known) {
+        napi_throw_type_error(env, NULL, "Invalid driver: expected 'mysql' or 'fake'");
+        return false;
+    }
+
+    bool has_fake = false;
+    if (napi_has_named_property(env, options, "fakeDriver", &has_fake) == napi_ok && has_fake) {
+        napi_value fake;
+        napi_get_named_property(env, options, "fakeDriver", &fake);
+        get_int_option(env, fake, "columns", &fake_options->columns);
+        get_int_option(env, fake, "rows", &fake_options->rows);
+        get_int_option(env, fake, "latencyUs", &fake_options->latency_us);
+    }
+
+    if (fake_options->columns < 1 || fake_options->columns > FAKE_COLUMNS_LIMIT || fake_options->rows < 0 ||
+        fake_options->latency_us < 0) {
+        napi_throw_range_error(env, NULL, "Invalid fakeDriver: expected 1 <= columns <= 4096, rows >= 0 and latencyUs >= 0");
+        return false;
+    }
+    return true;
+}
+
+/** Instance data of the calling environment */
+static PeekInstance *get_instance(napi_env env) {
+    PeekInstance *instance = NULL;
+    napi_get_instance_data(env, (void **)&instance);
+    return instance;
+}
+
+/** Shared pool of the calling environment, NULL before `initialize` */
+static SharedPool *get_shared(napi_env env) {
+    PeekInstance *instance = get_instance(env);
+    return instance ? instance->shared : NULL;
+}
+
+/** Close the event loop pool of an environment and leave its shared pool, the direct connection stays open */
+static void instance_release(PeekInstance *instance) {
+    // Detach first: queries failed by the destroy may queue new ones from their callbacks
+    EvPool *closing = instance->ev_pool;
+    instance->ev_pool = NULL;
+    ev_pool_destroy(closing);
+
+    // Tasks still running on the shared pool hold their own reference
+    shared_pool_detach(instance->shared);
+    instance->shared = NULL;
+}
+
+/** Close the connections of an environment when it exits, a worker's loop must have no open handle left */
+static void instance_finalize(napi_env env, void *data, void *hint) {
+    PeekInstance *instance = (PeekInstance *)data;
+    instance_release(instance);
+    if (instance->conn) {
+        peek_driver->close(instance->conn);
+    }
+    free(instance);
+}
+
+void InitMySQLInstance(napi_env env) {
+    PeekInstance *instance = (PeekInstance *)calloc(1, sizeof(PeekInstance));
+    if (!instance || napi_set_instance_data(env, instance, instance_finalize, NULL) != napi_ok) {
+        free(instance);
+        napi_throw_error(env, NULL, "Failed to create instance data");
+    }
+}
+
+/**
+ * Format a query into a heap buffer sized to fit
+ * @return char* - Query, NULL when out of memory
+ */
+static char *format_query(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (length < 0) {
+        return NULL;
+    }
+
+    char *query = (char *)malloc((size_t)length + 1);
+    if (!query) {
+        return NULL;
+    }
+
+    va_start(args, format);
+    vsnprintf(query, (size_t)length + 1, format, args);
+    va_end(args);
+    return query;
+}
 
 /** Initialize the connection pool */
 napi_value Initialize(napi_env env, napi_callback_info info) {
-    size_t argc = 5;
-    napi_value args[5];
+    size_t argc = 6;
+    napi_value args[6];
     napi_get_cb_info(env, info, &argc, args, NULL, NULL);
 
     if (argc < 5) {
@@ -31,28 +334,138 @@ napi_value Initialize(napi_env env, napi_callback_info info) {
     napi_get_value_string_utf8(env, args[3], database, sizeof(database), NULL);
     napi_get_value_int32(env, args[4], &port);
 
-    //? Step 1 : Setup Direct Conection
-    if (conn != NULL) {
-        mysql_close(conn);
+    PoolOptions pool_options;
+    int cache_size = 0, cache_ttl_ms = DEFAULT_RESULT_CACHE_TTL_MS;
+    int read_your_writes_ms = 0, replica_check_ms = DEFAULT_REPLICA_CHECK_INTERVAL_MS;
+    int slow_query_ms = 0;
+    if (argc > 5) {
+        if (!get_pool_options(env, args[5], &pool_options)) {
+            return NULL;
+        }
+        get_int_option(env, args[5], "resultCacheSize", &cache_size);
+        get_int_option(env, args[5], "resultCacheTtl", &cache_ttl_ms);
+        get_int_option(env, args[5], "readYourWrites", &read_your_writes_ms);
+        get_int_option(env, args[5], "replicaCheckInterval", &replica_check_ms);
+        get_int_option(env, args[5], "slowQueryThreshold", &slow_query_ms);
+    } else {
+        pool_options_default(&pool_options);
+    }
+
+    if (cache_size < 0) {
+        napi_throw_range_error(env, NULL, "Invalid resultCacheSize: expected resultCacheSize >= 0");
+        return NULL;
+    }
+
+    if (read_your_writes_ms < 0) {
+        napi_throw_range_error(env, NULL, "Invalid readYourWrites: expected readYourWrites >= 0");
+        return NULL;
+    }
+
+    if (slow_query_ms < 0) {
+        napi_throw_range_error(env, NULL, "Invalid slowQueryThreshold: expected slowQueryThreshold >= 0");
+        return NULL;
+    }
+
+    if (pool_options.min_size < 0 || pool_options.max_size < 1 || pool_options.min_size > pool_options.max_size ||
+        pool_options.max_size > POOL_SIZE_LIMIT) {
+        napi_throw_range_error(env, NULL, "Invalid pool size: expected 0 <= minPoolSize <= maxPoolSize <= 1024 and maxPoolSize >= 1");
+        return NULL;
+    }
+
+    const PeekDriver *driver = &mysql_driver;
+    FakeDriverOptions fake_options;
+    if (argc > 5 && !get_driver(env, args[5], &driver, &fake_options)) {
+        return NULL;
     }
 
-    conn = mysql_init(NULL);
-    if (!mysql_real_connect(conn, host, user, password, database, port, NULL, 0)) {
-        napi_throw_error(env, NULL, mysql_error(conn));
+    if (driver->real_query_nonblocking == NULL && pool_options.event_loop) {
+        napi_throw_error(env, NULL, "executionMode 'eventloop' needs the mysql driver");
         return NULL;
     }
 
-    //? Step 2 : Setup Connection Pool
-    if (pool != NULL) {
-        pool_destroy(pool);
+    ReplicaConfig *replicas = NULL, *shard_configs = NULL;
+    uint32_t replica_count = 0, shard_count = 0;
+    if (argc > 5 && !get_server_configs(env, args[5], "replicas", &replicas, &replica_count)) {
+        return NULL;
+    }
+    if (argc > 5 && !get_server_configs(env, args[5], "shards", &shard_configs, &shard_count)) {
+        server_configs_free(replicas, replica_count);
+        return NULL;
+    }
+    if (shard_count > SHARD_LIMIT) {
+        server_configs_free(replicas, replica_count);
+        server_configs_free(shard_configs, shard_count);
+        napi_throw_range_error(env, NULL, "Invalid shards: expected at most 64 shards");
+        return NULL;
+    }
+
+    // Ejected replicas are only re-added by the check
+    if (replica_count > 0 && replica_check_ms <= 0) {
+        server_configs_free(replicas, replica_count);
+        server_configs_free(shard_configs, shard_count);
+        napi_throw_range_error(env, NULL, "Invalid replicaCheckInterval: expected replicaCheckInterval > 0 with replicas");
+        return NULL;
+    }
+
+    //? Step 0 : Let go of this environment's pools, then select the driver of the process
+    PeekInstance *instance = get_instance(env);
+    instance_release(instance);
+    if (instance->conn) {
+        peek_driver->close(instance->conn);
+        instance->conn = NULL;
+    }
+
+    char error[256];
+    if (!shared_pool_use_driver(driver, &fake_options, error, sizeof(error))) {
+        server_configs_free(replicas, replica_count);
+        server_configs_free(shard_configs, shard_count);
+        napi_throw_error(env, NULL, error);
+        return NULL;
+    }
+
+    //? Step 1 : Setup Direct Conection
+    instance->conn = peek_driver->init(NULL);
+    if (!peek_driver->real_connect(instance->conn, host, user, password, database, port, NULL, 0)) {
+        server_configs_free(replicas, replica_count);
+        server_configs_free(shard_configs, shard_count);
+        napi_throw_error(env, NULL, peek_driver->error(instance->conn));
+        return NULL;
     }
 
-    pool = pool_create(host, user, password, database, port);
-    if (!pool) {
-        napi_throw_error(env, NULL, "Failed to create connection pool");
+    //? Step 2 : Share the connection pool of the server, its replicas, shards, advisor and result cache
+    SharedPoolConfig config = {.host = host,
+                               .user = user,
+                               .password = password,
+                               .database = database,
+                               .port = port,
+                               .pool_options = pool_options,
+                               .cache_size = cache_size,
+                               .cache_ttl_ms = cache_ttl_ms,
+                               .replicas = replicas,
+                               .replica_count = (int)replica_count,
+                               .read_your_writes_ms = read_your_writes_ms,
+                               .replica_check_ms = replica_check_ms,
+                               .shards = shard_configs,
+                               .shard_count = (int)shard_count,
+                               .slow_query_ms = slow_query_ms};
+    instance->shared = shared_pool_acquire(&config, error, sizeof(error));
+    server_configs_free(replicas, replica_count);
+    server_configs_free(shard_configs, shard_count);
+    if (!instance->shared) {
+        napi_throw_error(env, NULL, error);
         return NULL;
     }
 
+    //? Step 3 : Setup Event Loop Pool, single statements then run on this environment's thread without blocking it
+    if (pool_options.event_loop) {
+        uv_loop_t *loop = NULL;
+        if (napi_get_uv_event_loop(env, &loop) != napi_ok ||
+            !(instance->ev_pool = ev_pool_create(loop, host, user, password, database, port, &pool_options))) {
+            napi_throw_error(env, NULL, "Failed to create event loop pool");
+            return NULL;
+        }
+    }
+
     napi_value result;
     napi_get_boolean(env, true, &result);
     return result;
@@ -60,10 +473,7 @@ napi_value Initialize(napi_env env, napi_callback_info info) {
 
 /** Add cleanup function */
 napi_value Cleanup(napi_env env, napi_callback_info info) {
-    if (pool) {
-        pool_destroy(pool);
-        pool = NULL;
-    }
+    instance_release(get_instance(env));
 
     napi_value result;
     napi_get_boolean(env, true, &result);
@@ -89,18 +499,24 @@ napi_value ConnectMySQL(napi_env env, napi_callback_info info) {
     napi_get_value_string_utf8(env, args[2], password, sizeof(password), &str_len);
     napi_get_value_string_utf8(env, args[3], database, sizeof(database), &str_len);
 
-    conn = mysql_init(NULL);
+    PeekInstance *instance = get_instance(env);
+    MYSQL *conn = peek_driver->init(NULL);
     if (conn == NULL) {
         napi_throw_error(env, NULL, "MySQL init failed");
         return NULL;
     }
 
-    if (mysql_real_connect(conn, host, user, password, database, 3306, NULL, 0) == NULL) {
-        napi_throw_error(env, NULL, mysql_error(conn));
-        mysql_close(conn);
+    if (peek_driver->real_connect(conn, host, user, password, database, 3306, NULL, 0) == NULL) {
+        napi_throw_error(env, NULL, peek_driver->error(conn));
+        peek_driver->close(conn);
         return NULL;
     }
 
+    if (instance->conn) {
+        peek_driver->close(instance->conn);
+    }
+    instance->conn = conn;
+
     napi_value result;
     napi_get_boolean(env, 1, &result);
     return result;
@@ -108,95 +524,64 @@ napi_value ConnectMySQL(napi_env env, napi_callback_info info) {
 
 /** Function to Close MySQL Connection */
 napi_value CloseMySQL(napi_env env, napi_callback_info info) {
-    if (conn) {
-        mysql_close(conn);
-        conn = NULL;
+    PeekInstance *instance = get_instance(env);
+    if (instance->conn) {
+        peek_driver->close(instance->conn);
+        instance->conn = NULL;
     }
     napi_value result;
     napi_get_boolean(env, 1, &result);
     return result;
 }
 
-/** Function to Create or Update Table */
+/**
+ * Function to Create or Update Table
+ * - Missing columns are added, extra ones dropped and differing ones modified, in one ALTER TABLE
+ */
 napi_value CreateTable(napi_env env, napi_callback_info info) {
     size_t argc = 2;
     napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, NULL, NULL);
 
-    char table_name[256];
-    size_t table_name_len;
-    napi_get_value_string_utf8(env, args[0], table_name, sizeof(table_name), &table_name_len);
-
-    char new_columns[2048];
-    size_t new_columns_len;
-    napi_get_value_string_utf8(env, args[1], new_columns, sizeof(new_columns), &new_columns_len);
-
-    char query[512];
-    snprintf(query, sizeof(query), "SHOW TABLES LIKE '%s'", table_name);
-    if (mysql_query(conn, query)) {
-        napi_throw_error(env, NULL, mysql_error(conn));
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected 2 arguments: table_name, column_definitions");
         return NULL;
     }
 
-    MYSQL_RES *result = mysql_store_result(conn);
-    int table_exists = mysql_num_rows(result) > 0;
-    mysql_free_result(result);
-
-    if (!table_exists) {
-        char create_query[4096];
-        snprintf(create_query, sizeof(create_query), "CREATE TABLE %s (%s)", table_name, new_columns);
-        if (mysql_query(conn, create_query)) {
-            napi_throw_error(env, NULL, mysql_error(conn));
-            return NULL;
-        }
-    } else {
-        snprintf(query, sizeof(query), "SHOW COLUMNS FROM %s", table_name);
-        if (mysql_query(conn, query)) {
-            napi_throw_error(env, NULL, mysql_error(conn));
-            return NULL;
-        }
-
-        result = mysql_store_result(conn);
-        char existing_columns[2048] = "";
-        MYSQL_ROW row;
-        while ((row = mysql_fetch_row(result))) {
-            strcat(existing_columns, row[0]);
-            strcat(existing_columns, ",");
-        }
-        mysql_free_result(result);
-
-        // Add missing columns and track which ones exist
-        char *token = strtok(new_columns, ",");
-        char columns_to_keep[2048] = "";
-        while (token != NULL) {
-            char column[256];
-            strncpy(column, token, sizeof(column) - 1);
-            column[sizeof(column) - 1] = '\0';
-
-            char column_name[256];
-            sscanf(column, "%255s", column_name);
+    MYSQL *conn = get_instance(env)->conn;
+    SharedPool *shared = get_shared(env);
+    if (!conn) {
+        napi_throw_error(env, NULL, "Database not initialized");
+        return NULL;
+    }
 
-            if (!strstr(existing_columns, column_name)) {
-                char alter_query[512];
-                snprintf(alter_query, sizeof(alter_query), "ALTER TABLE %s ADD COLUMN %s", table_name, column);
-                mysql_query(conn, alter_query);
-            }
+    char *table_name = params_get_string(env, args[0], NULL);
+    char *definitions = params_get_string(env, args[1], NULL);
+    SchemaTable table = {0};
+    char error[TASK_ERROR_SIZE];
+
+    if (!table_name || !definitions) {
+        napi_throw_type_error(env, NULL, "Expected table_name and column_definitions to be strings");
+    } else if (!schema_table_from_definitions(table_name, definitions, &table)) {
+        napi_throw_error(env, NULL, "Invalid column_definitions: expected a comma separated list of column definitions");
+    } else if (!schema_sync_table(conn, &table, error, sizeof(error))) {
+        napi_throw_error(env, NULL, error);
+    }
 
-            strcat(columns_to_keep, column_name);
-            strcat(columns_to_keep, ",");
-            token = strtok(NULL, ",");
-        }
+    if (shared && shared->result_cache && table.ddl) {
+        result_cache_invalidate_table(shared->result_cache, table_name); // Columns may have been added or dropped
+    }
+    if (shared && shared->router && table.ddl) {
+        router_note_write(shared->router);
+    }
+    schema_table_free(&table);
+    free(table_name);
+    free(definitions);
 
-        // Drop extra columns
-        char *existing_col = strtok(existing_columns, ",");
-        while (existing_col != NULL) {
-            if (!strstr(columns_to_keep, existing_col)) {
-                char drop_query[512];
-                snprintf(drop_query, sizeof(drop_query), "ALTER TABLE %s DROP COLUMN %s", table_name, existing_col);
-                mysql_query(conn, drop_query);
-            }
-            existing_col = strtok(NULL, ",");
-        }
+    bool exception_pending = false;
+    napi_is_exception_pending(env, &exception_pending);
+    if (exception_pending) {
+        return NULL;
     }
 
     napi_value result_value;
@@ -215,209 +600,424 @@ napi_value CreateIndex(napi_env env, napi_callback_info info) {
         return NULL;
     }
 
-    char table_name[256];
-    char index_name[256];
-    char columns[1024];
-    napi_get_value_string_utf8(env, args[0], table_name, sizeof(table_name), NULL);
-    napi_get_value_string_utf8(env, args[1], index_name, sizeof(index_name), NULL);
-    napi_get_value_string_utf8(env, args[2], columns, sizeof(columns), NULL);
+    MYSQL *conn = get_instance(env)->conn;
+    SharedPool *shared = get_shared(env);
+    if (!conn) {
+        napi_throw_error(env, NULL, "Database not initialized");
+        return NULL;
+    }
+
+    char *table_name = params_get_string(env, args[0], NULL);
+    char *index_name = params_get_string(env, args[1], NULL);
+    char *columns = params_get_string(env, args[2], NULL);
+    char *query = NULL;
+
+    if (!table_name || !index_name || !columns) {
+        napi_throw_type_error(env, NULL, "Expected table_name, index_name and columns to be strings");
+        goto done;
+    }
 
-    char query[2048];
-    snprintf(query, sizeof(query), "SHOW INDEX FROM %s WHERE Key_name = '%s'", table_name, index_name);
+    if (!(query = format_query("SHOW INDEX FROM %s WHERE Key_name = '%s'", table_name, index_name))) {
+        napi_throw_error(env, NULL, "Out of memory");
+        goto done;
+    }
 
-    if (mysql_query(conn, query)) {
+    if (peek_driver->query(conn, query)) {
         char error_message[256];
-        snprintf(error_message, sizeof(error_message), "Failed to execute SHOW INDEX query: %s", mysql_error(conn));
+        snprintf(error_message, sizeof(error_message), "Failed to execute SHOW INDEX query: %s", peek_driver->error(conn));
         napi_throw_error(env, NULL, error_message);
-        return NULL;
+        goto done;
     }
 
-    MYSQL_RES *result = mysql_store_result(conn);
+    MYSQL_RES *result = peek_driver->store_result(conn);
     if (!result) {
         napi_throw_error(env, NULL, "Failed to retrieve result from SHOW INDEX query");
-        return NULL;
+        goto done;
     }
 
-    int index_exists = mysql_num_rows(result) > 0;
-    mysql_free_result(result);
+    int index_exists = peek_driver->num_rows(result) > 0;
+    peek_driver->free_result(result);
 
     if (!index_exists) {
-        snprintf(query, sizeof(query), "CREATE INDEX %s ON %s (%s)", index_name, table_name, columns);
-        if (mysql_query(conn, query)) {
+        free(query);
+        if (!(query = format_query("CREATE INDEX %s ON %s (%s)", index_name, table_name, columns))) {
+            napi_throw_error(env, NULL, "Out of memory");
+            goto done;
+        }
+        if (peek_driver->query(conn, query)) {
             char error_message[256];
-            snprintf(error_message, sizeof(error_message), "Failed to create index: %s", mysql_error(conn));
+            snprintf(error_message, sizeof(error_message), "Failed to create index: %s", peek_driver->error(conn));
             napi_throw_error(env, NULL, error_message);
-            return NULL;
+            goto done;
         }
     } else {
         printf("[CREATE INDEX] Index %s already exists on table %s\n", index_name, table_name);
     }
+    advisor_register_index(shared ? shared->advisor : NULL, table_name, index_name, columns);
+
+done:
+    free(table_name);
+    free(index_name);
+    free(columns);
+    free(query);
+
+    bool exception_pending = false;
+    napi_is_exception_pending(env, &exception_pending);
+    if (exception_pending) {
+        return NULL;
+    }
 
     napi_value result_value;
     napi_get_boolean(env, 1, &result_value);
     return result_value;
 }
 
-/** Function to Select Data from MySQL */
-napi_value Select(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1], result;
-    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+// =========================== QUERY TASKS ===========================
 
-    if (argc < 1) {
-        napi_throw_error(env, NULL, "Expected 1 argument: query");
-        return NULL;
+/** Record the rows decoded into a result set */
+static void record_rows(MetricOp op, const PeekResult *result) {
+    if (result) {
+        metrics_record_rows(op, result->num_rows, result->bytes);
     }
+}
 
-    char query[2048];
-    napi_get_value_string_utf8(env, args[0], query, sizeof(query), NULL);
-
-    if (!conn) {
-        napi_throw_error(env, NULL, "Database not initialized");
-        return NULL;
-    }
+/** Select task */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs, it owns the pools below
+    ConnectionPool *pool;
+    ReplicaRouter *router; // NULL reads from the primary
+    ResultCache *cache;    // NULL when the result is not cached
+    ResultCacheTicket ticket;
+    SlowQueryAdvisor *advisor; // NULL when slow selects are not explained
+    ShardMap *shards;          // Set when the select fans out to every shard
+    bool packed;               // Resolve with one packed buffer instead of row objects
+    char *query;
+    char *fingerprint;         // Query builder's fingerprint, keys the advisor, NULL to compute it
+    PeekParams params;
+    PeekResult *result;
+    EvQuery ev;
+} SelectTask;
+
+/** Write task (INSERT / UPDATE / DELETE / BULK INSERT) */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs
+    ConnectionPool *pool;
+    ReplicaRouter *router; // Told about the write, for read-your-writes
+    ResultCache *cache;    // Invalidated once the write ran
+    ShardMap *shards;      // Set when the write runs on every shard
+    char *query;
+    PeekParams params;
+    bool with_insert_id;
+    my_ulonglong affected_rows;
+    my_ulonglong insert_id;
+    EvQuery ev;
+} WriteTask;
+
+/** Outcome of a select on one pool */
+typedef enum {
+    SELECT_SERVED,    // Ran, or failed for a reason of its own
+    SELECT_SATURATED, // The replica had no connection to spare within acquireTimeout, retry on the primary
+    SELECT_LOST,      // The replica stopped answering, eject it and retry elsewhere
+} SelectOutcome;
+
+/**
+ * Run a select on one pool
+ * @param replica - Replica owning `source`, NULL for the primary
+ * @return SelectOutcome - Whether the select ran, otherwise why the replica could not run it
+ */
+static SelectOutcome select_run(SelectTask *select, ConnectionPool *source, ReplicaNode *replica) {
+    PeekTask *task = &select->base;
 
-    MYSQL *connection = pool_get_connection(pool);
-    if (!connection) {
-        napi_throw_error(env, NULL, "Failed to get database connection");
-        return NULL;
+    PoolConnection *pooled = pool_get_connection(source);
+    if (!pooled) {
+        if (replica) {
+            return SELECT_SATURATED; // A replica that is down is ejected by the health check, not by a busy pool
+        }
+        task_fail(task, "Failed to get database connection");
+        return SELECT_SERVED;
     }
 
-    MYSQL_STMT *stmt = mysql_stmt_init(connection);
+    MYSQL_STMT *stmt = stmt_cache_execute(&pooled->stmt_cache, pooled->connection, select->query, &select->params,
+                                          task->error, sizeof(task->error));
     if (!stmt) {
-        pool_return_connection(pool, connection);
-        napi_throw_error(env, NULL, "Statement initialization failed");
-        return NULL;
-    }
-
-    if (mysql_stmt_prepare(stmt, query, strlen(query)) || mysql_stmt_execute(stmt)) {
-        napi_throw_error(env, NULL, mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
-        pool_return_connection(pool, connection);
-        return NULL;
+        task->failed = true;
+    } else {
+        select->result = result_from_stmt(stmt, &pooled->scratch, task->error, sizeof(task->error));
+        task->failed = select->result == NULL;
+        stmt_cache_done(stmt);
     }
 
-    MYSQL_RES *metadata = mysql_stmt_result_metadata(stmt);
-    if (!metadata) {
-        napi_throw_error(env, NULL, "Failed to retrieve metadata");
-        mysql_stmt_close(stmt);
-        pool_return_connection(pool, connection);
-        return NULL;
+    // A failed statement on a replica that no longer answers is the replica's fault, not the query's
+    if (task->failed && replica && !pool_validate_connection(pooled->connection)) {
+        pool_discard_connection(source, pooled);
+        result_free(select->result);
+        select->result = NULL;
+        task->failed = false;
+        return SELECT_LOST;
     }
 
-    unsigned int num_fields = mysql_num_fields(metadata);
-    MYSQL_FIELD *fields = mysql_fetch_fields(metadata);
-    MYSQL_BIND *bind = (MYSQL_BIND *)calloc(num_fields, sizeof(MYSQL_BIND));
+    pool_return_connection(source, pooled);
+    return SELECT_SERVED;
+}
 
-    char row_data[num_fields][8192];
-    unsigned long lengths[num_fields];
-    bool is_nulls[num_fields];
+static void select_execute(PeekTask *task) {
+    SelectTask *select = (SelectTask *)task;
 
-    for (unsigned int i = 0; i < num_fields; i++) {
-        bind[i].buffer_type = MYSQL_TYPE_STRING;
-        bind[i].buffer = row_data[i];
-        bind[i].buffer_length = sizeof(row_data[i]);
-        bind[i].length = &lengths[i];
-        bind[i].is_null = &is_nulls[i];
+    //? Step 1: Read every shard and merge, or read from a replica when there is a healthy one, ejecting the ones that
+    //? stop answering until the primary serves it, a saturated replica hands the read to the primary
+    if (select->shards) {
+        task->failed = !shard_select(select->shards, select->query, &select->params, &select->result, task->error,
+                                     sizeof(task->error));
+    } else {
+        bool on_primary = !select->router;
+        for (;;) {
+            ReplicaNode *replica = on_primary ? NULL : router_acquire(select->router);
+            SelectOutcome outcome = select_run(select, replica ? replica->pool : select->pool, replica);
+            if (replica) {
+                router_release(select->router, replica, outcome == SELECT_LOST);
+            }
+            if (outcome == SELECT_SERVED) {
+                break;
+            }
+            on_primary = outcome == SELECT_SATURATED;
+        }
     }
 
-    // Initialize result to an undefined value
-    napi_get_undefined(env, &result);
+    record_rows(METRIC_OP_SELECT, select->result);
 
-    if (mysql_stmt_bind_result(stmt, bind)) {
-        napi_throw_error(env, NULL, "Failed to bind result");
-        goto cleanup;
+    //? Step 2: Cache the result
+    if (select->cache) {
+        result_cache_store(select->cache, &select->ticket, select->result);
     }
 
-    napi_create_array(env, &result);
-    uint32_t row_index = 0;
+    //? Step 3: Hand a slow select to the advisor
+    if (!task->failed) {
+        advisor_observe(select->advisor, select->query, select->fingerprint, &select->params,
+                        metrics_now_us() - task->started_us);
+    }
+}
 
-    while (!mysql_stmt_fetch(stmt)) {
-        napi_value row_obj;
-        napi_create_object(env, &row_obj);
+static napi_value select_complete(napi_env env, PeekTask *task) {
+    SelectTask *select = (SelectTask *)task;
+    return select->packed ? result_to_packed(env, select->result) : result_to_js(env, select->result);
+}
 
-        for (unsigned int i = 0; i < num_fields; i++) {
-            napi_value field_value;
-            napi_create_string_utf8(env, is_nulls[i] ? "" : row_data[i], lengths[i], &field_value);
-            napi_set_named_property(env, row_obj, fields[i].name, field_value);
-        }
+static void select_destroy(PeekTask *task) {
+    SelectTask *select = (SelectTask *)task;
+    result_cache_ticket_free(&select->ticket);
+    result_free(select->result);
+    params_free(&select->params);
+    free(select->query);
+    free(select->fingerprint);
+    shared_pool_release(select->shared);
+    free(select);
+}
 
-        napi_set_element(env, result, row_index++, row_obj);
+/** Event loop completion of a select */
+static void select_ev_done(EvQuery *query) {
+    SelectTask *select = (SelectTask *)query->context;
+    select->result = query->result;
+    query->result = NULL;
+    record_rows(METRIC_OP_SELECT, select->result);
+    if (query->failed) {
+        task_fail(&select->base, query->error);
+    } else {
+        if (select->cache) {
+            result_cache_store(select->cache, &select->ticket, select->result);
+        }
+        advisor_observe(select->advisor, select->query, select->fingerprint, &select->params,
+                        metrics_now_us() - select->base.started_us);
     }
+    task_finish(&select->base);
+}
 
-cleanup:
-    mysql_free_result(metadata);
-    mysql_stmt_close(stmt);
-    pool_return_connection(pool, connection);
-    free(bind);
-
-    return result;
+/** Event loop completion of a write */
+static void write_ev_done(EvQuery *query) {
+    WriteTask *write = (WriteTask *)query->context;
+    write->affected_rows = query->affected_rows;
+    write->insert_id = query->insert_id;
+    result_free(query->result);
+    query->result = NULL;
+    if (query->failed) {
+        task_fail(&write->base, query->error);
+    }
+    // Before the promise settles, so a select awaiting the write never sees a stale cached result
+    if (write->cache) {
+        result_cache_invalidate(write->cache, write->query);
+    }
+    if (write->router) {
+        router_note_write(write->router);
+    }
+    task_finish(&write->base);
 }
 
-/** Function to Insert Data into MySQL */
-napi_value Insert(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1], result;
-    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+/**
+ * Run a task on the event loop pool instead of the thread pool
+ * @param promise - Receives the promise, NULL with a pending exception on failure
+ * @return bool - False when the statement must run on a worker thread
+ */
+static bool ev_route(napi_env env, const char *name, PeekTask *task, EvQuery *query, napi_value *promise) {
+    EvPool *ev_pool = get_instance(env)->ev_pool;
+    if (!ev_pool || !ev_query_fits(query->sql, query->params)) {
+        return false;
+    }
 
-    if (argc < 1) {
-        napi_throw_error(env, NULL, "Expected 1 argument: query");
-        return NULL;
+    *promise = task_start(env, name, task);
+    if (*promise) {
+        ev_pool_submit(ev_pool, query);
     }
+    return true;
+}
 
-    char query[2048];
-    napi_get_value_string_utf8(env, args[0], query, sizeof(query), NULL);
+static void write_execute(PeekTask *task) {
+    WriteTask *write = (WriteTask *)task;
 
-    if (!pool) {
-        napi_throw_error(env, NULL, "Database not initialized");
-        return NULL;
+    //? Without a shard key, a write to a sharded table runs on every shard
+    if (write->shards) {
+        task->failed = !shard_write(write->shards, write->query, &write->params, &write->affected_rows, task->error,
+                                    sizeof(task->error));
+        if (write->cache) {
+            result_cache_invalidate(write->cache, write->query);
+        }
+        return;
     }
 
     //? Step 1: Get a connection from the pool
-    MYSQL *conn = pool_get_connection(pool);
-    if (!conn) {
-        napi_throw_error(env, NULL, "Could not get database connection from pool");
-        return NULL;
+    PoolConnection *pooled = pool_get_connection(write->pool);
+    if (!pooled) {
+        task_fail(task, "Could not get database connection from pool");
+        return;
+    }
+    MYSQL *connection = pooled->connection;
+
+    //? Step 2: Use connection to execute query, as a cached prepared statement when it has placeholders
+    if (write->params.count > 0) {
+        MYSQL_STMT *stmt = stmt_cache_execute(&pooled->stmt_cache, connection, write->query, &write->params,
+                                              task->error, sizeof(task->error));
+        if (stmt) {
+            write->affected_rows = peek_driver->stmt_affected_rows(stmt);
+            write->insert_id = peek_driver->stmt_insert_id(stmt);
+            stmt_cache_done(stmt);
+        } else {
+            task->failed = true;
+        }
+    } else if (peek_driver->query(connection, write->query) == 0) {
+        write->affected_rows = peek_driver->affected_rows(connection);
+        write->insert_id = peek_driver->insert_id(connection);
+    } else {
+        task_fail(task, peek_driver->error(connection));
     }
 
-    //? Step 2: Use connection to execute query
-    if (mysql_query(conn, query) == 0) {
-        // Get the number of affected rows
-        my_ulonglong affected_rows = mysql_affected_rows(conn);
-        // Get the last insert ID
-        my_ulonglong last_id = mysql_insert_id(conn);
+    //? Step 3: Return connection to the pool
+    pool_return_connection(write->pool, pooled);
 
-        // Create return object with affected rows and insert ID
-        napi_value obj;
-        napi_create_object(env, &obj);
+    //? Step 4: Invalidate cached results of the written tables, even on failure the write may have been applied
+    if (write->cache) {
+        result_cache_invalidate(write->cache, write->query);
+    }
+    if (write->router) {
+        router_note_write(write->router);
+    }
+}
+
+static napi_value write_complete(napi_env env, PeekTask *task) {
+    WriteTask *write = (WriteTask *)task;
 
-        napi_value affected_rows_value;
-        napi_create_int64(env, (int64_t)affected_rows, &affected_rows_value);
-        napi_set_named_property(env, obj, "affectedRows", affected_rows_value);
+    napi_value obj;
+    napi_create_object(env, &obj);
 
+    napi_value affected_rows_value;
+    napi_create_int64(env, (int64_t)write->affected_rows, &affected_rows_value);
+    napi_set_named_property(env, obj, "affectedRows", affected_rows_value);
+
+    if (write->with_insert_id) {
         napi_value insert_id_value;
-        napi_create_int64(env, (int64_t)last_id, &insert_id_value);
+        napi_create_int64(env, (int64_t)write->insert_id, &insert_id_value);
         napi_set_named_property(env, obj, "insertId", insert_id_value);
+    }
 
-        //? Step 3: Return connection to the pool
-        pool_return_connection(pool, conn);
+    return obj;
+}
 
-        return obj;
+static void write_destroy(PeekTask *task) {
+    WriteTask *write = (WriteTask *)task;
+    params_free(&write->params);
+    free(write->query);
+    shared_pool_release(write->shared);
+    free(write);
+}
+
+/**
+ * ## Route a statement by the `table` and `shardKey` of its options
+ * - Statements on a table without a declared shard key, or without `table`, run on the primary
+ * @param shards - Shard map, NULL without shards
+ * @param options - Options of the statement
+ * @param target - Receives the pool of the shard holding `shardKey`, NULL when the statement does not go to one shard
+ * @param fan_out - Receives whether the statement runs on every shard: a sharded table without `shardKey`
+ * @return bool - False with a pending exception when the key cannot be routed
+ */
+static bool get_shard_route(napi_env env, ShardMap *shards, napi_value options, ConnectionPool **target, bool *fan_out) {
+    *target = NULL;
+    *fan_out = false;
+
+    napi_valuetype type;
+    napi_typeof(env, options, &type);
+    if (!shards || type != napi_object) {
+        return true;
+    }
+
+    char *name = get_string_option(env, options, "table");
+    if (!name || !shard_map_contains(shards, name)) {
+        free(name);
+        return true;
     }
 
-    napi_throw_error(env, NULL, mysql_error(conn));
-    napi_get_undefined(env, &result);
+    bool has_key = false;
+    napi_value key_value;
+    napi_valuetype key_type = napi_undefined;
+    if (napi_has_named_property(env, options, "shardKey", &has_key) == napi_ok && has_key) {
+        napi_get_named_property(env, options, "shardKey", &key_value);
+        napi_typeof(env, key_value, &key_type);
+    }
+    if (key_type == napi_undefined) {
+        free(name);
+        *fan_out = true;
+        return true;
+    }
 
-    //? Step 3: Return connection to the pool
-    pool_return_connection(pool, conn);
+    PeekParam key;
+    memset(&key, 0, sizeof(PeekParam));
+    if (!params_value_from_js(env, key_value, &key)) {
+        free(name);
+        return false;
+    }
 
-    return result;
+    // Another environment may redeclare the table in between, so a table no longer sharded runs on the primary
+    char error[TASK_ERROR_SIZE];
+    int shard = shard_map_route(shards, name, &key, error, sizeof(error));
+    free(name);
+    if (key.type == PARAM_STRING || key.type == PARAM_BLOB) {
+        free(key.data);
+    }
+    if (shard == SHARD_INVALID) {
+        napi_throw_range_error(env, NULL, error);
+        return false;
+    }
+    *target = shard == SHARD_UNSHARDED ? NULL : shards->pools[shard];
+    return true;
 }
 
-/** Function to Update Data in MySQL */
-napi_value Update(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1], result;
+/**
+ * Queue a write query read from the first argument, with optional placeholder values as the second
+ * - The third argument routes a write to a sharded table, see `get_shard_route`
+ * @param with_insert_id - Whether the result reports `insertId`
+ * @param name - Async resource name
+ */
+static napi_value queue_write(napi_env env, napi_callback_info info, bool with_insert_id, MetricOp op, const char *name) {
+    size_t argc = 3;
+    napi_value args[3];
     napi_get_cb_info(env, info, &argc, args, NULL, NULL);
 
     if (argc < 1) {
@@ -425,151 +1025,663 @@ napi_value Update(napi_env env, napi_callback_info info) {
         return NULL;
     }
 
-    char query[2048];
-    napi_get_value_string_utf8(env, args[0], query, sizeof(query), NULL);
-
-    if (!pool) {
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
         napi_throw_error(env, NULL, "Database not initialized");
         return NULL;
     }
 
-    //? Step 1: Get a connection from the pool
-    MYSQL *conn = pool_get_connection(pool);
-    if (!conn) {
-        napi_throw_error(env, NULL, "Could not get database connection from pool");
+    char *query = params_get_string(env, args[0], NULL);
+    if (!query) {
+        napi_throw_type_error(env, NULL, "Expected query to be a string");
         return NULL;
     }
 
-    //? Step 2: Use connection to execute query
-    if (mysql_query(conn, query) == 0) {
-        my_ulonglong affected_rows = mysql_affected_rows(conn);
+    ConnectionPool *shard = NULL;
+    bool fan_out = false;
+    if (argc > 2 && !get_shard_route(env, shared->shards, args[2], &shard, &fan_out)) {
+        free(query);
+        return NULL;
+    }
+    if (fan_out && (op == METRIC_OP_INSERT || op == METRIC_OP_BULK_INSERT)) {
+        free(query);
+        napi_throw_error(env, NULL, "Expected a shardKey to insert into a sharded table");
+        return NULL;
+    }
 
-        napi_value obj;
-        napi_create_object(env, &obj);
+    WriteTask *write = (WriteTask *)calloc(1, sizeof(WriteTask));
+    if (!write) {
+        free(query);
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
 
-        napi_value affected_rows_value;
-        napi_create_int64(env, (int64_t)affected_rows, &affected_rows_value);
-        napi_set_named_property(env, obj, "affectedRows", affected_rows_value);
+    if (argc > 1 && !params_from_js(env, args[1], &write->params)) {
+        free(query);
+        free(write);
+        return NULL;
+    }
 
-        //? Step 3: Return connection to the pool
-        pool_return_connection(pool, conn);
+    write->base.execute = write_execute;
+    write->base.complete = write_complete;
+    write->base.destroy = write_destroy;
+    write->base.op = op;
+    write->pool = shard ? shard : shared->pool;
+    write->router = shard || fan_out ? NULL : shared->router; // Shards have no replicas
+    write->cache = shared->result_cache;
+    write->shards = fan_out ? shared->shards : NULL;
+    write->query = query;
+    write->with_insert_id = with_insert_id;
+    write->shared = shared_pool_retain(shared);
+
+    // The event loop pool connects to the primary only
+    write->ev = (EvQuery){.sql = query, .params = &write->params, .done = write_ev_done, .context = write};
+    napi_value promise;
+    if (!shard && !fan_out && ev_route(env, name, &write->base, &write->ev, &promise)) {
+        return promise;
+    }
+    return task_queue(env, name, &write->base);
+}
 
-        return obj;
+/**
+ * Function to Select Data from MySQL
+ * - With `{ packed: true }` the rows are copied into one ArrayBuffer, see `result_to_packed`
+ * - With `{ table, shardKey }` a select on a sharded table reads the shard holding the key, or every shard without it
+ * - With `{ fingerprint }` a slow select is reported under the query builder's fingerprint, see `Fingerprint`
+ * @example
+ * const rows = await select('SELECT * FROM devices WHERE id > ?', [10]);
+ * const { columns, kinds, rows, buffer } = await select('SELECT * FROM devices', [], { packed: true });
+ * const orders = await select('SELECT * FROM orders WHERE customer_id = ?', [7], { table: 'orders', shardKey: 7 });
+ */
+napi_value Select(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected 1 argument: query");
+        return NULL;
+    }
+
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
+        napi_throw_error(env, NULL, "Database not initialized");
+        return NULL;
     }
 
-    napi_throw_error(env, NULL, mysql_error(conn));
-    napi_get_undefined(env, &result);
+    SelectTask *select = (SelectTask *)calloc(1, sizeof(SelectTask));
+    if (!select) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
 
-    //? Step 3: Return connection to the pool
-    pool_return_connection(pool, conn);
+    if (!(select->query = params_get_string(env, args[0], NULL))) {
+        free(select);
+        napi_throw_type_error(env, NULL, "Expected query to be a string");
+        return NULL;
+    }
 
-    return result;
+    if (argc > 1 && !params_from_js(env, args[1], &select->params)) {
+        free(select->query);
+        free(select);
+        return NULL;
+    }
+
+    ConnectionPool *shard = NULL;
+    bool fan_out = false;
+    if (argc > 2) {
+        napi_valuetype type;
+        napi_typeof(env, args[2], &type);
+        if (type == napi_object) {
+            get_bool_option(env, args[2], "packed", &select->packed);
+            select->fingerprint = get_string_option(env, args[2], "fingerprint");
+        }
+        if (!get_shard_route(env, shared->shards, args[2], &shard, &fan_out)) {
+            select_destroy(&select->base);
+            return NULL;
+        }
+    }
+
+    //? Serve a cached result without leaving the main thread
+    ResultCache *result_cache = shared->result_cache;
+    if (result_cache) {
+        uint64_t started_us = metrics_now_us();
+        CachedResult *hit = result_cache_lookup(result_cache, select->query, &select->params, &select->ticket);
+        if (hit) {
+            napi_value rows = select->packed ? result_serialized_to_packed(env, hit->data) : result_serialized_to_js(env, hit->data);
+            result_cache_release(result_cache, hit);
+            select_destroy(&select->base);
+            metrics_record_op(METRIC_OP_SELECT, metrics_now_us() - started_us, rows == NULL);
+            if (!rows) {
+                return NULL;
+            }
+
+            napi_deferred deferred;
+            napi_value promise;
+            napi_create_promise(env, &deferred, &promise);
+            napi_resolve_deferred(env, deferred, rows);
+            return promise;
+        }
+        select->cache = select->ticket.key ? result_cache : NULL;
+    }
+
+    select->base.execute = select_execute;
+    select->base.complete = select_complete;
+    select->base.destroy = select_destroy;
+    select->base.op = METRIC_OP_SELECT;
+    select->pool = shard ? shard : shared->pool;
+    select->router = shard || fan_out ? NULL : shared->router;
+    select->advisor = shard || fan_out ? NULL : shared->advisor; // EXPLAINs run on the primary, which has no sharded rows
+    select->shards = fan_out ? shared->shards : NULL;
+    select->shared = shared_pool_retain(shared);
+
+    // With replicas or shards, selects go to the worker threads that route them
+    select->ev = (EvQuery){.sql = select->query, .params = &select->params, .done = select_ev_done, .context = select};
+    napi_value promise;
+    if (!select->router && !shard && !fan_out && ev_route(env, "peek:select", &select->base, &select->ev, &promise)) {
+        return promise;
+    }
+    return task_queue(env, "peek:select", &select->base);
+}
+
+/** Function to Insert Data into MySQL */
+napi_value Insert(napi_env env, napi_callback_info info) {
+    return queue_write(env, info, true, METRIC_OP_INSERT, "peek:insert");
+}
+
+/** Function to Update Data in MySQL */
+napi_value Update(napi_env env, napi_callback_info info) {
+    return queue_write(env, info, false, METRIC_OP_UPDATE, "peek:update");
 }
 
 /** Function to Delete Data from MySQL */
 napi_value Delete(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1], result;
+    return queue_write(env, info, false, METRIC_OP_DELETE, "peek:delete");
+}
+
+/** Function to Bulk Insert Data into MySQL */
+napi_value BulkInsert(napi_env env, napi_callback_info info) {
+    return queue_write(env, info, true, METRIC_OP_BULK_INSERT, "peek:bulk_insert");
+}
+
+// =========================== BULK INSERT ===========================
+
+/** Bulk insert task */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs
+    ConnectionPool *pool;
+    ReplicaRouter *router;
+    ResultCache *cache;
+    BulkRows rows;
+    int parallel;
+    BulkResult result;
+    bool failed; // Rejected from `complete`, with what the ranges that succeeded inserted
+} BulkInsertTask;
+
+static void bulk_insert_execute(PeekTask *task) {
+    BulkInsertTask *bulk = (BulkInsertTask *)task;
+    bulk->failed = !bulk_insert(bulk->pool, &bulk->rows, bulk->parallel, &bulk->result, task->error, sizeof(task->error));
+    if (bulk->cache) {
+        result_cache_invalidate_table(bulk->cache, bulk->rows.table);
+    }
+    if (bulk->router) {
+        router_note_write(bulk->router);
+    }
+}
+
+static napi_value bulk_insert_complete(napi_env env, PeekTask *task) {
+    BulkInsertTask *bulk = (BulkInsertTask *)task;
+
+    napi_value obj, value;
+    napi_create_object(env, &obj);
+
+    napi_create_int64(env, (int64_t)bulk->result.affected_rows, &value);
+    napi_set_named_property(env, obj, "affectedRows", value);
+
+    napi_create_int64(env, (int64_t)bulk->result.first_insert_id, &value);
+    napi_set_named_property(env, obj, "insertId", value);
+
+    napi_create_int64(env, (int64_t)bulk->result.last_insert_id, &value);
+    napi_set_named_property(env, obj, "lastInsertId", value);
+
+    napi_create_int64(env, (int64_t)bulk->result.statements, &value);
+    napi_set_named_property(env, obj, "statements", value);
+
+    if (!bulk->failed) {
+        return obj;
+    }
+
+    // Parallel ranges commit on their own, the error tells what the ones that succeeded inserted
+    napi_value message, error;
+    napi_create_string_utf8(env, task->error, NAPI_AUTO_LENGTH, &message);
+    napi_create_error(env, NULL, message, &error);
+    napi_set_named_property(env, error, "result", obj);
+    napi_throw(env, error);
+    return NULL;
+}
+
+static void bulk_insert_destroy(PeekTask *task) {
+    BulkInsertTask *bulk = (BulkInsertTask *)task;
+    bulk_rows_free(&bulk->rows);
+    shared_pool_release(bulk->shared);
+    free(bulk);
+}
+
+/**
+ * Function to Bulk Insert an array of records, serialized and chunked natively
+ * - Records of a sharded table go to the shard of the `table` and `shardKey` options, see `get_shard_route`
+ * - Each range of rows is inserted all or nothing, a failure rejects with an error whose `result` counts the rows of
+ *   the ranges that were kept, see `bulk_insert`
+ * @example
+ * bulkInsertRows('devices', [{ name: 'a', device_type: 'car' }, { name: 'b', device_type: 'bike' }], { parallel: 4 });
+ */
+napi_value BulkInsertRows(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
     napi_get_cb_info(env, info, &argc, args, NULL, NULL);
 
-    if (argc < 1) {
-        napi_throw_error(env, NULL, "Expected 1 argument: query");
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected 2 arguments: table, records");
         return NULL;
     }
 
-    char query[2048];
-    napi_get_value_string_utf8(env, args[0], query, sizeof(query), NULL);
-
-    if (!pool) {
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
         napi_throw_error(env, NULL, "Database not initialized");
         return NULL;
     }
 
-    //? Step 1: Get a connection from the pool
-    MYSQL *conn = pool_get_connection(pool);
-    if (!conn) {
-        napi_throw_error(env, NULL, "Could not get database connection from pool");
+    int parallel = 1;
+    ConnectionPool *shard = NULL;
+    bool fan_out = false;
+    if (argc > 2) {
+        napi_valuetype type;
+        napi_typeof(env, args[2], &type);
+        if (type == napi_object) {
+            get_int_option(env, args[2], "parallel", &parallel);
+        }
+        if (!get_shard_route(env, shared->shards, args[2], &shard, &fan_out)) {
+            return NULL;
+        }
+    }
+    if (parallel < 1) {
+        napi_throw_range_error(env, NULL, "Invalid parallel: expected parallel >= 1");
         return NULL;
     }
 
-    //? Step 2: Use connection to execute query
-    if (mysql_query(conn, query) == 0) {
-        my_ulonglong affected_rows = mysql_affected_rows(conn);
+    BulkInsertTask *bulk = (BulkInsertTask *)calloc(1, sizeof(BulkInsertTask));
+    if (!bulk) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
 
-        napi_value obj;
-        napi_create_object(env, &obj);
+    if (!bulk_rows_from_js(env, args[0], args[1], &bulk->rows)) {
+        free(bulk);
+        return NULL;
+    }
+    if (fan_out) {
+        bulk_rows_free(&bulk->rows);
+        free(bulk);
+        napi_throw_error(env, NULL, "Expected a shardKey to insert into a sharded table");
+        return NULL;
+    }
+
+    bulk->base.execute = bulk_insert_execute;
+    bulk->base.complete = bulk_insert_complete;
+    bulk->base.destroy = bulk_insert_destroy;
+    bulk->base.op = METRIC_OP_BULK_INSERT;
+    bulk->pool = shard ? shard : shared->pool;
+    bulk->parallel = parallel;
+    bulk->router = shard ? NULL : shared->router;
+    bulk->cache = shared->result_cache;
+    bulk->shared = shared_pool_retain(shared);
+
+    return task_queue(env, "peek:bulk_insert_rows", &bulk->base);
+}
+
+// =========================== LOAD DATA ===========================
+
+/** Tags load handles */
+static const napi_type_tag LOAD_TAG = {0x7065656b2d6c6f61ULL, 0x642d68616e646c65ULL};
+
+/** Event posted from the loading thread to the JS `onEvent` callback */
+typedef struct {
+    InfileEvent event;
+    uint64_t bytes;
+} LoadEvent;
+
+/** Load task */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs
+    ConnectionPool *pool;
+    ReplicaRouter *router;
+    ResultCache *cache;
+    char *query;
+    InfileSource *source;
+    napi_threadsafe_function events;
+    my_ulonglong affected_rows;
+    unsigned int warnings;
+    uint64_t bytes;
+} LoadTask;
+
+/** Runs on the loading thread */
+static void load_notify(void *context, InfileEvent event, uint64_t bytes) {
+    LoadEvent *load_event = (LoadEvent *)malloc(sizeof(LoadEvent));
+    if (!load_event) {
+        return;
+    }
+    load_event->event = event;
+    load_event->bytes = bytes;
+    if (napi_call_threadsafe_function((napi_threadsafe_function)context, load_event, napi_tsfn_nonblocking) != napi_ok) {
+        free(load_event);
+    }
+}
 
-        napi_value affected_rows_value;
-        napi_create_int64(env, (int64_t)affected_rows, &affected_rows_value);
-        napi_set_named_property(env, obj, "affectedRows", affected_rows_value);
+/** Runs on the main thread: onEvent('drain' | 'progress', bytes) */
+static void load_call_js(napi_env env, napi_value js_callback, void *context, void *data) {
+    LoadEvent *load_event = (LoadEvent *)data;
 
-        //? Step 3: Return connection to the pool
-        pool_return_connection(pool, conn);
+    if (env && js_callback) {
+        napi_value args[2], undefined;
+        napi_create_string_utf8(env, load_event->event == INFILE_EVENT_DRAIN ? "drain" : "progress", NAPI_AUTO_LENGTH, &args[0]);
+        napi_create_double(env, (double)load_event->bytes, &args[1]);
+        napi_get_undefined(env, &undefined);
+        napi_call_function(env, undefined, js_callback, 2, args, NULL);
+    }
 
-        return obj;
+    free(load_event);
+}
+
+static void load_handle_finalize(napi_env env, void *data, void *hint) {
+    infile_source_release((InfileSource *)data);
+}
+
+/** Read the load handle passed as a JS argument */
+static InfileSource *get_load_handle(napi_env env, napi_value value) {
+    bool is_load = false;
+    void *data = NULL;
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+    if (type != napi_external || napi_check_object_type_tag(env, value, &LOAD_TAG, &is_load) != napi_ok || !is_load ||
+        napi_get_value_external(env, value, &data) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected a load handle");
+        return NULL;
     }
+    return (InfileSource *)data;
+}
 
-    napi_throw_error(env, NULL, mysql_error(conn));
-    napi_get_undefined(env, &result);
+static void load_execute(PeekTask *task) {
+    LoadTask *load = (LoadTask *)task;
 
-    //? Step 3: Return connection to the pool
-    pool_return_connection(pool, conn);
+    PoolConnection *pooled = pool_get_connection(load->pool);
+    if (!pooled) {
+        load->bytes = infile_source_finish(load->source);
+        task_fail(task, "Could not get database connection from pool");
+        return;
+    }
 
-    return result;
+    task->failed = !infile_load(pooled, load->query, load->source, &load->affected_rows, &load->warnings, task->error,
+                                sizeof(task->error));
+    load->bytes = load->source->bytes_sent;
+
+    pool_return_connection(load->pool, pooled);
+
+    if (load->cache) {
+        result_cache_invalidate(load->cache, load->query);
+    }
+    if (load->router) {
+        router_note_write(load->router);
+    }
 }
 
-/** Function to Bulk Insert Data into MySQL */
-napi_value BulkInsert(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1], result;
+static napi_value load_complete(napi_env env, PeekTask *task) {
+    LoadTask *load = (LoadTask *)task;
+
+    napi_value obj, value;
+    napi_create_object(env, &obj);
+
+    napi_create_int64(env, (int64_t)load->affected_rows, &value);
+    napi_set_named_property(env, obj, "affectedRows", value);
+
+    napi_create_uint32(env, load->warnings, &value);
+    napi_set_named_property(env, obj, "warnings", value);
+
+    napi_create_double(env, (double)load->bytes, &value);
+    napi_set_named_property(env, obj, "bytes", value);
+
+    return obj;
+}
+
+static void load_destroy(PeekTask *task) {
+    LoadTask *load = (LoadTask *)task;
+    if (load->events) {
+        napi_release_threadsafe_function(load->events, napi_tsfn_release);
+    }
+    if (load->source) {
+        infile_source_release(load->source);
+    }
+    free(load->query);
+    shared_pool_release(load->shared);
+    free(load);
+}
+
+/**
+ * Function to start a LOAD DATA LOCAL INFILE fed from memory
+ * - Returns `{ handle, done }`: write file data to `handle`, `done` settles with the load result
+ * @example
+ * const { handle, done } = loadData("LOAD DATA LOCAL INFILE 'peek' INTO TABLE devices", (event, bytes) => {});
+ * loadWrite(handle, Buffer.from('1\tdevice 1\n'));
+ * loadEnd(handle);
+ * await done;
+ */
+napi_value LoadData(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, NULL, NULL);
 
-    if (argc < 1) {
-        napi_throw_error(env, NULL, "Expected 1 argument: query");
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected 2 arguments: query, onEvent");
         return NULL;
     }
 
-    char query[16384];
-    napi_get_value_string_utf8(env, args[0], query, sizeof(query), NULL);
-
-    if (!pool) {
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
         napi_throw_error(env, NULL, "Database not initialized");
         return NULL;
     }
 
-    MYSQL *conn = pool_get_connection(pool);
-    if (!conn) {
-        napi_throw_error(env, NULL, "Could not get database connection from pool");
+    if (!shared->pool->options.local_infile) {
+        napi_throw_error(env, NULL, "LOAD DATA LOCAL INFILE is disabled, enable the localInfile pool option");
         return NULL;
     }
 
-    if (mysql_query(conn, query) == 0) {
-        my_ulonglong affected_rows = mysql_affected_rows(conn);
-        my_ulonglong last_id = mysql_insert_id(conn);
+    napi_valuetype type;
+    napi_typeof(env, args[1], &type);
+    if (type != napi_function) {
+        napi_throw_type_error(env, NULL, "Expected onEvent to be a function");
+        return NULL;
+    }
 
-        napi_value obj;
-        napi_create_object(env, &obj);
+    LoadTask *load = (LoadTask *)calloc(1, sizeof(LoadTask));
+    if (!load) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
 
-        napi_value affected_rows_value;
-        napi_create_int64(env, (int64_t)affected_rows, &affected_rows_value);
-        napi_set_named_property(env, obj, "affectedRows", affected_rows_value);
+    if (!(load->query = params_get_string(env, args[0], NULL))) {
+        free(load);
+        napi_throw_type_error(env, NULL, "Expected query to be a string");
+        return NULL;
+    }
 
-        napi_value insert_id_value;
-        napi_create_int64(env, (int64_t)last_id, &insert_id_value);
-        napi_set_named_property(env, obj, "insertId", insert_id_value);
+    //? Step 1: Event channel from the loading thread back to JS
+    napi_value resource_name;
+    napi_create_string_utf8(env, "peek:load_events", NAPI_AUTO_LENGTH, &resource_name);
+    if (napi_create_threadsafe_function(env, args[1], NULL, resource_name, 0, 1, NULL, NULL, NULL, load_call_js,
+                                        &load->events) != napi_ok) {
+        free(load->query);
+        free(load);
+        napi_throw_error(env, NULL, "Failed to create load event channel");
+        return NULL;
+    }
 
-        pool_return_connection(pool, conn);
-        return obj;
+    //? Step 2: Shared source, one reference for the task and one for the JS handle
+    load->source = infile_source_create(load_notify, load->events);
+    napi_value handle;
+    if (!load->source || napi_create_external(env, load->source, load_handle_finalize, NULL, &handle) != napi_ok) {
+        load_destroy(&load->base);
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+    infile_source_retain(load->source);
+    napi_type_tag_object(env, handle, &LOAD_TAG);
+
+    load->base.execute = load_execute;
+    load->base.complete = load_complete;
+    load->base.destroy = load_destroy;
+    load->base.op = METRIC_OP_LOAD;
+    load->pool = shared->pool;
+    load->router = shared->router;
+    load->cache = shared->result_cache;
+    load->shared = shared_pool_retain(shared);
+
+    //? Step 3: Start the load, it waits for data on the connection
+    napi_value done = task_queue(env, "peek:load", &load->base);
+    if (!done) {
+        return NULL;
+    }
+
+    napi_value result;
+    napi_create_object(env, &result);
+    napi_set_named_property(env, result, "handle", handle);
+    napi_set_named_property(env, result, "done", done);
+    return result;
+}
+
+/** Function to write a chunk of file data, returns false when the caller should wait for a drain event */
+napi_value LoadWrite(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected 2 arguments: handle, chunk");
+        return NULL;
+    }
+
+    InfileSource *source = get_load_handle(env, args[0]);
+    if (!source) {
+        return NULL;
+    }
+
+    bool is_buffer = false, below_high_water = true;
+    napi_is_buffer(env, args[1], &is_buffer);
+
+    if (is_buffer) {
+        void *data;
+        size_t length;
+        napi_get_buffer_info(env, args[1], &data, &length);
+        below_high_water = infile_source_write(source, (const char *)data, length);
+    } else {
+        size_t length;
+        char *data = params_get_string(env, args[1], &length);
+        if (!data) {
+            napi_throw_type_error(env, NULL, "Expected chunk to be a Buffer or a string");
+            return NULL;
+        }
+        below_high_water = infile_source_write(source, data, length);
+        free(data);
+    }
+
+    napi_value result;
+    napi_get_boolean(env, below_high_water, &result);
+    return result;
+}
+
+/** Function to mark the end of the file data */
+napi_value LoadEnd(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    InfileSource *source = argc > 0 ? get_load_handle(env, args[0]) : NULL;
+    if (!source) {
+        if (argc == 0) {
+            napi_throw_error(env, NULL, "Expected 1 argument: handle");
+        }
+        return NULL;
+    }
+
+    infile_source_end(source);
+    return NULL;
+}
+
+/** Function to abort a load, the server rejects the statement with the given message */
+napi_value LoadAbort(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    InfileSource *source = argc > 0 ? get_load_handle(env, args[0]) : NULL;
+    if (!source) {
+        if (argc == 0) {
+            napi_throw_error(env, NULL, "Expected 1 argument: handle");
+        }
+        return NULL;
     }
 
-    const char *error_msg = mysql_error(conn);
-    pool_return_connection(pool, conn);
-    napi_throw_error(env, NULL, error_msg);
+    char *message = argc > 1 ? params_get_string(env, args[1], NULL) : NULL;
+    infile_source_abort(source, message);
+    free(message);
     return NULL;
 }
 
 // =========================== TRIGGERS ===========================
 
+/** Trigger task */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs
+    ConnectionPool *pool;
+    char *drop_query;
+    char *create_query;
+} TriggerTask;
+
+static void trigger_execute(PeekTask *task) {
+    TriggerTask *trigger = (TriggerTask *)task;
+
+    // Get connection from pool
+    PoolConnection *pooled = pool_get_connection(trigger->pool);
+    if (!pooled) {
+        task_fail(task, "Could not get database connection from pool");
+        return;
+    }
+    MYSQL *connection = pooled->connection;
+
+    // Drop existing trigger if it exists, then create the new one
+    if (peek_driver->query(connection, trigger->drop_query) || peek_driver->query(connection, trigger->create_query)) {
+        task_fail(task, peek_driver->error(connection));
+    }
+
+    pool_return_connection(trigger->pool, pooled);
+}
+
+static napi_value trigger_complete(napi_env env, PeekTask *task) {
+    napi_value result;
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+static void trigger_destroy(PeekTask *task) {
+    TriggerTask *trigger = (TriggerTask *)task;
+    free(trigger->drop_query);
+    free(trigger->create_query);
+    shared_pool_release(trigger->shared);
+    free(trigger);
+}
+
 /** Function to Create Trigger
  * @example
  * createTrigger(
@@ -589,58 +1701,1552 @@ napi_value CreateTrigger(napi_env env, napi_callback_info info) {
         return NULL;
     }
 
-    char trigger_name[256];
-    char table_name[256];
-    char trigger_time[16];
-    char trigger_body[4096];
-
-    napi_get_value_string_utf8(env, args[0], trigger_name, sizeof(trigger_name), NULL);
-    napi_get_value_string_utf8(env, args[1], table_name, sizeof(table_name), NULL);
-    napi_get_value_string_utf8(env, args[2], trigger_time, sizeof(trigger_time), NULL);
-    napi_get_value_string_utf8(env, args[3], trigger_body, sizeof(trigger_body), NULL);
-
-    if (!pool) {
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
         napi_throw_error(env, NULL, "Database not initialized");
         return NULL;
     }
 
-    // Get connection from pool
-    MYSQL *conn = pool_get_connection(pool);
-    if (!conn) {
-        napi_throw_error(env, NULL, "Could not get database connection from pool");
-        return NULL;
+    char *trigger_name = params_get_string(env, args[0], NULL);
+    char *table_name = params_get_string(env, args[1], NULL);
+    char *trigger_time = params_get_string(env, args[2], NULL);
+    char *trigger_body = params_get_string(env, args[3], NULL);
+    TriggerTask *trigger = NULL;
+
+    if (!trigger_name || !table_name || !trigger_time || !trigger_body) {
+        napi_throw_type_error(env, NULL, "Expected triggerName, tableName, triggerTime and triggerBody to be strings");
+        goto fail;
+    }
+
+    trigger = (TriggerTask *)calloc(1, sizeof(TriggerTask));
+    if (!trigger ||
+        !(trigger->drop_query = format_query("DROP TRIGGER IF EXISTS %s", trigger_name)) ||
+        !(trigger->create_query = format_query("CREATE TRIGGER %s " // trigger name
+                                               "%s INSERT ON %s "   // BEFORE/AFTER + table name
+                                               "FOR EACH ROW "
+                                               "%s", // trigger body
+                                               trigger_name, trigger_time, table_name, trigger_body))) {
+        napi_throw_error(env, NULL, "Out of memory");
+        goto fail;
+    }
+
+    free(trigger_name);
+    free(table_name);
+    free(trigger_time);
+    free(trigger_body);
+
+    trigger->base.execute = trigger_execute;
+    trigger->base.complete = trigger_complete;
+    trigger->base.destroy = trigger_destroy;
+    trigger->pool = shared->pool;
+    trigger->shared = shared_pool_retain(shared);
+
+    return task_queue(env, "peek:create_trigger", &trigger->base);
+
+fail:
+    if (trigger) {
+        free(trigger->drop_query);
+        free(trigger->create_query);
+        free(trigger);
+    }
+    free(trigger_name);
+    free(table_name);
+    free(trigger_time);
+    free(trigger_body);
+    return NULL;
+}
+
+// =========================== STREAMS ===========================
+
+/** Tags stream handles, so `streamNext` and `streamClose` reject any other external */
+static const napi_type_tag STREAM_TAG = {0x7065656b2d737472ULL, 0x65616d2d68616e64ULL};
+
+/**
+ * JS side handle of a stream
+ * - `busy` while a batch is fetched on a worker thread, which then owns the stream
+ * - Closing or collecting a busy handle is deferred until its fetch completes
+ */
+typedef struct {
+    PeekStream *stream;
+    SharedPool *shared; // Referenced until the stream is freed, it returns its connection to the pool
+    bool busy;
+    bool close_requested;
+    bool finalized;
+} StreamHandle;
+
+/** Stream open task */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs, then by the stream handle
+    ConnectionPool *pool;
+    char *query;
+    PeekParams params;
+    size_t batch_size;
+    PeekStream *stream;
+} StreamOpenTask;
+
+/** Stream fetch task */
+typedef struct {
+    PeekTask base;
+    StreamHandle *handle;
+    PeekResult *result;
+} StreamFetchTask;
+
+/** Release the stream of a handle and free the handle once JS no longer references it */
+static void stream_handle_settle(StreamHandle *handle) {
+    if (handle->close_requested || handle->finalized) {
+        stream_free(handle->stream);
+        handle->stream = NULL;
+        shared_pool_release(handle->shared);
+        handle->shared = NULL;
     }
+    if (handle->finalized) {
+        free(handle);
+    }
+}
 
-    // Drop existing trigger if it exists
-    char drop_query[512];
-    snprintf(drop_query, sizeof(drop_query), "DROP TRIGGER IF EXISTS %s", trigger_name);
+static void stream_handle_finalize(napi_env env, void *data, void *hint) {
+    StreamHandle *handle = (StreamHandle *)data;
+    handle->finalized = true;
+    if (!handle->busy) {
+        stream_handle_settle(handle);
+    }
+}
 
-    if (mysql_query(conn, drop_query)) {
-        const char *error_msg = mysql_error(conn);
-        pool_return_connection(pool, conn);
-        napi_throw_error(env, NULL, error_msg);
+/** Read the stream handle passed as a JS argument */
+static StreamHandle *get_stream_handle(napi_env env, napi_value value) {
+    bool is_stream = false;
+    void *data = NULL;
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+    if (type != napi_external || napi_check_object_type_tag(env, value, &STREAM_TAG, &is_stream) != napi_ok || !is_stream ||
+        napi_get_value_external(env, value, &data) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected a stream handle");
         return NULL;
     }
+    return (StreamHandle *)data;
+}
+
+static void stream_open_execute(PeekTask *task) {
+    StreamOpenTask *open = (StreamOpenTask *)task;
+    open->stream = stream_open(open->pool, open->query, &open->params, open->batch_size, task->error, sizeof(task->error));
+    task->failed = open->stream == NULL;
+}
 
-    // Create new trigger
-    char create_query[8192];
-    snprintf(create_query, sizeof(create_query),
-             "CREATE TRIGGER %s " // trigger name
-             "%s INSERT ON %s "   // BEFORE/AFTER + table name
-             "FOR EACH ROW "
-             "%s", // trigger body
-             trigger_name, trigger_time, table_name, trigger_body);
+static napi_value stream_open_complete(napi_env env, PeekTask *task) {
+    StreamOpenTask *open = (StreamOpenTask *)task;
 
-    if (mysql_query(conn, create_query)) {
-        const char *error_msg = mysql_error(conn);
-        pool_return_connection(pool, conn);
-        napi_throw_error(env, NULL, error_msg);
+    StreamHandle *handle = (StreamHandle *)calloc(1, sizeof(StreamHandle));
+    if (!handle) {
+        napi_throw_error(env, NULL, "Out of memory");
         return NULL;
     }
 
-    pool_return_connection(pool, conn);
+    napi_value external;
+    if (napi_create_external(env, handle, stream_handle_finalize, NULL, &external) != napi_ok) {
+        free(handle);
+        napi_throw_error(env, NULL, "Failed to create stream handle");
+        return NULL;
+    }
+    napi_type_tag_object(env, external, &STREAM_TAG);
+
+    // The handle owns the stream and its reference to the shared pool from now on
+    handle->stream = open->stream;
+    handle->shared = open->shared;
+    open->stream = NULL;
+    open->shared = NULL;
+    return external;
+}
 
-    napi_value result;
-    napi_get_boolean(env, true, &result);
+static void stream_open_destroy(PeekTask *task) {
+    StreamOpenTask *open = (StreamOpenTask *)task;
+    stream_free(open->stream);
+    params_free(&open->params);
+    free(open->query);
+    shared_pool_release(open->shared);
+    free(open);
+}
+
+static void stream_fetch_execute(PeekTask *task) {
+    StreamFetchTask *fetch = (StreamFetchTask *)task;
+    fetch->result = stream_fetch(fetch->handle->stream, task->error, sizeof(task->error));
+    task->failed = fetch->result == NULL;
+    record_rows(METRIC_OP_STREAM, fetch->result);
+}
+
+static napi_value stream_fetch_complete(napi_env env, PeekTask *task) {
+    return result_to_js(env, ((StreamFetchTask *)task)->result);
+}
+
+static void stream_fetch_destroy(PeekTask *task) {
+    StreamFetchTask *fetch = (StreamFetchTask *)task;
+    fetch->handle->busy = false;
+    stream_handle_settle(fetch->handle);
+    result_free(fetch->result);
+    free(fetch);
+}
+
+/**
+ * Function to open a streaming Select
+ * @example
+ * const handle = await selectStream('SELECT * FROM big_table WHERE id > ?', [10], 500);
+ */
+napi_value SelectStream(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected 1 argument: query");
+        return NULL;
+    }
+
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
+        napi_throw_error(env, NULL, "Database not initialized");
+        return NULL;
+    }
+
+    int batch_size = DEFAULT_STREAM_BATCH_SIZE;
+    if (argc > 2) {
+        napi_valuetype type;
+        napi_typeof(env, args[2], &type);
+        if (type == napi_number) {
+            napi_get_value_int32(env, args[2], &batch_size);
+        }
+    }
+    if (batch_size < 1) {
+        napi_throw_range_error(env, NULL, "Invalid batch size: expected batchSize >= 1");
+        return NULL;
+    }
+
+    StreamOpenTask *open = (StreamOpenTask *)calloc(1, sizeof(StreamOpenTask));
+    if (!open) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    if (!(open->query = params_get_string(env, args[0], NULL))) {
+        free(open);
+        napi_throw_type_error(env, NULL, "Expected query to be a string");
+        return NULL;
+    }
+
+    if (argc > 1 && !params_from_js(env, args[1], &open->params)) {
+        free(open->query);
+        free(open);
+        return NULL;
+    }
+
+    open->base.execute = stream_open_execute;
+    open->base.complete = stream_open_complete;
+    open->base.destroy = stream_open_destroy;
+    open->base.op = METRIC_OP_STREAM;
+    open->pool = shared->pool;
+    open->batch_size = (size_t)batch_size;
+    open->shared = shared_pool_retain(shared);
+
+    return task_queue(env, "peek:select_stream", &open->base);
+}
+
+/** Function to fetch the next batch of a stream, resolves with an empty array once it is exhausted */
+napi_value StreamNext(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected 1 argument: handle");
+        return NULL;
+    }
+
+    StreamHandle *handle = get_stream_handle(env, args[0]);
+    if (!handle) {
+        return NULL;
+    }
+
+    if (handle->busy) {
+        napi_throw_error(env, NULL, "A batch of this stream is already being fetched");
+        return NULL;
+    }
+
+    // Exhausted, failed or closed: nothing left to fetch
+    if (!handle->stream || !handle->stream->reader) {
+        napi_deferred deferred;
+        napi_value promise, empty;
+        napi_create_promise(env, &deferred, &promise);
+        napi_create_array(env, &empty);
+        napi_resolve_deferred(env, deferred, empty);
+        return promise;
+    }
+
+    StreamFetchTask *fetch = (StreamFetchTask *)calloc(1, sizeof(StreamFetchTask));
+    if (!fetch) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    fetch->base.execute = stream_fetch_execute;
+    fetch->base.complete = stream_fetch_complete;
+    fetch->base.destroy = stream_fetch_destroy;
+    fetch->base.op = METRIC_OP_STREAM;
+    fetch->handle = handle;
+    handle->busy = true;
+
+    return task_queue(env, "peek:stream_next", &fetch->base);
+}
+
+/** Function to close a stream and return its connection to the pool */
+napi_value StreamClose(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected 1 argument: handle");
+        return NULL;
+    }
+
+    StreamHandle *handle = get_stream_handle(env, args[0]);
+    if (!handle) {
+        return NULL;
+    }
+
+    handle->close_requested = true;
+    if (!handle->busy) {
+        stream_handle_settle(handle);
+    }
+
+    napi_value result;
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+// =========================== TRANSACTIONS ===========================
+
+/** Tags transaction handles */
+static const napi_type_tag TRANSACTION_TAG = {0x7065656b2d747261ULL, 0x6e73616374696f6eULL};
+
+/**
+ * JS side handle of a transaction
+ * - `busy` while a batch or select runs on a worker thread, which then owns the transaction
+ * - A collected handle rolls back a transaction that was never ended, once its running task completes
+ */
+typedef struct {
+    PeekTransaction *tx;
+    SharedPool *shared; // Referenced until the transaction is freed, it returns its connection to the pool
+    bool busy;
+    bool finalized;
+} TransactionHandle;
+
+/** Transaction begin task */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs, then by the transaction handle
+    ConnectionPool *pool;
+    PeekTransaction *tx;
+} TxBeginTask;
+
+/** Transaction batch task */
+typedef struct {
+    PeekTask base;
+    TransactionHandle *handle;
+    SqlStatement *statements;
+    size_t count;
+    TxEnd end;
+    TxStatementResult *results;
+    ReplicaRouter *router;
+    ResultCache *cache; // Invalidated as a whole on commit
+} TxExecuteTask;
+
+/** Transaction select task */
+typedef struct {
+    PeekTask base;
+    TransactionHandle *handle;
+    char *query;
+    PeekParams params;
+    PeekResult *result;
+} TxSelectTask;
+
+/** Free the handle once JS no longer references it and no task uses it */
+static void transaction_handle_settle(TransactionHandle *handle) {
+    if (handle->finalized && !handle->busy) {
+        transaction_free(handle->tx);
+        shared_pool_release(handle->shared);
+        free(handle);
+    }
+}
+
+static void transaction_handle_finalize(napi_env env, void *data, void *hint) {
+    TransactionHandle *handle = (TransactionHandle *)data;
+    handle->finalized = true;
+    transaction_handle_settle(handle);
+}
+
+/** Read the transaction handle passed as a JS argument and mark it busy */
+static TransactionHandle *claim_transaction_handle(napi_env env, napi_value value) {
+    bool is_transaction = false;
+    void *data = NULL;
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+    if (type != napi_external || napi_check_object_type_tag(env, value, &TRANSACTION_TAG, &is_transaction) != napi_ok ||
+        !is_transaction || napi_get_value_external(env, value, &data) != napi_ok) {
+        napi_throw_type_error(env, NULL, "Expected a transaction handle");
+        return NULL;
+    }
+
+    TransactionHandle *handle = (TransactionHandle *)data;
+    if (handle->busy) {
+        napi_throw_error(env, NULL, "Another statement of this transaction is still running");
+        return NULL;
+    }
+    handle->busy = true;
+    return handle;
+}
+
+static void tx_begin_execute(PeekTask *task) {
+    TxBeginTask *begin = (TxBeginTask *)task;
+    begin->tx = transaction_begin(begin->pool, task->error, sizeof(task->error));
+    task->failed = begin->tx == NULL;
+}
+
+static napi_value tx_begin_complete(napi_env env, PeekTask *task) {
+    TxBeginTask *begin = (TxBeginTask *)task;
+
+    TransactionHandle *handle = (TransactionHandle *)calloc(1, sizeof(TransactionHandle));
+    if (!handle) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    napi_value external;
+    if (napi_create_external(env, handle, transaction_handle_finalize, NULL, &external) != napi_ok) {
+        free(handle);
+        napi_throw_error(env, NULL, "Failed to create transaction handle");
+        return NULL;
+    }
+    napi_type_tag_object(env, external, &TRANSACTION_TAG);
+
+    // The handle owns the transaction and its reference to the shared pool from now on
+    handle->tx = begin->tx;
+    handle->shared = begin->shared;
+    begin->tx = NULL;
+    begin->shared = NULL;
+    return external;
+}
+
+static void tx_begin_destroy(PeekTask *task) {
+    TxBeginTask *begin = (TxBeginTask *)task;
+    transaction_free(begin->tx);
+    shared_pool_release(begin->shared);
+    free(begin);
+}
+
+static void tx_execute_execute(PeekTask *task) {
+    TxExecuteTask *batch = (TxExecuteTask *)task;
+    task->failed = !transaction_execute(batch->handle->tx, batch->statements, batch->count, batch->end, batch->results,
+                                        task->error, sizeof(task->error));
+
+    // Writes of earlier batches are only visible from the commit on, and their tables are not tracked
+    if (batch->cache && batch->end == TX_END_COMMIT) {
+        result_cache_invalidate_table(batch->cache, NULL);
+    }
+    if (batch->router && batch->end == TX_END_COMMIT) {
+        router_note_write(batch->router);
+    }
+}
+
+static napi_value tx_execute_complete(napi_env env, PeekTask *task) {
+    TxExecuteTask *batch = (TxExecuteTask *)task;
+
+    napi_value array;
+    napi_create_array_with_length(env, batch->count, &array);
+
+    for (size_t i = 0; i < batch->count; i++) {
+        napi_value obj, value;
+        napi_create_object(env, &obj);
+
+        napi_create_int64(env, (int64_t)batch->results[i].affected_rows, &value);
+        napi_set_named_property(env, obj, "affectedRows", value);
+
+        napi_create_int64(env, (int64_t)batch->results[i].insert_id, &value);
+        napi_set_named_property(env, obj, "insertId", value);
+
+        napi_set_element(env, array, (uint32_t)i, obj);
+    }
+
+    return array;
+}
+
+static void tx_execute_destroy(PeekTask *task) {
+    TxExecuteTask *batch = (TxExecuteTask *)task;
+    batch->handle->busy = false;
+    transaction_handle_settle(batch->handle);
+    sql_statements_free(batch->statements, batch->count);
+    free(batch->results);
+    free(batch);
+}
+
+static void tx_select_execute(PeekTask *task) {
+    TxSelectTask *select = (TxSelectTask *)task;
+    select->result = transaction_select(select->handle->tx, select->query, &select->params, task->error, sizeof(task->error));
+    task->failed = select->result == NULL;
+    record_rows(METRIC_OP_TRANSACTION, select->result);
+}
+
+static napi_value tx_select_complete(napi_env env, PeekTask *task) {
+    return result_to_js(env, ((TxSelectTask *)task)->result);
+}
+
+static void tx_select_destroy(PeekTask *task) {
+    TxSelectTask *select = (TxSelectTask *)task;
+    select->handle->busy = false;
+    transaction_handle_settle(select->handle);
+    result_free(select->result);
+    params_free(&select->params);
+    free(select->query);
+    free(select);
+}
+
+/** Copy a JS array of `[query, params]` pairs into statements */
+static bool statements_from_js(napi_env env, napi_value array, SqlStatement **statements, uint32_t *count) {
+    bool is_array = false;
+    napi_is_array(env, array, &is_array);
+    if (!is_array) {
+        napi_throw_type_error(env, NULL, "Expected statements to be an array");
+        return false;
+    }
+
+    napi_get_array_length(env, array, count);
+    *statements = (SqlStatement *)calloc(*count > 0 ? *count : 1, sizeof(SqlStatement));
+    if (!*statements) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < *count; i++) {
+        napi_value pair, query, params;
+        bool is_pair = false;
+        napi_get_element(env, array, i, &pair);
+        napi_is_array(env, pair, &is_pair);
+        if (!is_pair) {
+            napi_throw_type_error(env, NULL, "Expected each statement to be a [query, params] pair");
+            goto fail;
+        }
+
+        napi_get_element(env, pair, 0, &query);
+        napi_get_element(env, pair, 1, &params);
+        if (!((*statements)[i].query = params_get_string(env, query, NULL))) {
+            napi_throw_type_error(env, NULL, "Expected query to be a string");
+            goto fail;
+        }
+        if (!params_from_js(env, params, &(*statements)[i].params)) {
+            goto fail;
+        }
+    }
+    return true;
+
+fail:
+    sql_statements_free(*statements, *count);
+    *statements = NULL;
+    return false;
+}
+
+/**
+ * Function to begin a transaction, resolves with a handle pinning one pooled connection
+ * @example
+ * const handle = await transactionBegin();
+ */
+napi_value TransactionBegin(napi_env env, napi_callback_info info) {
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
+        napi_throw_error(env, NULL, "Database not initialized");
+        return NULL;
+    }
+
+    TxBeginTask *begin = (TxBeginTask *)calloc(1, sizeof(TxBeginTask));
+    if (!begin) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    begin->base.execute = tx_begin_execute;
+    begin->base.complete = tx_begin_complete;
+    begin->base.destroy = tx_begin_destroy;
+    begin->base.op = METRIC_OP_TRANSACTION;
+    begin->pool = shared->pool;
+    begin->shared = shared_pool_retain(shared);
+
+    return task_queue(env, "peek:transaction_begin", &begin->base);
+}
+
+/**
+ * Function to run queued writes of a transaction in one round trip, optionally ending it
+ * @example
+ * const results = await transactionExecute(handle, [['INSERT INTO devices (name) VALUES (?)', ['device 1']]], 'commit');
+ */
+napi_value TransactionExecute(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected 2 arguments: handle, statements");
+        return NULL;
+    }
+
+    TxEnd end = TX_END_NONE;
+    if (argc > 2) {
+        char *mode = params_get_string(env, args[2], NULL);
+        if (mode) {
+            if (strcmp(mode, "commit") == 0) {
+                end = TX_END_COMMIT;
+            } else if (strcmp(mode, "rollback") == 0) {
+                end = TX_END_ROLLBACK;
+            }
+            free(mode);
+        }
+    }
+
+    TxExecuteTask *batch = (TxExecuteTask *)calloc(1, sizeof(TxExecuteTask));
+    if (!batch) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    uint32_t count = 0;
+    if (!statements_from_js(env, args[1], &batch->statements, &count)) {
+        free(batch);
+        return NULL;
+    }
+    batch->count = count;
+    batch->end = end;
+
+    if (!(batch->results = (TxStatementResult *)calloc(count > 0 ? count : 1, sizeof(TxStatementResult)))) {
+        sql_statements_free(batch->statements, batch->count);
+        free(batch);
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    if (!(batch->handle = claim_transaction_handle(env, args[0]))) {
+        sql_statements_free(batch->statements, batch->count);
+        free(batch->results);
+        free(batch);
+        return NULL;
+    }
+
+    // The transaction holds a connection of the primary, its writes are noted on the shared pool it began on
+    batch->router = batch->handle->shared->router;
+    batch->cache = batch->handle->shared->result_cache;
+
+    batch->base.execute = tx_execute_execute;
+    batch->base.complete = tx_execute_complete;
+    batch->base.destroy = tx_execute_destroy;
+    batch->base.op = METRIC_OP_TRANSACTION;
+
+    return task_queue(env, "peek:transaction_execute", &batch->base);
+}
+
+/**
+ * Function to run a select inside a transaction
+ * @example
+ * const rows = await transactionSelect(handle, 'SELECT * FROM devices WHERE id = ?', [1]);
+ */
+napi_value TransactionSelect(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected 2 arguments: handle, query");
+        return NULL;
+    }
+
+    TxSelectTask *select = (TxSelectTask *)calloc(1, sizeof(TxSelectTask));
+    if (!select) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    if (!(select->query = params_get_string(env, args[1], NULL))) {
+        free(select);
+        napi_throw_type_error(env, NULL, "Expected query to be a string");
+        return NULL;
+    }
+
+    if ((argc > 2 && !params_from_js(env, args[2], &select->params)) ||
+        !(select->handle = claim_transaction_handle(env, args[0]))) {
+        params_free(&select->params);
+        free(select->query);
+        free(select);
+        return NULL;
+    }
+
+    select->base.execute = tx_select_execute;
+    select->base.complete = tx_select_complete;
+    select->base.destroy = tx_select_destroy;
+    select->base.op = METRIC_OP_TRANSACTION;
+
+    return task_queue(env, "peek:transaction_select", &select->base);
+}
+
+// =========================== BATCH ===========================
+
+/** Batch task */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs
+    ConnectionPool *pool;
+    SqlStatement *statements;
+    size_t count;
+    PeekResult **results;
+} BatchTask;
+
+static void batch_execute(PeekTask *task) {
+    BatchTask *batch = (BatchTask *)task;
+    task->failed = !batch_query(batch->pool, batch->statements, batch->count, batch->results, task->error,
+                                sizeof(task->error));
+    for (size_t i = 0; i < batch->count; i++) {
+        record_rows(METRIC_OP_BATCH, batch->results[i]);
+    }
+}
+
+static napi_value batch_complete(napi_env env, PeekTask *task) {
+    BatchTask *batch = (BatchTask *)task;
+
+    napi_value array;
+    napi_create_array_with_length(env, batch->count, &array);
+    for (size_t i = 0; i < batch->count; i++) {
+        napi_set_element(env, array, (uint32_t)i, result_to_js(env, batch->results[i]));
+    }
+    return array;
+}
+
+static void batch_destroy(PeekTask *task) {
+    BatchTask *batch = (BatchTask *)task;
+    for (size_t i = 0; i < batch->count; i++) {
+        result_free(batch->results[i]);
+    }
+    free(batch->results);
+    sql_statements_free(batch->statements, batch->count);
+    shared_pool_release(batch->shared);
+    free(batch);
+}
+
+/**
+ * Function to run independent queries in one round trip, resolves with one array of rows per query
+ * @example
+ * const [devices, users] = await batchQuery([['SELECT * FROM devices WHERE id = ?', [1]], ['SELECT * FROM users', []]]);
+ */
+napi_value BatchQuery(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected 1 argument: queries");
+        return NULL;
+    }
+
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
+        napi_throw_error(env, NULL, "Database not initialized");
+        return NULL;
+    }
+
+    BatchTask *batch = (BatchTask *)calloc(1, sizeof(BatchTask));
+    if (!batch) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    uint32_t count = 0;
+    if (!statements_from_js(env, args[0], &batch->statements, &count)) {
+        free(batch);
+        return NULL;
+    }
+    batch->count = count;
+
+    if (!(batch->results = (PeekResult **)calloc(count > 0 ? count : 1, sizeof(PeekResult *)))) {
+        sql_statements_free(batch->statements, batch->count);
+        free(batch);
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    batch->base.execute = batch_execute;
+    batch->base.complete = batch_complete;
+    batch->base.destroy = batch_destroy;
+    batch->base.op = METRIC_OP_BATCH;
+    batch->pool = shared->pool;
+    batch->shared = shared_pool_retain(shared);
+
+    return task_queue(env, "peek:batch", &batch->base);
+}
+
+// =========================== SCHEMA SYNC ===========================
+
+/** Schema sync task */
+typedef struct {
+    PeekTask base;
+    SharedPool *shared; // Referenced while the task runs
+    ConnectionPool *pool;
+    ReplicaRouter *router;
+    ResultCache *cache;
+    SchemaTables tables;
+    ShardMap *shards;           // Set to sync the tables on every shard instead of the primary
+    SchemaTables *shard_tables; // One copy of the tables per shard, their outcomes fold into `tables`
+    int parallel;
+} SchemaSyncTask;
+
+/**
+ * Invalidate cached results of the tables a sync ran DDL on
+ * @return bool - Whether any DDL ran
+ */
+static bool schema_sync_invalidate(SchemaSyncTask *sync, const SchemaTables *tables) {
+    bool changed = false;
+    for (size_t i = 0; i < tables->count; i++) {
+        const SchemaTable *table = &tables->items[i];
+        if (!table->ddl || table->status == SCHEMA_PENDING) {
+            continue;
+        }
+        changed = true;
+        if (sync->cache) {
+            result_cache_invalidate_table(sync->cache, table->name);
+        }
+    }
+    return changed;
+}
+
+/** Fold the outcome of a table on one shard into the one reported, the furthest outcome wins, a failure first */
+static void schema_sync_fold(SchemaTable *reported, const SchemaTable *table, int shard) {
+    if (table->status <= reported->status) {
+        return;
+    }
+    reported->status = table->status;
+    reported->changes = table->changes;
+    reported->algorithm = table->algorithm;
+    if (table->status == SCHEMA_FAILED) {
+        snprintf(reported->error, sizeof(reported->error), "Shard %d: %s", shard, table->error);
+    }
+}
+
+static void schema_sync_execute(PeekTask *task) {
+    SchemaSyncTask *sync = (SchemaSyncTask *)task;
+
+    if (!sync->shards) {
+        task->failed = !schema_sync(sync->pool, &sync->tables, sync->parallel, task->error, sizeof(task->error));
+        if (schema_sync_invalidate(sync, &sync->tables) && sync->router) {
+            router_note_write(sync->router);
+        }
+        return;
+    }
+
+    //? Sharded tables: one shard after the other, stopping at the first shard that cannot be introspected
+    for (int i = 0; i < sync->shards->shard_count && !task->failed; i++) {
+        SchemaTables *tables = &sync->shard_tables[i];
+        char error[TASK_ERROR_SIZE];
+        if (!schema_sync(sync->shards->pools[i], tables, sync->parallel, error, sizeof(error))) {
+            snprintf(task->error, sizeof(task->error), "Shard %d: %s", i, error);
+            task->failed = true;
+        }
+        schema_sync_invalidate(sync, tables);
+        for (size_t t = 0; t < tables->count; t++) {
+            schema_sync_fold(&sync->tables.items[t], &tables->items[t], i);
+        }
+    }
+}
+
+static napi_value schema_sync_complete(napi_env env, PeekTask *task) {
+    SchemaSyncTask *sync = (SchemaSyncTask *)task;
+
+    napi_value array;
+    napi_create_array_with_length(env, sync->tables.count, &array);
+    for (size_t i = 0; i < sync->tables.count; i++) {
+        SchemaTable *table = &sync->tables.items[i];
+        napi_value obj, value;
+        napi_create_object(env, &obj);
+
+        napi_create_string_utf8(env, table->name, NAPI_AUTO_LENGTH, &value);
+        napi_set_named_property(env, obj, "name", value);
+
+        napi_create_string_utf8(env, schema_status_name(table->status), NAPI_AUTO_LENGTH, &value);
+        napi_set_named_property(env, obj, "status", value);
+
+        napi_create_uint32(env, (uint32_t)table->changes, &value);
+        napi_set_named_property(env, obj, "changes", value);
+
+        if (table->algorithm) {
+            napi_create_string_utf8(env, table->algorithm, NAPI_AUTO_LENGTH, &value);
+            napi_set_named_property(env, obj, "algorithm", value);
+        }
+
+        if (table->status == SCHEMA_FAILED) {
+            napi_create_string_utf8(env, table->error, NAPI_AUTO_LENGTH, &value);
+            napi_set_named_property(env, obj, "error", value);
+        }
+
+        napi_set_element(env, array, (uint32_t)i, obj);
+    }
+    return array;
+}
+
+static void schema_sync_destroy(PeekTask *task) {
+    SchemaSyncTask *sync = (SchemaSyncTask *)task;
+    schema_tables_free(&sync->tables);
+    for (int i = 0; sync->shard_tables && i < sync->shards->shard_count; i++) {
+        schema_tables_free(&sync->shard_tables[i]);
+    }
+    free(sync->shard_tables);
+    shared_pool_release(sync->shared);
+    free(sync);
+}
+
+/**
+ * Function to create and alter many tables at once, skipping the tables whose hash did not change since the last sync
+ * - With `{ shards: true }` the tables are synced on every shard instead of the primary, when there are shards
+ * @example
+ * const results = await syncSchema([{ name: 'devices', hash: 'ab12', columns: [{ name: 'id', definition: 'id INT PRIMARY KEY' }] }], { parallel: 4 });
+ */
+napi_value SyncSchema(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected 1 argument: tables");
+        return NULL;
+    }
+
+    SharedPool *shared = get_shared(env);
+    if (!shared) {
+        napi_throw_error(env, NULL, "Database not initialized");
+        return NULL;
+    }
+
+    int parallel = 4;
+    bool on_shards = false;
+    if (argc > 1) {
+        napi_valuetype type;
+        napi_typeof(env, args[1], &type);
+        if (type == napi_object) {
+            get_int_option(env, args[1], "parallel", &parallel);
+            get_bool_option(env, args[1], "shards", &on_shards);
+        }
+    }
+    if (parallel < 1) {
+        napi_throw_range_error(env, NULL, "Invalid parallel: expected parallel >= 1");
+        return NULL;
+    }
+
+    SchemaSyncTask *sync = (SchemaSyncTask *)calloc(1, sizeof(SchemaSyncTask));
+    if (!sync) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    if (!schema_tables_from_js(env, args[0], &sync->tables)) {
+        free(sync);
+        return NULL;
+    }
+
+    // Every shard syncs its own copy, the sync fills in what it found per table
+    ShardMap *shards = shared->shards;
+    if (on_shards && shards) {
+        sync->shards = shards;
+        if (!(sync->shard_tables = (SchemaTables *)calloc(shards->shard_count, sizeof(SchemaTables)))) {
+            schema_sync_destroy(&sync->base);
+            napi_throw_error(env, NULL, "Out of memory");
+            return NULL;
+        }
+        for (int i = 0; i < shards->shard_count; i++) {
+            if (!schema_tables_from_js(env, args[0], &sync->shard_tables[i])) {
+                schema_sync_destroy(&sync->base);
+                return NULL;
+            }
+        }
+    }
+
+    sync->base.execute = schema_sync_execute;
+    sync->base.complete = schema_sync_complete;
+    sync->base.destroy = schema_sync_destroy;
+    sync->pool = shared->pool;
+    sync->parallel = parallel;
+    sync->router = shared->router;
+    sync->cache = shared->result_cache;
+    sync->shared = shared_pool_retain(shared);
+
+    return task_queue(env, "peek:sync_schema", &sync->base);
+}
+
+// =========================== RESULT CACHE ===========================
+
+/** Set a named number property */
+static void set_number(napi_env env, napi_value obj, const char *key, double number) {
+    napi_value value;
+    napi_create_double(env, number, &value);
+    napi_set_named_property(env, obj, key, value);
+}
+
+/**
+ * Function to read the result cache statistics
+ * @example
+ * resultCacheStats(); // { enabled: true, hits: 10, misses: 2, evictions: 0, invalidations: 1, expirations: 0, entries: 1, bytes: 812 }
+ */
+napi_value GetResultCacheStats(napi_env env, napi_callback_info info) {
+    SharedPool *shared = get_shared(env);
+    ResultCache *result_cache = shared ? shared->result_cache : NULL;
+    ResultCacheStats stats = {0};
+    if (result_cache) {
+        result_cache_stats(result_cache, &stats);
+    }
+
+    napi_value obj, enabled;
+    napi_create_object(env, &obj);
+    napi_get_boolean(env, result_cache != NULL, &enabled);
+    napi_set_named_property(env, obj, "enabled", enabled);
+    set_number(env, obj, "hits", (double)stats.hits);
+    set_number(env, obj, "misses", (double)stats.misses);
+    set_number(env, obj, "evictions", (double)stats.evictions);
+    set_number(env, obj, "invalidations", (double)stats.invalidations);
+    set_number(env, obj, "expirations", (double)stats.expirations);
+    set_number(env, obj, "entries", (double)stats.entries);
+    set_number(env, obj, "bytes", (double)stats.bytes);
+    return obj;
+}
+
+/**
+ * Function to invalidate cached results, of one table or all of them
+ * @example
+ * resultCacheClear('devices');
+ * resultCacheClear();
+ */
+napi_value ClearResultCache(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    char *table = NULL;
+    if (argc > 0) {
+        napi_valuetype type;
+        napi_typeof(env, args[0], &type);
+        if (type != napi_undefined && type != napi_null && !(table = params_get_string(env, args[0], NULL))) {
+            napi_throw_type_error(env, NULL, "Expected table to be a string");
+            return NULL;
+        }
+    }
+
+    SharedPool *shared = get_shared(env);
+    ResultCache *result_cache = shared ? shared->result_cache : NULL;
+    if (result_cache) {
+        if (table) {
+            result_cache_invalidate_table(result_cache, table);
+        } else {
+            result_cache_clear(result_cache);
+        }
+    }
+    free(table);
+
+    napi_value result;
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+// =========================== REPLICAS ===========================
+
+/**
+ * Function to read the state of the read replicas
+ * @example
+ * replicaStatus(); // [{ host: 'replica-1', port: 3306, healthy: true, outstanding: 2, reads: 120, ejections: 0 }]
+ */
+napi_value GetReplicaStatus(napi_env env, napi_callback_info info) {
+    SharedPool *shared = get_shared(env);
+    ReplicaRouter *router = shared ? shared->router : NULL;
+    int count = router ? router->replica_count : 0;
+
+    napi_value array;
+    napi_create_array_with_length(env, (size_t)count, &array);
+    if (count == 0) {
+        return array;
+    }
+
+    ReplicaStatus *statuses = (ReplicaStatus *)calloc((size_t)count, sizeof(ReplicaStatus));
+    if (!statuses) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+    router_status(router, statuses);
+
+    for (int i = 0; i < count; i++) {
+        napi_value obj, value;
+        napi_create_object(env, &obj);
+        napi_create_string_utf8(env, statuses[i].host, NAPI_AUTO_LENGTH, &value);
+        napi_set_named_property(env, obj, "host", value);
+        set_number(env, obj, "port", statuses[i].port);
+        napi_get_boolean(env, statuses[i].healthy, &value);
+        napi_set_named_property(env, obj, "healthy", value);
+        set_number(env, obj, "outstanding", statuses[i].outstanding);
+        set_number(env, obj, "reads", (double)statuses[i].reads);
+        set_number(env, obj, "ejections", (double)statuses[i].ejections);
+        napi_set_element(env, array, (uint32_t)i, obj);
+    }
+
+    free(statuses);
+    return array;
+}
+
+// =========================== METRICS ===========================
+
+/** Latency summary of a histogram, in milliseconds */
+static napi_value histogram_to_js(napi_env env, const Histogram *histogram) {
+    napi_value obj;
+    napi_create_object(env, &obj);
+    set_number(env, obj, "count", (double)histogram->count);
+    set_number(env, obj, "mean", histogram->count ? (double)histogram->sum_us / (double)histogram->count / 1000.0 : 0);
+    set_number(env, obj, "p50", (double)histogram_quantile(histogram, 0.5) / 1000.0);
+    set_number(env, obj, "p90", (double)histogram_quantile(histogram, 0.9) / 1000.0);
+    set_number(env, obj, "p99", (double)histogram_quantile(histogram, 0.99) / 1000.0);
+    set_number(env, obj, "p999", (double)histogram_quantile(histogram, 0.999) / 1000.0);
+    set_number(env, obj, "max", (double)histogram->max_us / 1000.0);
+    return obj;
+}
+
+/**
+ * Function to read the performance metrics
+ * @example
+ * stats(); // { operations: { select: { count: 10, errors: 0, rows: 120, bytes: 4096, latency: { p50: 0.8, ... } }, ... }, pool: { ... } }
+ */
+napi_value GetStats(napi_env env, napi_callback_info info) {
+    MetricsCounters *snapshot = (MetricsCounters *)malloc(sizeof(MetricsCounters));
+    if (!snapshot) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+    metrics_snapshot(snapshot);
+
+    SharedPool *shared = get_shared(env);
+    PoolGauges gauges;
+    pool_gauges(shared ? shared->pool : NULL, &gauges);
+
+    napi_value obj, operations, pool_obj;
+    napi_create_object(env, &obj);
+    napi_create_object(env, &operations);
+    for (int op = METRIC_OP_NONE + 1; op < METRIC_OP_COUNT; op++) {
+        napi_value operation;
+        napi_create_object(env, &operation);
+        set_number(env, operation, "count", (double)snapshot->latency[op].count);
+        set_number(env, operation, "errors", (double)snapshot->errors[op]);
+        set_number(env, operation, "rows", (double)snapshot->rows[op]);
+        set_number(env, operation, "bytes", (double)snapshot->bytes[op]);
+        napi_set_named_property(env, operation, "latency", histogram_to_js(env, &snapshot->latency[op]));
+        napi_set_named_property(env, operations, metrics_op_name((MetricOp)op), operation);
+    }
+    napi_set_named_property(env, obj, "operations", operations);
+
+    napi_create_object(env, &pool_obj);
+    set_number(env, pool_obj, "open", gauges.open);
+    set_number(env, pool_obj, "idle", gauges.idle);
+    set_number(env, pool_obj, "inUse", gauges.in_use);
+    set_number(env, pool_obj, "waiting", gauges.waiting);
+    set_number(env, pool_obj, "maxSize", gauges.max_size);
+    napi_set_named_property(env, pool_obj, "acquireWait", histogram_to_js(env, &snapshot->acquire_wait));
+    set_number(env, pool_obj, "acquireFailures", (double)snapshot->acquire_failures);
+    set_number(env, pool_obj, "reconnects", (double)snapshot->reconnects);
+    set_number(env, pool_obj, "pings", (double)snapshot->pings);
+    napi_set_named_property(env, obj, "pool", pool_obj);
+
+    free(snapshot);
+    return obj;
+}
+
+/**
+ * Function to render the performance metrics in the Prometheus text format
+ * @example
+ * prometheusMetrics(); // '# HELP peek_operation_duration_seconds ...'
+ */
+napi_value GetPrometheusMetrics(napi_env env, napi_callback_info info) {
+    MetricsCounters *snapshot = (MetricsCounters *)malloc(sizeof(MetricsCounters));
+    if (!snapshot) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+    metrics_snapshot(snapshot);
+
+    SharedPool *shared = get_shared(env);
+    PoolGauges gauges;
+    pool_gauges(shared ? shared->pool : NULL, &gauges);
+
+    char *text = metrics_prometheus(snapshot, &gauges);
+    free(snapshot);
+    if (!text) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    napi_value result;
+    napi_create_string_utf8(env, text, NAPI_AUTO_LENGTH, &result);
+    free(text);
+    return result;
+}
+
+// =========================== SLOW QUERIES ===========================
+
+/** Array of the names of a comma separated list */
+static napi_value column_list_to_js(napi_env env, const char *list) {
+    napi_value array;
+    napi_create_array(env, &array);
+    uint32_t index = 0;
+    while (*list) {
+        size_t length = strcspn(list, ",");
+        napi_value name;
+        napi_create_string_utf8(env, list, length, &name);
+        napi_set_element(env, array, index++, name);
+        list += length + (list[length] == ',' ? 1 : 0);
+    }
+    return array;
+}
+
+/** Indexes of an advice, `name` only for the declared ones */
+static napi_value advice_to_js(napi_env env, const AdvisorAdvice *advice, int count) {
+    napi_value array;
+    napi_create_array_with_length(env, (size_t)count, &array);
+    for (int i = 0; i < count; i++) {
+        napi_value obj, value;
+        napi_create_object(env, &obj);
+        napi_create_string_utf8(env, advice[i].table, NAPI_AUTO_LENGTH, &value);
+        napi_set_named_property(env, obj, "table", value);
+        if (advice[i].name[0]) {
+            napi_create_string_utf8(env, advice[i].name, NAPI_AUTO_LENGTH, &value);
+            napi_set_named_property(env, obj, "name", value);
+        }
+        napi_set_named_property(env, obj, "columns", column_list_to_js(env, advice[i].columns));
+        napi_set_element(env, array, (uint32_t)i, obj);
+    }
+    return array;
+}
+
+/** Plan of a slow query */
+static napi_value plan_to_js(napi_env env, const SlowQueryPlan *plan) {
+    napi_value obj, value, tables;
+    napi_create_object(env, &obj);
+    napi_get_boolean(env, plan->full_scan, &value);
+    napi_set_named_property(env, obj, "fullScan", value);
+    napi_get_boolean(env, plan->filesort, &value);
+    napi_set_named_property(env, obj, "filesort", value);
+    napi_get_boolean(env, plan->temporary_table, &value);
+    napi_set_named_property(env, obj, "temporaryTable", value);
+    napi_set_named_property(env, obj, "orderColumns", column_list_to_js(env, plan->order_columns));
+
+    napi_create_array_with_length(env, (size_t)plan->table_count, &tables);
+    for (int i = 0; i < plan->table_count; i++) {
+        const SlowQueryTable *table = &plan->tables[i];
+        napi_value table_obj;
+        napi_create_object(env, &table_obj);
+        napi_create_string_utf8(env, table->table, NAPI_AUTO_LENGTH, &value);
+        napi_set_named_property(env, table_obj, "table", value);
+        napi_create_string_utf8(env, table->access_type, NAPI_AUTO_LENGTH, &value);
+        napi_set_named_property(env, table_obj, "access", value);
+        if (table->key[0]) {
+            napi_create_string_utf8(env, table->key, NAPI_AUTO_LENGTH, &value);
+            napi_set_named_property(env, table_obj, "key", value);
+        }
+        set_number(env, table_obj, "rows", (double)table->rows);
+        napi_set_named_property(env, table_obj, "filterColumns", column_list_to_js(env, table->columns));
+        napi_set_element(env, tables, (uint32_t)i, table_obj);
+    }
+    napi_set_named_property(env, obj, "tables", tables);
+    return obj;
+}
+
+/**
+ * Function to read the slow queries seen since `initialize` or the last reset, slowest total first
+ * @example
+ * slowQueryReport(); // { enabled: true, threshold: 100, dropped: 0, queries: [{ fingerprint: 'SELECT * FROM users WHERE email = ?', count: 3, ... }] }
+ */
+napi_value GetSlowQueryReport(napi_env env, napi_callback_info info) {
+    SharedPool *shared = get_shared(env);
+    SlowQueryAdvisor *advisor = shared ? shared->advisor : NULL;
+    SlowQueryReport *reports = NULL;
+    int count = 0;
+    uint64_t dropped = 0;
+    if (advisor && !advisor_report(advisor, &reports, &count, &dropped)) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    napi_value obj, value, queries;
+    napi_create_object(env, &obj);
+    napi_get_boolean(env, advisor != NULL, &value);
+    napi_set_named_property(env, obj, "enabled", value);
+    set_number(env, obj, "threshold", advisor ? (double)advisor->threshold_us / 1000.0 : 0);
+    set_number(env, obj, "dropped", (double)dropped);
+
+    napi_create_array_with_length(env, (size_t)count, &queries);
+    for (int i = 0; i < count; i++) {
+        const SlowQueryEntry *entry = &reports[i].entry;
+        napi_value query;
+        napi_create_object(env, &query);
+        napi_create_string_utf8(env, entry->fingerprint, NAPI_AUTO_LENGTH, &value);
+        napi_set_named_property(env, query, "fingerprint", value);
+        set_number(env, query, "count", (double)entry->count);
+        set_number(env, query, "totalTime", (double)entry->total_us / 1000.0);
+        set_number(env, query, "meanTime", (double)entry->total_us / (double)entry->count / 1000.0);
+        set_number(env, query, "maxTime", (double)entry->max_us / 1000.0);
+        if (entry->explained) {
+            napi_set_named_property(env, query, "plan", plan_to_js(env, &entry->plan));
+        }
+        if (entry->error[0]) {
+            napi_create_string_utf8(env, entry->error, NAPI_AUTO_LENGTH, &value);
+            napi_set_named_property(env, query, "explainError", value);
+        }
+        napi_set_named_property(env, query, "coveringIndexes", advice_to_js(env, reports[i].covering, reports[i].covering_count));
+        napi_set_named_property(env, query, "suggestedIndexes", advice_to_js(env, reports[i].suggested, reports[i].suggested_count));
+        napi_set_element(env, queries, (uint32_t)i, query);
+    }
+    napi_set_named_property(env, obj, "queries", queries);
+
+    advisor_reports_free(reports, count);
+    return obj;
+}
+
+/**
+ * Function to forget the slow queries seen so far, the declared indexes are kept
+ * @example
+ * slowQueryReset();
+ */
+napi_value ResetSlowQueries(napi_env env, napi_callback_info info) {
+    SharedPool *shared = get_shared(env);
+    if (shared && shared->advisor) {
+        advisor_reset(shared->advisor);
+    }
+
+    napi_value result;
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+/**
+ * Function to fingerprint a statement, the key slow selects are grouped by in `slowQueryReport`
+ * @return string - Statement with every literal and placeholder replaced by `?`
+ * @example
+ * const key = fingerprint('SELECT * FROM users WHERE id IN (1, 2, 3)'); // 'SELECT * FROM users WHERE id IN (?)'
+ */
+napi_value Fingerprint(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected 1 argument: query");
+        return NULL;
+    }
+
+    char *query = params_get_string(env, args[0], NULL);
+    if (!query) {
+        napi_throw_type_error(env, NULL, "Expected query to be a string");
+        return NULL;
+    }
+
+    char *fingerprint = advisor_fingerprint(query);
+    free(query);
+    if (!fingerprint) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    napi_value result;
+    napi_create_string_utf8(env, fingerprint, NAPI_AUTO_LENGTH, &result);
+    free(fingerprint);
+    return result;
+}
+
+/**
+ * Function to declare the indexes of the schemas, which slow queries are matched against
+ * - Tables skipped by the schema sync still declare theirs
+ * @example
+ * declareIndexes([{ table: 'users', name: 'idx_email', columns: 'email' }]);
+ */
+napi_value DeclareIndexes(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    bool is_array = false;
+    if (argc < 1 || napi_is_array(env, args[0], &is_array) != napi_ok || !is_array) {
+        napi_throw_type_error(env, NULL, "Expected indexes to be an array");
+        return NULL;
+    }
+
+    SharedPool *shared = get_shared(env);
+    SlowQueryAdvisor *advisor = shared ? shared->advisor : NULL;
+    uint32_t length = 0;
+    napi_get_array_length(env, args[0], &length);
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value index, table_value = NULL, name_value = NULL, columns_value = NULL;
+        napi_valuetype type = napi_undefined;
+        napi_get_element(env, args[0], i, &index);
+        napi_typeof(env, index, &type);
+        if (type != napi_object) {
+            napi_throw_type_error(env, NULL, "Expected every index to have a table, name and columns");
+            return NULL;
+        }
+        napi_get_named_property(env, index, "table", &table_value);
+        napi_get_named_property(env, index, "name", &name_value);
+        napi_get_named_property(env, index, "columns", &columns_value);
+
+        char *table = params_get_string(env, table_value, NULL);
+        char *name = params_get_string(env, name_value, NULL);
+        char *columns = params_get_string(env, columns_value, NULL);
+        bool valid = table && name && columns;
+        if (valid) {
+            advisor_register_index(advisor, table, name, columns);
+        }
+        free(table);
+        free(name);
+        free(columns);
+        if (!valid) {
+            napi_throw_type_error(env, NULL, "Expected every index to have a table, name and columns");
+            return NULL;
+        }
+    }
+
+    napi_value result;
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+// =========================== SHARDS ===========================
+
+/**
+ * Function to declare the shard keys of the schemas
+ * - Without the `shards` option the keys are ignored, every table stays on the primary
+ * @return boolean - Whether the keys were declared
+ * @example
+ * declareShardKeys([{ table: 'orders', column: 'customer_id', strategy: 'range', ranges: [1000000] }]);
+ */
+napi_value DeclareShardKeys(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    bool is_array = false;
+    if (argc < 1 || napi_is_array(env, args[0], &is_array) != napi_ok || !is_array) {
+        napi_throw_type_error(env, NULL, "Expected shard keys to be an array");
+        return NULL;
+    }
+
+    SharedPool *shared = get_shared(env);
+    ShardMap *shards = shared ? shared->shards : NULL;
+    uint32_t length = 0;
+    napi_get_array_length(env, args[0], &length);
+    for (uint32_t i = 0; shards && i < length; i++) {
+        napi_value key;
+        napi_valuetype type = napi_undefined;
+        napi_get_element(env, args[0], i, &key);
+        napi_typeof(env, key, &type);
+
+        //? Step 1: Table, column and strategy, hash by default
+        char *table = type == napi_object ? get_string_option(env, key, "table") : NULL;
+        char *column = type == napi_object ? get_string_option(env, key, "column") : NULL;
+        char *strategy = type == napi_object ? get_string_option(env, key, "strategy") : NULL;
+        bool valid = table && column && (!strategy || strcmp(strategy, "hash") == 0 || strcmp(strategy, "range") == 0);
+        bool range = valid && strategy && strcmp(strategy, "range") == 0;
+        free(strategy);
+
+        //? Step 2: Lower bounds of the shards after the first, for a range
+        double bounds[SHARD_LIMIT];
+        uint32_t bound_count = 0;
+        if (valid && range) {
+            napi_value ranges;
+            bool ranges_array = false;
+            napi_get_named_property(env, key, "ranges", &ranges);
+            napi_is_array(env, ranges, &ranges_array);
+            if (ranges_array) {
+                napi_get_array_length(env, ranges, &bound_count);
+            }
+            valid = ranges_array && bound_count < SHARD_LIMIT;
+            for (uint32_t b = 0; valid && b < bound_count; b++) {
+                napi_value bound;
+                napi_valuetype bound_type;
+                napi_get_element(env, ranges, b, &bound);
+                napi_typeof(env, bound, &bound_type);
+                valid = bound_type == napi_number && napi_get_value_double(env, bound, &bounds[b]) == napi_ok;
+            }
+        }
+
+        if (!valid) {
+            free(table);
+            free(column);
+            napi_throw_type_error(env, NULL,
+                                  "Expected every shard key to have a table, a column, a strategy of 'hash' or 'range', "
+                                  "and numeric ranges for a range");
+            return NULL;
+        }
+
+        char error[TASK_ERROR_SIZE];
+        valid = shard_map_declare(shards, table, column, range ? SHARD_RANGE : SHARD_HASH, bounds, (int)bound_count, error,
+                                  sizeof(error));
+        free(table);
+        free(column);
+        if (!valid) {
+            napi_throw_range_error(env, NULL, error);
+            return NULL;
+        }
+    }
+
+    napi_value result;
+    napi_get_boolean(env, shards != NULL, &result);
+    return result;
+}
+
+/**
+ * Function to find the shard holding a key of a sharded table, e.g. to split a multi-row insert per shard
+ * @return number - Shard index, -1 when the table is not sharded
+ * @example
+ * const shard = shardOf('orders', 42);
+ */
+napi_value ShardOf(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected 2 arguments: table, key");
+        return NULL;
+    }
+
+    char *name = params_get_string(env, args[0], NULL);
+    if (!name) {
+        napi_throw_type_error(env, NULL, "Expected table to be a string");
+        return NULL;
+    }
+
+    SharedPool *shared = get_shared(env);
+    ShardMap *shards = shared ? shared->shards : NULL;
+    int shard = SHARD_UNSHARDED;
+    if (shard_map_contains(shards, name)) {
+        PeekParam key;
+        memset(&key, 0, sizeof(PeekParam));
+        if (!params_value_from_js(env, args[1], &key)) {
+            free(name);
+            return NULL;
+        }
+
+        char error[TASK_ERROR_SIZE];
+        shard = shard_map_route(shards, name, &key, error, sizeof(error));
+        if (key.type == PARAM_STRING || key.type == PARAM_BLOB) {
+            free(key.data);
+        }
+        if (shard == SHARD_INVALID) {
+            free(name);
+            napi_throw_range_error(env, NULL, error);
+            return NULL;
+        }
+    }
+    free(name);
+
+    napi_value result;
+    napi_create_int32(env, shard, &result);
     return result;
 }
@@ -0,0 +1,340 @@
+#include "../include/mysql_metrics.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static MetricsShard *shards = NULL;      // Every thread that recorded something, newest first
+static MetricsShard *free_shards = NULL; // Shards of threads that exited, guarded by the lock
+static pthread_mutex_t shards_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t shard_key; // Hands the shard back when its thread exits
+static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+static _Thread_local MetricsShard *local_shard = NULL;
+
+static const char *const OP_NAMES[METRIC_OP_COUNT] = {
+    "none", "select", "insert", "update", "delete", "bulk_insert", "load", "stream", "transaction", "batch",
+};
+
+uint64_t metrics_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+const char *metrics_op_name(MetricOp op) {
+    return op > METRIC_OP_NONE && op < METRIC_OP_COUNT ? OP_NAMES[op] : OP_NAMES[METRIC_OP_NONE];
+}
+
+/** Put the shard of an exiting thread on the free list */
+static void shard_retire(void *data) {
+    MetricsShard *shard = (MetricsShard *)data;
+    pthread_mutex_lock(&shards_lock);
+    shard->next_free = free_shards;
+    free_shards = shard;
+    pthread_mutex_unlock(&shards_lock);
+}
+
+static void shard_key_create(void) {
+    pthread_key_create(&shard_key, shard_retire);
+}
+
+/**
+ * Shard of the calling thread, one of an exited thread or a new one registered on first use
+ * @return MetricsShard* - Shard, NULL when out of memory
+ */
+static MetricsShard *get_shard(void) {
+    if (local_shard) {
+        return local_shard;
+    }
+    pthread_once(&shard_key_once, shard_key_create);
+
+    pthread_mutex_lock(&shards_lock);
+    MetricsShard *shard = free_shards;
+    if (shard) {
+        free_shards = shard->next_free;
+    } else if ((shard = (MetricsShard *)calloc(1, sizeof(MetricsShard)))) {
+        shard->next = shards;
+        __atomic_store_n(&shards, shard, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&shards_lock);
+
+    if (shard) {
+        pthread_setspecific(shard_key, shard);
+        local_shard = shard;
+    }
+    return shard;
+}
+
+/** Add to a counter only the calling thread writes: a plain add, atomic so snapshots never read a torn value */
+static inline void counter_add(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t counter_read(const uint64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/** Bucket of a value */
+static int histogram_index(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (int)value;
+    }
+
+    int magnitude = 63 - __builtin_clzll(value);
+    if (magnitude > HISTOGRAM_MAX_MAGNITUDE) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+
+    int shift = magnitude - HISTOGRAM_SUB_BUCKET_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/** Largest value of a bucket */
+static uint64_t histogram_upper_bound(int index) {
+    int block = index / HISTOGRAM_SUB_BUCKETS;
+    uint64_t sub = (uint64_t)(index % HISTOGRAM_SUB_BUCKETS);
+    if (block == 0) {
+        return sub;
+    }
+    return ((HISTOGRAM_SUB_BUCKETS + sub + 1) << (block - 1)) - 1;
+}
+
+static void histogram_record(Histogram *histogram, uint64_t value) {
+    counter_add(&histogram->counts[histogram_index(value)], 1);
+    counter_add(&histogram->count, 1);
+    counter_add(&histogram->sum_us, value);
+    if (value > counter_read(&histogram->max_us)) {
+        __atomic_store_n(&histogram->max_us, value, __ATOMIC_RELAXED);
+    }
+}
+
+/** Add a histogram being written by another thread into a snapshot */
+static void histogram_merge(Histogram *into, const Histogram *from) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        into->counts[i] += counter_read(&from->counts[i]);
+    }
+    into->count += counter_read(&from->count);
+    into->sum_us += counter_read(&from->sum_us);
+    uint64_t max_us = counter_read(&from->max_us);
+    if (max_us > into->max_us) {
+        into->max_us = max_us;
+    }
+}
+
+void metrics_record_op(MetricOp op, uint64_t elapsed_us, bool failed) {
+    MetricsShard *shard;
+    if (op <= METRIC_OP_NONE || op >= METRIC_OP_COUNT || !(shard = get_shard())) {
+        return;
+    }
+    histogram_record(&shard->counters.latency[op], elapsed_us);
+    if (failed) {
+        counter_add(&shard->counters.errors[op], 1);
+    }
+}
+
+void metrics_record_rows(MetricOp op, uint64_t rows, uint64_t bytes) {
+    MetricsShard *shard;
+    if (op <= METRIC_OP_NONE || op >= METRIC_OP_COUNT || !(shard = get_shard())) {
+        return;
+    }
+    counter_add(&shard->counters.rows[op], rows);
+    counter_add(&shard->counters.bytes[op], bytes);
+}
+
+void metrics_record_acquire(uint64_t elapsed_us, bool acquired) {
+    MetricsShard *shard = get_shard();
+    if (!shard) {
+        return;
+    }
+    histogram_record(&shard->counters.acquire_wait, elapsed_us);
+    if (!acquired) {
+        counter_add(&shard->counters.acquire_failures, 1);
+    }
+}
+
+void metrics_record_reconnect(void) {
+    MetricsShard *shard = get_shard();
+    if (shard) {
+        counter_add(&shard->counters.reconnects, 1);
+    }
+}
+
+void metrics_record_ping(void) {
+    MetricsShard *shard = get_shard();
+    if (shard) {
+        counter_add(&shard->counters.pings, 1);
+    }
+}
+
+void metrics_snapshot(MetricsCounters *snapshot) {
+    memset(snapshot, 0, sizeof(MetricsCounters));
+
+    // Shards are only ever pushed in front, so the list can be walked without the lock
+    for (MetricsShard *shard = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); shard; shard = shard->next) {
+        const MetricsCounters *counters = &shard->counters;
+        for (int op = 0; op < METRIC_OP_COUNT; op++) {
+            histogram_merge(&snapshot->latency[op], &counters->latency[op]);
+            snapshot->errors[op] += counter_read(&counters->errors[op]);
+            snapshot->rows[op] += counter_read(&counters->rows[op]);
+            snapshot->bytes[op] += counter_read(&counters->bytes[op]);
+        }
+        histogram_merge(&snapshot->acquire_wait, &counters->acquire_wait);
+        snapshot->acquire_failures += counter_read(&counters->acquire_failures);
+        snapshot->reconnects += counter_read(&counters->reconnects);
+        snapshot->pings += counter_read(&counters->pings);
+    }
+}
+
+uint64_t histogram_quantile(const Histogram *histogram, double quantile) {
+    uint64_t total = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        total += histogram->counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(quantile * (double)total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t bound = histogram_upper_bound(i);
+            return bound < histogram->max_us ? bound : histogram->max_us;
+        }
+    }
+    return histogram->max_us;
+}
+
+uint64_t histogram_count_below(const Histogram *histogram, uint64_t value) {
+    uint64_t count = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS && histogram_upper_bound(i) <= value; i++) {
+        count += histogram->counts[i];
+    }
+    return count;
+}
+
+// =========================== PROMETHEUS ===========================
+
+/** Growing text buffer */
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} TextBuffer;
+
+static void text_append(TextBuffer *text, const char *format, ...) {
+    if (text->failed) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (length < 0) {
+        text->failed = true;
+        return;
+    }
+
+    if (text->length + (size_t)length + 1 > text->capacity) {
+        size_t capacity = text->capacity ? text->capacity : 4096;
+        while (text->length + (size_t)length + 1 > capacity) {
+            capacity *= 2;
+        }
+        char *data = (char *)realloc(text->data, capacity);
+        if (!data) {
+            text->failed = true;
+            return;
+        }
+        text->data = data;
+        text->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(text->data + text->length, text->capacity - text->length, format, args);
+    va_end(args);
+    text->length += (size_t)length;
+}
+
+/** Bucket bounds of exported histograms, in seconds */
+static const double PROMETHEUS_BUCKETS[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                            0.025,  0.05,    0.1,    0.25,  0.5,    1,     2.5,  5, 10};
+
+/** Write the series of a histogram, `labels` is empty or a `key="value"` list */
+static void text_histogram(TextBuffer *text, const char *name, const char *labels, const Histogram *histogram) {
+    const char *separator = labels[0] ? "," : "";
+    for (size_t i = 0; i < sizeof(PROMETHEUS_BUCKETS) / sizeof(PROMETHEUS_BUCKETS[0]); i++) {
+        uint64_t bound_us = (uint64_t)(PROMETHEUS_BUCKETS[i] * 1000000.0);
+        text_append(text, "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, separator, PROMETHEUS_BUCKETS[i],
+                    (unsigned long long)histogram_count_below(histogram, bound_us));
+    }
+    text_append(text, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, separator, (unsigned long long)histogram->count);
+    const char *open = labels[0] ? "{" : "", *close = labels[0] ? "}" : "";
+    text_append(text, "%s_sum%s%s%s %.6f\n", name, open, labels, close, (double)histogram->sum_us / 1000000.0);
+    text_append(text, "%s_count%s%s%s %llu\n", name, open, labels, close, (unsigned long long)histogram->count);
+}
+
+/** Write a counter with one series per operation */
+static void text_op_counter(TextBuffer *text, const char *name, const char *help, const uint64_t *values) {
+    text_append(text, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+    for (int op = METRIC_OP_NONE + 1; op < METRIC_OP_COUNT; op++) {
+        text_append(text, "%s{op=\"%s\"} %llu\n", name, OP_NAMES[op], (unsigned long long)values[op]);
+    }
+}
+
+char *metrics_prometheus(const MetricsCounters *snapshot, const PoolGauges *gauges) {
+    TextBuffer text = {0};
+    char labels[64];
+
+    text_append(&text, "# HELP peek_operation_duration_seconds Time from the call to the settled promise\n");
+    text_append(&text, "# TYPE peek_operation_duration_seconds histogram\n");
+    for (int op = METRIC_OP_NONE + 1; op < METRIC_OP_COUNT; op++) {
+        snprintf(labels, sizeof(labels), "op=\"%s\"", OP_NAMES[op]);
+        text_histogram(&text, "peek_operation_duration_seconds", labels, &snapshot->latency[op]);
+    }
+
+    text_op_counter(&text, "peek_operation_errors_total", "Operations that failed", snapshot->errors);
+    text_op_counter(&text, "peek_rows_decoded_total", "Rows decoded from the server", snapshot->rows);
+    text_op_counter(&text, "peek_bytes_decoded_total", "Bytes of the values decoded from the server", snapshot->bytes);
+
+    text_append(&text, "# HELP peek_pool_acquire_wait_seconds Time spent waiting for a pooled connection\n");
+    text_append(&text, "# TYPE peek_pool_acquire_wait_seconds histogram\n");
+    text_histogram(&text, "peek_pool_acquire_wait_seconds", "", &snapshot->acquire_wait);
+
+    text_append(&text, "# HELP peek_pool_acquire_failures_total Checkouts that timed out or could not connect\n");
+    text_append(&text, "# TYPE peek_pool_acquire_failures_total counter\n");
+    text_append(&text, "peek_pool_acquire_failures_total %llu\n", (unsigned long long)snapshot->acquire_failures);
+    text_append(&text, "# HELP peek_pool_reconnects_total Connections reopened after a failed ping\n");
+    text_append(&text, "# TYPE peek_pool_reconnects_total counter\n");
+    text_append(&text, "peek_pool_reconnects_total %llu\n", (unsigned long long)snapshot->reconnects);
+    text_append(&text, "# HELP peek_pool_pings_total Connection pings\n");
+    text_append(&text, "# TYPE peek_pool_pings_total counter\n");
+    text_append(&text, "peek_pool_pings_total %llu\n", (unsigned long long)snapshot->pings);
+
+    text_append(&text, "# HELP peek_pool_connections Pooled connections by state\n");
+    text_append(&text, "# TYPE peek_pool_connections gauge\n");
+    text_append(&text, "peek_pool_connections{state=\"in_use\"} %d\n", gauges->in_use);
+    text_append(&text, "peek_pool_connections{state=\"idle\"} %d\n", gauges->idle);
+    text_append(&text, "# HELP peek_pool_max_connections Upper bound of pooled connections\n");
+    text_append(&text, "# TYPE peek_pool_max_connections gauge\n");
+    text_append(&text, "peek_pool_max_connections %d\n", gauges->max_size);
+    text_append(&text, "# HELP peek_pool_waiters Callers waiting for a pooled connection\n");
+    text_append(&text, "# TYPE peek_pool_waiters gauge\n");
+    text_append(&text, "peek_pool_waiters %d\n", gauges->waiting);
+
+    if (text.failed) {
+        free(text.data);
+        return NULL;
+    }
+    return text.data;
+}
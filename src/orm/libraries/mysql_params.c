@@ -0,0 +1,263 @@
+#include "../include/mysql_params.h"
+#include <math.h>
+#include <mysql.h>
+#include <node_api.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Largest integer a JS number holds exactly */
+#define MAX_SAFE_INTEGER 9007199254740991.0
+
+char *params_get_string(napi_env env, napi_value value, size_t *length) {
+    size_t size = 0;
+    if (napi_get_value_string_utf8(env, value, NULL, 0, &size) != napi_ok) {
+        return NULL;
+    }
+
+    char *buffer = (char *)malloc(size + 1);
+    if (!buffer) {
+        return NULL;
+    }
+
+    napi_get_value_string_utf8(env, value, buffer, size + 1, &size);
+    if (length) {
+        *length = size;
+    }
+    return buffer;
+}
+
+/** Convert a JS Date into a UTC MYSQL_TIME */
+static void date_to_time(double ms, MYSQL_TIME *out) {
+    time_t seconds = (time_t)floor(ms / 1000.0);
+    long millis = (long)(ms - (double)seconds * 1000.0);
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+
+    memset(out, 0, sizeof(MYSQL_TIME));
+    out->year = (unsigned int)(tm.tm_year + 1900);
+    out->month = (unsigned int)(tm.tm_mon + 1);
+    out->day = (unsigned int)tm.tm_mday;
+    out->hour = (unsigned int)tm.tm_hour;
+    out->minute = (unsigned int)tm.tm_min;
+    out->second = (unsigned int)tm.tm_sec;
+    out->second_part = (unsigned long)millis * 1000;
+    out->time_type = MYSQL_TIMESTAMP_DATETIME;
+}
+
+bool params_value_from_js(napi_env env, napi_value value, PeekParam *param) {
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+
+    switch (type) {
+    case napi_undefined:
+    case napi_null:
+        param->type = PARAM_NULL;
+        param->is_null = true;
+        return true;
+
+    case napi_boolean: {
+        bool flag;
+        napi_get_value_bool(env, value, &flag);
+        param->type = PARAM_INT;
+        param->int_value = flag ? 1 : 0;
+        return true;
+    }
+
+    case napi_number: {
+        double number;
+        napi_get_value_double(env, value, &number);
+        if (number == floor(number) && fabs(number) <= MAX_SAFE_INTEGER) {
+            param->type = PARAM_INT;
+            param->int_value = (long long)number;
+        } else {
+            param->type = PARAM_DOUBLE;
+            param->double_value = number;
+        }
+        return true;
+    }
+
+    case napi_bigint: {
+        int64_t number;
+        bool lossless;
+        napi_get_value_bigint_int64(env, value, &number, &lossless);
+        if (!lossless) {
+            napi_throw_range_error(env, NULL, "BigInt parameter does not fit in a signed 64-bit integer");
+            return false;
+        }
+        param->type = PARAM_INT;
+        param->int_value = (long long)number;
+        return true;
+    }
+
+    case napi_string: {
+        size_t length;
+        param->data = params_get_string(env, value, &length);
+        if (!param->data) {
+            napi_throw_error(env, NULL, "Out of memory");
+            return false;
+        }
+        param->type = PARAM_STRING;
+        param->length = (unsigned long)length;
+        return true;
+    }
+
+    case napi_object: {
+        bool is_buffer = false, is_date = false;
+        napi_is_buffer(env, value, &is_buffer);
+        napi_is_date(env, value, &is_date);
+
+        if (is_buffer) {
+            void *data;
+            size_t length;
+            napi_get_buffer_info(env, value, &data, &length);
+            param->data = (char *)malloc(length ? length : 1);
+            if (!param->data) {
+                napi_throw_error(env, NULL, "Out of memory");
+                return false;
+            }
+            memcpy(param->data, data, length);
+            param->type = PARAM_BLOB;
+            param->length = (unsigned long)length;
+            return true;
+        }
+
+        if (is_date) {
+            double ms;
+            napi_get_date_value(env, value, &ms);
+            param->type = PARAM_DATETIME;
+            date_to_time(ms, &param->time_value);
+            return true;
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    napi_throw_type_error(env, NULL, "Unsupported query parameter type");
+    return false;
+}
+
+bool params_from_js(napi_env env, napi_value array, PeekParams *params) {
+    params->items = NULL;
+    params->count = 0;
+
+    napi_valuetype type;
+    napi_typeof(env, array, &type);
+    if (type == napi_undefined || type == napi_null) {
+        return true;
+    }
+
+    bool is_array = false;
+    napi_is_array(env, array, &is_array);
+    if (!is_array) {
+        napi_throw_type_error(env, NULL, "Query parameters must be an array");
+        return false;
+    }
+
+    uint32_t count;
+    napi_get_array_length(env, array, &count);
+    if (count == 0) {
+        return true;
+    }
+
+    params->items = (PeekParam *)calloc(count, sizeof(PeekParam));
+    if (!params->items) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        napi_value element;
+        napi_get_element(env, array, i, &element);
+        params->count = i + 1;
+        if (!params_value_from_js(env, element, &params->items[i])) {
+            params_free(params);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void params_bind(PeekParams *params, MYSQL_BIND *bind) {
+    for (size_t i = 0; i < params->count; i++) {
+        PeekParam *param = &params->items[i];
+        bind[i].is_null = &param->is_null;
+
+        switch (param->type) {
+        case PARAM_NULL:
+            bind[i].buffer_type = MYSQL_TYPE_NULL;
+            break;
+        case PARAM_INT:
+            bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
+            bind[i].buffer = &param->int_value;
+            break;
+        case PARAM_DOUBLE:
+            bind[i].buffer_type = MYSQL_TYPE_DOUBLE;
+            bind[i].buffer = &param->double_value;
+            break;
+        case PARAM_STRING:
+            bind[i].buffer_type = MYSQL_TYPE_STRING;
+            bind[i].buffer = param->data;
+            bind[i].buffer_length = param->length;
+            bind[i].length = &param->length;
+            break;
+        case PARAM_BLOB:
+            bind[i].buffer_type = MYSQL_TYPE_BLOB;
+            bind[i].buffer = param->data;
+            bind[i].buffer_length = param->length;
+            bind[i].length = &param->length;
+            break;
+        case PARAM_DATETIME:
+            bind[i].buffer_type = MYSQL_TYPE_DATETIME;
+            bind[i].buffer = &param->time_value;
+            break;
+        }
+    }
+}
+
+bool params_copy(const PeekParams *source, PeekParams *copy) {
+    memset(copy, 0, sizeof(PeekParams));
+    if (source->count == 0) {
+        return true;
+    }
+
+    if (!(copy->items = (PeekParam *)calloc(source->count, sizeof(PeekParam)))) {
+        return false;
+    }
+    for (size_t i = 0; i < source->count; i++) {
+        const PeekParam *param = &source->items[i];
+        copy->items[i] = *param;
+        if (param->type == PARAM_STRING || param->type == PARAM_BLOB) {
+            // One extra byte keeps strings NUL terminated, as `params_get_string` leaves them
+            if (!(copy->items[i].data = (char *)malloc(param->length + 1))) {
+                params_free(copy);
+                return false;
+            }
+            memcpy(copy->items[i].data, param->data, param->length);
+            copy->items[i].data[param->length] = '\0';
+        }
+        copy->count = i + 1;
+    }
+    return true;
+}
+
+void params_free(PeekParams *params) {
+    if (!params->items) {
+        return;
+    }
+
+    for (size_t i = 0; i < params->count; i++) {
+        if (params->items[i].type == PARAM_STRING || params->items[i].type == PARAM_BLOB) {
+            free(params->items[i].data);
+        }
+    }
+
+    free(params->items);
+    params->items = NULL;
+    params->count = 0;
+}
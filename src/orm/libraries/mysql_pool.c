@@ -1,9 +1,16 @@
+#include "../include/mysql_driver.h"
 #include "../include/mysql_pool.h"
+#include "../include/mysql_infile.h"
+#include "../include/mysql_metrics.h"
+#include "../include/mysql_stmt_cache.h"
+#include "../include/mysql_util.h"
+#include <errno.h>
 #include <mysql.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /**
  * ## Create a connection
@@ -11,27 +18,290 @@
  * @return MYSQL* - Connection
  */
 static MYSQL *create_connection(ConnectionPool *pool) {
-    MYSQL *conn = mysql_init(NULL);
+    MYSQL *conn = peek_driver->init(NULL);
     if (conn == NULL) {
         return NULL;
     }
 
     unsigned int timeout = 60;
-    mysql_options(conn, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
-    mysql_options(conn, MYSQL_OPT_READ_TIMEOUT, &timeout);
-    mysql_options(conn, MYSQL_OPT_WRITE_TIMEOUT, &timeout);
+    peek_driver->options(conn, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    peek_driver->options(conn, MYSQL_OPT_READ_TIMEOUT, &timeout);
+    peek_driver->options(conn, MYSQL_OPT_WRITE_TIMEOUT, &timeout);
 
-    if (!mysql_real_connect(conn, pool->host, pool->user, pool->password,
-                            pool->database, pool->port, NULL, 0)) {
-        mysql_close(conn);
+    if (pool->options.local_infile) {
+        unsigned int local_infile = 1;
+        peek_driver->options(conn, MYSQL_OPT_LOCAL_INFILE, &local_infile);
+    }
+
+    // Without multi statements: batches and transactions turn them on while they hold the connection
+    if (!peek_driver->real_connect(conn, pool->host, pool->user, pool->password, pool->database, pool->port, NULL, 0)) {
+        peek_driver->close(conn);
         return NULL;
     }
 
+    if (pool->options.local_infile) {
+        infile_install_guard(conn);
+    }
+
     return conn;
 }
 
-ConnectionPool *pool_create(const char *host, const char *user, const char *password, const char *database, int port) {
-    ConnectionPool *pool = (ConnectionPool *)malloc(sizeof(ConnectionPool));
+/**
+ * Close the connection of a slot and drop its prepared statements
+ * @note Closing first means the cached statements are only freed, without extra round trips
+ */
+static void close_slot_connection(PoolConnection *slot) {
+    if (slot->connection) {
+        peek_driver->close(slot->connection);
+        slot->connection = NULL;
+    }
+    stmt_cache_clear(&slot->stmt_cache);
+    slot->max_packet = 0;
+    slot->multi_statements = false;
+}
+
+/**
+ * Push a slot on the idle stack
+ * @note Caller holds `pool->lock`
+ */
+static void push_idle(ConnectionPool *pool, PoolConnection *slot) {
+    slot->state = SLOT_IDLE;
+    pool->idle[pool->idle_count++] = slot;
+}
+
+/**
+ * Hand a slot to the oldest waiter
+ * @return bool - False when nobody waits
+ * @note Caller holds `pool->lock`
+ */
+static bool hand_to_waiter(ConnectionPool *pool, PoolConnection *slot, SlotState state) {
+    PoolWaiter *waiter = pool->wait_head;
+    if (!waiter) {
+        return false;
+    }
+
+    pool->wait_head = waiter->next;
+    if (!pool->wait_head) {
+        pool->wait_tail = NULL;
+    }
+    slot->state = state;
+    waiter->connection = slot;
+    pthread_cond_signal(&waiter->cond);
+    return true;
+}
+
+/**
+ * Push a slot whose connection is gone on the empty stack, or hand it to the oldest waiter to connect
+ * - Callers only queue while no slot is empty, so an emptied slot must go to one of them or they would wait for a
+ *   connection that is never returned
+ * @note Caller holds `pool->lock`
+ */
+static void push_empty(ConnectionPool *pool, PoolConnection *slot) {
+    slot->connection = NULL;
+
+    // The slot stays counted in `current_size`, the waiter opens its connection
+    if (hand_to_waiter(pool, slot, SLOT_CONNECTING)) {
+        return;
+    }
+
+    slot->state = SLOT_EMPTY;
+    pool->empty[pool->empty_count++] = slot;
+    pool->current_size--;
+}
+
+/**
+ * Hand a connection to the oldest waiter, or park it on the idle stack
+ * @note Caller holds `pool->lock`
+ */
+static void release_locked(ConnectionPool *pool, PoolConnection *slot) {
+    slot->last_used_ms = slot->last_checked_ms = util_now_ms();
+    if (!hand_to_waiter(pool, slot, SLOT_IN_USE)) {
+        push_idle(pool, slot);
+    }
+}
+
+/**
+ * Wait in the FIFO queue until a connection is handed over or the timeout expires
+ * @note Caller holds `pool->lock`
+ */
+static PoolConnection *wait_for_connection(ConnectionPool *pool) {
+    PoolWaiter waiter = {.connection = NULL, .next = NULL};
+    pthread_cond_init(&waiter.cond, NULL);
+
+    if (pool->wait_tail) {
+        pool->wait_tail->next = &waiter;
+    } else {
+        pool->wait_head = &waiter;
+    }
+    pool->wait_tail = &waiter;
+
+    struct timespec deadline;
+    if (pool->options.acquire_timeout_ms > 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += pool->options.acquire_timeout_ms / 1000;
+        deadline.tv_nsec += (long)(pool->options.acquire_timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    while (!waiter.connection) {
+        int rc = pool->options.acquire_timeout_ms > 0
+                     ? pthread_cond_timedwait(&waiter.cond, &pool->lock, &deadline)
+                     : pthread_cond_wait(&waiter.cond, &pool->lock);
+        if (rc == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    // Timed out without a hand-off: leave the queue
+    if (!waiter.connection) {
+        PoolWaiter **link = &pool->wait_head;
+        PoolWaiter *prev = NULL;
+        while (*link && *link != &waiter) {
+            prev = *link;
+            link = &(*link)->next;
+        }
+        if (*link) {
+            *link = waiter.next;
+            if (pool->wait_tail == &waiter) {
+                pool->wait_tail = prev;
+            }
+        }
+    }
+
+    pthread_cond_destroy(&waiter.cond);
+    return waiter.connection;
+}
+
+/**
+ * ## Background health check
+ * - Every `health_check_interval_ms`, takes connections not used nor checked for a whole interval off the idle stack
+ * - Closes the ones idle longer than `idle_timeout_ms` down to `min_size`, pings and reconnects the rest
+ * - Tops the pool back up to `min_size`
+ * @note Network round trips happen outside `pool->lock`
+ */
+static void *health_check_loop(void *arg) {
+    ConnectionPool *pool = (ConnectionPool *)arg;
+    PoolConnection **batch = (PoolConnection **)calloc(pool->options.max_size, sizeof(PoolConnection *));
+    PoolConnection **closing = (PoolConnection **)calloc(pool->options.max_size, sizeof(PoolConnection *));
+    bool *evict = (bool *)calloc(pool->options.max_size, sizeof(bool));
+    if (!batch || !closing || !evict) {
+        free(batch);
+        free(closing);
+        free(evict);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += pool->options.health_check_interval_ms / 1000;
+        deadline.tv_nsec += (long)(pool->options.health_check_interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&pool->health_cond, &pool->lock, &deadline);
+        if (pool->stopping) {
+            break;
+        }
+
+        //? Step 1: Take stale connections off the idle stack
+        uint64_t now = util_now_ms();
+        int count = 0, kept = 0;
+        for (int i = 0; i < pool->idle_count; i++) {
+            PoolConnection *slot = pool->idle[i];
+            if (now - slot->last_checked_ms >= (uint64_t)pool->options.health_check_interval_ms) {
+                slot->state = SLOT_CHECKING;
+                batch[count++] = slot;
+            } else {
+                pool->idle[kept++] = slot;
+            }
+        }
+        pool->idle_count = kept;
+        pthread_mutex_unlock(&pool->lock);
+
+        //? Step 2: Ping what we keep, reconnect what is broken
+        for (int i = 0; i < count; i++) {
+            PoolConnection *slot = batch[i];
+            evict[i] = pool->options.idle_timeout_ms > 0 &&
+                       now - slot->last_used_ms > (uint64_t)pool->options.idle_timeout_ms;
+            if (!evict[i] && !pool_validate_connection(slot->connection)) {
+                close_slot_connection(slot);
+                slot->connection = create_connection(pool);
+                metrics_record_reconnect();
+            }
+        }
+
+        //? Step 3: Put them back, evicting down to min_size, a ping is no use so they keep aging towards eviction
+        int closing_count = 0;
+        uint64_t checked = util_now_ms();
+        pthread_mutex_lock(&pool->lock);
+        for (int i = 0; i < count; i++) {
+            PoolConnection *slot = batch[i];
+            if (!slot->connection) {
+                push_empty(pool, slot);
+            } else if (evict[i] && pool->current_size - closing_count > pool->options.min_size) {
+                closing[closing_count++] = slot;
+            } else {
+                slot->last_checked_ms = checked;
+                if (!hand_to_waiter(pool, slot, SLOT_IN_USE)) {
+                    push_idle(pool, slot);
+                }
+            }
+        }
+
+        //? Step 4: Top up to min_size
+        while (!pool->stopping && closing_count == 0 && pool->current_size < pool->options.min_size && pool->empty_count > 0) {
+            PoolConnection *slot = pool->empty[--pool->empty_count];
+            slot->state = SLOT_CONNECTING;
+            pool->current_size++;
+            pthread_mutex_unlock(&pool->lock);
+            slot->connection = create_connection(pool);
+            pthread_mutex_lock(&pool->lock);
+            if (!slot->connection) {
+                push_empty(pool, slot);
+                break;
+            }
+            release_locked(pool, slot);
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        //? Step 5: Close evicted connections outside the lock, then free their slots
+        for (int i = 0; i < closing_count; i++) {
+            close_slot_connection(closing[i]);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        for (int i = 0; i < closing_count; i++) {
+            push_empty(pool, closing[i]);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(batch);
+    free(closing);
+    free(evict);
+    return NULL;
+}
+
+void pool_options_default(PoolOptions *options) {
+    options->min_size = DEFAULT_MIN_POOL_SIZE;
+    options->max_size = DEFAULT_MAX_POOL_SIZE;
+    options->acquire_timeout_ms = DEFAULT_ACQUIRE_TIMEOUT_MS;
+    options->idle_timeout_ms = DEFAULT_IDLE_TIMEOUT_MS;
+    options->validate_after_ms = DEFAULT_VALIDATE_AFTER_MS;
+    options->health_check_interval_ms = DEFAULT_HEALTH_CHECK_INTERVAL_MS;
+    options->stmt_cache_size = DEFAULT_STMT_CACHE_SIZE;
+    options->local_infile = false;
+    options->event_loop = false;
+}
+
+ConnectionPool *pool_create(const char *host, const char *user, const char *password, const char *database, int port, const PoolOptions *options) {
+    ConnectionPool *pool = (ConnectionPool *)calloc(1, sizeof(ConnectionPool));
     if (!pool) {
         return NULL;
     }
@@ -41,12 +311,38 @@ ConnectionPool *pool_create(const char *host, const char *user, const char *pass
         free(pool);
         return NULL;
     }
+    pthread_cond_init(&pool->health_cond, NULL);
+
+    if (options) {
+        pool->options = *options;
+    } else {
+        pool_options_default(&pool->options);
+    }
+
+    // Clamp sizes into a sane range
+    if (pool->options.max_size < 1) {
+        pool->options.max_size = 1;
+    }
+    if (pool->options.max_size > POOL_SIZE_LIMIT) {
+        pool->options.max_size = POOL_SIZE_LIMIT;
+    }
+    if (pool->options.min_size < 0) {
+        pool->options.min_size = 0;
+    }
+    if (pool->options.min_size > pool->options.max_size) {
+        pool->options.min_size = pool->options.max_size;
+    }
+
+    int max_size = pool->options.max_size;
 
     // Copy strings with error checking
     if (!(pool->host = strdup(host)) ||
         !(pool->user = strdup(user)) ||
         !(pool->password = strdup(password)) ||
-        !(pool->database = strdup(database))) {
+        !(pool->database = strdup(database)) ||
+        !(pool->connections = (PoolConnection *)calloc(max_size, sizeof(PoolConnection))) ||
+        !(pool->idle = (PoolConnection **)calloc(max_size, sizeof(PoolConnection *))) ||
+        !(pool->empty = (PoolConnection **)calloc(max_size, sizeof(PoolConnection *)))) {
         pool_destroy(pool);
         return NULL;
     }
@@ -54,21 +350,32 @@ ConnectionPool *pool_create(const char *host, const char *user, const char *pass
     pool->port = port;
     pool->current_size = 0;
 
-    // Initialize all connections to NULL
-    memset(pool->connections, 0, sizeof(pool->connections));
-    for (int i = 0; i < MAX_POOL_SIZE; i++) {
-        pool->connections[i].in_use = false;
+    // Every slot starts empty; push in reverse so slot 0 is handed out first
+    for (int i = max_size - 1; i >= 0; i--) {
+        if (!stmt_cache_init(&pool->connections[i].stmt_cache, pool->options.stmt_cache_size)) {
+            pool_destroy(pool);
+            return NULL;
+        }
+        arena_init(&pool->connections[i].scratch, 0);
+        pool->connections[i].state = SLOT_EMPTY;
+        pool->empty[pool->empty_count++] = &pool->connections[i];
     }
 
     // Create initial connections
-    for (int i = 0; i < MIN_POOL_SIZE; i++) {
-        MYSQL *conn = create_connection(pool);
-        if (!conn) {
+    for (int i = 0; i < pool->options.min_size; i++) {
+        PoolConnection *slot = pool->empty[--pool->empty_count];
+        pool->current_size++;
+        slot->connection = create_connection(pool);
+        if (!slot->connection) {
             pool_destroy(pool);
             return NULL;
         }
-        pool->connections[i].connection = conn;
-        pool->current_size++;
+        slot->last_used_ms = slot->last_checked_ms = util_now_ms();
+        push_idle(pool, slot);
+    }
+
+    if (pool->options.health_check_interval_ms > 0) {
+        pool->health_running = pthread_create(&pool->health_thread, NULL, health_check_loop, pool) == 0;
     }
 
     return pool;
@@ -78,20 +385,36 @@ void pool_destroy(ConnectionPool *pool) {
     if (!pool)
         return;
 
+    // Stop the health check first, it takes the lock itself
     pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_signal(&pool->health_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (pool->health_running) {
+        pthread_join(pool->health_thread, NULL);
+    }
 
-    for (int i = 0; i < MAX_POOL_SIZE; i++) {
-        if (pool->connections[i].connection) {
-            mysql_close(pool->connections[i].connection);
+    pthread_mutex_lock(&pool->lock);
+
+    if (pool->connections) {
+        for (int i = 0; i < pool->options.max_size; i++) {
+            close_slot_connection(&pool->connections[i]);
+            stmt_cache_destroy(&pool->connections[i].stmt_cache);
+            arena_destroy(&pool->connections[i].scratch);
         }
     }
 
+    free(pool->connections);
+    free(pool->idle);
+    free(pool->empty);
     free(pool->host);
     free(pool->user);
     free(pool->password);
     free(pool->database);
 
     pthread_mutex_unlock(&pool->lock);
+    pthread_cond_destroy(&pool->health_cond);
     pthread_mutex_destroy(&pool->lock);
     free(pool);
 }
@@ -100,68 +423,144 @@ bool pool_validate_connection(MYSQL *conn) {
     if (!conn) {
         return false;
     }
-    return mysql_ping(conn) == 0;
+    metrics_record_ping();
+    return peek_driver->ping(conn) == 0;
 }
 
-MYSQL *pool_get_connection(ConnectionPool *pool) {
+void pool_gauges(ConnectionPool *pool, PoolGauges *gauges) {
+    memset(gauges, 0, sizeof(PoolGauges));
     if (!pool) {
-        return NULL;
+        return;
     }
 
     pthread_mutex_lock(&pool->lock);
+    gauges->open = pool->current_size;
+    gauges->idle = pool->idle_count;
+    gauges->in_use = pool->current_size - pool->idle_count;
+    gauges->max_size = pool->options.max_size;
+    for (PoolWaiter *waiter = pool->wait_head; waiter; waiter = waiter->next) {
+        gauges->waiting++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
 
-    // First, try to reuse existing connections
-    for (int i = 0; i < pool->current_size; i++) {
-        if (!pool->connections[i].in_use) {
-            MYSQL *conn = pool->connections[i].connection;
-
-            // Validate and potentially reconnect
-            if (!pool_validate_connection(conn)) {
-                mysql_close(conn);
-                conn = create_connection(pool);
-                if (!conn) {
-                    continue; // Try next connection if reconnection fails
-                }
-                pool->connections[i].connection = conn;
+/** Check out a connection, see `pool_get_connection` */
+static PoolConnection *get_connection(ConnectionPool *pool) {
+    for (;;) {
+        PoolConnection *slot = NULL;
+        bool connect = false;
+
+        pthread_mutex_lock(&pool->lock);
+
+        if (!pool->wait_head && pool->idle_count > 0) {
+            // Reuse the most recently used idle connection
+            slot = pool->idle[--pool->idle_count];
+            slot->state = SLOT_IN_USE;
+        } else if (pool->empty_count > 0) {
+            // Expand the pool: reserve a slot, connect once the lock is released
+            slot = pool->empty[--pool->empty_count];
+            slot->state = SLOT_CONNECTING;
+            pool->current_size++;
+            connect = true;
+        } else if (pool->options.acquire_timeout_ms != 0) {
+            // Pool is full and all connections are in use: queue up
+            slot = wait_for_connection(pool);
+            connect = slot && slot->state == SLOT_CONNECTING; // A slot emptied while we waited
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+
+        if (!slot) {
+            return NULL;
+        }
+
+        if (connect) {
+            slot->connection = create_connection(pool);
+            if (!slot->connection) {
+                pthread_mutex_lock(&pool->lock);
+                push_empty(pool, slot);
+                pthread_mutex_unlock(&pool->lock);
+                return NULL;
             }
+            slot->state = SLOT_IN_USE;
+            return slot;
+        }
 
-            pool->connections[i].in_use = true;
-            pthread_mutex_unlock(&pool->lock);
-            return conn;
+        // Only connections that sat idle for a while pay for a ping
+        bool stale = pool->options.validate_after_ms >= 0 &&
+                     util_now_ms() - slot->last_checked_ms >= (uint64_t)pool->options.validate_after_ms;
+
+        if (stale && !pool_validate_connection(slot->connection)) {
+            close_slot_connection(slot);
+            slot->connection = create_connection(pool);
+            metrics_record_reconnect();
+            if (!slot->connection) {
+                pthread_mutex_lock(&pool->lock);
+                push_empty(pool, slot);
+                pthread_mutex_unlock(&pool->lock);
+                continue; // Try next connection if reconnection fails
+            }
         }
+
+        return slot;
     }
+}
 
-    // If we need to expand the pool
-    if (pool->current_size < MAX_POOL_SIZE) {
-        MYSQL *conn = create_connection(pool);
-        if (conn) {
-            int idx = pool->current_size++;
-            pool->connections[idx].connection = conn;
-            pool->connections[idx].in_use = true;
-            pthread_mutex_unlock(&pool->lock);
-            return conn;
-        }
+PoolConnection *pool_get_connection(ConnectionPool *pool) {
+    if (!pool) {
+        return NULL;
     }
 
-    // Pool is full and all connections are in use
-    pthread_mutex_unlock(&pool->lock);
-    return NULL;
+    uint64_t started_us = metrics_now_us();
+    PoolConnection *slot = get_connection(pool);
+    metrics_record_acquire(metrics_now_us() - started_us, slot != NULL);
+    return slot;
 }
 
-void pool_return_connection(ConnectionPool *pool, MYSQL *conn) {
+bool pool_enable_multi_statements(PoolConnection *conn) {
+    if (!conn->multi_statements) {
+        conn->multi_statements = peek_driver->set_server_option(conn->connection, MYSQL_OPTION_MULTI_STATEMENTS_ON) == 0;
+    }
+    return conn->multi_statements;
+}
+
+void pool_drain_results(MYSQL *conn) {
+    while (peek_driver->more_results(conn) && peek_driver->next_result(conn) == 0) {
+        MYSQL_RES *res = peek_driver->store_result(conn);
+        if (res) {
+            peek_driver->free_result(res);
+        }
+    }
+}
+
+void pool_return_connection(ConnectionPool *pool, PoolConnection *conn) {
     if (!pool || !conn) {
         return;
     }
 
+    // The next holder must not be able to stack statements
+    if (conn->multi_statements) {
+        pool_drain_results(conn->connection);
+        if (peek_driver->set_server_option(conn->connection, MYSQL_OPTION_MULTI_STATEMENTS_OFF) != 0) {
+            pool_discard_connection(pool, conn);
+            return;
+        }
+        conn->multi_statements = false;
+    }
+
     pthread_mutex_lock(&pool->lock);
+    release_locked(pool, conn);
+    pthread_mutex_unlock(&pool->lock);
+}
 
-    // Find the connection in the pool and mark it as not in use
-    for (int i = 0; i < pool->current_size; i++) {
-        if (pool->connections[i].connection == conn) {
-            pool->connections[i].in_use = false;
-            break;
-        }
+void pool_discard_connection(ConnectionPool *pool, PoolConnection *conn) {
+    if (!pool || !conn) {
+        return;
     }
 
+    close_slot_connection(conn);
+
+    pthread_mutex_lock(&pool->lock);
+    push_empty(pool, conn);
     pthread_mutex_unlock(&pool->lock);
-}
\ No newline at end of file
+}
@@ -0,0 +1,1027 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_result.h"
+#include <ctype.h>
+#include <mysql.h>
+#include <node_api.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Make room for `rows` more rows */
+static bool result_reserve(PeekResult *result, size_t rows) {
+    if (result->num_rows + rows <= result->capacity) {
+        return true;
+    }
+
+    size_t capacity = result->capacity ? result->capacity * 2 : 64;
+    if (capacity < result->num_rows + rows) {
+        capacity = result->num_rows + rows;
+    }
+
+    PeekCell *cells = (PeekCell *)realloc(result->cells, capacity * result->num_fields * sizeof(PeekCell));
+    if (!cells) {
+        return false;
+    }
+
+    result->cells = cells;
+    result->capacity = capacity;
+    return true;
+}
+
+/** Largest integer a JS number holds exactly */
+#define MAX_SAFE_INTEGER 9007199254740991LL
+
+/** Days between 1970-01-01 and a proleptic Gregorian date */
+static long long days_from_civil(long long year, unsigned int month, unsigned int day) {
+    year -= month <= 2;
+    long long era = (year >= 0 ? year : year - 399) / 400;
+    unsigned int yoe = (unsigned int)(year - era * 400);
+    unsigned int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long long)doe - 719468;
+}
+
+/** Convert a MYSQL_TIME read as UTC into milliseconds since the epoch */
+static double time_to_ms(const MYSQL_TIME *time) {
+    long long days = days_from_civil(time->year, time->month, time->day);
+    long long seconds = days * 86400 + time->hour * 3600 + time->minute * 60 + time->second;
+    return (double)seconds * 1000.0 + (double)(time->second_part / 1000);
+}
+
+ColumnKind result_column_kind(const MYSQL_FIELD *field) {
+    bool is_unsigned = (field->flags & UNSIGNED_FLAG) != 0;
+
+    switch (field->type) {
+    case MYSQL_TYPE_TINY:
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_INT24:
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_LONGLONG:
+    case MYSQL_TYPE_YEAR:
+        return is_unsigned ? COLUMN_UINT : COLUMN_INT;
+    case MYSQL_TYPE_FLOAT:
+    case MYSQL_TYPE_DOUBLE:
+        return COLUMN_DOUBLE;
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_NEWDATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+        return COLUMN_DATETIME;
+    case MYSQL_TYPE_BIT:
+    case MYSQL_TYPE_GEOMETRY:
+        return COLUMN_BINARY;
+    case MYSQL_TYPE_TINY_BLOB:
+    case MYSQL_TYPE_MEDIUM_BLOB:
+    case MYSQL_TYPE_LONG_BLOB:
+    case MYSQL_TYPE_BLOB:
+    case MYSQL_TYPE_STRING:
+    case MYSQL_TYPE_VAR_STRING:
+    case MYSQL_TYPE_VARCHAR:
+        // Charset 63 is `binary`: BLOB, BINARY and VARBINARY rather than TEXT, CHAR and VARCHAR
+        return field->charsetnr == 63 ? COLUMN_BINARY : COLUMN_STRING;
+    default:
+        return COLUMN_STRING;
+    }
+}
+
+/**
+ * Fetch buffers of one column
+ */
+typedef struct {
+    union {
+        long long int_value;
+        double double_value;
+        MYSQL_TIME time_value;
+    };
+    unsigned long length;
+    bool is_null;
+    bool error;
+} ColumnBuffer;
+
+struct ResultReader {
+    MYSQL_STMT *stmt;
+    MYSQL_RES *metadata;
+    unsigned int num_fields;
+    ColumnKind *kinds;
+    MYSQL_BIND *bind;
+    ColumnBuffer *buffers;
+    bool buffered;
+    bool done;
+};
+
+/** Bind buffer size of a string or binary column */
+static unsigned long column_buffer_size(const MYSQL_FIELD *field, bool buffered) {
+    unsigned long size = buffered ? field->max_length : field->length;
+    if (!buffered && size > RESULT_COLUMN_BUFFER_SIZE) {
+        size = RESULT_COLUMN_BUFFER_SIZE;
+    }
+    if (size > RESULT_COLUMN_BUFFER_LIMIT) {
+        size = RESULT_COLUMN_BUFFER_LIMIT;
+    }
+    // Room for the terminating NUL of MYSQL_TYPE_STRING
+    return size + 1;
+}
+
+ResultReader *result_reader_create(MYSQL_STMT *stmt, Arena *scratch, bool buffered, char *error, size_t error_size) {
+    arena_reset(scratch);
+
+    //? Step 1: Transfer a buffered result first, so the metadata carries the longest value of each column
+    if (buffered) {
+        bool update_max_length = true;
+        peek_driver->stmt_attr_set(stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &update_max_length);
+        if (peek_driver->stmt_store_result(stmt)) {
+            snprintf(error, error_size, "%s", peek_driver->stmt_error(stmt));
+            return NULL;
+        }
+    }
+
+    MYSQL_RES *metadata = peek_driver->stmt_result_metadata(stmt);
+    if (!metadata) {
+        snprintf(error, error_size, "Failed to retrieve metadata");
+        return NULL;
+    }
+
+    unsigned int num_fields = peek_driver->num_fields(metadata);
+    MYSQL_FIELD *fields = peek_driver->fetch_fields(metadata);
+
+    //? Step 2: Allocate the reader and its bind buffers from the connection's scratch arena
+    ResultReader *reader = (ResultReader *)arena_calloc(scratch, 1, sizeof(ResultReader));
+    if (!reader ||
+        !(reader->kinds = (ColumnKind *)arena_calloc(scratch, num_fields, sizeof(ColumnKind))) ||
+        !(reader->bind = (MYSQL_BIND *)arena_calloc(scratch, num_fields, sizeof(MYSQL_BIND))) ||
+        !(reader->buffers = (ColumnBuffer *)arena_calloc(scratch, num_fields, sizeof(ColumnBuffer)))) {
+        peek_driver->free_result(metadata);
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    reader->stmt = stmt;
+    reader->metadata = metadata;
+    reader->num_fields = num_fields;
+    reader->buffered = buffered;
+
+    //? Step 3: Bind every column by kind, byte buffers sized from the column metadata
+    for (unsigned int i = 0; i < num_fields; i++) {
+        MYSQL_BIND *bind = &reader->bind[i];
+        ColumnBuffer *buffer = &reader->buffers[i];
+
+        reader->kinds[i] = result_column_kind(&fields[i]);
+        bind->length = &buffer->length;
+        bind->is_null = &buffer->is_null;
+        bind->error = &buffer->error;
+
+        switch (reader->kinds[i]) {
+        case COLUMN_INT:
+        case COLUMN_UINT:
+            bind->buffer_type = MYSQL_TYPE_LONGLONG;
+            bind->buffer = &buffer->int_value;
+            bind->is_unsigned = reader->kinds[i] == COLUMN_UINT;
+            break;
+        case COLUMN_DOUBLE:
+            bind->buffer_type = MYSQL_TYPE_DOUBLE;
+            bind->buffer = &buffer->double_value;
+            break;
+        case COLUMN_DATETIME:
+            bind->buffer_type = MYSQL_TYPE_DATETIME;
+            bind->buffer = &buffer->time_value;
+            break;
+        case COLUMN_STRING:
+        case COLUMN_BINARY:
+            bind->buffer_type = reader->kinds[i] == COLUMN_BINARY ? MYSQL_TYPE_BLOB : MYSQL_TYPE_STRING;
+            bind->buffer_length = column_buffer_size(&fields[i], buffered);
+            if (!(bind->buffer = arena_alloc(scratch, bind->buffer_length))) {
+                result_reader_free(reader);
+                snprintf(error, error_size, "Out of memory");
+                return NULL;
+            }
+            break;
+        }
+    }
+
+    if (peek_driver->stmt_bind_result(stmt, reader->bind)) {
+        result_reader_free(reader);
+        snprintf(error, error_size, "Failed to bind result");
+        return NULL;
+    }
+
+    return reader;
+}
+
+/** Copy the bytes of a string or binary column into the result arena, fetching values longer than the bind buffer */
+static bool reader_copy_bytes(ResultReader *reader, unsigned int column, PeekResult *result, PeekCell *cell) {
+    MYSQL_BIND *bind = &reader->bind[column];
+    unsigned long length = reader->buffers[column].length;
+
+    cell->length = length;
+    cell->data = (char *)arena_alloc(&result->arena, length + 1);
+    if (!cell->data) {
+        return false;
+    }
+    result->bytes += length;
+
+    if (length < bind->buffer_length) {
+        memcpy(cell->data, bind->buffer, length);
+    } else {
+        // Truncated: fetch the whole value straight into its final place
+        unsigned long fetched = 0;
+        bool is_null = false, error = false;
+        MYSQL_BIND column_bind;
+        memset(&column_bind, 0, sizeof(MYSQL_BIND));
+        column_bind.buffer_type = bind->buffer_type;
+        column_bind.buffer = cell->data;
+        column_bind.buffer_length = length + 1;
+        column_bind.length = &fetched;
+        column_bind.is_null = &is_null;
+        column_bind.error = &error;
+        if (peek_driver->stmt_fetch_column(reader->stmt, &column_bind, column, 0)) {
+            return false;
+        }
+    }
+
+    cell->data[length] = '\0';
+    return true;
+}
+
+/** Copy the bound row of a reader into the next row of a result set */
+static bool reader_copy_row(ResultReader *reader, PeekResult *result) {
+    if (!result_reserve(result, 1)) {
+        return false;
+    }
+
+    unsigned int num_fields = reader->num_fields;
+    PeekCell *row = result->cells + result->num_rows * num_fields;
+    memset(row, 0, num_fields * sizeof(PeekCell));
+    result->num_rows++;
+
+    for (unsigned int i = 0; i < num_fields; i++) {
+        PeekCell *cell = &row[i];
+        ColumnBuffer *buffer = &reader->buffers[i];
+        cell->is_null = buffer->is_null;
+        if (cell->is_null) {
+            continue;
+        }
+
+        if (reader->kinds[i] != COLUMN_STRING && reader->kinds[i] != COLUMN_BINARY) {
+            result->bytes += sizeof(cell->int_value);
+        }
+
+        switch (reader->kinds[i]) {
+        case COLUMN_INT:
+            cell->int_value = buffer->int_value;
+            break;
+        case COLUMN_UINT:
+            cell->uint_value = (unsigned long long)buffer->int_value;
+            break;
+        case COLUMN_DOUBLE:
+            cell->double_value = buffer->double_value;
+            break;
+        case COLUMN_DATETIME:
+            // Zero dates ('0000-00-00') have no Date equivalent
+            if (buffer->time_value.year == 0 && buffer->time_value.month == 0 && buffer->time_value.day == 0) {
+                cell->is_null = true;
+            } else {
+                cell->double_value = time_to_ms(&buffer->time_value);
+            }
+            break;
+        case COLUMN_STRING:
+        case COLUMN_BINARY:
+            if (!reader_copy_bytes(reader, i, result, cell)) {
+                return false;
+            }
+            break;
+        }
+    }
+
+    return true;
+}
+
+/** Allocate an empty result set with the columns of a result */
+static PeekResult *result_create(const MYSQL_FIELD *fields, unsigned int num_fields, const ColumnKind *kinds, char *error,
+                                 size_t error_size) {
+    PeekResult *result = (PeekResult *)calloc(1, sizeof(PeekResult));
+    if (!result) {
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    arena_init(&result->arena, 0);
+    result->num_fields = num_fields;
+    result->field_names = (char **)arena_calloc(&result->arena, num_fields ? num_fields : 1, sizeof(char *));
+    result->kinds = (ColumnKind *)arena_alloc(&result->arena, (num_fields ? num_fields : 1) * sizeof(ColumnKind));
+    if (!result->field_names || !result->kinds) {
+        goto fail;
+    }
+
+    for (unsigned int i = 0; i < num_fields; i++) {
+        result->kinds[i] = kinds ? kinds[i] : result_column_kind(&fields[i]);
+        if (!(result->field_names[i] = arena_strdup(&result->arena, fields[i].name))) {
+            goto fail;
+        }
+    }
+
+    return result;
+
+fail:
+    snprintf(error, error_size, "Out of memory");
+    result_free(result);
+    return NULL;
+}
+
+PeekResult *result_reader_fetch(ResultReader *reader, size_t max_rows, char *error, size_t error_size) {
+    PeekResult *result = result_create(peek_driver->fetch_fields(reader->metadata), reader->num_fields, reader->kinds, error, error_size);
+    if (!result) {
+        return NULL;
+    }
+
+    // A buffered result knows its row count: allocate the cells once
+    if (reader->buffered && reader->num_fields > 0) {
+        size_t rows = (size_t)peek_driver->stmt_num_rows(reader->stmt);
+        if (max_rows > 0 && rows > max_rows) {
+            rows = max_rows;
+        }
+        if (rows > 0 && !result_reserve(result, rows)) {
+            snprintf(error, error_size, "Out of memory");
+            goto fail;
+        }
+    }
+
+    while (!reader->done && (max_rows == 0 || result->num_rows < max_rows)) {
+        int status = peek_driver->stmt_fetch(reader->stmt);
+        if (status == MYSQL_NO_DATA) {
+            reader->done = true;
+        } else if (status == 1) {
+            snprintf(error, error_size, "%s", peek_driver->stmt_error(reader->stmt));
+            goto fail;
+        } else if (!reader_copy_row(reader, result)) {
+            snprintf(error, error_size, "Failed to read column: %s", peek_driver->stmt_error_code(reader->stmt) ? peek_driver->stmt_error(reader->stmt) : "Out of memory");
+            goto fail;
+        }
+    }
+
+    return result;
+
+fail:
+    result_free(result);
+    return NULL;
+}
+
+bool result_reader_done(const ResultReader *reader) {
+    return reader->done;
+}
+
+void result_reader_free(ResultReader *reader) {
+    if (reader && reader->metadata) {
+        peek_driver->free_result(reader->metadata);
+        reader->metadata = NULL;
+    }
+}
+
+PeekResult *result_from_stmt(MYSQL_STMT *stmt, Arena *scratch, char *error, size_t error_size) {
+    ResultReader *reader = result_reader_create(stmt, scratch, true, error, error_size);
+    if (!reader) {
+        return NULL;
+    }
+
+    PeekResult *result = result_reader_fetch(reader, 0, error, error_size);
+    result_reader_free(reader);
+    return result;
+}
+/** Parse a text protocol DATE / DATETIME / TIMESTAMP, `YYYY-MM-DD[ hh:mm:ss[.ffffff]]` */
+static bool parse_text_time(const char *text, unsigned long length, MYSQL_TIME *time) {
+    char buffer[40];
+    if (length >= sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+
+    memset(time, 0, sizeof(MYSQL_TIME));
+    int parsed = sscanf(buffer, "%u-%u-%u %u:%u:%u", &time->year, &time->month, &time->day, &time->hour, &time->minute,
+                        &time->second);
+    if (parsed != 3 && parsed != 6) {
+        return false;
+    }
+
+    // Fractional digits are scaled to microseconds: '.5' of a DATETIME(1) is 500000
+    const char *fraction = strchr(buffer, '.');
+    if (fraction) {
+        unsigned long scale = 100000;
+        for (const char *digit = fraction + 1; *digit >= '0' && *digit <= '9' && scale > 0; digit++, scale /= 10) {
+            time->second_part += (unsigned long)(*digit - '0') * scale;
+        }
+    }
+    return true;
+}
+
+/** Copy one text protocol value into a cell */
+static bool text_copy_cell(PeekResult *result, ColumnKind kind, const char *text, unsigned long length, PeekCell *cell) {
+    MYSQL_TIME time;
+
+    result->bytes += kind == COLUMN_STRING || kind == COLUMN_BINARY ? length : sizeof(cell->int_value);
+
+    switch (kind) {
+    case COLUMN_INT:
+        cell->int_value = strtoll(text, NULL, 10);
+        return true;
+    case COLUMN_UINT:
+        cell->uint_value = strtoull(text, NULL, 10);
+        return true;
+    case COLUMN_DOUBLE:
+        cell->double_value = strtod(text, NULL);
+        return true;
+    case COLUMN_DATETIME:
+        // Zero dates ('0000-00-00') have no Date equivalent
+        if (!parse_text_time(text, length, &time) || (time.year == 0 && time.month == 0 && time.day == 0)) {
+            cell->is_null = true;
+        } else {
+            cell->double_value = time_to_ms(&time);
+        }
+        return true;
+    case COLUMN_STRING:
+    case COLUMN_BINARY:
+        cell->length = length;
+        cell->data = (char *)arena_alloc(&result->arena, length + 1);
+        if (!cell->data) {
+            return false;
+        }
+        memcpy(cell->data, text, length);
+        cell->data[length] = '\0';
+        return true;
+    }
+    return true;
+}
+
+PeekResult *result_from_text(MYSQL_RES *res, char *error, size_t error_size) {
+    unsigned int num_fields = res ? peek_driver->num_fields(res) : 0;
+    PeekResult *result = result_create(res ? peek_driver->fetch_fields(res) : NULL, num_fields, NULL, error, error_size);
+    if (!result || !res || num_fields == 0) {
+        return result;
+    }
+
+    size_t rows = (size_t)peek_driver->num_rows(res);
+    if (rows > 0 && !result_reserve(result, rows)) {
+        goto fail;
+    }
+
+    MYSQL_ROW values;
+    while ((values = peek_driver->fetch_row(res))) {
+        unsigned long *lengths = peek_driver->fetch_lengths(res);
+        PeekCell *row = result->cells + result->num_rows * num_fields;
+        memset(row, 0, num_fields * sizeof(PeekCell));
+        result->num_rows++;
+
+        for (unsigned int i = 0; i < num_fields; i++) {
+            row[i].is_null = values[i] == NULL;
+            if (!row[i].is_null && !text_copy_cell(result, result->kinds[i], values[i], lengths[i], &row[i])) {
+                goto fail;
+            }
+        }
+    }
+
+    return result;
+
+fail:
+    snprintf(error, error_size, "Out of memory");
+    result_free(result);
+    return NULL;
+}
+
+
+/** Convert one cell into a JS value */
+static napi_value cell_to_js(napi_env env, ColumnKind kind, const PeekCell *cell) {
+    napi_value value;
+
+    if (cell->is_null) {
+        napi_get_null(env, &value);
+        return value;
+    }
+
+    switch (kind) {
+    case COLUMN_INT:
+        if (cell->int_value > MAX_SAFE_INTEGER || cell->int_value < -MAX_SAFE_INTEGER) {
+            napi_create_bigint_int64(env, cell->int_value, &value);
+        } else {
+            napi_create_int64(env, cell->int_value, &value);
+        }
+        break;
+    case COLUMN_UINT:
+        if (cell->uint_value > (unsigned long long)MAX_SAFE_INTEGER) {
+            napi_create_bigint_uint64(env, cell->uint_value, &value);
+        } else {
+            napi_create_int64(env, (int64_t)cell->uint_value, &value);
+        }
+        break;
+    case COLUMN_DOUBLE:
+        napi_create_double(env, cell->double_value, &value);
+        break;
+    case COLUMN_DATETIME:
+        napi_create_date(env, cell->double_value, &value);
+        break;
+    case COLUMN_BINARY:
+        napi_create_buffer_copy(env, cell->length, cell->data, NULL, &value);
+        break;
+    case COLUMN_STRING:
+    default:
+        napi_create_string_utf8(env, cell->data, cell->length, &value);
+        break;
+    }
+
+    return value;
+}
+
+/** Row source of `rows_to_js`: returns the cells of the next row */
+typedef const PeekCell *(*RowReader)(void *source);
+
+/** Build the row objects of a result set, reading the cells of each row from `source` */
+static napi_value rows_to_js(napi_env env, size_t num_rows, unsigned int num_fields, char *const *field_names,
+                             const ColumnKind *kinds, RowReader read_row, void *source) {
+    napi_value array;
+    napi_create_array_with_length(env, num_rows, &array);
+
+    if (num_rows == 0) {
+        return array;
+    }
+
+    //? Step 1: Create the column keys once per result set, every row shares them
+    napi_property_descriptor *descriptors = (napi_property_descriptor *)calloc(num_fields, sizeof(napi_property_descriptor));
+    if (!descriptors) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < num_fields; i++) {
+        napi_create_string_utf8(env, field_names[i], NAPI_AUTO_LENGTH, &descriptors[i].name);
+        descriptors[i].attributes = napi_default_jsproperty;
+    }
+
+    //? Step 2: Define every property of a row in one call, in column order, so all rows share one hidden class
+    for (size_t r = 0; r < num_rows; r++) {
+        const PeekCell *row = read_row(source);
+
+        napi_handle_scope scope;
+        napi_open_handle_scope(env, &scope);
+
+        for (unsigned int i = 0; i < num_fields; i++) {
+            descriptors[i].value = cell_to_js(env, kinds[i], &row[i]);
+        }
+
+        napi_value row_obj;
+        napi_create_object(env, &row_obj);
+        napi_define_properties(env, row_obj, num_fields, descriptors);
+        napi_set_element(env, array, (uint32_t)r, row_obj);
+
+        napi_close_handle_scope(env, scope);
+    }
+
+    free(descriptors);
+    return array;
+}
+
+/** Row cursor over the cells of a result set */
+typedef struct {
+    const PeekResult *result;
+    size_t next;
+} ResultRows;
+
+static const PeekCell *result_read_row(void *source) {
+    ResultRows *rows = (ResultRows *)source;
+    return rows->result->cells + rows->next++ * rows->result->num_fields;
+}
+
+napi_value result_to_js(napi_env env, const PeekResult *result) {
+    ResultRows rows = {.result = result, .next = 0};
+    return rows_to_js(env, result->num_rows, result->num_fields, result->field_names, result->kinds, result_read_row, &rows);
+}
+
+/** Whether a column kind is serialized as a length and its bytes */
+static bool kind_has_bytes(ColumnKind kind) {
+    return kind == COLUMN_STRING || kind == COLUMN_BINARY;
+}
+
+size_t result_serialized_size(const PeekResult *result) {
+    //? Step 1: Header: column count, row count, then per column its kind and NUL terminated name
+    size_t size = sizeof(uint32_t) + sizeof(uint64_t);
+    for (unsigned int i = 0; i < result->num_fields; i++) {
+        size += 1 + strlen(result->field_names[i]) + 1;
+    }
+
+    //? Step 2: Cells: a null flag, then 8 bytes or a 4 byte length and the bytes
+    for (size_t c = 0; c < result->num_rows * result->num_fields; c++) {
+        const PeekCell *cell = &result->cells[c];
+        size += 1;
+        if (!cell->is_null) {
+            size += kind_has_bytes(result->kinds[c % result->num_fields]) ? sizeof(uint32_t) + cell->length : 8;
+        }
+    }
+    return size;
+}
+
+void result_serialize(const PeekResult *result, uint8_t *out) {
+    uint32_t num_fields = result->num_fields;
+    uint64_t num_rows = result->num_rows;
+    memcpy(out, &num_fields, sizeof(num_fields));
+    out += sizeof(num_fields);
+    memcpy(out, &num_rows, sizeof(num_rows));
+    out += sizeof(num_rows);
+
+    for (unsigned int i = 0; i < num_fields; i++) {
+        size_t length = strlen(result->field_names[i]) + 1;
+        *out++ = (uint8_t)result->kinds[i];
+        memcpy(out, result->field_names[i], length);
+        out += length;
+    }
+
+    for (size_t c = 0; c < num_rows * num_fields; c++) {
+        const PeekCell *cell = &result->cells[c];
+        *out++ = cell->is_null;
+        if (cell->is_null) {
+            continue;
+        }
+        if (kind_has_bytes(result->kinds[c % num_fields])) {
+            uint32_t length = (uint32_t)cell->length;
+            memcpy(out, &length, sizeof(length));
+            memcpy(out + sizeof(length), cell->data, length);
+            out += sizeof(length) + length;
+        } else {
+            // Every fixed size kind lives in the same 8 bytes of the union
+            memcpy(out, &cell->uint_value, 8);
+            out += 8;
+        }
+    }
+}
+
+/** Row cursor over the cells of a serialized result set, decoding one row at a time into `row` */
+typedef struct {
+    const uint8_t *next;
+    unsigned int num_fields;
+    const ColumnKind *kinds;
+    PeekCell *row;
+} SerializedRows;
+
+static const PeekCell *serialized_read_row(void *source) {
+    SerializedRows *rows = (SerializedRows *)source;
+    PeekCell *row = rows->row;
+    const uint8_t *in = rows->next;
+
+    for (unsigned int i = 0; i < rows->num_fields; i++) {
+        PeekCell *cell = &row[i];
+        cell->is_null = *in++;
+        if (cell->is_null) {
+            continue;
+        }
+        if (kind_has_bytes(rows->kinds[i])) {
+            uint32_t length;
+            memcpy(&length, in, sizeof(length));
+            cell->length = length;
+            cell->data = (char *)(in + sizeof(length));
+            in += sizeof(length) + length;
+        } else {
+            memcpy(&cell->uint_value, in, 8);
+            in += 8;
+        }
+    }
+
+    rows->next = in;
+    return row;
+}
+
+/** Header of a serialized result set, with a scratch row to decode its cells into */
+typedef struct {
+    uint32_t num_fields;
+    uint64_t num_rows;
+    ColumnKind *kinds;
+    char **field_names; // Point into the buffer
+    PeekCell *row;
+    const uint8_t *cells;
+} SerializedHeader;
+
+static void serialized_close(SerializedHeader *header) {
+    free(header->row);
+    free(header->field_names);
+    free(header->kinds);
+}
+
+/** Read the header of a serialized result set, throwing on failure */
+static bool serialized_open(napi_env env, const uint8_t *data, SerializedHeader *header) {
+    memcpy(&header->num_fields, data, sizeof(header->num_fields));
+    data += sizeof(header->num_fields);
+    memcpy(&header->num_rows, data, sizeof(header->num_rows));
+    data += sizeof(header->num_rows);
+
+    size_t columns = header->num_fields ? header->num_fields : 1;
+    header->kinds = (ColumnKind *)calloc(columns, sizeof(ColumnKind));
+    header->field_names = (char **)calloc(columns, sizeof(char *));
+    header->row = (PeekCell *)calloc(columns, sizeof(PeekCell));
+    if (!header->kinds || !header->field_names || !header->row) {
+        serialized_close(header);
+        napi_throw_error(env, NULL, "Out of memory");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->num_fields; i++) {
+        header->kinds[i] = (ColumnKind)*data++;
+        header->field_names[i] = (char *)data;
+        data += strlen((const char *)data) + 1;
+    }
+    header->cells = data;
+    return true;
+}
+
+napi_value result_serialized_to_js(napi_env env, const uint8_t *data) {
+    //? Step 1: Column kinds and names, names point into the buffer
+    SerializedHeader header;
+    if (!serialized_open(env, data, &header)) {
+        return NULL;
+    }
+
+    //? Step 2: Rows, decoded one at a time straight from the buffer
+    SerializedRows rows = {.next = header.cells, .num_fields = header.num_fields, .kinds = header.kinds, .row = header.row};
+    napi_value array = rows_to_js(env, (size_t)header.num_rows, header.num_fields, header.field_names, header.kinds,
+                                  serialized_read_row, &rows);
+
+    serialized_close(&header);
+    return array;
+}
+
+/** Write the cells of one row into the slots, tags and data area of a packed buffer */
+static void pack_row(const PeekCell *row, unsigned int num_fields, const ColumnKind *kinds, uint8_t *slots,
+                     uint8_t *tags, uint8_t *data, uint32_t *data_used) {
+    for (unsigned int i = 0; i < num_fields; i++) {
+        const PeekCell *cell = &row[i];
+        uint8_t *slot = slots + (size_t)i * 8;
+        double number = 0;
+        tags[i] = cell->is_null ? PACKED_NULL : PACKED_VALUE;
+        if (cell->is_null) {
+            memcpy(slot, &number, 8);
+            continue;
+        }
+
+        switch (kinds[i]) {
+        case COLUMN_INT:
+            if (cell->int_value > MAX_SAFE_INTEGER || cell->int_value < -MAX_SAFE_INTEGER) {
+                tags[i] = PACKED_BIG;
+                memcpy(slot, &cell->int_value, 8);
+                continue;
+            }
+            number = (double)cell->int_value;
+            break;
+        case COLUMN_UINT:
+            if (cell->uint_value > (unsigned long long)MAX_SAFE_INTEGER) {
+                tags[i] = PACKED_BIG;
+                memcpy(slot, &cell->uint_value, 8);
+                continue;
+            }
+            number = (double)cell->uint_value;
+            break;
+        case COLUMN_STRING:
+        case COLUMN_BINARY: {
+            uint32_t span[2] = {*data_used, (uint32_t)cell->length};
+            memcpy(slot, span, 8);
+            if (cell->length > 0) {
+                memcpy(data + *data_used, cell->data, cell->length);
+            }
+            *data_used += (uint32_t)cell->length;
+            continue;
+        }
+        default:
+            number = cell->double_value; // Doubles, and dates as ms since the epoch
+            break;
+        }
+        memcpy(slot, &number, 8);
+    }
+}
+
+/**
+ * Build a packed result set, reading the cells of each row from `source`
+ * @param data_bytes - Bytes of every string and buffer of the result set
+ */
+static napi_value rows_to_packed(napi_env env, size_t num_rows, unsigned int num_fields, char *const *field_names,
+                                 const ColumnKind *kinds, size_t data_bytes, RowReader read_row, void *source) {
+    if (data_bytes > UINT32_MAX) {
+        napi_throw_range_error(env, NULL, "Result too large to pack: its strings and buffers exceed 4 GiB");
+        return NULL;
+    }
+
+    //? Step 1: One buffer for the slots, the tags and the data area
+    size_t cells = num_rows * num_fields;
+    void *base = NULL;
+    napi_value buffer;
+    if (napi_create_arraybuffer(env, cells * 9 + data_bytes, &base, &buffer) != napi_ok) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return NULL;
+    }
+    uint8_t *slots = (uint8_t *)base;
+    uint8_t *tags = slots + cells * 8;
+    uint8_t *data = tags + cells;
+
+    //? Step 2: Copy the rows in
+    uint32_t data_used = 0;
+    for (size_t r = 0; r < num_rows; r++) {
+        pack_row(read_row(source), num_fields, kinds, slots + r * num_fields * 8, tags + r * num_fields, data, &data_used);
+    }
+
+    //? Step 3: Column names and kinds, once per result set
+    napi_value obj, columns, column_kinds, value;
+    napi_create_object(env, &obj);
+    napi_create_array_with_length(env, num_fields, &columns);
+    napi_create_array_with_length(env, num_fields, &column_kinds);
+    for (unsigned int i = 0; i < num_fields; i++) {
+        napi_create_string_utf8(env, field_names[i], NAPI_AUTO_LENGTH, &value);
+        napi_set_element(env, columns, i, value);
+        napi_create_uint32(env, (uint32_t)kinds[i], &value);
+        napi_set_element(env, column_kinds, i, value);
+    }
+    napi_set_named_property(env, obj, "columns", columns);
+    napi_set_named_property(env, obj, "kinds", column_kinds);
+    napi_create_double(env, (double)num_rows, &value);
+    napi_set_named_property(env, obj, "rows", value);
+    napi_set_named_property(env, obj, "buffer", buffer);
+    return obj;
+}
+
+napi_value result_to_packed(napi_env env, const PeekResult *result) {
+    size_t data_bytes = 0;
+    for (size_t c = 0; c < result->num_rows * result->num_fields; c++) {
+        if (!result->cells[c].is_null && kind_has_bytes(result->kinds[c % result->num_fields])) {
+            data_bytes += result->cells[c].length;
+        }
+    }
+
+    ResultRows rows = {.result = result, .next = 0};
+    return rows_to_packed(env, result->num_rows, result->num_fields, result->field_names, result->kinds, data_bytes,
+                          result_read_row, &rows);
+}
+
+napi_value result_serialized_to_packed(napi_env env, const uint8_t *data) {
+    SerializedHeader header;
+    if (!serialized_open(env, data, &header)) {
+        return NULL;
+    }
+
+    //? Step 1: Size the data area with a first pass over the cells
+    size_t data_bytes = 0;
+    SerializedRows rows = {.next = header.cells, .num_fields = header.num_fields, .kinds = header.kinds, .row = header.row};
+    for (uint64_t r = 0; r < header.num_rows; r++) {
+        const PeekCell *row = serialized_read_row(&rows);
+        for (uint32_t i = 0; i < header.num_fields; i++) {
+            if (!row[i].is_null && kind_has_bytes(header.kinds[i])) {
+                data_bytes += row[i].length;
+            }
+        }
+    }
+
+    //? Step 2: Pack them with a second
+    rows.next = header.cells;
+    napi_value packed = rows_to_packed(env, (size_t)header.num_rows, header.num_fields, header.field_names, header.kinds,
+                                       data_bytes, serialized_read_row, &rows);
+
+    serialized_close(&header);
+    return packed;
+}
+
+/** Compare bytes with ASCII letters folded, then by length */
+static int compare_folded(const char *a, unsigned long a_length, const char *b, unsigned long b_length) {
+    unsigned long length = a_length < b_length ? a_length : b_length;
+    for (unsigned long i = 0; i < length; i++) {
+        int difference = tolower((unsigned char)a[i]) - tolower((unsigned char)b[i]);
+        if (difference != 0) {
+            return difference;
+        }
+    }
+    return a_length < b_length ? -1 : a_length > b_length;
+}
+
+/** Compare two cells of a column, NULL first */
+static int compare_cells(ColumnKind kind, const PeekCell *a, const PeekCell *b) {
+    if (a->is_null || b->is_null) {
+        return (int)b->is_null - (int)a->is_null;
+    }
+
+    switch (kind) {
+    case COLUMN_INT:
+        return a->int_value < b->int_value ? -1 : a->int_value > b->int_value;
+    case COLUMN_UINT:
+        return a->uint_value < b->uint_value ? -1 : a->uint_value > b->uint_value;
+    case COLUMN_DOUBLE:
+    case COLUMN_DATETIME:
+        return a->double_value < b->double_value ? -1 : a->double_value > b->double_value;
+    case COLUMN_STRING:
+        return compare_folded(a->data, a->length, b->data, b->length);
+    case COLUMN_BINARY: {
+        int difference = memcmp(a->data, b->data, a->length < b->length ? a->length : b->length);
+        if (difference != 0) {
+            return difference;
+        }
+        return a->length < b->length ? -1 : a->length > b->length;
+    }
+    }
+    return 0;
+}
+
+/** Compare two rows on the merge keys */
+static int compare_rows(const PeekResult *result, const ResultSortKey *keys, size_t key_count, const PeekCell *a,
+                        const PeekCell *b) {
+    for (size_t k = 0; k < key_count; k++) {
+        unsigned int column = keys[k].column;
+        int order = compare_cells(result->kinds[column], &a[column], &b[column]);
+        if (order != 0) {
+            return keys[k].descending ? -order : order;
+        }
+    }
+    return 0;
+}
+
+PeekResult *result_merge(PeekResult **parts, size_t count, const ResultSortKey *keys, size_t key_count, size_t offset,
+                         size_t limit, char *error, size_t error_size) {
+    PeekResult *merged = parts[0];
+    unsigned int num_fields = merged->num_fields;
+    size_t *next = (size_t *)calloc(count, sizeof(size_t));
+    PeekCell *cells = NULL;
+
+    //? Step 1: Every part must have the columns of the first one
+    size_t total = 0;
+    bool same_columns = true;
+    for (size_t i = 0; i < count; i++) {
+        total += parts[i]->num_rows;
+        same_columns = same_columns && parts[i]->num_fields == num_fields &&
+                       memcmp(parts[i]->kinds, merged->kinds, num_fields * sizeof(ColumnKind)) == 0;
+    }
+    for (size_t k = 0; k < key_count; k++) {
+        same_columns = same_columns && keys[k].column < num_fields;
+    }
+    if (!same_columns) {
+        snprintf(error, error_size, "Cannot merge result sets of different columns");
+        goto fail;
+    }
+
+    if (offset > total) {
+        offset = total;
+    }
+    size_t rows = total - offset;
+    if (rows > limit) {
+        rows = limit;
+    }
+    if (!next || !(cells = (PeekCell *)malloc((rows ? rows : 1) * (num_fields ? num_fields : 1) * sizeof(PeekCell)))) {
+        snprintf(error, error_size, "Out of memory");
+        goto fail;
+    }
+
+    //? Step 2: Take the smallest head of the parts until `offset + rows` rows were taken, the first part wins ties
+    for (size_t taken = 0; taken < offset + rows; taken++) {
+        size_t best = count;
+        for (size_t i = 0; i < count; i++) {
+            if (next[i] == parts[i]->num_rows) {
+                continue;
+            }
+            if (best == count) {
+                best = i;
+                if (key_count == 0) {
+                    break;
+                }
+                continue;
+            }
+            const PeekCell *row = parts[i]->cells + next[i] * num_fields;
+            const PeekCell *best_row = parts[best]->cells + next[best] * num_fields;
+            if (compare_rows(merged, keys, key_count, row, best_row) < 0) {
+                best = i;
+            }
+        }
+
+        const PeekCell *row = parts[best]->cells + next[best]++ * num_fields;
+        if (taken >= offset) {
+            memcpy(cells + (taken - offset) * num_fields, row, num_fields * sizeof(PeekCell));
+        }
+    }
+
+    //? Step 3: The first part takes the merged rows and the memory their bytes live in
+    free(merged->cells);
+    merged->cells = cells;
+    merged->num_rows = merged->capacity = rows;
+    for (size_t i = 1; i < count; i++) {
+        merged->bytes += parts[i]->bytes;
+        arena_adopt(&merged->arena, &parts[i]->arena);
+        result_free(parts[i]);
+        parts[i] = NULL;
+    }
+    free(next);
+    return merged;
+
+fail:
+    free(next);
+    for (size_t i = 0; i < count; i++) {
+        result_free(parts[i]);
+        parts[i] = NULL;
+    }
+    return NULL;
+}
+
+void result_free(PeekResult *result) {
+    if (!result) {
+        return;
+    }
+
+    arena_destroy(&result->arena);
+    free(result->cells);
+    free(result);
+}
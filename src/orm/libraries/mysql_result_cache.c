@@ -0,0 +1,621 @@
+#include "../include/mysql_result_cache.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_result.h"
+#include "../include/mysql_sql.h"
+#include "../include/mysql_util.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/** Initial number of entry buckets, doubled whenever there are more entries than buckets */
+#define RESULT_CACHE_INITIAL_BUCKETS 64
+
+// =========================== STATEMENT SCANNER ===========================
+
+/** Table named by a statement, pointing into its text */
+typedef struct {
+    const char *name;
+    size_t length;
+} TableName;
+
+/** What a statement reads or writes */
+typedef struct {
+    TableName tables[RESULT_CACHE_MAX_TABLES];
+    int count;
+    bool overflow;  // Named more than `RESULT_CACHE_MAX_TABLES` tables
+    bool cacheable; // Plain deterministic SELECT
+} StatementInfo;
+
+/** Whether a token is one of the keywords of a NULL terminated list */
+static bool token_in(const SqlToken *token, const char *const *words) {
+    for (; *words; words++) {
+        if (sql_is_keyword(token, *words)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Keywords followed by a table name */
+static const char *const TABLE_KEYWORDS[] = {"FROM", "JOIN", "UPDATE", "INTO", "TABLE", NULL};
+
+/** Keywords skipped between a table keyword and the table name */
+static const char *const TABLE_MODIFIERS[] = {
+    "IF", "NOT", "EXISTS", "IGNORE", "LOW_PRIORITY", "HIGH_PRIORITY", "DELAYED", "QUICK", "TABLE", "ONLY", NULL};
+
+/** Keywords that may follow a table name, so they are never taken as its alias */
+static const char *const CLAUSE_KEYWORDS[] = {
+    "WHERE", "JOIN", "INNER", "LEFT", "RIGHT", "CROSS", "NATURAL", "STRAIGHT_JOIN", "ON", "USING",
+    "GROUP", "ORDER", "LIMIT", "HAVING", "WINDOW", "SET", "VALUES", "VALUE", "SELECT", "UNION",
+    "EXCEPT", "INTERSECT", "FOR", "LOCK", "PARTITION", "USE", "FORCE", "IGNORE", "INTO", "FIELDS",
+    "COLUMNS", "LINES", "CHARACTER", "ADD", "DROP", "MODIFY", "CHANGE", "RENAME", "ALTER", "LIKE",
+    "TO", "AFTER", "BEFORE", "FROM", "TABLE", NULL};
+
+/** Functions whose result changes between calls, only when followed by `(` */
+static const char *const VOLATILE_FUNCTIONS[] = {
+    "NOW", "RAND", "UUID", "UUID_SHORT", "SYSDATE", "CURDATE", "CURTIME", "UNIX_TIMESTAMP", "LAST_INSERT_ID",
+    "CONNECTION_ID", "FOUND_ROWS", "ROW_COUNT", "SLEEP", "GET_LOCK", "USER", "SESSION_USER", "SYSTEM_USER", NULL};
+
+/** Keywords that read the clock, the session or locks, so the result must not be cached */
+static const char *const VOLATILE_KEYWORDS[] = {
+    "CURRENT_TIMESTAMP", "CURRENT_DATE", "CURRENT_TIME", "CURRENT_USER", "LOCALTIME", "LOCALTIMESTAMP",
+    "UTC_TIMESTAMP", "UTC_DATE", "UTC_TIME", "FOR", "LOCK", "INTO", NULL};
+
+/** Record the table an identifier names, without its backquotes */
+static void add_table(StatementInfo *info, const SqlToken *token) {
+    const char *name = token->start;
+    size_t length = token->length;
+    if (*name == '`') {
+        name++;
+        length = length >= 2 ? length - 2 : 0;
+    }
+    if (length == 4 && strncasecmp(name, "DUAL", 4) == 0) {
+        return;
+    }
+    for (int i = 0; i < info->count; i++) {
+        if (info->tables[i].length == length && strncasecmp(info->tables[i].name, name, length) == 0) {
+            return;
+        }
+    }
+    if (info->count == RESULT_CACHE_MAX_TABLES) {
+        info->overflow = true;
+        return;
+    }
+    info->tables[info->count++] = (TableName){name, length};
+}
+
+/**
+ * Read the tables following a table keyword
+ * - `db.table` names the table, `list` also reads `table [AS] alias, table ...`
+ * - Leaves `token` at the first token that is not part of the table list
+ */
+static void read_tables(const char **pos, SqlToken *token, bool list, StatementInfo *info) {
+    do {
+        *pos = sql_next_token(*pos, token);
+        while (token_in(token, TABLE_MODIFIERS)) {
+            *pos = sql_next_token(*pos, token);
+        }
+        if (token->kind != SQL_TOKEN_IDENTIFIER || token_in(token, CLAUSE_KEYWORDS)) {
+            return; // Derived table, variable or no table at all
+        }
+
+        SqlToken name = *token;
+        *pos = sql_next_token(*pos, token);
+        if (sql_is_symbol(token, '.')) {
+            *pos = sql_next_token(*pos, token);
+            if (token->kind != SQL_TOKEN_IDENTIFIER) {
+                return;
+            }
+            name = *token;
+            *pos = sql_next_token(*pos, token);
+        }
+        add_table(info, &name);
+
+        if (!list) {
+            return;
+        }
+        if (sql_is_keyword(token, "AS")) {
+            *pos = sql_next_token(*pos, token);
+        }
+        if (token->kind == SQL_TOKEN_IDENTIFIER && !token_in(token, CLAUSE_KEYWORDS)) {
+            *pos = sql_next_token(*pos, token); // Alias
+        }
+    } while (sql_is_symbol(token, ','));
+}
+
+/** Find the tables a statement reads or writes and whether its result can be cached */
+static void scan_statement(const char *sql, StatementInfo *info) {
+    memset(info, 0, sizeof(StatementInfo));
+
+    SqlToken token;
+    const char *pos = sql_next_token(sql, &token);
+    while (sql_is_symbol(&token, '(')) {
+        pos = sql_next_token(pos, &token);
+    }
+
+    bool select = sql_is_keyword(&token, "SELECT") || sql_is_keyword(&token, "WITH");
+    bool ddl = sql_is_keyword(&token, "CREATE") || sql_is_keyword(&token, "ALTER") || sql_is_keyword(&token, "DROP");
+    bool cacheable = select;
+
+    if (sql_is_keyword(&token, "TRUNCATE")) {
+        read_tables(&pos, &token, false, info);
+    }
+
+    while (token.kind != SQL_TOKEN_END) {
+        if (token.kind == SQL_TOKEN_IDENTIFIER) {
+            if (select && token_in(&token, VOLATILE_KEYWORDS)) {
+                cacheable = false;
+            } else if (select && token_in(&token, VOLATILE_FUNCTIONS)) {
+                SqlToken next;
+                sql_next_token(pos, &next);
+                cacheable = cacheable && !sql_is_symbol(&next, '(');
+            }
+
+            if (token_in(&token, TABLE_KEYWORDS) || (ddl && sql_is_keyword(&token, "ON"))) {
+                bool list = sql_is_keyword(&token, "FROM") || sql_is_keyword(&token, "UPDATE") ||
+                            sql_is_keyword(&token, "TABLE");
+                read_tables(&pos, &token, list, info);
+                continue;
+            }
+        } else if (sql_is_symbol(&token, '@')) {
+            cacheable = false; // User or system variable
+        }
+        pos = sql_next_token(pos, &token);
+    }
+
+    info->cacheable = cacheable && info->count > 0 && !info->overflow;
+}
+
+// =========================== CACHE KEY ===========================
+
+/** Append SQL text with whitespace runs outside quotes collapsed and trailing whitespace and `;` dropped */
+static bool key_append_sql(SqlBuffer *key, const char *sql) {
+    char quote = 0;
+    bool space = false;
+
+    for (const char *p = sql; *p; p++) {
+        char c = *p;
+        if (quote) {
+            if (c == '\\' && quote != '`' && p[1]) {
+                if (!sql_append(key, p, 2)) {
+                    return false;
+                }
+                p++;
+                continue;
+            }
+            if (c == quote) {
+                quote = 0;
+            }
+        } else if (isspace((unsigned char)c)) {
+            space = true;
+            continue;
+        } else if (c == '\'' || c == '"' || c == '`') {
+            quote = c;
+        }
+
+        if (space && key->length > 0 && !sql_append(key, " ", 1)) {
+            return false;
+        }
+        space = false;
+        if (!sql_append(key, &c, 1)) {
+            return false;
+        }
+    }
+
+    while (!quote && key->length > 0 && (key->data[key->length - 1] == ';' || key->data[key->length - 1] == ' ')) {
+        key->data[--key->length] = '\0';
+    }
+    return true;
+}
+
+/** Append placeholder values, each tagged with its type so `1` and `'1'` stay different keys */
+static bool key_append_params(SqlBuffer *key, const PeekParams *params) {
+    for (size_t i = 0; params && i < params->count; i++) {
+        const PeekParam *param = &params->items[i];
+        char tag = param->is_null ? (char)0xFF : (char)param->type;
+        if (!sql_append(key, &tag, 1)) {
+            return false;
+        }
+        if (param->is_null) {
+            continue;
+        }
+
+        bool ok = true;
+        switch (param->type) {
+        case PARAM_INT:
+            ok = sql_append(key, (const char *)&param->int_value, sizeof(param->int_value));
+            break;
+        case PARAM_DOUBLE:
+            ok = sql_append(key, (const char *)&param->double_value, sizeof(param->double_value));
+            break;
+        case PARAM_STRING:
+        case PARAM_BLOB: {
+            uint64_t length = param->length;
+            ok = sql_append(key, (const char *)&length, sizeof(length)) && sql_append(key, param->data, param->length);
+            break;
+        }
+        case PARAM_DATETIME: {
+            const MYSQL_TIME *time = &param->time_value;
+            unsigned long parts[7] = {time->year, time->month, time->day, time->hour, time->minute, time->second, time->second_part};
+            ok = sql_append(key, (const char *)parts, sizeof(parts));
+            break;
+        }
+        case PARAM_NULL:
+        default:
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// =========================== TABLES ===========================
+
+/** Find the generation of a table, `create` adds it when missing. Caller holds the lock */
+static ResultCacheTable *table_find(ResultCache *cache, const char *name, size_t length, bool create) {
+    ResultCacheTable **bucket = &cache->tables[util_hash_folded(name, length) % RESULT_CACHE_TABLE_BUCKETS];
+    for (ResultCacheTable *table = *bucket; table; table = table->next) {
+        if (strlen(table->name) == length && strncasecmp(table->name, name, length) == 0) {
+            return table;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    ResultCacheTable *table = (ResultCacheTable *)calloc(1, sizeof(ResultCacheTable));
+    if (!table || !(table->name = (char *)malloc(length + 1))) {
+        free(table);
+        return NULL;
+    }
+    for (size_t i = 0; i < length; i++) {
+        table->name[i] = (char)tolower((unsigned char)name[i]);
+    }
+    table->name[length] = '\0';
+    table->next = *bucket;
+    *bucket = table;
+    return table;
+}
+
+/** Whether a table it read was written since the dependencies were taken. Caller holds the lock */
+static bool dependencies_stale(const ResultCache *cache, uint64_t epoch, const ResultCacheDependency *tables, int count) {
+    if (epoch != cache->epoch) {
+        return true;
+    }
+    for (int i = 0; i < count; i++) {
+        if (tables[i].table->generation != tables[i].generation) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// =========================== ENTRIES ===========================
+
+/** Unlink an entry from the LRU list */
+static void lru_unlink(ResultCache *cache, ResultCacheEntry *entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+    entry->prev = entry->next = NULL;
+}
+
+/** Link an entry as most recently used */
+static void lru_push_front(ResultCache *cache, ResultCacheEntry *entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) {
+        cache->head->prev = entry;
+    }
+    cache->head = entry;
+    if (!cache->tail) {
+        cache->tail = entry;
+    }
+}
+
+/** Drop one reference of a result. Caller holds the lock */
+static void result_unref(CachedResult *result) {
+    if (--result->refs == 0) {
+        free(result);
+    }
+}
+
+/** Remove an entry from the cache. Caller holds the lock */
+static void entry_remove(ResultCache *cache, ResultCacheEntry *entry) {
+    ResultCacheEntry **link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link && *link != entry) {
+        link = &(*link)->bucket;
+    }
+    if (*link) {
+        *link = entry->bucket;
+    }
+
+    lru_unlink(cache, entry);
+    cache->stats.entries--;
+    cache->stats.bytes -= entry->bytes;
+    result_unref(entry->result);
+    free(entry->key);
+    free(entry);
+}
+
+/** Look up an entry by key. Caller holds the lock */
+static ResultCacheEntry *entry_find(ResultCache *cache, const char *key, size_t length, uint64_t hash) {
+    for (ResultCacheEntry *entry = cache->buckets[hash & (cache->bucket_count - 1)]; entry; entry = entry->bucket) {
+        if (entry->hash == hash && entry->key_length == length && memcmp(entry->key, key, length) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/** Double the buckets once there are more entries than buckets. Caller holds the lock */
+static void buckets_grow(ResultCache *cache) {
+    if (cache->stats.entries <= cache->bucket_count) {
+        return;
+    }
+
+    size_t count = cache->bucket_count * 2;
+    ResultCacheEntry **buckets = (ResultCacheEntry **)calloc(count, sizeof(ResultCacheEntry *));
+    if (!buckets) {
+        return; // Longer chains, still correct
+    }
+
+    for (ResultCacheEntry *entry = cache->head; entry; entry = entry->next) {
+        ResultCacheEntry **bucket = &buckets[entry->hash & (count - 1)];
+        entry->bucket = *bucket;
+        *bucket = entry;
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = count;
+}
+
+// =========================== CACHE ===========================
+
+ResultCache *result_cache_create(size_t max_bytes, int ttl_ms) {
+    ResultCache *cache = (ResultCache *)calloc(1, sizeof(ResultCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->bucket_count = RESULT_CACHE_INITIAL_BUCKETS;
+    cache->buckets = (ResultCacheEntry **)calloc(cache->bucket_count, sizeof(ResultCacheEntry *));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->max_bytes = max_bytes;
+    cache->ttl_ms = ttl_ms;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+void result_cache_destroy(ResultCache *cache) {
+    if (!cache) {
+        return;
+    }
+
+    result_cache_clear(cache);
+    for (int i = 0; i < RESULT_CACHE_TABLE_BUCKETS; i++) {
+        ResultCacheTable *table = cache->tables[i];
+        while (table) {
+            ResultCacheTable *next = table->next;
+            free(table->name);
+            free(table);
+            table = next;
+        }
+    }
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+}
+
+CachedResult *result_cache_lookup(ResultCache *cache, const char *sql, const PeekParams *params, ResultCacheTicket *ticket) {
+    //? Step 1: Only plain deterministic SELECTs are cached
+    StatementInfo info;
+    scan_statement(sql, &info);
+    if (!info.cacheable) {
+        return NULL;
+    }
+
+    //? Step 2: Build the key outside the lock
+    SqlBuffer key = {0};
+    if (!key_append_sql(&key, sql) || !sql_append(&key, "", 1) || !key_append_params(&key, params)) {
+        sql_free(&key);
+        return NULL;
+    }
+    uint64_t hash = util_hash(key.data, key.length);
+
+    pthread_mutex_lock(&cache->lock);
+
+    //? Step 3: A hit is only served while no table it read was written and its TTL has not passed
+    ResultCacheEntry *entry = entry_find(cache, key.data, key.length, hash);
+    if (entry && dependencies_stale(cache, entry->epoch, entry->tables, entry->table_count)) {
+        cache->stats.invalidations++;
+        entry_remove(cache, entry);
+        entry = NULL;
+    } else if (entry && entry->expires_ms && util_now_ms() >= entry->expires_ms) {
+        cache->stats.expirations++;
+        entry_remove(cache, entry);
+        entry = NULL;
+    }
+
+    if (entry) {
+        if (cache->head != entry) {
+            lru_unlink(cache, entry);
+            lru_push_front(cache, entry);
+        }
+        CachedResult *result = entry->result;
+        result->refs++;
+        cache->stats.hits++;
+        pthread_mutex_unlock(&cache->lock);
+        sql_free(&key);
+        return result;
+    }
+
+    //? Step 4: On a miss, take the generations before the statement runs
+    cache->stats.misses++;
+    ticket->epoch = cache->epoch;
+    ticket->table_count = 0;
+    for (int i = 0; i < info.count; i++) {
+        ResultCacheTable *table = table_find(cache, info.tables[i].name, info.tables[i].length, true);
+        if (!table) {
+            pthread_mutex_unlock(&cache->lock);
+            sql_free(&key);
+            return NULL;
+        }
+        ticket->tables[ticket->table_count++] = (ResultCacheDependency){table, table->generation};
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    // The key is kept by the entry, so drop the spare capacity of the buffer
+    char *data = (char *)realloc(key.data, key.length);
+    ticket->key = data ? data : key.data;
+    ticket->key_length = key.length;
+    ticket->hash = hash;
+    return NULL;
+}
+
+void result_cache_store(ResultCache *cache, ResultCacheTicket *ticket, const PeekResult *result) {
+    if (!ticket->key || !result) {
+        return;
+    }
+
+    //? Step 1: Serialize outside the lock
+    size_t size = result_serialized_size(result);
+    size_t bytes = sizeof(ResultCacheEntry) + sizeof(CachedResult) + size + ticket->key_length;
+    if (bytes > cache->max_bytes) {
+        return;
+    }
+
+    CachedResult *cached = (CachedResult *)malloc(sizeof(CachedResult) + size);
+    ResultCacheEntry *entry = (ResultCacheEntry *)calloc(1, sizeof(ResultCacheEntry));
+    if (!cached || !entry) {
+        free(cached);
+        free(entry);
+        return;
+    }
+    cached->refs = 1;
+    cached->size = size;
+    result_serialize(result, cached->data);
+
+    pthread_mutex_lock(&cache->lock);
+
+    //? Step 2: A write ran while the statement did, its result may already be stale
+    if (dependencies_stale(cache, ticket->epoch, ticket->tables, ticket->table_count)) {
+        pthread_mutex_unlock(&cache->lock);
+        free(cached);
+        free(entry);
+        return;
+    }
+
+    //? Step 3: Replace a concurrent result of the same key, then evict until the entry fits
+    ResultCacheEntry *existing = entry_find(cache, ticket->key, ticket->key_length, ticket->hash);
+    if (existing) {
+        entry_remove(cache, existing);
+    }
+    while (cache->tail && cache->stats.bytes + bytes > cache->max_bytes) {
+        cache->stats.evictions++;
+        entry_remove(cache, cache->tail);
+    }
+
+    //? Step 4: Insert as most recently used, the entry takes over the ticket's key
+    entry->key = ticket->key;
+    entry->key_length = ticket->key_length;
+    entry->hash = ticket->hash;
+    entry->result = cached;
+    memcpy(entry->tables, ticket->tables, (size_t)ticket->table_count * sizeof(ResultCacheDependency));
+    entry->table_count = ticket->table_count;
+    entry->epoch = ticket->epoch;
+    entry->expires_ms = cache->ttl_ms > 0 ? util_now_ms() + (uint64_t)cache->ttl_ms : 0;
+    entry->bytes = bytes;
+    ticket->key = NULL;
+
+    ResultCacheEntry **bucket = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    entry->bucket = *bucket;
+    *bucket = entry;
+    lru_push_front(cache, entry);
+    cache->stats.entries++;
+    cache->stats.bytes += bytes;
+    buckets_grow(cache);
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void result_cache_release(ResultCache *cache, CachedResult *result) {
+    if (!result) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    result_unref(result);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void result_cache_ticket_free(ResultCacheTicket *ticket) {
+    free(ticket->key);
+    ticket->key = NULL;
+}
+
+void result_cache_invalidate(ResultCache *cache, const char *sql) {
+    StatementInfo info;
+    scan_statement(sql, &info);
+
+    pthread_mutex_lock(&cache->lock);
+    if (info.count == 0 || info.overflow) {
+        cache->epoch++;
+    } else {
+        // Entries are dropped lazily, when a lookup or the LRU reaches them
+        for (int i = 0; i < info.count; i++) {
+            ResultCacheTable *table = table_find(cache, info.tables[i].name, info.tables[i].length, false);
+            if (table) {
+                table->generation++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void result_cache_invalidate_table(ResultCache *cache, const char *table) {
+    pthread_mutex_lock(&cache->lock);
+    if (!table) {
+        cache->epoch++;
+    } else {
+        const char *dot = strrchr(table, '.');
+        const char *name = dot ? dot + 1 : table;
+        ResultCacheTable *found = table_find(cache, name, strlen(name), false);
+        if (found) {
+            found->generation++;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void result_cache_clear(ResultCache *cache) {
+    pthread_mutex_lock(&cache->lock);
+    while (cache->head) {
+        entry_remove(cache, cache->head);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void result_cache_stats(ResultCache *cache, ResultCacheStats *stats) {
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
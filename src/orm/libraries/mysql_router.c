@@ -0,0 +1,246 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_router.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_util.h"
+#include <mysql.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Open the health check connection of a replica */
+static MYSQL *open_probe(const ConnectionPool *pool) {
+    MYSQL *probe = peek_driver->init(NULL);
+    if (!probe) {
+        return NULL;
+    }
+
+    unsigned int timeout = REPLICA_PROBE_TIMEOUT_S;
+    peek_driver->options(probe, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    peek_driver->options(probe, MYSQL_OPT_READ_TIMEOUT, &timeout);
+    peek_driver->options(probe, MYSQL_OPT_WRITE_TIMEOUT, &timeout);
+
+    if (!peek_driver->real_connect(probe, pool->host, pool->user, pool->password, pool->database, pool->port, NULL, 0)) {
+        peek_driver->close(probe);
+        return NULL;
+    }
+    return probe;
+}
+
+/**
+ * Whether a replica answers, reconnecting its probe when needed
+ * @note Only called by one thread at a time: `router_create`, then the health check thread
+ */
+static bool probe_replica(ReplicaNode *node) {
+    if (!node->probe) {
+        node->probe = open_probe(node->pool);
+    }
+    if (pool_validate_connection(node->probe)) {
+        return true;
+    }
+    if (node->probe) {
+        peek_driver->close(node->probe);
+        node->probe = NULL;
+    }
+    return false;
+}
+
+/** Update the health of a replica after a probe. Caller holds the lock */
+static void set_healthy(ReplicaNode *node, bool healthy) {
+    if (node->healthy && !healthy) {
+        node->ejections++;
+    }
+    node->healthy = healthy;
+}
+
+/**
+ * ## Replica health check loop
+ * - Every `check_interval_ms`, probes every replica outside the lock
+ * - Ejects the ones that stopped answering and re-adds the ones that answer again
+ */
+static void *check_loop(void *arg) {
+    ReplicaRouter *router = (ReplicaRouter *)arg;
+    bool *healthy = (bool *)calloc(router->replica_count, sizeof(bool));
+    if (!healthy) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&router->lock);
+    while (!router->stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += router->check_interval_ms / 1000;
+        deadline.tv_nsec += (long)(router->check_interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&router->check_cond, &router->lock, &deadline);
+        if (router->stopping) {
+            break;
+        }
+        pthread_mutex_unlock(&router->lock);
+
+        for (int i = 0; i < router->replica_count; i++) {
+            healthy[i] = probe_replica(&router->replicas[i]);
+        }
+
+        pthread_mutex_lock(&router->lock);
+        for (int i = 0; i < router->replica_count; i++) {
+            set_healthy(&router->replicas[i], healthy[i]);
+        }
+    }
+    pthread_mutex_unlock(&router->lock);
+
+    free(healthy);
+    return NULL;
+}
+
+ReplicaRouter *router_create(const ReplicaConfig *replicas, int count, const ConnectionPool *primary, int read_your_writes_ms,
+                             int check_interval_ms) {
+    ReplicaRouter *router = (ReplicaRouter *)calloc(1, sizeof(ReplicaRouter));
+    if (!router) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&router->lock, NULL);
+    pthread_cond_init(&router->check_cond, NULL);
+    router->read_your_writes_ms = read_your_writes_ms;
+    router->check_interval_ms = check_interval_ms;
+
+    if (!(router->replicas = (ReplicaNode *)calloc(count > 0 ? count : 1, sizeof(ReplicaNode)))) {
+        router_destroy(router);
+        return NULL;
+    }
+
+    // Replicas only serve reads: no LOAD DATA, no event loop pool
+    PoolOptions options = primary->options;
+    options.local_infile = false;
+    options.event_loop = false;
+
+    //? Step 1: One pool per replica, an unreachable replica gets a pool that opens connections on demand
+    for (int i = 0; i < count; i++) {
+        const ReplicaConfig *config = &replicas[i];
+        const char *host = config->host ? config->host : primary->host;
+        const char *user = config->user ? config->user : primary->user;
+        const char *password = config->password ? config->password : primary->password;
+        const char *database = config->database ? config->database : primary->database;
+        int port = config->port > 0 ? config->port : primary->port;
+
+        ReplicaNode *node = &router->replicas[i];
+        if (!(node->pool = pool_create(host, user, password, database, port, &options))) {
+            PoolOptions lazy = options;
+            lazy.min_size = 0;
+            node->pool = pool_create(host, user, password, database, port, &lazy);
+        }
+        if (!node->pool) {
+            router_destroy(router);
+            return NULL;
+        }
+        router->replica_count++;
+
+        //? Step 2: Probe it once, reads only go to replicas known to answer
+        node->healthy = probe_replica(node);
+    }
+
+    if (check_interval_ms > 0) {
+        router->check_running = pthread_create(&router->check_thread, NULL, check_loop, router) == 0;
+    }
+    return router;
+}
+
+void router_destroy(ReplicaRouter *router) {
+    if (!router) {
+        return;
+    }
+
+    // Stop the health check first, it uses the probes
+    pthread_mutex_lock(&router->lock);
+    router->stopping = true;
+    pthread_cond_signal(&router->check_cond);
+    pthread_mutex_unlock(&router->lock);
+
+    if (router->check_running) {
+        pthread_join(router->check_thread, NULL);
+    }
+
+    for (int i = 0; i < router->replica_count; i++) {
+        ReplicaNode *node = &router->replicas[i];
+        if (node->probe) {
+            peek_driver->close(node->probe);
+        }
+        pool_destroy(node->pool);
+    }
+
+    pthread_cond_destroy(&router->check_cond);
+    pthread_mutex_destroy(&router->lock);
+    free(router->replicas);
+    free(router);
+}
+
+ReplicaNode *router_acquire(ReplicaRouter *router) {
+    pthread_mutex_lock(&router->lock);
+
+    //? Step 1: Read your writes: stay on the primary right after a write
+    if (router->read_your_writes_ms > 0 && router->last_write_ms &&
+        util_now_ms() - router->last_write_ms < (uint64_t)router->read_your_writes_ms) {
+        pthread_mutex_unlock(&router->lock);
+        return NULL;
+    }
+
+    //? Step 2: Least outstanding reads among healthy replicas, starting after the last pick
+    ReplicaNode *best = NULL;
+    int best_index = 0;
+    for (int i = 0; i < router->replica_count; i++) {
+        int index = (router->next + i) % router->replica_count;
+        ReplicaNode *node = &router->replicas[index];
+        if (node->healthy && (!best || node->outstanding < best->outstanding)) {
+            best = node;
+            best_index = index;
+        }
+    }
+
+    if (best) {
+        best->outstanding++;
+        best->reads++;
+        router->next = (best_index + 1) % router->replica_count;
+    }
+
+    pthread_mutex_unlock(&router->lock);
+    return best;
+}
+
+void router_release(ReplicaRouter *router, ReplicaNode *node, bool lost) {
+    pthread_mutex_lock(&router->lock);
+    node->outstanding--;
+    if (lost) {
+        set_healthy(node, false);
+    }
+    pthread_mutex_unlock(&router->lock);
+}
+
+void router_note_write(ReplicaRouter *router) {
+    if (router->read_your_writes_ms <= 0) {
+        return;
+    }
+    pthread_mutex_lock(&router->lock);
+    router->last_write_ms = util_now_ms();
+    pthread_mutex_unlock(&router->lock);
+}
+
+void router_status(ReplicaRouter *router, ReplicaStatus *statuses) {
+    pthread_mutex_lock(&router->lock);
+    for (int i = 0; i < router->replica_count; i++) {
+        const ReplicaNode *node = &router->replicas[i];
+        statuses[i] = (ReplicaStatus){
+            .host = node->pool->host,
+            .port = node->pool->port,
+            .healthy = node->healthy,
+            .outstanding = node->outstanding,
+            .reads = node->reads,
+            .ejections = node->ejections,
+        };
+    }
+    pthread_mutex_unlock(&router->lock);
+}
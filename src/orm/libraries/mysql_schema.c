@@ -0,0 +1,1254 @@
+#include "../include/mysql_schema.h"
+#include "../include/mysql_driver.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_sql.h"
+#include "../include/mysql_util.h"
+#include <ctype.h>
+#include <mysql.h>
+#include <mysqld_error.h>
+#include <node_api.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/** ALTER TABLE clauses tried in order, the next one only when the server cannot run the previous one */
+static const char *const ALTER_ALGORITHMS[] = {", ALGORITHM=INSTANT", ", ALGORITHM=INPLACE, LOCK=NONE", ""};
+static const char *const ALTER_ALGORITHM_NAMES[] = {"instant", "inplace", "copy"};
+#define ALTER_ALGORITHM_COUNT 3
+
+// =========================== NAME SETS ===========================
+
+/**
+ * Open addressing set of names, case-insensitive like MySQL table and column names
+ * - Maps a name to its index in the array it was built from
+ */
+typedef struct {
+    const char **names; // NULL for an empty slot
+    size_t *indexes;
+    size_t mask;
+} NameSet;
+
+/** Allocate a set for up to `count` names, kept at most half full */
+static bool name_set_init(NameSet *set, size_t count) {
+    size_t capacity = 8;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    set->names = (const char **)calloc(capacity, sizeof(const char *));
+    set->indexes = (size_t *)calloc(capacity, sizeof(size_t));
+    set->mask = capacity - 1;
+    return set->names && set->indexes;
+}
+
+/** Add a name, the first index wins for duplicates */
+static void name_set_add(NameSet *set, const char *name, size_t index) {
+    size_t slot = (size_t)util_hash_folded(name, strlen(name)) & set->mask;
+    while (set->names[slot]) {
+        if (strcasecmp(set->names[slot], name) == 0) {
+            return;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+    set->names[slot] = name;
+    set->indexes[slot] = index;
+}
+
+/** Find a name, false when it is not in the set */
+static bool name_set_find(const NameSet *set, const char *name, size_t *index) {
+    size_t slot = (size_t)util_hash_folded(name, strlen(name)) & set->mask;
+    while (set->names[slot]) {
+        if (strcasecmp(set->names[slot], name) == 0) {
+            *index = set->indexes[slot];
+            return true;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+    return false;
+}
+
+static void name_set_free(NameSet *set) {
+    free(set->names);
+    free(set->indexes);
+    memset(set, 0, sizeof(NameSet));
+}
+
+/** Index the tables of a sync by name */
+static bool table_set_init(NameSet *set, const SchemaTables *tables) {
+    if (!name_set_init(set, tables->count)) {
+        name_set_free(set);
+        return false;
+    }
+    for (size_t i = 0; i < tables->count; i++) {
+        name_set_add(set, tables->items[i].name, i);
+    }
+    return true;
+}
+
+/** Table of the sync by name, NULL when it is not part of it */
+static SchemaTable *find_table(const NameSet *set, SchemaTables *tables, const char *name) {
+    size_t index;
+    return name_set_find(set, name, &index) ? &tables->items[index] : NULL;
+}
+
+// =========================== DEFINITIONS ===========================
+
+static bool is_word_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '$' || c == '.';
+}
+
+static const char *skip_spaces(const char *p) {
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+/** End of the token at `p`: a quoted string or identifier, a parenthesized group, a word, or one character */
+static const char *token_end(const char *p) {
+    if (*p == '\'' || *p == '"' || *p == '`') {
+        char quote = *p++;
+        while (*p) {
+            if (*p == '\\' && quote != '`' && p[1]) {
+                p += 2;
+            } else if (*p == quote && p[1] == quote) {
+                p += 2;
+            } else if (*p == quote) {
+                return p + 1;
+            } else {
+                p++;
+            }
+        }
+        return p;
+    }
+    if (*p == '(') {
+        int depth = 0;
+        while (*p) {
+            if (*p == '\'' || *p == '"' || *p == '`') {
+                p = token_end(p);
+                continue;
+            }
+            depth += *p == '(' ? 1 : *p == ')' ? -1 : 0;
+            if (*p++ == ')' && depth == 0) {
+                break;
+            }
+        }
+        return p;
+    }
+    if (is_word_char(*p)) {
+        while (is_word_char(*p)) {
+            p++;
+        }
+        return p;
+    }
+    return *p ? p + 1 : p;
+}
+
+/** Whether the token `[start, end)` is `word`, case-insensitively */
+static bool token_is(const char *start, const char *end, const char *word) {
+    size_t length = strlen(word);
+    return (size_t)(end - start) == length && strncasecmp(start, word, length) == 0;
+}
+
+/** Copy `[start, end)` lowercased outside quotes, with one space before a word and none around punctuation */
+static size_t normalize_text(const char *start, const char *end, char *out, size_t size) {
+    size_t length = 0;
+    bool space = false;
+    char quote = 0;
+    for (const char *p = start; p < end && length + 2 < size; p++) {
+        char c = *p;
+        if (quote) {
+            out[length++] = c;
+            if (c == '\\' && p + 1 < end) {
+                out[length++] = *++p;
+            } else if (c == quote) {
+                quote = 0;
+            }
+        } else if (isspace((unsigned char)c)) {
+            space = true;
+        } else {
+            if (space && length > 0 && (is_word_char(out[length - 1]) || out[length - 1] == ')') && is_word_char(c)) {
+                out[length++] = ' ';
+            }
+            space = false;
+            quote = c == '\'' || c == '"' ? c : 0;
+            out[length++] = (char)tolower((unsigned char)c);
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+/**
+ * ## Fold a column type for comparison
+ * - Synonyms: INTEGER is INT, BOOL is TINYINT, NUMERIC is DECIMAL, JSON is LONGTEXT (as MariaDB stores it)
+ * - Integer display widths are dropped, MySQL 8 no longer reports them
+ * - Implicit lengths are filled in: DECIMAL is DECIMAL(10,0), CHAR is CHAR(1)
+ */
+static void normalize_type(const char *start, const char *end, char *out, size_t size) {
+    static const char *const synonyms[][2] = {
+        {"integer", "int"},  {"bool", "tinyint"},  {"boolean", "tinyint"}, {"dec", "decimal"},
+        {"numeric", "decimal"}, {"fixed", "decimal"}, {"real", "double"},  {"json", "longtext"},
+    };
+    static const char *const integers[] = {"tinyint", "smallint", "mediumint", "int", "bigint", "year"};
+
+    char text[SCHEMA_TYPE_SIZE];
+    normalize_text(start, end, text, sizeof(text));
+
+    //? Step 1: Base type, through its synonyms
+    char base[32];
+    size_t word = 0;
+    while (text[word] && is_word_char(text[word])) {
+        word++;
+    }
+    snprintf(base, sizeof(base), "%.*s", (int)word, text);
+    for (size_t i = 0; i < sizeof(synonyms) / sizeof(synonyms[0]); i++) {
+        if (strcmp(base, synonyms[i][0]) == 0) {
+            snprintf(base, sizeof(base), "%s", synonyms[i][1]);
+            break;
+        }
+    }
+
+    //? Step 2: Length and precision
+    const char *rest = text + word;
+    const char *close = rest[0] == '(' ? strchr(rest, ')') : NULL;
+    char group[64] = "";
+    bool integer = false;
+    for (size_t i = 0; i < sizeof(integers) / sizeof(integers[0]); i++) {
+        integer = integer || strcmp(base, integers[i]) == 0;
+    }
+    if (integer && close) {
+        rest = close + 1;
+    } else if (strcmp(base, "decimal") == 0 && !close) {
+        snprintf(group, sizeof(group), "(10,0)");
+    } else if (strcmp(base, "decimal") == 0 && !memchr(rest, ',', (size_t)(close - rest))) {
+        snprintf(group, sizeof(group), "%.*s,0)", (int)(close - rest), rest);
+        rest = close + 1;
+    } else if ((strcmp(base, "char") == 0 || strcmp(base, "binary") == 0 || strcmp(base, "bit") == 0) && !close) {
+        snprintf(group, sizeof(group), "(1)");
+    }
+    snprintf(out, size, "%s%s%s", base, group, rest);
+}
+
+/** Copy a default value, unquoted, with NOW() and CURRENT_TIMESTAMP folded */
+static void normalize_default(const char *start, const char *end, SchemaColumnInfo *info) {
+    static const char *const timestamps[] = {"current_timestamp", "current_timestamp()", "now()", "localtime",
+                                             "localtime()", "localtimestamp", "localtimestamp()"};
+    info->has_default = true;
+    char *out = info->default_value;
+    size_t size = sizeof(info->default_value), length = 0;
+
+    //? Step 1: Quoted strings keep their case, quotes and escapes are removed
+    if (end > start && (*start == '\'' || *start == '"')) {
+        char quote = *start;
+        for (const char *p = start + 1; p < end && length + 1 < size; p++) {
+            if (*p == '\\' && p + 1 < end) {
+                out[length++] = *++p;
+            } else if (*p == quote && p + 1 < end && p[1] == quote) {
+                out[length++] = *p++;
+            } else if (*p != quote) {
+                out[length++] = *p;
+            }
+        }
+        out[length] = '\0';
+        return;
+    }
+
+    //? Step 2: Expressions drop their outer parentheses
+    if (end - start >= 2 && *start == '(' && end[-1] == ')') {
+        start++;
+        end--;
+    }
+
+    char text[SCHEMA_DEFAULT_SIZE];
+    normalize_text(start, end, text, sizeof(text));
+    for (size_t i = 0; i < sizeof(timestamps) / sizeof(timestamps[0]); i++) {
+        if (strcmp(text, timestamps[i]) == 0) {
+            snprintf(out, size, "current_timestamp");
+            return;
+        }
+    }
+    if (strcmp(text, "null") == 0) {
+        info->has_default = false;
+        out[0] = '\0';
+    } else {
+        snprintf(out, size, "%s", strcmp(text, "true") == 0 ? "1" : strcmp(text, "false") == 0 ? "0" : text);
+    }
+}
+
+/**
+ * ## Parse a column definition
+ * @param definition - As in CREATE TABLE, name included
+ * @param info - Receives the attributes
+ * @param stripped - Receives the definition without PRIMARY KEY and UNIQUE, as MODIFY COLUMN needs it,
+ *                   `strlen(definition) + 1` bytes, may be NULL
+ * @return bool - False when there is no name or type
+ */
+static bool parse_column(const char *definition, SchemaColumnInfo *info, char *stripped) {
+    memset(info, 0, sizeof(SchemaColumnInfo));
+    info->nullable = true;
+
+    //? Step 1: Name, then the type with its length and sign
+    const char *p = skip_spaces(definition);
+    const char *end = token_end(p);
+    if (end == p) {
+        return false;
+    }
+    p = skip_spaces(end);
+    const char *type = p;
+    if (!is_word_char(*p)) {
+        return false;
+    }
+    p = token_end(p);
+    for (;;) {
+        const char *next = skip_spaces(p);
+        end = token_end(next);
+        if (*next == '(' || token_is(next, end, "UNSIGNED") || token_is(next, end, "SIGNED") ||
+            token_is(next, end, "ZEROFILL") || token_is(next, end, "PRECISION") || token_is(next, end, "VARYING")) {
+            p = end;
+            continue;
+        }
+        break;
+    }
+    normalize_type(type, p, info->type, sizeof(info->type));
+
+    size_t length = (size_t)(p - definition);
+    if (stripped) {
+        memcpy(stripped, definition, length);
+    }
+
+    //? Step 2: Attributes, copied to `stripped` except the keys
+    while (*(end = skip_spaces(p))) {
+        const char *word = end;
+        end = token_end(word);
+        bool keep = true;
+        if (token_is(word, end, "NOT")) {
+            const char *next = skip_spaces(end);
+            if (token_is(next, token_end(next), "NULL")) {
+                info->nullable = false;
+                end = token_end(next);
+            }
+        } else if (token_is(word, end, "NULL")) {
+            info->nullable = true;
+        } else if (token_is(word, end, "DEFAULT")) {
+            const char *value = skip_spaces(end);
+            end = token_end(value);
+            if ((*value == '-' || *value == '+') && end == value + 1) {
+                end = token_end(skip_spaces(end));
+            }
+            if (is_word_char(*value) && *end == '(') {
+                end = token_end(end); // NOW(), CURRENT_TIMESTAMP(6)
+            }
+            normalize_default(value, end, info);
+        } else if (token_is(word, end, "PRIMARY") || token_is(word, end, "KEY")) {
+            const char *next = skip_spaces(end);
+            if (token_is(word, end, "PRIMARY") && token_is(next, token_end(next), "KEY")) {
+                end = token_end(next);
+            }
+            info->primary_key = true;
+            info->nullable = false;
+            keep = false;
+        } else if (token_is(word, end, "UNIQUE")) {
+            const char *next = skip_spaces(end);
+            if (token_is(next, token_end(next), "KEY")) {
+                end = token_end(next);
+            }
+            info->unique = true;
+            keep = false;
+        } else if (token_is(word, end, "AUTO_INCREMENT")) {
+            info->auto_increment = true;
+        }
+
+        if (stripped && keep) {
+            memcpy(stripped + length, p, (size_t)(end - p));
+            length += (size_t)(end - p);
+        }
+        p = end;
+    }
+    if (stripped) {
+        stripped[length] = '\0';
+    }
+    return true;
+}
+
+/** Read the attributes of an existing column: TABLE_NAME, COLUMN_NAME, COLUMN_TYPE, IS_NULLABLE, COLUMN_DEFAULT, COLUMN_KEY, EXTRA */
+static void existing_column_info(MYSQL_ROW row, SchemaColumnInfo *info) {
+    memset(info, 0, sizeof(SchemaColumnInfo));
+    const char *type = row[2] ? row[2] : "";
+    normalize_type(type, type + strlen(type), info->type, sizeof(info->type));
+    info->nullable = row[3] && strcasecmp(row[3], "YES") == 0;
+    // MariaDB quotes string defaults and reports a missing one as NULL
+    if (row[4] && strcasecmp(row[4], "NULL") != 0) {
+        normalize_default(row[4], row[4] + strlen(row[4]), info);
+    }
+    info->primary_key = row[5] && strcmp(row[5], "PRI") == 0;
+    info->unique = row[5] && strcmp(row[5], "UNI") == 0;
+    info->auto_increment = row[6] && strstr(row[6], "auto_increment") != NULL;
+}
+
+/** Whether two defaults differ, numbers compared by value so `0` matches `0.00` */
+static bool defaults_differ(const SchemaColumnInfo *wanted, const SchemaColumnInfo *found) {
+    if (wanted->has_default != found->has_default) {
+        return true;
+    }
+    if (!wanted->has_default || strcmp(wanted->default_value, found->default_value) == 0) {
+        return false;
+    }
+    char *wanted_end, *found_end;
+    double wanted_number = strtod(wanted->default_value, &wanted_end);
+    double found_number = strtod(found->default_value, &found_end);
+    return wanted_end == wanted->default_value || *wanted_end || found_end == found->default_value || *found_end ||
+           wanted_number != found_number;
+}
+
+/**
+ * Whether an existing column needs MODIFY COLUMN
+ * @note Keys are not compared, uniqueness is added with ADD UNIQUE and primary keys are never changed
+ */
+static bool column_differs(const SchemaColumnInfo *wanted, const SchemaColumnInfo *found) {
+    return strcmp(wanted->type, found->type) != 0 || wanted->nullable != found->nullable ||
+           wanted->auto_increment != found->auto_increment || defaults_differ(wanted, found);
+}
+
+/** Whether a definition list entry is a table constraint rather than a column */
+static bool is_constraint(const char *entry) {
+    static const char *const keywords[] = {"CONSTRAINT", "FOREIGN", "PRIMARY", "UNIQUE", "KEY",
+                                           "INDEX",      "CHECK",   "FULLTEXT", "SPATIAL"};
+    const char *end = token_end(entry);
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        if (token_is(entry, end, keywords[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Copy `[start, end)` without surrounding spaces */
+static char *copy_trimmed(const char *start, const char *end) {
+    start = skip_spaces(start);
+    while (end > start && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    return strndup(start, (size_t)(end - start));
+}
+
+/** Append a copied string to an array */
+static bool push_string(char ***items, size_t *count, char *item) {
+    char **grown = item ? (char **)realloc(*items, (*count + 1) * sizeof(char *)) : NULL;
+    if (!grown) {
+        free(item);
+        return false;
+    }
+    *items = grown;
+    (*items)[(*count)++] = item;
+    return true;
+}
+
+bool schema_table_from_definitions(const char *name, const char *definitions, SchemaTable *table) {
+    memset(table, 0, sizeof(SchemaTable));
+    if (!(table->name = strdup(name))) {
+        return false;
+    }
+
+    const char *start = definitions;
+    for (const char *p = definitions;; p = token_end(p)) {
+        if (*p && *p != ',') {
+            continue;
+        }
+
+        char *entry = copy_trimmed(start, p);
+        if (!entry) {
+            return false;
+        }
+        if (!*entry) {
+            free(entry);
+        } else if (is_constraint(entry)) {
+            if (!push_string(&table->constraints, &table->constraint_count, entry)) {
+                return false;
+            }
+        } else {
+            SchemaColumn *columns = (SchemaColumn *)realloc(table->columns, (table->column_count + 1) * sizeof(SchemaColumn));
+            if (!columns) {
+                free(entry);
+                return false;
+            }
+            table->columns = columns;
+            SchemaColumn *column = &columns[table->column_count++];
+            const char *name_end = token_end(entry);
+            column->definition = entry;
+            column->name = *entry == '`' ? strndup(entry + 1, (size_t)(name_end - entry - 2))
+                                         : strndup(entry, (size_t)(name_end - entry));
+            if (!column->name || !parse_column(entry, &column->info, NULL)) {
+                return false;
+            }
+        }
+
+        if (!*p) {
+            break;
+        }
+        start = p + 1;
+    }
+    return table->column_count > 0;
+}
+
+// =========================== FROM JS ===========================
+
+/** Read a string property, NULL when it is missing or not a string */
+static char *get_string_property(napi_env env, napi_value object, const char *key) {
+    bool has_property = false;
+    if (napi_has_named_property(env, object, key, &has_property) != napi_ok || !has_property) {
+        return NULL;
+    }
+    napi_value value;
+    napi_valuetype type;
+    napi_get_named_property(env, object, key, &value);
+    napi_typeof(env, value, &type);
+    return type == napi_string ? params_get_string(env, value, NULL) : NULL;
+}
+
+/**
+ * Read an optional array property
+ * @return bool - False with a pending exception when it is set but not an array
+ */
+static bool get_array_property(napi_env env, napi_value object, const char *key, napi_value *array, uint32_t *length) {
+    *length = 0;
+    bool has_property = false;
+    if (napi_has_named_property(env, object, key, &has_property) != napi_ok || !has_property) {
+        return true;
+    }
+
+    napi_valuetype type;
+    bool is_array = false;
+    napi_get_named_property(env, object, key, array);
+    napi_typeof(env, *array, &type);
+    if (type == napi_undefined) {
+        return true;
+    }
+    napi_is_array(env, *array, &is_array);
+    if (!is_array) {
+        char message[96];
+        snprintf(message, sizeof(message), "Expected %s to be an array", key);
+        napi_throw_type_error(env, NULL, message);
+        return false;
+    }
+    napi_get_array_length(env, *array, length);
+    return true;
+}
+
+/** Read an optional array of strings */
+static bool get_string_array(napi_env env, napi_value object, const char *key, char ***items, size_t *count) {
+    napi_value array;
+    uint32_t length;
+    if (!get_array_property(env, object, key, &array, &length)) {
+        return false;
+    }
+    if (length == 0) {
+        return true;
+    }
+
+    if (!(*items = (char **)calloc(length, sizeof(char *)))) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return false;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value element;
+        napi_get_element(env, array, i, &element);
+        if (!((*items)[i] = params_get_string(env, element, NULL))) {
+            char message[96];
+            snprintf(message, sizeof(message), "Expected %s to hold strings", key);
+            napi_throw_type_error(env, NULL, message);
+            return false;
+        }
+        *count = i + 1;
+    }
+    return true;
+}
+
+/** Copy one table schema */
+static bool table_from_js(napi_env env, napi_value object, SchemaTable *table) {
+    napi_valuetype type;
+    napi_typeof(env, object, &type);
+    if (type != napi_object || !(table->name = get_string_property(env, object, "name"))) {
+        napi_throw_type_error(env, NULL, "Expected every table to be an object with a name");
+        return false;
+    }
+
+    if ((table->hash = get_string_property(env, object, "hash")) && strlen(table->hash) > SCHEMA_HASH_SIZE) {
+        napi_throw_range_error(env, NULL, "Invalid hash: expected at most 128 characters");
+        return false;
+    }
+
+    //? Step 1: Columns, each with its full definition
+    napi_value array;
+    uint32_t length;
+    if (!get_array_property(env, object, "columns", &array, &length)) {
+        return false;
+    }
+    if (length == 0) {
+        napi_throw_error(env, NULL, "Every table needs at least one column");
+        return false;
+    }
+    if (!(table->columns = (SchemaColumn *)calloc(length, sizeof(SchemaColumn)))) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return false;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value column;
+        napi_get_element(env, array, i, &column);
+        napi_typeof(env, column, &type);
+        table->column_count = i + 1;
+        if (type != napi_object || !(table->columns[i].name = get_string_property(env, column, "name")) ||
+            !(table->columns[i].definition = get_string_property(env, column, "definition"))) {
+            napi_throw_type_error(env, NULL, "Expected every column to be an object with a name and a definition");
+            return false;
+        }
+        if (!parse_column(table->columns[i].definition, &table->columns[i].info, NULL)) {
+            char message[TASK_ERROR_SIZE];
+            snprintf(message, sizeof(message), "Invalid column definition: %s", table->columns[i].definition);
+            napi_throw_error(env, NULL, message);
+            return false;
+        }
+    }
+
+    //? Step 2: Indexes
+    if (!get_array_property(env, object, "indexes", &array, &length)) {
+        return false;
+    }
+    if (length > 0 && !(table->indexes = (SchemaIndex *)calloc(length, sizeof(SchemaIndex)))) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return false;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value index;
+        napi_get_element(env, array, i, &index);
+        napi_typeof(env, index, &type);
+        table->index_count = i + 1;
+        if (type != napi_object || !(table->indexes[i].name = get_string_property(env, index, "name")) ||
+            !(table->indexes[i].columns = get_string_property(env, index, "columns"))) {
+            napi_throw_type_error(env, NULL, "Expected every index to be an object with a name and columns");
+            return false;
+        }
+    }
+
+    //? Step 3: Foreign keys and the tables they need
+    return get_string_array(env, object, "constraints", &table->constraints, &table->constraint_count) &&
+           get_string_array(env, object, "references", &table->references, &table->reference_count);
+}
+
+bool schema_tables_from_js(napi_env env, napi_value array, SchemaTables *tables) {
+    memset(tables, 0, sizeof(SchemaTables));
+
+    bool is_array = false;
+    napi_is_array(env, array, &is_array);
+    if (!is_array) {
+        napi_throw_type_error(env, NULL, "Expected tables to be an array");
+        return false;
+    }
+
+    uint32_t length;
+    napi_get_array_length(env, array, &length);
+    if (length == 0) {
+        return true;
+    }
+
+    if (!(tables->items = (SchemaTable *)calloc(length, sizeof(SchemaTable)))) {
+        napi_throw_error(env, NULL, "Out of memory");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value object;
+        napi_get_element(env, array, i, &object);
+        tables->count = i + 1;
+        if (!table_from_js(env, object, &tables->items[i])) {
+            schema_tables_free(tables);
+            return false;
+        }
+    }
+    return true;
+}
+
+// =========================== INTROSPECTION ===========================
+
+/** Append the names of the pending tables as a list of string literals */
+static bool append_pending_names(SqlBuffer *sql, MYSQL *conn, const SchemaTables *tables, char *error, size_t error_size) {
+    bool first = true;
+    for (size_t i = 0; i < tables->count; i++) {
+        const SchemaTable *table = &tables->items[i];
+        if (table->status != SCHEMA_PENDING) {
+            continue;
+        }
+        PeekParam name = {.type = PARAM_STRING, .length = (unsigned long)strlen(table->name), .data = table->name};
+        if ((!first && !sql_append(sql, ", ", 2)) || !sql_append_value(sql, conn, &name, error, error_size)) {
+            return false;
+        }
+        first = false;
+    }
+    return true;
+}
+
+/**
+ * Skip the tables whose hash matches the metadata table, creating it on the first sync
+ * @return bool - False when the metadata table could not be read or created
+ */
+static bool read_hashes(MYSQL *conn, SchemaTables *tables, const NameSet *set, char *error, size_t error_size) {
+    if (peek_driver->query(conn, "SELECT table_name, schema_hash FROM `" SCHEMA_META_TABLE "`")) {
+        if (peek_driver->error_code(conn) != ER_NO_SUCH_TABLE ||
+            peek_driver->query(conn, "CREATE TABLE IF NOT EXISTS `" SCHEMA_META_TABLE "` ("
+                                     "table_name VARCHAR(64) NOT NULL PRIMARY KEY, "
+                                     "schema_hash VARCHAR(128) NOT NULL, "
+                                     "synced_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP)")) {
+            snprintf(error, error_size, "Failed to read " SCHEMA_META_TABLE ": %s", peek_driver->error(conn));
+            return false;
+        }
+        return true;
+    }
+
+    MYSQL_RES *res = peek_driver->store_result(conn);
+    if (!res) {
+        snprintf(error, error_size, "Failed to read " SCHEMA_META_TABLE ": %s", peek_driver->error(conn));
+        return false;
+    }
+
+    MYSQL_ROW row;
+    while (peek_driver->num_fields(res) >= 2 && (row = peek_driver->fetch_row(res))) {
+        SchemaTable *table = row[0] && row[1] ? find_table(set, tables, row[0]) : NULL;
+        if (table && table->hash && strcmp(table->hash, row[1]) == 0) {
+            table->status = SCHEMA_SKIPPED;
+        }
+    }
+    peek_driver->free_result(res);
+    return true;
+}
+
+/** Record a column found by the introspection */
+static bool note_column(SchemaTable *table, MYSQL_ROW row) {
+    table->exists = true;
+    if (table->existing_count == table->existing_capacity) {
+        size_t capacity = table->existing_capacity ? table->existing_capacity * 2 : 16;
+        SchemaExistingColumn *existing =
+            (SchemaExistingColumn *)realloc(table->existing, capacity * sizeof(SchemaExistingColumn));
+        if (!existing) {
+            return false;
+        }
+        table->existing = existing;
+        table->existing_capacity = capacity;
+    }
+
+    SchemaExistingColumn *column = &table->existing[table->existing_count];
+    if (!(column->name = strdup(row[1]))) {
+        return false;
+    }
+    existing_column_info(row, &column->info);
+    table->existing_count++;
+    return true;
+}
+
+/** Record an index found by the introspection */
+static void note_index(SchemaTable *table, const char *name) {
+    for (size_t i = 0; i < table->index_count; i++) {
+        if (strcasecmp(table->indexes[i].name, name) == 0) {
+            table->indexes[i].exists = true;
+        }
+    }
+}
+
+/**
+ * ## Read the columns and indexes of every pending table in one round trip
+ * - One result set, `C` rows for columns then `I` rows for indexes, so no multi-statement is needed
+ * @return bool - False when `information_schema` could not be read
+ */
+static bool introspect(MYSQL *conn, SchemaTables *tables, const NameSet *set, char *error, size_t error_size) {
+    SqlBuffer sql = {0};
+    const char *columns = "SELECT 'C', TABLE_NAME, COLUMN_NAME, COLUMN_TYPE, IS_NULLABLE, COLUMN_DEFAULT, COLUMN_KEY, "
+                          "EXTRA, ORDINAL_POSITION FROM information_schema.COLUMNS "
+                          "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME IN (";
+    const char *indexes = ") UNION ALL SELECT DISTINCT 'I', TABLE_NAME, INDEX_NAME, NULL, NULL, NULL, NULL, NULL, 0 "
+                          "FROM information_schema.STATISTICS WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME IN (";
+    const char *order = ") ORDER BY 1, 2, 9";
+    bool ok = sql_append(&sql, columns, strlen(columns)) && append_pending_names(&sql, conn, tables, error, error_size) &&
+              sql_append(&sql, indexes, strlen(indexes)) && append_pending_names(&sql, conn, tables, error, error_size) &&
+              sql_append(&sql, order, strlen(order));
+    if (!ok) {
+        snprintf(error, error_size, "Out of memory");
+        sql_free(&sql);
+        return false;
+    }
+
+    MYSQL_RES *res = NULL;
+    if (peek_driver->real_query(conn, sql.data, (unsigned long)sql.length) || !(res = peek_driver->store_result(conn))) {
+        snprintf(error, error_size, "Failed to read information_schema: %s", peek_driver->error(conn));
+        sql_free(&sql);
+        return false;
+    }
+    sql_free(&sql);
+
+    MYSQL_ROW row;
+    SchemaTable *table = NULL;
+    while (ok && peek_driver->num_fields(res) >= 8 && (row = peek_driver->fetch_row(res))) {
+        if (!row[0] || !row[1] || !row[2]) {
+            continue;
+        }
+        // Rows come grouped by table, most lookups hit the previous one
+        if (!table || strcasecmp(table->name, row[1]) != 0) {
+            table = find_table(set, tables, row[1]);
+        }
+        if (!table || table->status != SCHEMA_PENDING) {
+            continue;
+        }
+        if (row[0][0] == 'C') {
+            ok = note_column(table, row + 1);
+        } else if (strcmp(row[2], "PRIMARY") != 0) {
+            note_index(table, row[2]);
+        }
+    }
+    peek_driver->free_result(res);
+    if (!ok) {
+        snprintf(error, error_size, "Out of memory");
+    }
+    return ok;
+}
+
+// =========================== PLAN ===========================
+
+/** Append one ALTER TABLE clause, separated from the previous one */
+static bool append_clause(SqlBuffer *sql, SchemaTable *table, const char *clause) {
+    bool first = table->changes++ == 0;
+    return sql_append(sql, first ? " " : ", ", first ? 1 : 2) && sql_append(sql, clause, strlen(clause));
+}
+
+/** Plan the CREATE TABLE of a table missing from the database, with its indexes inline */
+static bool plan_create(SchemaTable *table, SqlBuffer *sql) {
+    bool ok = sql_append(sql, "CREATE TABLE ", 13) && sql_append_identifier(sql, table->name) && sql_append(sql, " (", 2);
+    for (size_t i = 0; ok && i < table->column_count; i++) {
+        const char *definition = table->columns[i].definition;
+        ok = (i == 0 || sql_append(sql, ", ", 2)) && sql_append(sql, definition, strlen(definition));
+    }
+    for (size_t i = 0; ok && i < table->constraint_count; i++) {
+        ok = sql_append(sql, ", ", 2) && sql_append(sql, table->constraints[i], strlen(table->constraints[i]));
+    }
+    for (size_t i = 0; ok && i < table->index_count; i++) {
+        const SchemaIndex *index = &table->indexes[i];
+        ok = sql_append(sql, ", INDEX ", 8) && sql_append_identifier(sql, index->name) && sql_append(sql, " (", 2) &&
+             sql_append(sql, index->columns, strlen(index->columns)) && sql_append(sql, ")", 1);
+    }
+    table->changes = table->column_count + table->constraint_count + table->index_count;
+    return ok && sql_append(sql, ")", 1);
+}
+
+/**
+ * ## Plan one ALTER TABLE bringing an existing table in line
+ * - Columns are matched by name through hash sets: missing ones are added, extra ones dropped, differing ones modified
+ * - Missing indexes are added, and UNIQUE where a column gained it
+ */
+static bool plan_alter(SchemaTable *table, SqlBuffer *sql) {
+    NameSet wanted = {0}, found = {0};
+    bool ok = name_set_init(&wanted, table->column_count) && name_set_init(&found, table->existing_count) &&
+              sql_append(sql, "ALTER TABLE ", 12) && sql_append_identifier(sql, table->name);
+    for (size_t i = 0; ok && i < table->column_count; i++) {
+        name_set_add(&wanted, table->columns[i].name, i);
+    }
+    for (size_t i = 0; ok && i < table->existing_count; i++) {
+        name_set_add(&found, table->existing[i].name, i);
+    }
+
+    //? Step 1: Drop the columns the schema no longer has
+    for (size_t i = 0, index; ok && i < table->existing_count; i++) {
+        if (!name_set_find(&wanted, table->existing[i].name, &index)) {
+            ok = append_clause(sql, table, "DROP COLUMN ") && sql_append_identifier(sql, table->existing[i].name);
+        }
+    }
+
+    //? Step 2: Add the missing columns, modify the differing ones
+    for (size_t i = 0, index; ok && i < table->column_count; i++) {
+        const SchemaColumn *column = &table->columns[i];
+        if (!name_set_find(&found, column->name, &index)) {
+            ok = append_clause(sql, table, "ADD COLUMN ") && sql_append(sql, column->definition, strlen(column->definition));
+            continue;
+        }
+
+        const SchemaColumnInfo *existing = &table->existing[index].info;
+        if (column_differs(&column->info, existing)) {
+            char *stripped = (char *)malloc(strlen(column->definition) + 1);
+            SchemaColumnInfo info;
+            ok = stripped && parse_column(column->definition, &info, stripped) &&
+                 append_clause(sql, table, "MODIFY COLUMN ") && sql_append(sql, stripped, strlen(stripped));
+            free(stripped);
+        }
+        if (ok && column->info.unique && !existing->unique && !existing->primary_key) {
+            ok = append_clause(sql, table, "ADD UNIQUE (") && sql_append_identifier(sql, column->name) &&
+                 sql_append(sql, ")", 1);
+        }
+    }
+
+    //? Step 3: Add the missing indexes
+    for (size_t i = 0; ok && i < table->index_count; i++) {
+        const SchemaIndex *index = &table->indexes[i];
+        if (!index->exists) {
+            ok = append_clause(sql, table, "ADD INDEX ") && sql_append_identifier(sql, index->name) &&
+                 sql_append(sql, " (", 2) && sql_append(sql, index->columns, strlen(index->columns)) &&
+                 sql_append(sql, ")", 1);
+        }
+    }
+
+    name_set_free(&wanted);
+    name_set_free(&found);
+    return ok;
+}
+
+/** Plan the single statement bringing a table in line, none when it already is */
+static bool plan_table(SchemaTable *table) {
+    SqlBuffer sql = {0};
+    if (!(table->exists ? plan_alter(table, &sql) : plan_create(table, &sql))) {
+        sql_free(&sql);
+        return false;
+    }
+
+    if (table->changes == 0) {
+        table->status = SCHEMA_UNCHANGED;
+        sql_free(&sql);
+    } else {
+        table->ddl = sql.data;
+    }
+    return true;
+}
+
+/** Introspect and plan every pending table */
+static bool plan_tables(MYSQL *conn, SchemaTables *tables, const NameSet *set, char *error, size_t error_size) {
+    size_t pending = 0;
+    for (size_t i = 0; i < tables->count; i++) {
+        pending += tables->items[i].status == SCHEMA_PENDING;
+    }
+    if (pending > 0 && !introspect(conn, tables, set, error, error_size)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < tables->count; i++) {
+        if (tables->items[i].status == SCHEMA_PENDING && !plan_table(&tables->items[i])) {
+            snprintf(error, error_size, "Out of memory");
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Level every table with DDL after the tables with DDL it references, a cycle stops after `count` rounds */
+static int plan_levels(SchemaTables *tables, const NameSet *set) {
+    int max_level = 0;
+    for (size_t round = 0; round < tables->count; round++) {
+        bool changed = false;
+        for (size_t i = 0; i < tables->count; i++) {
+            SchemaTable *table = &tables->items[i];
+            for (size_t r = 0; table->ddl && r < table->reference_count; r++) {
+                SchemaTable *referenced = find_table(set, tables, table->references[r]);
+                if (referenced && referenced != table && referenced->ddl && referenced->level >= table->level) {
+                    table->level = referenced->level + 1;
+                    max_level = table->level > max_level ? table->level : max_level;
+                    changed = true;
+                }
+            }
+        }
+        if (!changed) {
+            break;
+        }
+    }
+    return max_level;
+}
+
+// =========================== RUN ===========================
+
+/**
+ * Tables of one level, pulled by every worker
+ */
+typedef struct {
+    ConnectionPool *pool;
+    SchemaTable **tables;
+    size_t count;
+    size_t next;
+    pthread_mutex_t lock;
+} SchemaWork;
+
+/** Whether the server refused an ALGORITHM or LOCK clause, so the next one may still run */
+static bool algorithm_refused(unsigned int code) {
+    return code == ER_ALTER_OPERATION_NOT_SUPPORTED || code == ER_ALTER_OPERATION_NOT_SUPPORTED_REASON ||
+           code == ER_UNKNOWN_ALTER_ALGORITHM || code == ER_UNKNOWN_ALTER_LOCK;
+}
+
+/** Run the statement of one table, an ALTER with the cheapest algorithm the server accepts */
+static void run_table(MYSQL *conn, SchemaTable *table) {
+    if (!table->exists) {
+        if (peek_driver->query(conn, table->ddl)) {
+            snprintf(table->error, sizeof(table->error), "%s", peek_driver->error(conn));
+            table->status = SCHEMA_FAILED;
+        } else {
+            table->status = SCHEMA_CREATED;
+        }
+        return;
+    }
+
+    for (int i = 0; i < ALTER_ALGORITHM_COUNT; i++) {
+        SqlBuffer sql = {0};
+        if (!sql_append(&sql, table->ddl, strlen(table->ddl)) ||
+            !sql_append(&sql, ALTER_ALGORITHMS[i], strlen(ALTER_ALGORITHMS[i]))) {
+            sql_free(&sql);
+            snprintf(table->error, sizeof(table->error), "Out of memory");
+            table->status = SCHEMA_FAILED;
+            return;
+        }
+
+        int status = peek_driver->real_query(conn, sql.data, (unsigned long)sql.length);
+        sql_free(&sql);
+        if (status == 0) {
+            table->algorithm = ALTER_ALGORITHM_NAMES[i];
+            table->status = SCHEMA_ALTERED;
+            return;
+        }
+        if (i + 1 == ALTER_ALGORITHM_COUNT || !algorithm_refused(peek_driver->error_code(conn))) {
+            snprintf(table->error, sizeof(table->error), "%s", peek_driver->error(conn));
+            table->status = SCHEMA_FAILED;
+            return;
+        }
+    }
+}
+
+/** Take tables until none is left, on one pooled connection */
+static void run_tables(SchemaWork *work) {
+    PoolConnection *pooled = NULL;
+    for (;;) {
+        pthread_mutex_lock(&work->lock);
+        size_t index = work->next++;
+        pthread_mutex_unlock(&work->lock);
+        if (index >= work->count) {
+            break;
+        }
+
+        SchemaTable *table = work->tables[index];
+        if (!pooled && !(pooled = pool_get_connection(work->pool))) {
+            snprintf(table->error, sizeof(table->error), "Failed to get database connection");
+            table->status = SCHEMA_FAILED;
+            continue;
+        }
+
+        run_table(pooled->connection, table);
+        if (table->status == SCHEMA_FAILED && !pool_validate_connection(pooled->connection)) {
+            pool_discard_connection(work->pool, pooled);
+            pooled = NULL;
+        }
+    }
+    if (pooled) {
+        pool_return_connection(work->pool, pooled);
+    }
+}
+
+static void *run_tables_thread(void *data) {
+    peek_driver->thread_init();
+    run_tables((SchemaWork *)data);
+    peek_driver->thread_end();
+    return NULL;
+}
+
+/** Run one level, the calling thread working alongside up to `parallel` - 1 others */
+static void run_level(ConnectionPool *pool, SchemaTable **tables, size_t count, int parallel) {
+    SchemaWork work = {.pool = pool, .tables = tables, .count = count};
+    pthread_mutex_init(&work.lock, NULL);
+
+    if ((size_t)parallel > count) {
+        parallel = (int)count;
+    }
+
+    pthread_t threads[SCHEMA_MAX_PARALLEL];
+    bool started[SCHEMA_MAX_PARALLEL] = {false};
+    for (int i = 1; i < parallel; i++) {
+        started[i] = pthread_create(&threads[i], NULL, run_tables_thread, &work) == 0;
+    }
+
+    run_tables(&work);
+
+    for (int i = 1; i < parallel; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    pthread_mutex_destroy(&work.lock);
+}
+
+/** Record the hashes of the tables now in line with their schema, in one statement */
+static void write_hashes(MYSQL *conn, const SchemaTables *tables) {
+    SqlBuffer sql = {0};
+    const char *insert = "INSERT INTO `" SCHEMA_META_TABLE "` (table_name, schema_hash) VALUES ";
+    bool ok = sql_append(&sql, insert, strlen(insert));
+    size_t rows = 0;
+    char error[TASK_ERROR_SIZE];
+
+    for (size_t i = 0; ok && i < tables->count; i++) {
+        const SchemaTable *table = &tables->items[i];
+        if (!table->hash || (table->status != SCHEMA_UNCHANGED && table->status != SCHEMA_CREATED &&
+                             table->status != SCHEMA_ALTERED)) {
+            continue;
+        }
+        PeekParam name = {.type = PARAM_STRING, .length = (unsigned long)strlen(table->name), .data = table->name};
+        PeekParam hash = {.type = PARAM_STRING, .length = (unsigned long)strlen(table->hash), .data = table->hash};
+        ok = sql_append(&sql, rows > 0 ? ", (" : "(", rows > 0 ? 3 : 1) &&
+             sql_append_value(&sql, conn, &name, error, sizeof(error)) && sql_append(&sql, ", ", 2) &&
+             sql_append_value(&sql, conn, &hash, error, sizeof(error)) && sql_append(&sql, ")", 1);
+        rows++;
+    }
+
+    const char *upsert = " ON DUPLICATE KEY UPDATE schema_hash = VALUES(schema_hash)";
+    // A failed write only means the tables are introspected again on the next sync
+    if (ok && rows > 0 && sql_append(&sql, upsert, strlen(upsert))) {
+        peek_driver->real_query(conn, sql.data, (unsigned long)sql.length);
+    }
+    sql_free(&sql);
+}
+
+bool schema_sync(ConnectionPool *pool, SchemaTables *tables, int parallel, char *error, size_t error_size) {
+    error[0] = '\0';
+    if (tables->count == 0) {
+        return true;
+    }
+
+    NameSet set;
+    if (!table_set_init(&set, tables)) {
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+
+    PoolConnection *pooled = pool_get_connection(pool);
+    if (!pooled) {
+        snprintf(error, error_size, "Failed to get database connection");
+        name_set_free(&set);
+        return false;
+    }
+
+    //? Step 1: Skip the tables whose hash did not change, introspect and plan the others
+    bool ok = read_hashes(pooled->connection, tables, &set, error, error_size) &&
+              plan_tables(pooled->connection, tables, &set, error, error_size);
+    pool_return_connection(pool, pooled);
+
+    //? Step 2: Run the statements level by level, each level spread over the pool
+    SchemaTable **level_tables = ok ? (SchemaTable **)calloc(tables->count, sizeof(SchemaTable *)) : NULL;
+    if (ok && !level_tables) {
+        snprintf(error, error_size, "Out of memory");
+        ok = false;
+    }
+
+    if (parallel > pool->options.max_size) {
+        parallel = pool->options.max_size;
+    }
+    if (parallel > SCHEMA_MAX_PARALLEL) {
+        parallel = SCHEMA_MAX_PARALLEL;
+    }
+    if (parallel < 1) {
+        parallel = 1;
+    }
+
+    int max_level = ok ? plan_levels(tables, &set) : -1;
+    for (int level = 0; level <= max_level; level++) {
+        size_t count = 0;
+        for (size_t i = 0; i < tables->count; i++) {
+            SchemaTable *table = &tables->items[i];
+            if (table->status == SCHEMA_PENDING && table->ddl && table->level == level) {
+                level_tables[count++] = table;
+            }
+        }
+        if (count > 0) {
+            run_level(pool, level_tables, count, parallel);
+        }
+    }
+    free(level_tables);
+    name_set_free(&set);
+    if (!ok) {
+        return false;
+    }
+
+    //? Step 3: Remember the hashes of the tables now in line
+    if ((pooled = pool_get_connection(pool))) {
+        write_hashes(pooled->connection, tables);
+        pool_return_connection(pool, pooled);
+    }
+    return true;
+}
+
+bool schema_sync_table(MYSQL *conn, SchemaTable *table, char *error, size_t error_size) {
+    error[0] = '\0';
+    SchemaTables tables = {.items = table, .count = 1};
+    NameSet set;
+    if (!table_set_init(&set, &tables)) {
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+
+    bool ok = plan_tables(conn, &tables, &set, error, error_size);
+    name_set_free(&set);
+    if (!ok || !table->ddl) {
+        return ok;
+    }
+
+    run_table(conn, table);
+    if (table->status == SCHEMA_FAILED) {
+        snprintf(error, error_size, "%s", table->error);
+        return false;
+    }
+    return true;
+}
+
+const char *schema_status_name(SchemaStatus status) {
+    switch (status) {
+    case SCHEMA_SKIPPED:
+        return "skipped";
+    case SCHEMA_UNCHANGED:
+        return "unchanged";
+    case SCHEMA_CREATED:
+        return "created";
+    case SCHEMA_ALTERED:
+        return "altered";
+    case SCHEMA_FAILED:
+        return "failed";
+    default:
+        return "pending";
+    }
+}
+
+/** Free an array of strings */
+static void free_strings(char **items, size_t count) {
+    for (size_t i = 0; items && i < count; i++) {
+        free(items[i]);
+    }
+    free(items);
+}
+
+void schema_table_free(SchemaTable *table) {
+    for (size_t i = 0; table->columns && i < table->column_count; i++) {
+        free(table->columns[i].name);
+        free(table->columns[i].definition);
+    }
+    for (size_t i = 0; table->indexes && i < table->index_count; i++) {
+        free(table->indexes[i].name);
+        free(table->indexes[i].columns);
+    }
+    for (size_t i = 0; table->existing && i < table->existing_count; i++) {
+        free(table->existing[i].name);
+    }
+    free(table->columns);
+    free(table->indexes);
+    free(table->existing);
+    free_strings(table->constraints, table->constraint_count);
+    free_strings(table->references, table->reference_count);
+    free(table->ddl);
+    free(table->name);
+    free(table->hash);
+    memset(table, 0, sizeof(SchemaTable));
+}
+
+void schema_tables_free(SchemaTables *tables) {
+    for (size_t i = 0; tables->items && i < tables->count; i++) {
+        schema_table_free(&tables->items[i]);
+    }
+    free(tables->items);
+    memset(tables, 0, sizeof(SchemaTables));
+}
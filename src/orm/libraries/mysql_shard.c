@@ -0,0 +1,690 @@
+#include "../include/mysql_async.h"
+#include "../include/mysql_driver.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_result.h"
+#include "../include/mysql_shard.h"
+#include "../include/mysql_sql.h"
+#include "../include/mysql_stmt_cache.h"
+#include "../include/mysql_util.h"
+#include <limits.h>
+#include <math.h>
+#include <mysql.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/** Bytes of an ORDER BY column name kept */
+#define SHARD_NAME_SIZE 65
+
+// =========================== SHARD MAP ===========================
+
+ShardMap *shard_map_create(const ReplicaConfig *servers, int count, const ConnectionPool *primary) {
+    ShardMap *map = (ShardMap *)calloc(1, sizeof(ShardMap));
+    if (!map || !(map->pools = (ConnectionPool **)calloc(count > 0 ? count : 1, sizeof(ConnectionPool *)))) {
+        free(map);
+        return NULL;
+    }
+    pthread_mutex_init(&map->lock, NULL);
+
+    // Shards serve single statements: no LOAD DATA, no event loop pool
+    PoolOptions options = primary->options;
+    options.local_infile = false;
+    options.event_loop = false;
+
+    for (int i = 0; i < count; i++) {
+        const ReplicaConfig *config = &servers[i];
+        const char *host = config->host ? config->host : primary->host;
+        const char *user = config->user ? config->user : primary->user;
+        const char *password = config->password ? config->password : primary->password;
+        const char *database = config->database ? config->database : primary->database;
+        int port = config->port > 0 ? config->port : primary->port;
+
+        ConnectionPool *shard = pool_create(host, user, password, database, port, &options);
+        if (!shard) {
+            PoolOptions lazy = options;
+            lazy.min_size = 0;
+            shard = pool_create(host, user, password, database, port, &lazy);
+        }
+        if (!shard) {
+            shard_map_destroy(map);
+            return NULL;
+        }
+        map->pools[map->shard_count++] = shard;
+    }
+    return map;
+}
+
+/** Free the names and bounds of a shard key */
+static void shard_table_free(ShardTable *table) {
+    free(table->table);
+    free(table->column);
+    free(table->bounds);
+}
+
+/** Shard key of a table, with the lock held */
+static ShardTable *find_table(ShardMap *map, const char *table) {
+    for (size_t i = 0; i < map->table_count; i++) {
+        if (strcmp(map->tables[i].table, table) == 0) {
+            return &map->tables[i];
+        }
+    }
+    return NULL;
+}
+
+void shard_map_destroy(ShardMap *map) {
+    if (!map) {
+        return;
+    }
+    for (int i = 0; i < map->shard_count; i++) {
+        pool_destroy(map->pools[i]);
+    }
+    for (size_t i = 0; i < map->table_count; i++) {
+        shard_table_free(&map->tables[i]);
+    }
+    free(map->tables);
+    free(map->pools);
+    pthread_mutex_destroy(&map->lock);
+    free(map);
+}
+
+bool shard_map_declare(ShardMap *map, const char *table, const char *column, ShardStrategy strategy, const double *bounds,
+                       int bound_count, char *error, size_t error_size) {
+    //? Step 1: A range needs one ascending lower bound per shard after the first
+    if (strategy == SHARD_RANGE) {
+        if (bound_count != map->shard_count - 1) {
+            snprintf(error, error_size, "Shard key of %s: expected %d range bounds, one per shard after the first", table,
+                     map->shard_count - 1);
+            return false;
+        }
+        for (int i = 0; i < bound_count; i++) {
+            if (!isfinite(bounds[i]) || (i > 0 && bounds[i] <= bounds[i - 1])) {
+                snprintf(error, error_size, "Shard key of %s: expected ascending range bounds", table);
+                return false;
+            }
+        }
+    }
+
+    ShardTable declared = {.strategy = strategy};
+    declared.table = strdup(table);
+    declared.column = strdup(column);
+    if (strategy == SHARD_RANGE && bound_count > 0 && (declared.bounds = (double *)malloc(bound_count * sizeof(double)))) {
+        memcpy(declared.bounds, bounds, bound_count * sizeof(double));
+    }
+    if (!declared.table || !declared.column || (strategy == SHARD_RANGE && bound_count > 0 && !declared.bounds)) {
+        shard_table_free(&declared);
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+
+    //? Step 2: Replace the previous key of the table, or add it
+    pthread_mutex_lock(&map->lock);
+    ShardTable *existing = find_table(map, table);
+    if (existing) {
+        shard_table_free(existing);
+        *existing = declared;
+        pthread_mutex_unlock(&map->lock);
+        return true;
+    }
+
+    ShardTable *tables = (ShardTable *)realloc(map->tables, (map->table_count + 1) * sizeof(ShardTable));
+    if (tables) {
+        map->tables = tables;
+        map->tables[map->table_count++] = declared;
+    }
+    pthread_mutex_unlock(&map->lock);
+
+    if (!tables) {
+        shard_table_free(&declared);
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+    return true;
+}
+
+bool shard_map_contains(ShardMap *map, const char *table) {
+    if (!map) {
+        return false;
+    }
+    pthread_mutex_lock(&map->lock);
+    bool found = find_table(map, table) != NULL;
+    pthread_mutex_unlock(&map->lock);
+    return found;
+}
+
+/**
+ * Jump consistent hash: bucket of a key among `buckets`
+ * @note Growing from n to n + 1 buckets only moves 1 / (n + 1) of the keys, all to the new bucket
+ */
+static int jump_hash(uint64_t key, int buckets) {
+    int64_t bucket = -1, next = 0;
+    while (next < buckets) {
+        bucket = next;
+        key = key * 2862933555777941757ULL + 1;
+        next = (int64_t)((double)(bucket + 1) * ((double)(1LL << 31) / (double)((key >> 33) + 1)));
+    }
+    return (int)bucket;
+}
+
+/**
+ * Text a key is hashed from, the same whatever type JS bound it as
+ * @return size_t - Length of the text, in `buffer` or at `*text`
+ */
+static size_t key_text(const PeekParam *key, char *buffer, size_t size, const char **text) {
+    *text = buffer;
+    switch (key->type) {
+    case PARAM_INT:
+        return (size_t)snprintf(buffer, size, "%lld", key->int_value);
+    case PARAM_DOUBLE:
+        if (key->double_value == floor(key->double_value) && fabs(key->double_value) < 9007199254740992.0) {
+            return (size_t)snprintf(buffer, size, "%lld", (long long)key->double_value);
+        }
+        return (size_t)snprintf(buffer, size, "%.17g", key->double_value);
+    case PARAM_DATETIME:
+        return (size_t)snprintf(buffer, size, "%04u-%02u-%02u %02u:%02u:%02u", key->time_value.year, key->time_value.month,
+                                key->time_value.day, key->time_value.hour, key->time_value.minute, key->time_value.second);
+    case PARAM_STRING:
+    case PARAM_BLOB:
+        *text = key->data;
+        return key->length;
+    case PARAM_NULL:
+        break;
+    }
+    return 0;
+}
+
+/** Numeric value of a range key: a number, or a string holding one */
+static bool key_number(const PeekParam *key, double *value) {
+    if (key->type == PARAM_INT) {
+        *value = (double)key->int_value;
+        return true;
+    }
+    if (key->type == PARAM_DOUBLE) {
+        *value = key->double_value;
+        return true;
+    }
+    if (key->type != PARAM_STRING || key->length == 0) {
+        return false;
+    }
+    char *end = NULL;
+    *value = strtod(key->data, &end);
+    return end == key->data + key->length;
+}
+
+/** Shard holding a key of a table, with the lock held */
+static int route_key(const ShardMap *map, const ShardTable *table, const PeekParam *key, char *error, size_t error_size) {
+    if (key->type == PARAM_NULL || key->is_null) {
+        snprintf(error, error_size, "Shard key %s of %s cannot be NULL", table->column, table->table);
+        return SHARD_INVALID;
+    }
+
+    if (table->strategy == SHARD_HASH) {
+        char buffer[64];
+        const char *text;
+        size_t length = key_text(key, buffer, sizeof(buffer), &text);
+        return jump_hash(util_hash(text, length), map->shard_count);
+    }
+
+    double value;
+    if (!key_number(key, &value)) {
+        snprintf(error, error_size, "Shard key %s of %s must be a number to pick a range", table->column, table->table);
+        return SHARD_INVALID;
+    }
+
+    int shard = 0;
+    while (shard < map->shard_count - 1 && value >= table->bounds[shard]) {
+        shard++;
+    }
+    return shard;
+}
+
+int shard_map_route(ShardMap *map, const char *table, const PeekParam *key, char *error, size_t error_size) {
+    pthread_mutex_lock(&map->lock);
+    const ShardTable *declared = find_table(map, table);
+    int shard = declared ? route_key(map, declared, key, error, error_size) : SHARD_UNSHARDED;
+    pthread_mutex_unlock(&map->lock);
+    return shard;
+}
+
+// =========================== FAN OUT ===========================
+
+/** Column of the ORDER BY of a fanned out select */
+typedef struct {
+    char name[SHARD_NAME_SIZE]; // Empty for a position
+    unsigned int position;      // 1 based, 0 for a name
+    bool descending;
+} ShardOrder;
+
+/**
+ * What a fanned out select runs on each shard, and how the shard results are merged
+ * - `query` and `params` are the statement with its LIMIT widened to cover the offset, NULL and empty when it has none
+ */
+typedef struct {
+    ShardOrder order[SHARD_ORDER_LIMIT];
+    int order_count;
+    size_t offset;
+    size_t limit;
+    char *query;
+    PeekParams params;
+} ShardPlan;
+
+/** Statement run on one shard */
+typedef struct {
+    ConnectionPool *pool;
+    const char *query;
+    PeekParams params; // Own copy, bound on the shard's thread
+    bool select;
+    PeekResult *result;
+    my_ulonglong affected_rows;
+    bool ok;
+    char error[TASK_ERROR_SIZE];
+} ShardJob;
+
+/** Run the statement of a job on a connection of its shard */
+static void run_job(ShardJob *job) {
+    PoolConnection *pooled = pool_get_connection(job->pool);
+    if (!pooled) {
+        snprintf(job->error, sizeof(job->error), "Failed to get database connection");
+        return;
+    }
+
+    if (job->select || job->params.count > 0) {
+        MYSQL_STMT *stmt = stmt_cache_execute(&pooled->stmt_cache, pooled->connection, job->query, &job->params, job->error,
+                                              sizeof(job->error));
+        if (stmt) {
+            if (job->select) {
+                job->result = result_from_stmt(stmt, &pooled->scratch, job->error, sizeof(job->error));
+                job->ok = job->result != NULL;
+            } else {
+                job->affected_rows = peek_driver->stmt_affected_rows(stmt);
+                job->ok = true;
+            }
+            stmt_cache_done(stmt);
+        }
+    } else if (peek_driver->query(pooled->connection, job->query) == 0) {
+        job->affected_rows = peek_driver->affected_rows(pooled->connection);
+        job->ok = true;
+    } else {
+        snprintf(job->error, sizeof(job->error), "%s", peek_driver->error(pooled->connection));
+    }
+
+    pool_return_connection(job->pool, pooled);
+}
+
+static void *run_job_thread(void *data) {
+    peek_driver->thread_init();
+    run_job((ShardJob *)data);
+    peek_driver->thread_end();
+    return NULL;
+}
+
+/**
+ * ## Run a statement on every shard at once, one thread per shard
+ * @return ShardJob* - Jobs, one per shard, NULL when out of memory
+ */
+static ShardJob *run_on_shards(ShardMap *map, const char *query, const PeekParams *params, bool select) {
+    int count = map->shard_count;
+    ShardJob *jobs = (ShardJob *)calloc(count, sizeof(ShardJob));
+    if (!jobs) {
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        jobs[i].pool = map->pools[i];
+        jobs[i].query = query;
+        jobs[i].select = select;
+        if (!params_copy(params, &jobs[i].params)) {
+            for (int j = 0; j < i; j++) {
+                params_free(&jobs[j].params);
+            }
+            free(jobs);
+            return NULL;
+        }
+    }
+
+    //? The calling thread takes the first shard, and the shards whose thread could not start
+    pthread_t threads[SHARD_LIMIT];
+    bool started[SHARD_LIMIT] = {false};
+    for (int i = 1; i < count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, run_job_thread, &jobs[i]) == 0;
+    }
+    for (int i = 0; i < count; i++) {
+        if (i == 0 || !started[i]) {
+            run_job(&jobs[i]);
+        }
+    }
+    for (int i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    return jobs;
+}
+
+/** Free jobs and what their shards returned */
+static void jobs_free(ShardJob *jobs, int count) {
+    for (int i = 0; i < count; i++) {
+        result_free(jobs[i].result);
+        params_free(&jobs[i].params);
+    }
+    free(jobs);
+}
+
+/** First failed job, as the error of the whole statement */
+static bool jobs_ok(const ShardJob *jobs, int count, char *error, size_t error_size) {
+    for (int i = 0; i < count; i++) {
+        if (!jobs[i].ok) {
+            snprintf(error, error_size, "Shard %d: %s", i, jobs[i].error);
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Keywords that end an ORDER BY item */
+static bool ends_order_item(const SqlToken *token) {
+    return token->kind == SQL_TOKEN_END || sql_is_symbol(token, ',') || sql_is_symbol(token, ')') ||
+           sql_is_symbol(token, ';') || sql_is_keyword(token, "LIMIT") || sql_is_keyword(token, "FOR") ||
+           sql_is_keyword(token, "LOCK");
+}
+
+/**
+ * Read the items of an ORDER BY, starting after `BY`
+ * - Items must be columns, dotted or not, or positions, each optionally followed by ASC or DESC
+ */
+static bool read_order(const char *p, ShardPlan *plan, char *error, size_t error_size) {
+    SqlToken token;
+    for (;;) {
+        if (plan->order_count == SHARD_ORDER_LIMIT) {
+            snprintf(error, error_size, "Cannot merge shards on more than %d ORDER BY columns", SHARD_ORDER_LIMIT);
+            return false;
+        }
+        ShardOrder *order = &plan->order[plan->order_count++];
+        const char *item = sql_next_token(p, &token);
+        const char *start = token.start;
+
+        //? Step 1: A dotted column keeps its last part, a number is a position
+        if (token.kind == SQL_TOKEN_IDENTIFIER) {
+            sql_token_name(&token, order->name, sizeof(order->name));
+            SqlToken dot, part;
+            const char *after_dot;
+            while ((after_dot = sql_next_token(item, &dot), sql_is_symbol(&dot, '.')) &&
+                   (sql_next_token(after_dot, &part), part.kind == SQL_TOKEN_IDENTIFIER)) {
+                item = sql_next_token(after_dot, &part);
+                sql_token_name(&part, order->name, sizeof(order->name));
+            }
+        } else if (token.kind == SQL_TOKEN_LITERAL && *token.start >= '0' && *token.start <= '9') {
+            order->position = (unsigned int)strtoul(token.start, NULL, 10);
+        }
+
+        //? Step 2: Then the direction, then the end of the item, anything else is an expression
+        p = sql_next_token(item, &token);
+        if (sql_is_keyword(&token, "ASC") || sql_is_keyword(&token, "DESC")) {
+            order->descending = sql_is_keyword(&token, "DESC");
+            p = sql_next_token(p, &token);
+        }
+        if ((!order->name[0] && order->position == 0) || !ends_order_item(&token)) {
+            int length = (int)(token.start - start);
+            snprintf(error, error_size, "Cannot merge shards on ORDER BY %.*s: order by selected columns", length > 64 ? 64 : length,
+                     start);
+            return false;
+        }
+        if (!sql_is_symbol(&token, ',')) {
+            return true;
+        }
+    }
+}
+
+/** Aggregate functions, whose per shard values cannot be concatenated */
+static const char *const AGGREGATES[] = {"COUNT", "SUM", "AVG", "MIN", "MAX", "GROUP_CONCAT", "BIT_AND", "BIT_OR",
+                                         "BIT_XOR", "STD", "STDDEV", "STDDEV_POP", "STDDEV_SAMP", "VARIANCE", "VAR_POP",
+                                         "VAR_SAMP", "JSON_ARRAYAGG", "JSON_OBJECTAGG"};
+
+/** Whether a token followed by `(` calls an aggregate function */
+static bool is_aggregate(const SqlToken *token, const char *after) {
+    SqlToken next;
+    if (token->kind != SQL_TOKEN_IDENTIFIER || (sql_next_token(after, &next), !sql_is_symbol(&next, '('))) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(AGGREGATES) / sizeof(AGGREGATES[0]); i++) {
+        if (sql_is_keyword(token, AGGREGATES[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Read one value of a LIMIT clause, a number or a placeholder
+ * @param placeholder - Index of the next placeholder, advanced past a placeholder value
+ */
+static bool read_limit_value(const SqlToken *token, const PeekParams *params, size_t *placeholder, size_t *value) {
+    if (token->kind == SQL_TOKEN_LITERAL && *token->start >= '0' && *token->start <= '9') {
+        *value = (size_t)strtoull(token->start, NULL, 10);
+        return true;
+    }
+    if (!sql_is_symbol(token, '?') || *placeholder >= params->count) {
+        return false;
+    }
+    const PeekParam *param = &params->items[(*placeholder)++];
+    if (param->type != PARAM_INT || param->int_value < 0) {
+        return false;
+    }
+    *value = (size_t)param->int_value;
+    return true;
+}
+
+/**
+ * ## Plan a fanned out select
+ * - Reads the outermost ORDER BY and LIMIT, outside parentheses
+ * - Refuses DISTINCT, GROUP BY, HAVING and aggregates outside subqueries: every shard would return its own rows for them
+ * - `LIMIT n OFFSET m` and `LIMIT m, n` become `LIMIT ?` bound to `n + m`, the placeholders they used are dropped
+ */
+static bool plan_select(const char *query, const PeekParams *params, ShardPlan *plan, char *error, size_t error_size) {
+    memset(plan, 0, sizeof(ShardPlan));
+    plan->limit = SIZE_MAX;
+
+    SqlToken token;
+    const char *p = query;
+    const char *order = NULL;
+    const char *limit = NULL;
+    size_t placeholders = 0, limit_placeholder = 0;
+    int depth = 0;
+    int subquery = 0; // Depth of the outermost subquery the scan is in, 0 outside them
+
+    //? Step 1: Find the outermost ORDER BY and LIMIT, counting the placeholders before the LIMIT
+    while ((p = sql_next_token(p, &token), token.kind != SQL_TOKEN_END)) {
+        if (sql_is_symbol(&token, '(')) {
+            depth++;
+        } else if (sql_is_symbol(&token, ')')) {
+            if (depth-- == subquery) {
+                subquery = 0;
+            }
+        } else if (depth > 0 && subquery == 0 && sql_is_keyword(&token, "SELECT")) {
+            subquery = depth;
+        } else if (subquery == 0 && (sql_is_keyword(&token, "DISTINCT") || sql_is_keyword(&token, "GROUP") ||
+                                     sql_is_keyword(&token, "HAVING") || is_aggregate(&token, p))) {
+            char name[32];
+            sql_token_name(&token, name, sizeof(name));
+            snprintf(error, error_size, "Cannot merge shards on %s%s: pin the shard key to run it on one shard", name,
+                     sql_is_keyword(&token, "GROUP") ? " BY" : is_aggregate(&token, p) ? "()" : "");
+            return false;
+        } else if (sql_is_symbol(&token, '?')) {
+            placeholders++;
+        } else if (depth == 0 && sql_is_keyword(&token, "ORDER")) {
+            SqlToken by;
+            const char *next = sql_next_token(p, &by);
+            if (sql_is_keyword(&by, "BY")) {
+                order = p = next;
+                limit = NULL;
+            }
+        } else if (depth == 0 && sql_is_keyword(&token, "LIMIT")) {
+            limit = token.start;
+            limit_placeholder = placeholders;
+        }
+    }
+
+    plan->order_count = 0;
+    if (order && !read_order(order, plan, error, error_size)) {
+        return false;
+    }
+    if (!limit) {
+        return true;
+    }
+
+    //? Step 2: Read the LIMIT clause
+    size_t placeholder = limit_placeholder, first = 0, second = 0;
+    p = sql_next_token(limit, &token); // LIMIT
+    p = sql_next_token(p, &token);
+    bool valid = read_limit_value(&token, params, &placeholder, &first);
+    const char *end = p;
+    plan->limit = first;
+
+    SqlToken separator;
+    const char *next = sql_next_token(p, &separator);
+    if (valid && (sql_is_symbol(&separator, ',') || sql_is_keyword(&separator, "OFFSET"))) {
+        end = sql_next_token(next, &token);
+        valid = read_limit_value(&token, params, &placeholder, &second);
+        plan->offset = sql_is_symbol(&separator, ',') ? first : second;
+        plan->limit = sql_is_symbol(&separator, ',') ? second : first;
+    }
+    if (!valid) {
+        snprintf(error, error_size, "Cannot fan out a LIMIT that is not a number");
+        return false;
+    }
+
+    //? Step 3: Every shard returns up to offset + limit rows, the offset applies to the merged rows
+    size_t prefix = (size_t)(limit - query);
+    size_t suffix = strlen(end);
+    size_t used = placeholder - limit_placeholder;
+    if (!(plan->query = (char *)malloc(prefix + sizeof("LIMIT ?") + suffix)) || !params_copy(params, &plan->params)) {
+        free(plan->query);
+        plan->query = NULL;
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+    memcpy(plan->query, query, prefix);
+    memcpy(plan->query + prefix, "LIMIT ?", 7);
+    memcpy(plan->query + prefix + 7, end, suffix + 1);
+
+    size_t rows = plan->limit > (size_t)LLONG_MAX - plan->offset ? (size_t)LLONG_MAX : plan->offset + plan->limit;
+    PeekParam widened = {.type = PARAM_INT, .int_value = (long long)rows};
+    if (used == 0) {
+        // Literal values: one placeholder more
+        PeekParam *items = (PeekParam *)realloc(plan->params.items, (plan->params.count + 1) * sizeof(PeekParam));
+        if (!items) {
+            snprintf(error, error_size, "Out of memory");
+            return false;
+        }
+        plan->params.items = items;
+        memmove(&items[limit_placeholder + 1], &items[limit_placeholder],
+                (plan->params.count - limit_placeholder) * sizeof(PeekParam));
+        plan->params.count++;
+    } else if (used == 2) {
+        // Placeholder values are integers, nothing to free
+        memmove(&plan->params.items[limit_placeholder + 1], &plan->params.items[limit_placeholder + 2],
+                (plan->params.count - limit_placeholder - 2) * sizeof(PeekParam));
+        plan->params.count--;
+    }
+    plan->params.items[limit_placeholder] = widened;
+    return true;
+}
+
+/** Match the ORDER BY of a plan to the columns of a result */
+static bool order_keys(const ShardPlan *plan, const PeekResult *result, ResultSortKey *keys, char *error, size_t error_size) {
+    for (int k = 0; k < plan->order_count; k++) {
+        const ShardOrder *order = &plan->order[k];
+        keys[k].descending = order->descending;
+        keys[k].column = result->num_fields;
+
+        if (order->position > 0) {
+            keys[k].column = order->position - 1;
+        } else {
+            for (unsigned int i = 0; i < result->num_fields; i++) {
+                if (strcasecmp(result->field_names[i], order->name) == 0) {
+                    keys[k].column = i;
+                    break;
+                }
+            }
+        }
+
+        if (keys[k].column >= result->num_fields) {
+            if (order->position > 0) {
+                snprintf(error, error_size, "Cannot merge shards on ORDER BY %u: there are %u columns", order->position,
+                         result->num_fields);
+            } else {
+                snprintf(error, error_size, "Cannot merge shards on ORDER BY %s: it is not a selected column", order->name);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool shard_select(ShardMap *map, const char *query, const PeekParams *params, PeekResult **result, char *error,
+                  size_t error_size) {
+    *result = NULL;
+
+    ShardPlan plan;
+    if (!plan_select(query, params, &plan, error, error_size)) {
+        free(plan.query);
+        params_free(&plan.params);
+        return false;
+    }
+
+    //? Step 1: Run the select on every shard
+    int count = map->shard_count;
+    ShardJob *jobs = run_on_shards(map, plan.query ? plan.query : query, plan.query ? &plan.params : params, true);
+    free(plan.query);
+    params_free(&plan.params);
+    if (!jobs) {
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+    if (!jobs_ok(jobs, count, error, error_size)) {
+        jobs_free(jobs, count);
+        return false;
+    }
+
+    //? Step 2: Merge the sorted shard results into the first one
+    ResultSortKey keys[SHARD_ORDER_LIMIT];
+    PeekResult *parts[SHARD_LIMIT];
+    bool ordered = order_keys(&plan, jobs[0].result, keys, error, error_size);
+    for (int i = 0; i < count; i++) {
+        parts[i] = jobs[i].result;
+        jobs[i].result = NULL;
+    }
+    jobs_free(jobs, count);
+
+    if (!ordered) {
+        for (int i = 0; i < count; i++) {
+            result_free(parts[i]);
+        }
+        return false;
+    }
+
+    *result = result_merge(parts, (size_t)count, keys, (size_t)plan.order_count, plan.offset, plan.limit, error, error_size);
+    return *result != NULL;
+}
+
+bool shard_write(ShardMap *map, const char *query, const PeekParams *params, my_ulonglong *affected_rows, char *error,
+                 size_t error_size) {
+    *affected_rows = 0;
+
+    ShardJob *jobs = run_on_shards(map, query, params, false);
+    if (!jobs) {
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+
+    for (int i = 0; i < map->shard_count; i++) {
+        *affected_rows += jobs[i].affected_rows;
+    }
+    bool ok = jobs_ok(jobs, map->shard_count, error, error_size);
+    jobs_free(jobs, map->shard_count);
+    return ok;
+}
@@ -0,0 +1,321 @@
+#include "../include/mysql_shared.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static SharedPool *registry = NULL; // Every shared pool some environment or running task holds
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static FakeDriverOptions fake_options_in_use; // Set while the fake driver is in use
+
+/** Free server configs copied with `server_configs_copy` */
+static void server_configs_free(const ReplicaConfig *configs, int count) {
+    for (int i = 0; configs && i < count; i++) {
+        free((char *)configs[i].host);
+        free((char *)configs[i].user);
+        free((char *)configs[i].password);
+        free((char *)configs[i].database);
+    }
+    free((ReplicaConfig *)configs);
+}
+
+/**
+ * Copy server configs, kept to compare the configs of environments joining later
+ * @param failed - Set when out of memory, left alone otherwise
+ * @return ReplicaConfig* - Copy, NULL without configs
+ */
+static ReplicaConfig *server_configs_copy(const ReplicaConfig *configs, int count, bool *failed) {
+    if (count <= 0) {
+        return NULL;
+    }
+
+    ReplicaConfig *copy = (ReplicaConfig *)calloc((size_t)count, sizeof(ReplicaConfig));
+    *failed |= copy == NULL;
+    for (int i = 0; copy && i < count; i++) {
+        copy[i].port = configs[i].port;
+        copy[i].host = configs[i].host ? strdup(configs[i].host) : NULL;
+        copy[i].user = configs[i].user ? strdup(configs[i].user) : NULL;
+        copy[i].password = configs[i].password ? strdup(configs[i].password) : NULL;
+        copy[i].database = configs[i].database ? strdup(configs[i].database) : NULL;
+        *failed |= (configs[i].host && !copy[i].host) || (configs[i].user && !copy[i].user) ||
+                   (configs[i].password && !copy[i].password) || (configs[i].database && !copy[i].database);
+    }
+    return copy;
+}
+
+/** Whether two optional strings are equal, NULL only equals NULL */
+static bool same_string(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/** Whether two lists of server configs are equal, in order */
+static bool same_servers(const ReplicaConfig *a, int a_count, const ReplicaConfig *b, int b_count) {
+    if (a_count != b_count) {
+        return false;
+    }
+    for (int i = 0; i < a_count; i++) {
+        if (a[i].port != b[i].port || !same_string(a[i].host, b[i].host) || !same_string(a[i].user, b[i].user) ||
+            !same_string(a[i].password, b[i].password) || !same_string(a[i].database, b[i].database)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * First option of a config that differs from the ones a shared pool was created with
+ * @return const char* - Name of the option, NULL when they are the same
+ */
+static const char *shared_pool_mismatch(const SharedPool *shared, const SharedPoolConfig *config) {
+    const SharedPoolConfig *own = &shared->config;
+    const PoolOptions *a = &own->pool_options, *b = &config->pool_options;
+    if (a->min_size != b->min_size) {
+        return "minPoolSize";
+    }
+    if (a->max_size != b->max_size) {
+        return "maxPoolSize";
+    }
+    if (a->acquire_timeout_ms != b->acquire_timeout_ms) {
+        return "acquireTimeout";
+    }
+    if (a->idle_timeout_ms != b->idle_timeout_ms) {
+        return "idleTimeout";
+    }
+    if (a->validate_after_ms != b->validate_after_ms) {
+        return "validateAfter";
+    }
+    if (a->health_check_interval_ms != b->health_check_interval_ms) {
+        return "healthCheckInterval";
+    }
+    if (a->stmt_cache_size != b->stmt_cache_size) {
+        return "statementCacheSize";
+    }
+    if (a->local_infile != b->local_infile) {
+        return "localInfile";
+    }
+    if (own->cache_size != config->cache_size) {
+        return "resultCacheSize";
+    }
+    if (own->cache_ttl_ms != config->cache_ttl_ms) {
+        return "resultCacheTtl";
+    }
+    if (!same_servers(own->replicas, own->replica_count, config->replicas, config->replica_count)) {
+        return "replicas";
+    }
+    if (own->read_your_writes_ms != config->read_your_writes_ms) {
+        return "readYourWrites";
+    }
+    if (own->replica_check_ms != config->replica_check_ms) {
+        return "replicaCheckInterval";
+    }
+    if (!same_servers(own->shards, own->shard_count, config->shards, config->shard_count)) {
+        return "shards";
+    }
+    if (own->slow_query_ms != config->slow_query_ms) {
+        return "slowQueryThreshold";
+    }
+    return NULL;
+}
+
+/** Destroy a shared pool, the advisor and the router before the pool they borrow from */
+static void shared_pool_free(SharedPool *shared) {
+    advisor_destroy(shared->advisor);
+    router_destroy(shared->router);
+    shard_map_destroy(shared->shards);
+    pool_destroy(shared->pool);
+    result_cache_destroy(shared->result_cache);
+    server_configs_free(shared->config.replicas, shared->config.replica_count);
+    server_configs_free(shared->config.shards, shared->config.shard_count);
+    free(shared->host);
+    free(shared->user);
+    free(shared->password);
+    free(shared->database);
+    free(shared);
+}
+
+/** Whether a shared pool serves the server and credentials of a config */
+static bool shared_pool_matches(const SharedPool *shared, const SharedPoolConfig *config) {
+    return shared->port == config->port && strcmp(shared->host, config->host) == 0 &&
+           strcmp(shared->user, config->user) == 0 && strcmp(shared->password, config->password) == 0 &&
+           strcmp(shared->database, config->database) == 0;
+}
+
+/**
+ * Create a shared pool: the primary pool, then what is built on it
+ * @return SharedPool* - Shared pool holding one reference, NULL with `error` set
+ */
+static SharedPool *shared_pool_create(const SharedPoolConfig *config, char *error, size_t error_size) {
+    SharedPool *shared = (SharedPool *)calloc(1, sizeof(SharedPool));
+    if (!shared) {
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    shared->host = strdup(config->host);
+    shared->user = strdup(config->user);
+    shared->password = strdup(config->password);
+    shared->database = strdup(config->database);
+    shared->port = config->port;
+    shared->environments = 1;
+    shared->refs = 1;
+
+    // The event loop pool is the environment's own, so is its option
+    bool failed = false;
+    shared->config = *config;
+    shared->config.host = shared->host;
+    shared->config.user = shared->user;
+    shared->config.password = shared->password;
+    shared->config.database = shared->database;
+    shared->config.pool_options.event_loop = false;
+    shared->config.replicas = server_configs_copy(config->replicas, config->replica_count, &failed);
+    shared->config.shards = server_configs_copy(config->shards, config->shard_count, &failed);
+    if (failed || !shared->host || !shared->user || !shared->password || !shared->database) {
+        shared_pool_free(shared);
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    //? Step 1: The primary, the replica pools reads are routed to, and the shard pools
+    shared->pool = pool_create(config->host, config->user, config->password, config->database, config->port,
+                               &config->pool_options);
+    if (!shared->pool) {
+        shared_pool_free(shared);
+        snprintf(error, error_size, "Failed to create connection pool");
+        return NULL;
+    }
+
+    if (config->replica_count > 0 &&
+        !(shared->router = router_create(config->replicas, config->replica_count, shared->pool,
+                                         config->read_your_writes_ms, config->replica_check_ms))) {
+        shared_pool_free(shared);
+        snprintf(error, error_size, "Failed to create replica pools");
+        return NULL;
+    }
+
+    // Sharded tables are declared later by the schemas, until then every table stays on the primary
+    if (config->shard_count > 0 && !(shared->shards = shard_map_create(config->shards, config->shard_count, shared->pool))) {
+        shared_pool_free(shared);
+        snprintf(error, error_size, "Failed to create shard pools");
+        return NULL;
+    }
+
+    //? Step 2: Slow selects are explained on the primary, whatever served them
+    if (config->slow_query_ms > 0 && !(shared->advisor = advisor_create(shared->pool, config->slow_query_ms))) {
+        shared_pool_free(shared);
+        snprintf(error, error_size, "Failed to create slow query advisor");
+        return NULL;
+    }
+
+    //? Step 3: Result cache, opt-in with resultCacheSize
+    if (config->cache_size > 0 &&
+        !(shared->result_cache = result_cache_create((size_t)config->cache_size, config->cache_ttl_ms))) {
+        shared_pool_free(shared);
+        snprintf(error, error_size, "Failed to create result cache");
+        return NULL;
+    }
+    return shared;
+}
+
+bool shared_pool_use_driver(const PeekDriver *driver, const FakeDriverOptions *fake_options, char *error, size_t error_size) {
+    pthread_mutex_lock(&registry_lock);
+    if (registry && driver != peek_driver) {
+        snprintf(error, error_size, "Cannot use the %s driver: another environment uses the %s driver", driver->name,
+                 peek_driver->name);
+        pthread_mutex_unlock(&registry_lock);
+        return false;
+    }
+
+    // The fake driver's data is process-wide too, it only changes with the driver
+    if (registry && driver == &fake_driver && memcmp(fake_options, &fake_options_in_use, sizeof(FakeDriverOptions)) != 0) {
+        snprintf(error, error_size, "Cannot change the fakeDriver options: another environment uses the fake driver");
+        pthread_mutex_unlock(&registry_lock);
+        return false;
+    }
+    if (!registry) {
+        peek_driver = driver;
+        if (driver == &fake_driver) {
+            fake_driver_configure(fake_options);
+            fake_options_in_use = *fake_options;
+        }
+    }
+
+    // Initialize the client library before any worker thread touches it, once at a time
+    bool failed = peek_driver->library_init(0, NULL, NULL) != 0;
+    pthread_mutex_unlock(&registry_lock);
+    if (failed) {
+        snprintf(error, error_size, "Failed to initialize MySQL client library");
+    }
+    return !failed;
+}
+
+SharedPool *shared_pool_acquire(const SharedPoolConfig *config, char *error, size_t error_size) {
+    pthread_mutex_lock(&registry_lock);
+    for (SharedPool *shared = registry; shared; shared = shared->next) {
+        // A pool no environment holds any more only waits for its running tasks
+        if (shared->environments == 0 || !shared_pool_matches(shared, config)) {
+            continue;
+        }
+
+        const char *option = shared_pool_mismatch(shared, config);
+        if (option) {
+            snprintf(error, error_size,
+                     "Cannot share the connection pool of %s:%d: another environment initialized it with another %s",
+                     config->host, config->port, option);
+            shared = NULL;
+        } else {
+            shared->environments++;
+            shared->refs++;
+        }
+        pthread_mutex_unlock(&registry_lock);
+        return shared;
+    }
+
+    // Created under the lock, so two environments initializing at once share one pool
+    SharedPool *shared = shared_pool_create(config, error, error_size);
+    if (shared) {
+        shared->next = registry;
+        registry = shared;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return shared;
+}
+
+void shared_pool_detach(SharedPool *shared) {
+    if (!shared) {
+        return;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    shared->environments--;
+    pthread_mutex_unlock(&registry_lock);
+    shared_pool_release(shared);
+}
+
+SharedPool *shared_pool_retain(SharedPool *shared) {
+    pthread_mutex_lock(&registry_lock);
+    shared->refs++;
+    pthread_mutex_unlock(&registry_lock);
+    return shared;
+}
+
+void shared_pool_release(SharedPool *shared) {
+    if (!shared) {
+        return;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    bool last = --shared->refs == 0;
+    if (last) {
+        for (SharedPool **link = &registry; *link; link = &(*link)->next) {
+            if (*link == shared) {
+                *link = shared->next;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (last) {
+        shared_pool_free(shared);
+    }
+}
@@ -0,0 +1,311 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_sql.h"
+#include "../include/mysql_params.h"
+#include <ctype.h>
+#include <math.h>
+#include <mysql.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+bool sql_reserve(SqlBuffer *sql, size_t extra) {
+    if (sql->length + extra + 1 <= sql->capacity) {
+        return true;
+    }
+
+    size_t capacity = sql->capacity ? sql->capacity : 4096;
+    while (capacity < sql->length + extra + 1) {
+        capacity *= 2;
+    }
+
+    char *data = (char *)realloc(sql->data, capacity);
+    if (!data) {
+        return false;
+    }
+
+    sql->data = data;
+    sql->capacity = capacity;
+    return true;
+}
+
+bool sql_append(SqlBuffer *sql, const char *text, size_t length) {
+    if (!sql_reserve(sql, length)) {
+        return false;
+    }
+    memcpy(sql->data + sql->length, text, length);
+    sql->length += length;
+    sql->data[sql->length] = '\0';
+    return true;
+}
+
+bool sql_append_identifier(SqlBuffer *sql, const char *name) {
+    size_t length = strlen(name);
+    if (!sql_reserve(sql, length * 2 + 2)) {
+        return false;
+    }
+
+    sql->data[sql->length++] = '`';
+    for (size_t i = 0; i < length; i++) {
+        if (name[i] == '`') {
+            sql->data[sql->length++] = '`';
+        }
+        sql->data[sql->length++] = name[i];
+    }
+    sql->data[sql->length++] = '`';
+    sql->data[sql->length] = '\0';
+    return true;
+}
+
+bool sql_append_value(SqlBuffer *sql, MYSQL *conn, const PeekParam *value, char *error, size_t error_size) {
+    char literal[64];
+    int length = 0;
+
+    switch (value->type) {
+    case PARAM_NULL:
+        return sql_append(sql, "NULL", 4);
+
+    case PARAM_INT:
+        length = snprintf(literal, sizeof(literal), "%lld", value->int_value);
+        return sql_append(sql, literal, (size_t)length);
+
+    case PARAM_DOUBLE:
+        if (!isfinite(value->double_value)) {
+            snprintf(error, error_size, "Cannot send a non-finite number");
+            return false;
+        }
+        length = snprintf(literal, sizeof(literal), "%.17g", value->double_value);
+        return sql_append(sql, literal, (size_t)length);
+
+    case PARAM_DATETIME: {
+        const MYSQL_TIME *time = &value->time_value;
+        length = snprintf(literal, sizeof(literal), "'%04u-%02u-%02u %02u:%02u:%02u.%06lu'", time->year, time->month,
+                          time->day, time->hour, time->minute, time->second, time->second_part);
+        return sql_append(sql, literal, (size_t)length);
+    }
+
+    case PARAM_STRING:
+        // Escaping at most doubles the length; the quote aware variant also honours NO_BACKSLASH_ESCAPES
+        if (!sql_reserve(sql, (size_t)value->length * 2 + 2)) {
+            break;
+        }
+        sql->data[sql->length++] = '\'';
+        sql->length += peek_driver->real_escape_string_quote(conn, sql->data + sql->length, value->data, value->length, '\'');
+        sql->data[sql->length++] = '\'';
+        sql->data[sql->length] = '\0';
+        return true;
+
+    case PARAM_BLOB: {
+        static const char hex[] = "0123456789ABCDEF";
+        if (!sql_reserve(sql, (size_t)value->length * 2 + 3)) {
+            break;
+        }
+        sql->data[sql->length++] = 'X';
+        sql->data[sql->length++] = '\'';
+        for (unsigned long i = 0; i < value->length; i++) {
+            unsigned char byte = (unsigned char)value->data[i];
+            sql->data[sql->length++] = hex[byte >> 4];
+            sql->data[sql->length++] = hex[byte & 0x0F];
+        }
+        sql->data[sql->length++] = '\'';
+        sql->data[sql->length] = '\0';
+        return true;
+    }
+    }
+
+    snprintf(error, error_size, "Out of memory");
+    return false;
+}
+
+/** Length of the quoted string, identifier or comment starting at `query[i]`, 0 if none starts there */
+static size_t skip_quoted(const char *query, size_t i, size_t length) {
+    char c = query[i];
+
+    if (c == '\'' || c == '"' || c == '`') {
+        size_t j = i + 1;
+        while (j < length) {
+            if (query[j] == '\\' && c != '`' && j + 1 < length) {
+                j += 2;
+            } else if (query[j] == c) {
+                // A doubled quote is an escaped quote
+                if (j + 1 < length && query[j + 1] == c) {
+                    j += 2;
+                } else {
+                    return j + 1 - i;
+                }
+            } else {
+                j++;
+            }
+        }
+        return length - i;
+    }
+
+    if (c == '#' || (c == '-' && i + 2 < length && query[i + 1] == '-' && isspace((unsigned char)query[i + 2]))) {
+        const char *end = memchr(query + i, '\n', length - i);
+        return end ? (size_t)(end - query) - i : length - i;
+    }
+
+    if (c == '/' && i + 1 < length && query[i + 1] == '*') {
+        const char *end = strstr(query + i + 2, "*/");
+        return end ? (size_t)(end - query) + 2 - i : length - i;
+    }
+
+    return 0;
+}
+
+bool sql_append_statement(SqlBuffer *sql, MYSQL *conn, const char *query, const PeekParams *params, char *error,
+                          size_t error_size) {
+    size_t length = strlen(query);
+    while (length > 0 && (query[length - 1] == ';' || isspace((unsigned char)query[length - 1]))) {
+        length--;
+    }
+
+    size_t param_count = params ? params->count : 0;
+    size_t used = 0, copied = 0;
+
+    for (size_t i = 0; i < length;) {
+        size_t skip = skip_quoted(query, i, length);
+        if (skip > 0) {
+            i += skip;
+            continue;
+        }
+        if (query[i] != '?') {
+            i++;
+            continue;
+        }
+
+        // Keep counting past the last value, so the mismatch error reports the real placeholder count
+        if (used < param_count) {
+            if (!sql_append(sql, query + copied, i - copied)) {
+                snprintf(error, error_size, "Out of memory");
+                return false;
+            }
+            if (!sql_append_value(sql, conn, &params->items[used], error, error_size)) {
+                return false;
+            }
+            copied = i + 1;
+        }
+        used++;
+        i++;
+    }
+
+    if (used != param_count) {
+        snprintf(error, error_size, "Expected %zu query parameters, got %zu", used, param_count);
+        return false;
+    }
+
+    if (!sql_append(sql, query + copied, length - copied)) {
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+    return true;
+}
+
+/** Skip whitespace and comments */
+static const char *skip_space(const char *p) {
+    for (;;) {
+        if (isspace((unsigned char)*p)) {
+            p++;
+        } else if (*p == '#' || (p[0] == '-' && p[1] == '-' && (p[2] == '\0' || isspace((unsigned char)p[2])))) {
+            while (*p && *p != '\n') {
+                p++;
+            }
+        } else if (p[0] == '/' && p[1] == '*') {
+            const char *end = strstr(p + 2, "*/");
+            p = end ? end + 2 : p + strlen(p);
+        } else {
+            return p;
+        }
+    }
+}
+
+const char *sql_next_token(const char *p, SqlToken *token) {
+    p = skip_space(p);
+    token->start = p;
+    char c = *p;
+
+    if (c == '\0') {
+        token->kind = SQL_TOKEN_END;
+    } else if (c == '`' || c == '\'' || c == '"') {
+        for (p++; *p; p++) {
+            if (*p == '\\' && c != '`' && p[1]) {
+                p++;
+            } else if (*p == c && p[1] == c) {
+                p++; // Doubled quote
+            } else if (*p == c) {
+                p++;
+                break;
+            }
+        }
+        token->kind = c == '`' ? SQL_TOKEN_IDENTIFIER : SQL_TOKEN_LITERAL;
+    } else if (isdigit((unsigned char)c) || (c == '.' && isdigit((unsigned char)p[1]))) {
+        while (isalnum((unsigned char)*p) || *p == '.' || *p == '_') {
+            p++;
+        }
+        token->kind = SQL_TOKEN_LITERAL;
+    } else if (isalpha((unsigned char)c) || c == '_' || c == '$' || (unsigned char)c >= 0x80) {
+        while (isalnum((unsigned char)*p) || *p == '_' || *p == '$' || (unsigned char)*p >= 0x80) {
+            p++;
+        }
+        token->kind = SQL_TOKEN_IDENTIFIER;
+    } else {
+        p++;
+        token->kind = SQL_TOKEN_SYMBOL;
+    }
+    token->length = (size_t)(p - token->start);
+    return p;
+}
+
+bool sql_is_symbol(const SqlToken *token, char symbol) {
+    return token->kind == SQL_TOKEN_SYMBOL && *token->start == symbol;
+}
+
+bool sql_is_keyword(const SqlToken *token, const char *keyword) {
+    return token->kind == SQL_TOKEN_IDENTIFIER && *token->start != '`' && strlen(keyword) == token->length &&
+           strncasecmp(token->start, keyword, token->length) == 0;
+}
+
+bool sql_single_statement(const char *query) {
+    SqlToken token;
+    const char *p = query;
+    bool ended = false;
+    while ((p = sql_next_token(p, &token), token.kind != SQL_TOKEN_END)) {
+        if (ended) {
+            return false;
+        }
+        ended = sql_is_symbol(&token, ';');
+    }
+    return true;
+}
+
+void sql_token_name(const SqlToken *token, char *name, size_t size) {
+    const char *start = token->start;
+    size_t length = token->length;
+    if (*start == '`') {
+        start++;
+        length = length >= 2 ? length - 2 : 0;
+    }
+    if (length >= size) {
+        length = size - 1;
+    }
+    memcpy(name, start, length);
+    name[length] = '\0';
+}
+
+void sql_free(SqlBuffer *sql) {
+    free(sql->data);
+    sql->data = NULL;
+    sql->length = sql->capacity = 0;
+}
+
+void sql_statements_free(SqlStatement *statements, size_t count) {
+    if (!statements) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        params_free(&statements[i].params);
+        free(statements[i].query);
+    }
+    free(statements);
+}
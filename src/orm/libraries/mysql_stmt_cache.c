@@ -0,0 +1,222 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_stmt_cache.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_util.h"
+#include <errmsg.h>
+#include <mysql.h>
+#include <mysqld_error.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Whether a failed statement cannot run again: the table changed under it, or its connection is gone
+ * @note Any other error, a duplicate key or a foreign key violation, leaves the statement ready for its next execute
+ */
+static bool statement_broken(MYSQL_STMT *stmt) {
+    unsigned int code = peek_driver->stmt_error_code(stmt);
+    return code == ER_NEED_REPREPARE || code == CR_SERVER_GONE_ERROR || code == CR_SERVER_LOST;
+}
+
+/** Unlink an entry from the LRU list */
+static void lru_unlink(StmtCache *cache, StmtCacheEntry *entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+    entry->prev = entry->next = NULL;
+}
+
+/** Link an entry as most recently used */
+static void lru_push_front(StmtCache *cache, StmtCacheEntry *entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) {
+        cache->head->prev = entry;
+    }
+    cache->head = entry;
+    if (!cache->tail) {
+        cache->tail = entry;
+    }
+}
+
+/** Remove an entry from the cache and close its statement */
+static void cache_remove(StmtCache *cache, StmtCacheEntry *entry) {
+    StmtCacheEntry **link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link && *link != entry) {
+        link = &(*link)->bucket;
+    }
+    if (*link) {
+        *link = entry->bucket;
+    }
+
+    lru_unlink(cache, entry);
+    peek_driver->stmt_close(entry->stmt);
+    free(entry->sql);
+    free(entry);
+    cache->size--;
+}
+
+/** Look up a statement, promoting it to most recently used */
+static StmtCacheEntry *cache_find(StmtCache *cache, const char *sql, size_t length, uint64_t hash) {
+    for (StmtCacheEntry *entry = cache->buckets[hash & (cache->bucket_count - 1)]; entry; entry = entry->bucket) {
+        if (entry->hash == hash && entry->sql_length == length && memcmp(entry->sql, sql, length) == 0) {
+            if (cache->head != entry) {
+                lru_unlink(cache, entry);
+                lru_push_front(cache, entry);
+            }
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/** Prepare a statement and insert it, evicting the least recently used one when full */
+static StmtCacheEntry *cache_prepare(StmtCache *cache, MYSQL *conn, const char *sql, size_t length, uint64_t hash, char *error, size_t error_size) {
+    MYSQL_STMT *stmt = peek_driver->stmt_init(conn);
+    if (!stmt) {
+        snprintf(error, error_size, "Statement initialization failed");
+        return NULL;
+    }
+
+    if (peek_driver->stmt_prepare(stmt, sql, length)) {
+        snprintf(error, error_size, "%s", peek_driver->stmt_error(stmt));
+        peek_driver->stmt_close(stmt);
+        return NULL;
+    }
+
+    StmtCacheEntry *entry = (StmtCacheEntry *)calloc(1, sizeof(StmtCacheEntry));
+    if (!entry || !(entry->sql = (char *)malloc(length + 1))) {
+        free(entry);
+        peek_driver->stmt_close(stmt);
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    memcpy(entry->sql, sql, length);
+    entry->sql[length] = '\0';
+    entry->sql_length = length;
+    entry->hash = hash;
+    entry->stmt = stmt;
+
+    if (cache->size >= cache->capacity && cache->tail) {
+        cache_remove(cache, cache->tail);
+    }
+
+    StmtCacheEntry **bucket = &cache->buckets[hash & (cache->bucket_count - 1)];
+    entry->bucket = *bucket;
+    *bucket = entry;
+    lru_push_front(cache, entry);
+    cache->size++;
+
+    return entry;
+}
+
+bool stmt_cache_init(StmtCache *cache, int capacity) {
+    memset(cache, 0, sizeof(StmtCache));
+    cache->capacity = capacity < 1 ? 1 : capacity;
+
+    // Power of two with a load factor of at most 0.5
+    cache->bucket_count = 2;
+    while (cache->bucket_count < (size_t)cache->capacity * 2) {
+        cache->bucket_count <<= 1;
+    }
+
+    cache->buckets = (StmtCacheEntry **)calloc(cache->bucket_count, sizeof(StmtCacheEntry *));
+    return cache->buckets != NULL;
+}
+
+MYSQL_STMT *stmt_cache_execute(StmtCache *cache, MYSQL *conn, const char *sql, PeekParams *params, char *error, size_t error_size) {
+    size_t length = strlen(sql);
+    uint64_t hash = util_hash(sql, length);
+    size_t param_count = params ? params->count : 0;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        StmtCacheEntry *entry = cache_find(cache, sql, length, hash);
+        if (!entry) {
+            entry = cache_prepare(cache, conn, sql, length, hash, error, error_size);
+            if (!entry) {
+                return NULL;
+            }
+        }
+
+        MYSQL_STMT *stmt = entry->stmt;
+
+        if (peek_driver->stmt_param_count(stmt) != param_count) {
+            snprintf(error, error_size, "Expected %lu query parameters, got %zu", peek_driver->stmt_param_count(stmt), param_count);
+            return NULL;
+        }
+
+        if (param_count > 0) {
+            MYSQL_BIND *bind = (MYSQL_BIND *)calloc(param_count, sizeof(MYSQL_BIND));
+            if (!bind) {
+                snprintf(error, error_size, "Out of memory");
+                return NULL;
+            }
+            params_bind(params, bind);
+            bool failed = peek_driver->stmt_bind_param(stmt, bind);
+            free(bind);
+            if (failed) {
+                snprintf(error, error_size, "%s", peek_driver->stmt_error(stmt));
+                if (statement_broken(stmt)) {
+                    cache_remove(cache, entry);
+                }
+                return NULL;
+            }
+        }
+
+        if (peek_driver->stmt_execute(stmt) == 0) {
+            return stmt;
+        }
+
+        unsigned int code = peek_driver->stmt_error_code(stmt);
+        snprintf(error, error_size, "%s", peek_driver->stmt_error(stmt));
+        if (!statement_broken(stmt)) {
+            break; // The statement is fine, the values were not: keep it cached
+        }
+        cache_remove(cache, entry);
+
+        // Table definition changed since the statement was prepared: prepare it again once
+        if (code != ER_NEED_REPREPARE) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+void stmt_cache_done(MYSQL_STMT *stmt) {
+    if (stmt) {
+        peek_driver->stmt_free_result(stmt);
+    }
+}
+
+void stmt_cache_clear(StmtCache *cache) {
+    StmtCacheEntry *entry = cache->head;
+    while (entry) {
+        StmtCacheEntry *next = entry->next;
+        peek_driver->stmt_close(entry->stmt);
+        free(entry->sql);
+        free(entry);
+        entry = next;
+    }
+
+    if (cache->buckets) {
+        memset(cache->buckets, 0, cache->bucket_count * sizeof(StmtCacheEntry *));
+    }
+    cache->head = cache->tail = NULL;
+    cache->size = 0;
+}
+
+void stmt_cache_destroy(StmtCache *cache) {
+    stmt_cache_clear(cache);
+    free(cache->buckets);
+    cache->buckets = NULL;
+}
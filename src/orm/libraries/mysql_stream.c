@@ -0,0 +1,137 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_stream.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_result.h"
+#include <mysql.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Prepare `sql` as a read-only cursor, bind `params` and execute it */
+static MYSQL_STMT *open_cursor(MYSQL *conn, const char *sql, PeekParams *params, size_t batch_size, char *error, size_t error_size) {
+    MYSQL_STMT *stmt = peek_driver->stmt_init(conn);
+    if (!stmt) {
+        snprintf(error, error_size, "Statement initialization failed");
+        return NULL;
+    }
+
+    //? Step 1: Ask for a server side cursor, so only one batch at a time crosses the wire
+    unsigned long cursor_type = CURSOR_TYPE_READ_ONLY;
+    unsigned long prefetch_rows = (unsigned long)batch_size;
+    peek_driver->stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursor_type);
+    peek_driver->stmt_attr_set(stmt, STMT_ATTR_PREFETCH_ROWS, &prefetch_rows);
+
+    //? Step 2: Prepare and bind the placeholder values
+    if (peek_driver->stmt_prepare(stmt, sql, strlen(sql))) {
+        goto fail;
+    }
+
+    size_t param_count = params ? params->count : 0;
+    if (peek_driver->stmt_param_count(stmt) != param_count) {
+        snprintf(error, error_size, "Expected %lu query parameters, got %zu", peek_driver->stmt_param_count(stmt), param_count);
+        peek_driver->stmt_close(stmt);
+        return NULL;
+    }
+
+    if (param_count > 0) {
+        MYSQL_BIND *bind = (MYSQL_BIND *)calloc(param_count, sizeof(MYSQL_BIND));
+        if (!bind) {
+            snprintf(error, error_size, "Out of memory");
+            peek_driver->stmt_close(stmt);
+            return NULL;
+        }
+        params_bind(params, bind);
+        bool failed = peek_driver->stmt_bind_param(stmt, bind);
+        free(bind);
+        if (failed) {
+            goto fail;
+        }
+    }
+
+    //? Step 3: Execute, rows stay on the server until fetched
+    if (peek_driver->stmt_execute(stmt)) {
+        goto fail;
+    }
+
+    return stmt;
+
+fail:
+    snprintf(error, error_size, "%s", peek_driver->stmt_error(stmt));
+    peek_driver->stmt_close(stmt);
+    return NULL;
+}
+
+PeekStream *stream_open(ConnectionPool *pool, const char *sql, PeekParams *params, size_t batch_size, char *error, size_t error_size) {
+    PeekStream *stream = (PeekStream *)calloc(1, sizeof(PeekStream));
+    if (!stream) {
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    stream->pool = pool;
+    stream->batch_size = batch_size > 0 ? batch_size : DEFAULT_STREAM_BATCH_SIZE;
+
+    stream->pooled = pool_get_connection(pool);
+    if (!stream->pooled) {
+        snprintf(error, error_size, "Failed to get database connection");
+        free(stream);
+        return NULL;
+    }
+
+    // The cursor needs its own statement: cached statements are shared and have no cursor attributes
+    stream->stmt = open_cursor(stream->pooled->connection, sql, params, stream->batch_size, error, error_size);
+    if (stream->stmt) {
+        stream->reader = result_reader_create(stream->stmt, &stream->pooled->scratch, false, error, error_size);
+    }
+
+    if (!stream->reader) {
+        stream_free(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+PeekResult *stream_fetch(PeekStream *stream, char *error, size_t error_size) {
+    if (!stream->reader) {
+        snprintf(error, error_size, "Stream is closed");
+        return NULL;
+    }
+
+    PeekResult *result = result_reader_fetch(stream->reader, stream->batch_size, error, error_size);
+
+    // Hand the connection back as early as possible
+    if (!result || result_reader_done(stream->reader)) {
+        stream_release(stream);
+    }
+
+    return result;
+}
+
+void stream_release(PeekStream *stream) {
+    if (stream->reader) {
+        result_reader_free(stream->reader);
+        stream->reader = NULL;
+    }
+
+    if (stream->stmt) {
+        peek_driver->stmt_close(stream->stmt);
+        stream->stmt = NULL;
+    }
+
+    if (stream->pooled) {
+        pool_return_connection(stream->pool, stream->pooled);
+        stream->pooled = NULL;
+    }
+}
+
+void stream_free(PeekStream *stream) {
+    if (!stream) {
+        return;
+    }
+
+    stream_release(stream);
+    free(stream);
+}
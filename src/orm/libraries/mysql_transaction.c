@@ -0,0 +1,215 @@
+#include "../include/mysql_driver.h"
+#include "../include/mysql_transaction.h"
+#include "../include/mysql_params.h"
+#include "../include/mysql_pool.h"
+#include "../include/mysql_result.h"
+#include "../include/mysql_sql.h"
+#include "../include/mysql_stmt_cache.h"
+#include <errmsg.h>
+#include <mysql.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Whether an error means the connection itself is gone, taking the transaction with it */
+static bool connection_lost(MYSQL *conn) {
+    unsigned int code = peek_driver->error_code(conn);
+    return code == CR_SERVER_GONE_ERROR || code == CR_SERVER_LOST;
+}
+
+/** Stop pinning the connection: return it, or close it when its state is unknown */
+static void finish(PeekTransaction *tx, bool discard) {
+    if (tx->pooled) {
+        if (discard) {
+            pool_discard_connection(tx->pool, tx->pooled);
+        } else {
+            pool_return_connection(tx->pool, tx->pooled);
+        }
+        tx->pooled = NULL;
+    }
+    tx->finished = true;
+}
+
+PeekTransaction *transaction_begin(ConnectionPool *pool, char *error, size_t error_size) {
+    PeekTransaction *tx = (PeekTransaction *)calloc(1, sizeof(PeekTransaction));
+    if (!tx) {
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    tx->pool = pool;
+    tx->pooled = pool_get_connection(pool);
+    if (!tx->pooled) {
+        snprintf(error, error_size, "Failed to get database connection");
+        free(tx);
+        return NULL;
+    }
+
+    return tx;
+}
+
+bool transaction_execute(PeekTransaction *tx, const SqlStatement *statements, size_t count, TxEnd end,
+                         TxStatementResult *results, char *error, size_t error_size) {
+    if (tx->finished) {
+        // Rolling back a transaction that is already over is a no-op, anything else is a mistake
+        if (count == 0 && end == TX_END_ROLLBACK) {
+            return true;
+        }
+        snprintf(error, error_size, "Transaction is already finished");
+        return false;
+    }
+
+    // Nothing was ever sent: there is no transaction to end on the server
+    if (count == 0 && !tx->begun) {
+        if (end != TX_END_NONE) {
+            finish(tx, false);
+        }
+        return true;
+    }
+    if (count == 0 && end == TX_END_NONE) {
+        return true;
+    }
+
+    // Joined with the others, a query holding several statements would shift every result after it
+    for (size_t i = 0; i < count; i++) {
+        if (!sql_single_statement(statements[i].query)) {
+            snprintf(error, error_size, "Expected one statement per query, query %zu of %zu holds several", i + 1,
+                     count);
+            return false;
+        }
+    }
+
+    MYSQL *conn = tx->pooled->connection;
+
+    //? Step 1: Join the batch into one multi-statement
+    SqlBuffer sql = {0};
+    size_t leading = tx->begun ? 0 : 1;
+    bool ok = leading == 0 || sql_append(&sql, "START TRANSACTION", 17);
+
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = (sql.length == 0 || sql_append(&sql, ";", 1)) &&
+             sql_append_statement(&sql, conn, statements[i].query, &statements[i].params, error, error_size);
+    }
+
+    if (ok && end != TX_END_NONE) {
+        const char *tail = end == TX_END_COMMIT ? ";COMMIT" : ";ROLLBACK";
+        ok = sql_append(&sql, tail, strlen(tail));
+    }
+
+    if (!ok) {
+        if (error[0] == '\0') {
+            snprintf(error, error_size, "Out of memory");
+        }
+        sql_free(&sql);
+        return false;
+    }
+
+    // Only the pinned connection takes several statements per query, returning it turns them off
+    if (!pool_enable_multi_statements(tx->pooled)) {
+        snprintf(error, error_size, "Failed to enable multi statements: %s", peek_driver->error(conn));
+        sql_free(&sql);
+        if (connection_lost(conn)) {
+            finish(tx, true);
+        }
+        return false;
+    }
+
+    //? Step 2: Send it in one round trip and walk the result of every statement
+    int status = peek_driver->real_query(conn, sql.data, (unsigned long)sql.length);
+    sql_free(&sql);
+
+    size_t index = 0;
+    while (status == 0) {
+        // Selects queued as writes still produce a result set, which must be consumed
+        MYSQL_RES *res = peek_driver->store_result(conn);
+        if (res) {
+            peek_driver->free_result(res);
+        }
+
+        if (index == 0 && leading) {
+            tx->begun = true;
+        } else if (index - leading < count) {
+            results[index - leading].affected_rows = peek_driver->affected_rows(conn);
+            results[index - leading].insert_id = peek_driver->insert_id(conn);
+        }
+
+        index++;
+        status = peek_driver->next_result(conn);
+    }
+
+    //? Step 3: -1 means every statement ran, anything else is the error of statement `index`
+    if (status == -1) {
+        if (end != TX_END_NONE) {
+            finish(tx, false);
+        }
+        return true;
+    }
+
+    // The statements after the failing one never ran, make sure none left a result behind on the pinned connection
+    pool_drain_results(conn);
+
+    bool end_failed = index >= leading + count;
+    if (index < leading) {
+        snprintf(error, error_size, "START TRANSACTION failed: %s", peek_driver->error(conn));
+    } else if (!end_failed) {
+        snprintf(error, error_size, "Statement %zu of %zu failed: %s", index - leading + 1, count, peek_driver->error(conn));
+    } else {
+        snprintf(error, error_size, "%s failed: %s", end == TX_END_COMMIT ? "COMMIT" : "ROLLBACK", peek_driver->error(conn));
+    }
+
+    // A failed COMMIT or ROLLBACK leaves the server side state unknown, never hand that connection out again
+    if (connection_lost(conn) || end_failed) {
+        finish(tx, true);
+    }
+    return false;
+}
+
+PeekResult *transaction_select(PeekTransaction *tx, const char *query, PeekParams *params, char *error, size_t error_size) {
+    if (tx->finished) {
+        snprintf(error, error_size, "Transaction is already finished");
+        return NULL;
+    }
+
+    PoolConnection *pooled = tx->pooled;
+
+    // A read before any write opens the transaction on its own
+    if (!tx->begun) {
+        if (peek_driver->query(pooled->connection, "START TRANSACTION")) {
+            snprintf(error, error_size, "START TRANSACTION failed: %s", peek_driver->error(pooled->connection));
+            if (connection_lost(pooled->connection)) {
+                finish(tx, true);
+            }
+            return NULL;
+        }
+        tx->begun = true;
+    }
+
+    MYSQL_STMT *stmt = stmt_cache_execute(&pooled->stmt_cache, pooled->connection, query, params, error, error_size);
+    if (!stmt) {
+        if (connection_lost(pooled->connection)) {
+            finish(tx, true);
+        }
+        return NULL;
+    }
+
+    PeekResult *result = result_from_stmt(stmt, &pooled->scratch, error, error_size);
+    stmt_cache_done(stmt);
+    return result;
+}
+
+void transaction_release(PeekTransaction *tx) {
+    if (!tx || tx->finished) {
+        return;
+    }
+
+    bool discard = tx->begun && peek_driver->query(tx->pooled->connection, "ROLLBACK") != 0;
+    finish(tx, discard);
+}
+
+void transaction_free(PeekTransaction *tx) {
+    if (tx) {
+        transaction_release(tx);
+        free(tx);
+    }
+}
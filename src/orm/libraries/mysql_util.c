@@ -0,0 +1,32 @@
+#include "../include/mysql_util.h"
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define FNV_OFFSET_BASIS 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+uint64_t util_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+uint64_t util_hash(const char *data, size_t length) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t util_hash_folded(const char *data, size_t length) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)tolower((unsigned char)data[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
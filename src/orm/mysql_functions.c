@@ -4,6 +4,15 @@
 /** Init MySQL functions */
 void InitMySQLFunctions(napi_env env, napi_value exports) {
     napi_value connectFn, closeFn, createTableFn, selectFn, initializeFn, cleanupFn, insertFn, updateFn, deleteFn, createIndexFn, bulkInsertFn, createTriggerFn;
+    napi_value selectStreamFn, streamNextFn, streamCloseFn, bulkInsertRowsFn;
+    napi_value loadDataFn, loadWriteFn, loadEndFn, loadAbortFn;
+    napi_value transactionBeginFn, transactionExecuteFn, transactionSelectFn, batchQueryFn;
+    napi_value syncSchemaFn;
+    napi_value resultCacheStatsFn, resultCacheClearFn, replicaStatusFn, statsFn, prometheusMetricsFn;
+    napi_value slowQueryReportFn, slowQueryResetFn, declareIndexesFn, fingerprintFn;
+    napi_value declareShardKeysFn, shardOfFn;
+
+    InitMySQLInstance(env);
 
     napi_create_function(env, NULL, 0, ConnectMySQL, NULL, &connectFn);
     napi_set_named_property(env, exports, "connectMySQL", connectFn);
@@ -40,4 +49,76 @@ void InitMySQLFunctions(napi_env env, napi_value exports) {
 
     napi_create_function(env, NULL, 0, CreateTrigger, NULL, &createTriggerFn);
     napi_set_named_property(env, exports, "createTrigger", createTriggerFn);
+
+    napi_create_function(env, NULL, 0, SelectStream, NULL, &selectStreamFn);
+    napi_set_named_property(env, exports, "selectStream", selectStreamFn);
+
+    napi_create_function(env, NULL, 0, StreamNext, NULL, &streamNextFn);
+    napi_set_named_property(env, exports, "streamNext", streamNextFn);
+
+    napi_create_function(env, NULL, 0, StreamClose, NULL, &streamCloseFn);
+    napi_set_named_property(env, exports, "streamClose", streamCloseFn);
+
+    napi_create_function(env, NULL, 0, BulkInsertRows, NULL, &bulkInsertRowsFn);
+    napi_set_named_property(env, exports, "bulkInsertRows", bulkInsertRowsFn);
+
+    napi_create_function(env, NULL, 0, LoadData, NULL, &loadDataFn);
+    napi_set_named_property(env, exports, "loadData", loadDataFn);
+
+    napi_create_function(env, NULL, 0, LoadWrite, NULL, &loadWriteFn);
+    napi_set_named_property(env, exports, "loadWrite", loadWriteFn);
+
+    napi_create_function(env, NULL, 0, LoadEnd, NULL, &loadEndFn);
+    napi_set_named_property(env, exports, "loadEnd", loadEndFn);
+
+    napi_create_function(env, NULL, 0, LoadAbort, NULL, &loadAbortFn);
+    napi_set_named_property(env, exports, "loadAbort", loadAbortFn);
+
+    napi_create_function(env, NULL, 0, TransactionBegin, NULL, &transactionBeginFn);
+    napi_set_named_property(env, exports, "transactionBegin", transactionBeginFn);
+
+    napi_create_function(env, NULL, 0, TransactionExecute, NULL, &transactionExecuteFn);
+    napi_set_named_property(env, exports, "transactionExecute", transactionExecuteFn);
+
+    napi_create_function(env, NULL, 0, TransactionSelect, NULL, &transactionSelectFn);
+    napi_set_named_property(env, exports, "transactionSelect", transactionSelectFn);
+
+    napi_create_function(env, NULL, 0, BatchQuery, NULL, &batchQueryFn);
+    napi_set_named_property(env, exports, "batchQuery", batchQueryFn);
+
+    napi_create_function(env, NULL, 0, SyncSchema, NULL, &syncSchemaFn);
+    napi_set_named_property(env, exports, "syncSchema", syncSchemaFn);
+
+    napi_create_function(env, NULL, 0, GetResultCacheStats, NULL, &resultCacheStatsFn);
+    napi_set_named_property(env, exports, "resultCacheStats", resultCacheStatsFn);
+
+    napi_create_function(env, NULL, 0, ClearResultCache, NULL, &resultCacheClearFn);
+    napi_set_named_property(env, exports, "resultCacheClear", resultCacheClearFn);
+
+    napi_create_function(env, NULL, 0, GetReplicaStatus, NULL, &replicaStatusFn);
+    napi_set_named_property(env, exports, "replicaStatus", replicaStatusFn);
+
+    napi_create_function(env, NULL, 0, GetStats, NULL, &statsFn);
+    napi_set_named_property(env, exports, "stats", statsFn);
+
+    napi_create_function(env, NULL, 0, GetPrometheusMetrics, NULL, &prometheusMetricsFn);
+    napi_set_named_property(env, exports, "prometheusMetrics", prometheusMetricsFn);
+
+    napi_create_function(env, NULL, 0, GetSlowQueryReport, NULL, &slowQueryReportFn);
+    napi_set_named_property(env, exports, "slowQueryReport", slowQueryReportFn);
+
+    napi_create_function(env, NULL, 0, ResetSlowQueries, NULL, &slowQueryResetFn);
+    napi_set_named_property(env, exports, "slowQueryReset", slowQueryResetFn);
+
+    napi_create_function(env, NULL, 0, DeclareIndexes, NULL, &declareIndexesFn);
+    napi_set_named_property(env, exports, "declareIndexes", declareIndexesFn);
+
+    napi_create_function(env, NULL, 0, Fingerprint, NULL, &fingerprintFn);
+    napi_set_named_property(env, exports, "fingerprint", fingerprintFn);
+
+    napi_create_function(env, NULL, 0, DeclareShardKeys, NULL, &declareShardKeysFn);
+    napi_set_named_property(env, exports, "declareShardKeys", declareShardKeysFn);
+
+    napi_create_function(env, NULL, 0, ShardOf, NULL, &shardOfFn);
+    napi_set_named_property(env, exports, "shardOf", shardOfFn);
 }